@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <kernel/thread.h>
+#include <kernel/smp.h>
 #include <arch/ops.h>
 
 #include <dev/flash.h>
@@ -54,12 +55,14 @@
 #include <crypto_hash.h>
 #include <malloc.h>
 #include <boot_stats.h>
+#include <init_graph.h>
 #include <sha.h>
 #include <platform/iomap.h>
 #include <boot_device.h>
 #include <boot_verifier.h>
 #include <image_verify.h>
 #include <decompress.h>
+#include <decompressor.h>
 #include <platform/timer.h>
 #include <sys/types.h>
 #if USE_RPMB_FOR_DEVINFO
@@ -240,6 +243,9 @@ struct verified_boot_state_name vbsn[] =
 #endif
 /*As per spec delay wait time before shutdown in Red state*/
 #define DELAY_WAIT 30000
+
+/* Read size used when the boot image is hashed while it loads */
+#define BOOT_HASH_CHUNK_SIZE (1024 * 1024)
 static unsigned page_size = BOARD_KERNEL_PAGESIZE;
 
 uint32_t kernel_hdr_page_size()
@@ -375,6 +381,48 @@ extern int emmc_recovery_init(void);
 extern int fastboot_trigger(void);
 #endif
 
+#if DISPLAY_SPLASH_SCREEN
+/* Splash screen bring-up runs next to the boot image loading. Anything
+ * that draws on, queries or turns off the display waits for it first.
+ */
+static int aboot_display_init(void *arg)
+{
+	dprintf(SPEW, "Display Init: Start\n");
+#if DISPLAY_HDMI_PRIMARY
+	if (!strlen(device.display_panel))
+		strlcpy(device.display_panel, DISPLAY_PANEL_HDMI,
+			sizeof(device.display_panel));
+#endif
+#if ENABLE_WBC
+	/* Wait if the display shutdown is in progress */
+	while(pm_app_display_shutdown_in_prgs());
+	if (!pm_appsbl_display_init_done())
+		target_display_init(device.display_panel);
+	else
+		display_image_on_screen();
+#else
+	target_display_init(device.display_panel);
+#endif
+	dprintf(SPEW, "Display Init: Done\n");
+
+	return 0;
+}
+
+static struct init_task display_task = {
+	.name = "display_init",
+	.run = aboot_display_init,
+};
+static bool display_task_started;
+#endif
+
+static void aboot_display_wait(void)
+{
+#if DISPLAY_SPLASH_SCREEN
+	if (display_task_started)
+		init_task_wait(&display_task);
+#endif
+}
+
 static void update_ker_tags_rdisk_addr(boot_img_hdr *hdr, bool is_arm64)
 {
 	/* overwrite the destination of specified for the project */
@@ -487,6 +535,10 @@ unsigned char *update_cmdline(const char * cmdline)
 	char resume_buf[resume_buflen];
 	int swap_ptn_index = INVALID_PTN;
 #endif
+#if BOOT_TRACE_CMDLINE
+	char boot_trace_buf[BS_TRACE_CMDLINE_LEN];
+	unsigned boot_trace_len;
+#endif
 
 #if VERIFIED_BOOT
 	uint32_t boot_state = RED;
@@ -748,6 +800,11 @@ unsigned char *update_cmdline(const char * cmdline)
 	}
 #endif
 
+#if BOOT_TRACE_CMDLINE
+	boot_trace_len = bs_trace_summary(boot_trace_buf, sizeof(boot_trace_buf));
+	cmdline_len += boot_trace_len;
+#endif
+
 	if (cmdline_len > 0) {
 		const char *src;
 		unsigned char *dst;
@@ -1033,6 +1090,14 @@ unsigned char *update_cmdline(const char * cmdline)
 			while ((*dst++ = *src++));
 		}
 #endif
+
+#if BOOT_TRACE_CMDLINE
+		if (boot_trace_len) {
+			src = boot_trace_buf;
+			--dst;
+			while ((*dst++ = *src++));
+		}
+#endif
 	}
 
 
@@ -1158,6 +1223,9 @@ void boot_linux(void *kernel, unsigned *tags,
 
 	ramdisk = (void *)PA((addr_t)ramdisk);
 
+	/* Join point for the parallel init, the panel node and menus need it */
+	aboot_display_wait();
+
 	final_cmdline = update_cmdline((const char*)cmdline);
 
 #if DEVICE_TREE
@@ -1213,6 +1281,15 @@ void boot_linux(void *kernel, unsigned *tags,
 	target_display_shutdown();
 #endif
 
+	/* Park the secondary cpus, the kernel brings them up itself. One
+	 * that is still running would be racing the kernel, so don't boot.
+	 */
+	if (smp_stop())
+	{
+		dprintf(CRITICAL, "ERROR: Secondary cpus did not power down\n");
+		ASSERT(0);
+	}
+
 	/* Perform target specific cleanup */
 	target_uninit();
 	free_verified_boot_resource(&info);
@@ -1323,6 +1400,9 @@ static void verify_signed_bootimg(uint32_t bootimg_addr, uint32_t bootimg_size)
 #endif
 #endif
 
+	/* Authentication failures and mdtp may put up a menu */
+	aboot_display_wait();
+
 	/* Assume device is rooted at this time. */
 	device.is_tampered = 1;
 
@@ -1502,9 +1582,118 @@ void get_recovery_dtbo_info(uint32_t *dtbo_size, void **dtbo_buf)
 	return;
 }
 
+/* Gzip kernel inflated while the boot image loads, see boot_image_chunk_loaded() */
+static struct gunzip_stream *kernel_gunzip;
+static unsigned char *kernel_gunzip_in;
+
+static void kernel_gunzip_abort()
+{
+	if (kernel_gunzip)
+		decompress_stream_end(kernel_gunzip, NULL, NULL);
+
+	kernel_gunzip = NULL;
+}
+
+/* zlib only gets to see images nobody is going to authenticate, the others
+ * are inflated once they have been verified.
+ */
+static bool kernel_gunzip_allowed()
+{
+#if VERIFIED_BOOT_2
+	return device.is_unlocked;
+#else
+	return !((target_use_signed_kernel() && !device.is_unlocked) ||
+		is_test_mode_enabled());
+#endif
+}
+
+/* A chunk of the boot image has landed: feed it to the stream hash armed
+ * with hash_stream_begin() and to the kernel inflate, if any.
+ */
+static void boot_image_chunk_loaded(unsigned char *buf, uint32_t len)
+{
+	uint32_t loaded;
+
+	hash_stream_update(buf, len);
+
+	if (!kernel_gunzip)
+		return;
+
+	loaded = buf + len - kernel_gunzip_in;
+
+	/* Not a gzip kernel or a bad one, leave it to the decompress() after
+	 * authentication, which also reports the error.
+	 */
+	if (!is_gzip_package(kernel_gunzip_in, loaded) ||
+		decompress_stream_update(kernel_gunzip, loaded))
+		kernel_gunzip_abort();
+}
+
+/* Reads len bytes of the image in chunks, handing each one to
+ * boot_image_chunk_loaded(). The read of the next chunk is queued before
+ * the current one is processed, so storage DMA, the crypto engine and the
+ * CPU all work at the same time.
+ */
+static int mmc_read_boot_image(uint64_t data_addr, unsigned char *out, uint32_t len)
+{
+#if MMC_SDHCI_SUPPORT
+	struct mmc_request req[2];
+	uint32_t chunk[2];
+	uint32_t cur = 0;
+
+	if (!len)
+		return 0;
+
+	chunk[cur] = MIN(len, BOOT_HASH_CHUNK_SIZE);
+	mmc_submit_read(&req[cur], data_addr, out, chunk[cur]);
+
+	while (len)
+	{
+		/* Only req[cur] is in flight here, so nothing is left to drain */
+		if (mmc_wait(&req[cur]))
+			return -1;
+
+		data_addr += chunk[cur];
+		len -= chunk[cur];
+
+		if (len)
+		{
+			chunk[!cur] = MIN(len, BOOT_HASH_CHUNK_SIZE);
+			mmc_submit_read(&req[!cur], data_addr, out + chunk[cur], chunk[!cur]);
+		}
+
+		boot_image_chunk_loaded(out, chunk[cur]);
+
+		out += chunk[cur];
+		cur = !cur;
+	}
+
+	return 0;
+#else
+	uint32_t chunk;
+
+	while (len)
+	{
+		chunk = MIN(len, BOOT_HASH_CHUNK_SIZE);
+
+		if (mmc_read(data_addr, (uint32_t *)out, chunk))
+			return -1;
+
+		boot_image_chunk_loaded(out, chunk);
+
+		data_addr += chunk;
+		out += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+#endif
+}
+
 int boot_linux_from_mmc(void)
 {
 	boot_img_hdr *hdr = (void*) buf;
+	struct bs_trace trace;
 	boot_img_hdr *uhdr;
 	unsigned offset = 0;
 	int rcode;
@@ -1525,9 +1714,13 @@ int boot_linux_from_mmc(void)
 	unsigned int out_avai_len = 0;
 	unsigned char *out_addr = NULL;
 	uint32_t dtb_offset = 0;
+	int kernel_gunzip_rc = -1;
 	unsigned char *kernel_start_addr = NULL;
 	unsigned int kernel_size = 0;
 	unsigned int patched_kernel_hdr_size = 0;
+#if !VERIFIED_BOOT_2
+	bool hash_while_loading = false;
+#endif
 	uint64_t image_size = 0;
 	int rc;
 #if VERIFIED_BOOT_2
@@ -1779,14 +1972,69 @@ int boot_linux_from_mmc(void)
 		dprintf(CRITICAL, "booimage  size is greater than DDR can hold\n");
 		return -1;
 	}
+#if !VERIFIED_BOOT_2
+	/* The image is going to be hashed below, either to authenticate it or
+	 * to hand its digest to TZ. Hash it as it comes off the card instead.
+	 */
+	if((target_use_signed_kernel() && (!device.is_unlocked)) || is_test_mode_enabled())
+		hash_while_loading = true;
+#ifdef TZ_SAVE_KERNEL_HASH
+	else
+	{
+		target_crypto_init_params();
+		hash_while_loading = true;
+	}
+#endif /* TZ_SAVE_KERNEL_HASH */
+
+	if (hash_while_loading)
+	{
+#if IMAGE_VERIF_ALGO_SHA1 && !VERIFIED_BOOT
+		hash_stream_begin(image_addr, CRYPTO_AUTH_ALG_SHA1);
+#else
+		hash_stream_begin(image_addr, CRYPTO_AUTH_ALG_SHA256);
+#endif
+		hash_stream_update(image_addr, page_size);
+	}
+#endif
+
+	/* If the kernel is gzipped and the image is not authenticated, inflate
+	 * it while the rest of the image loads. It goes where the decompress()
+	 * below would put it, leaving room for the dtbo that is loaded at the
+	 * end of the scratch region.
+	 */
+	kernel_gunzip_abort();
+	if (hdr->kernel_size && kernel_gunzip_allowed())
+	{
+		out_avai_len = target_get_max_flash_size() - imagesize_actual - page_size;
+#if VERIFIED_BOOT_2
+		out_avai_len -= MIN(out_avai_len, DTBO_IMG_BUF);
+#endif
+		kernel_gunzip_in = image_addr + page_size;
+		kernel_gunzip = decompress_stream_begin(kernel_gunzip_in,
+				image_addr + imagesize_actual + page_size, out_avai_len);
+	}
+
 	offset = page_size;
 	/* Read image without signature and header*/
-	if (mmc_read(ptn + offset, (void *)(image_addr + offset), imagesize_actual - page_size))
+	rcode = mmc_read_boot_image(ptn + offset, image_addr + offset, imagesize_actual - page_size);
+	if (rcode)
 	{
 		dprintf(CRITICAL, "ERROR: Cannot read boot image\n");
+		hash_stream_abort();
+		kernel_gunzip_abort();
 		return -1;
 	}
 
+	/* All input is in, collect the result now so that none of the early
+	 * returns below has to end the stream.
+	 */
+	if (kernel_gunzip)
+	{
+		kernel_gunzip_rc = decompress_stream_end(kernel_gunzip,
+				&dtb_offset, &out_len);
+		kernel_gunzip = NULL;
+	}
+
 	if (partition_multislot_is_supported())
 	{
 		dprintf(INFO, "Loading boot image (%d) active_slot(%s): done\n",
@@ -1859,6 +2107,7 @@ int boot_linux_from_mmc(void)
 	info.multi_slot_boot = partition_multislot_is_supported();
 	info.bootreason_alarm = boot_reason_alarm;
 	info.bootinto_recovery = boot_into_recovery;
+	aboot_display_wait();
 	status = load_image_and_auth(&info);
 	if(status)
 		return -1;
@@ -1888,6 +2137,7 @@ int boot_linux_from_mmc(void)
 		if(mmc_read(ptn + offset, (void *)(image_addr + offset), page_size))
 		{
 			dprintf(CRITICAL, "ERROR: Cannot read boot image signature\n");
+			hash_stream_abort();
 			return -1;
 		}
 
@@ -1914,16 +2164,21 @@ int boot_linux_from_mmc(void)
 			ext_partition.image_addr = (uint32)image_addr;
 			ext_partition.image_size = imagesize_actual;
 			ext_partition.sig_avail = FALSE;
+			aboot_display_wait();
 			mdtp_fwlock_verify_lock(&ext_partition);
 		}
 #endif /* MDTP_SUPPORT */
 	}
+
+	/* Drop whatever was not consumed by the checks above */
+	hash_stream_abort();
 #endif
 
 #if VERIFIED_BOOT
 	if((boot_verify_get_state() == ORANGE) && (!boot_into_ffbm))
 	{
 #if FBCON_DISPLAY_MSG
+		aboot_display_wait();
 		display_bootverify_menu(DISPLAY_MENU_ORANGE);
 		wait_for_users_action();
 #else
@@ -1945,10 +2200,10 @@ int boot_linux_from_mmc(void)
 	}
 #endif
 	/*
-	 * Check if the kernel image is a gzip package. If yes, need to decompress it.
-	 * If not, continue booting.
+	 * Check if the kernel image is a compressed (gzip, lz4 or zstd) package.
+	 * If yes, need to decompress it. If not, continue booting.
 	 */
-	if (is_gzip_package((unsigned char *)(image_addr + page_size), hdr->kernel_size))
+	if (is_compressed_package((unsigned char *)(image_addr + page_size), hdr->kernel_size))
 	{
 		out_addr = (unsigned char *)(image_addr + imagesize_actual + page_size);
 		out_avai_len = target_get_max_flash_size() - imagesize_actual - page_size;
@@ -1957,15 +2212,20 @@ int boot_linux_from_mmc(void)
 			out_avai_len -= DTBO_IMG_BUF;
 #endif
 		dprintf(INFO, "decompressing kernel image: start\n");
-		rc = decompress((unsigned char *)(image_addr + page_size),
-				hdr->kernel_size, out_addr, out_avai_len,
-				&dtb_offset, &out_len);
+		bs_trace_begin(&trace, "decompress");
+		/* Inflated while loading, unless the stream ran short */
+		rc = kernel_gunzip_rc;
+		if (rc)
+			rc = decompress_package((unsigned char *)(image_addr + page_size),
+					hdr->kernel_size, out_addr, out_avai_len,
+					&dtb_offset, &out_len);
 		if (rc)
 		{
 			dprintf(CRITICAL, "decompressing kernel image failed!!!\n");
 			ASSERT(0);
 		}
 
+		bs_trace_end(&trace);
 		dprintf(INFO, "decompressing kernel image: done\n");
 		kptr = (struct kernel64_hdr *)out_addr;
 		kernel_start_addr = out_addr;
@@ -2067,13 +2327,14 @@ int boot_linux_from_mmc(void)
 			return -1;
 		}
 
-		if (is_gzip_package((unsigned char *)dt_table_offset + dt_entry.offset, dt_entry.size))
+		if (is_compressed_package((unsigned char *)dt_table_offset + dt_entry.offset, dt_entry.size))
 		{
 			unsigned int compressed_size = 0;
 			out_addr += out_len;
 			out_avai_len -= out_len;
 			dprintf(INFO, "decompressing dtb: start\n");
-			rc = decompress((unsigned char *)dt_table_offset + dt_entry.offset,
+			bs_trace_begin(&trace, "decompress");
+			rc = decompress_package((unsigned char *)dt_table_offset + dt_entry.offset,
 					dt_entry.size, out_addr, out_avai_len,
 					&compressed_size, &dtb_size);
 			if (rc)
@@ -2082,6 +2343,7 @@ int boot_linux_from_mmc(void)
 				ASSERT(0);
 			}
 
+			bs_trace_end(&trace);
 			dprintf(INFO, "decompressing dtb: done\n");
 			best_match_dt_addr = out_addr;
 		} else {
@@ -2951,160 +3213,429 @@ static bool critical_flash_allowed(const char * entry)
 }
 
 #if DEVICE_TREE
-int copy_dtb(uint8_t *boot_image_start, unsigned int scratch_offset)
+/* Copy the best matching dtb of the dt.img at table to tags_addr */
+static int copy_dtb_table(boot_img_hdr *hdr, struct dt_table *table,
+			  unsigned int scratch_offset)
 {
-	uint32 dt_image_offset = 0;
-	uint32_t n;
-	struct dt_table *table = NULL;
 	struct dt_entry dt_entry;
 	uint32_t dt_hdr_size = 0;
 	unsigned int compressed_size = 0;
 	unsigned int dtb_size = 0;
 	unsigned int out_avai_len = 0;
 	unsigned char *out_addr = NULL;
+	struct bs_trace trace;
 	unsigned char *best_match_dt_addr = NULL;
 	int rc;
 
-	boot_img_hdr *hdr = (boot_img_hdr *) (boot_image_start);
-
-#ifndef OSVERSION_IN_BOOTIMAGE
-	dt_size = hdr->dt_size;
-#endif
-
-	if(dt_size != 0) {
-		/* add kernel offset */
-		dt_image_offset += page_size;
-		n = ROUND_TO_PAGE(hdr->kernel_size, page_mask);
-		dt_image_offset += n;
-
-		/* add ramdisk offset */
-		n = ROUND_TO_PAGE(hdr->ramdisk_size, page_mask);
-		dt_image_offset += n;
-
-		/* add second offset */
-		if(hdr->second_size != 0) {
-			n = ROUND_TO_PAGE(hdr->second_size, page_mask);
-			dt_image_offset += n;
-		}
-
-		/* offset now point to start of dt.img */
-		table = (struct dt_table*)(boot_image_start + dt_image_offset);
-
-		if (dev_tree_validate(table, hdr->page_size, &dt_hdr_size) != 0) {
-			dprintf(CRITICAL, "ERROR: Cannot validate Device Tree Table \n");
-			return -1;
-		}
-
-		/* Its Error if, dt_hdr_size (table->num_entries * dt_entry size + Dev_Tree Header)
-		goes beyound hdr->dt_size*/
-		if (dt_hdr_size > ROUND_TO_PAGE(dt_size,hdr->page_size)) {
-			dprintf(CRITICAL, "ERROR: Invalid Device Tree size \n");
-			return -1;
-		}
+	if (dev_tree_validate(table, hdr->page_size, &dt_hdr_size) != 0) {
+		dprintf(CRITICAL, "ERROR: Cannot validate Device Tree Table \n");
+		return -1;
+	}
 
-		/* Find index of device tree within device tree table */
-		if(dev_tree_get_entry_info(table, &dt_entry) != 0){
-			dprintf(CRITICAL, "ERROR: Getting device tree address failed\n");
-			return -1;
-		}
+	/* Its Error if, dt_hdr_size (table->num_entries * dt_entry size + Dev_Tree Header)
+	goes beyound hdr->dt_size*/
+	if (dt_hdr_size > ROUND_TO_PAGE(dt_size,hdr->page_size)) {
+		dprintf(CRITICAL, "ERROR: Invalid Device Tree size \n");
+		return -1;
+	}
 
-		best_match_dt_addr = (unsigned char *)boot_image_start + dt_image_offset + dt_entry.offset;
-		if (is_gzip_package(best_match_dt_addr, dt_entry.size))
-		{
-			out_addr = (unsigned char *)target_get_scratch_address() + scratch_offset;
-			out_avai_len = target_get_max_flash_size() - scratch_offset;
-			dprintf(INFO, "decompressing dtb: start\n");
-			rc = decompress(best_match_dt_addr,
-					dt_entry.size, out_addr, out_avai_len,
-					&compressed_size, &dtb_size);
-			if (rc)
-			{
-				dprintf(CRITICAL, "decompressing dtb failed!!!\n");
-				ASSERT(0);
-			}
+	/* Find index of device tree within device tree table */
+	if(dev_tree_get_entry_info(table, &dt_entry) != 0){
+		dprintf(CRITICAL, "ERROR: Getting device tree address failed\n");
+		return -1;
+	}
 
-			dprintf(INFO, "decompressing dtb: done\n");
-			best_match_dt_addr = out_addr;
-		} else {
-			dtb_size = dt_entry.size;
-		}
-		/* Validate and Read device device tree in the "tags_add */
-		if (check_aboot_addr_range_overlap(hdr->tags_addr, dtb_size) ||
-			check_ddr_addr_range_bound(hdr->tags_addr, dtb_size))
+	best_match_dt_addr = (unsigned char *)table + dt_entry.offset;
+	if (is_compressed_package(best_match_dt_addr, dt_entry.size))
+	{
+		out_addr = (unsigned char *)target_get_scratch_address() + scratch_offset;
+		out_avai_len = target_get_max_flash_size() - scratch_offset;
+		dprintf(INFO, "decompressing dtb: start\n");
+		bs_trace_begin(&trace, "decompress");
+		rc = decompress_package(best_match_dt_addr,
+				dt_entry.size, out_addr, out_avai_len,
+				&compressed_size, &dtb_size);
+		if (rc)
 		{
-			dprintf(CRITICAL, "Device tree addresses are not valid.\n");
-			return -1;
+			dprintf(CRITICAL, "decompressing dtb failed!!!\n");
+			ASSERT(0);
 		}
 
-		/* Read device device tree in the "tags_add */
-		memmove((void*) hdr->tags_addr, (void *)best_match_dt_addr, dtb_size);
-	} else
+		bs_trace_end(&trace);
+		dprintf(INFO, "decompressing dtb: done\n");
+		best_match_dt_addr = out_addr;
+	} else {
+		dtb_size = dt_entry.size;
+	}
+	/* Validate and Read device device tree in the "tags_add */
+	if (check_aboot_addr_range_overlap(hdr->tags_addr, dtb_size) ||
+		check_ddr_addr_range_bound(hdr->tags_addr, dtb_size))
+	{
+		dprintf(CRITICAL, "Device tree addresses are not valid.\n");
 		return -1;
+	}
+
+	/* Read device device tree in the "tags_add */
+	memmove((void*) hdr->tags_addr, (void *)best_match_dt_addr, dtb_size);
 
 	/* Everything looks fine. Return success. */
 	return 0;
 }
-#endif
 
-void cmd_boot(const char *arg, void *data, unsigned sz)
+int copy_dtb(uint8_t *boot_image_start, unsigned int scratch_offset)
 {
-	unsigned kernel_actual;
-	unsigned ramdisk_actual;
-	unsigned second_actual;
-	uint32_t image_actual;
-	uint32_t dt_actual = 0;
-	boot_img_hdr *hdr = NULL;
-	struct kernel64_hdr *kptr = NULL;
-	char *ptr = ((char*) data);
-	int ret = 0;
-	uint8_t dtb_copied = 0;
-	unsigned int out_len = 0;
-	unsigned int out_avai_len = 0;
-	unsigned char *out_addr = NULL;
-	uint32_t dtb_offset = 0;
-	unsigned char *kernel_start_addr = NULL;
-	unsigned int kernel_size = 0;
-	unsigned int scratch_offset = 0;
-#if VERIFIED_BOOT_2
-	void *dtbo_image_buf = NULL;
-	uint32_t dtbo_image_sz = 0;
-	void *vbmeta_image_buf = NULL;
-	uint32_t vbmeta_image_sz = 0;
-#endif
-#if !VERIFIED_BOOT_2
-	uint32_t sig_actual = 0;
-	uint32_t sig_size = 0;
-#ifdef MDTP_SUPPORT
-        static bool is_mdtp_activated = 0;
-#endif /* MDTP_SUPPORT */
-#endif
+	uint32 dt_image_offset = 0;
+	uint32_t n;
+	struct dt_table *table = NULL;
 
-#if FBCON_DISPLAY_MSG
-	/* Exit keys' detection thread firstly */
-	exit_menu_keys_detection();
-#endif
+	boot_img_hdr *hdr = (boot_img_hdr *) (boot_image_start);
 
-#if VERIFIED_BOOT || VERIFIED_BOOT_2
-	if(target_build_variant_user() && !device.is_unlocked)
-	{
-		fastboot_fail("unlock device to use this command");
-		goto boot_failed;
-	}
+#ifndef OSVERSION_IN_BOOTIMAGE
+	dt_size = hdr->dt_size;
 #endif
 
-	if (sz < sizeof(hdr)) {
-		fastboot_fail("invalid bootimage header");
-		goto boot_failed;
-	}
+	if(dt_size == 0)
+		return -1;
 
-	hdr = (boot_img_hdr *)data;
+	/* add kernel offset */
+	dt_image_offset += page_size;
+	n = ROUND_TO_PAGE(hdr->kernel_size, page_mask);
+	dt_image_offset += n;
 
-	/* ensure commandline is terminated */
-	hdr->cmdline[BOOT_ARGS_SIZE-1] = 0;
+	/* add ramdisk offset */
+	n = ROUND_TO_PAGE(hdr->ramdisk_size, page_mask);
+	dt_image_offset += n;
 
-	if(target_is_emmc_boot() && hdr->page_size) {
-		page_size = hdr->page_size;
-		page_mask = page_size - 1;
+	/* add second offset */
+	if(hdr->second_size != 0) {
+		n = ROUND_TO_PAGE(hdr->second_size, page_mask);
+		dt_image_offset += n;
+	}
+
+	/* offset now point to start of dt.img */
+	table = (struct dt_table*)(boot_image_start + dt_image_offset);
+
+	return copy_dtb_table(hdr, table, scratch_offset);
+}
+#endif
+
+/*
+ * Direct boot: with "oem boot-direct" armed, a downloaded boot image is
+ * scattered while it arrives. The kernel and ramdisk are received at their
+ * load addresses; the header page, second stage, dt and any trailer are
+ * packed behind each other in the download buffer. cmd_boot then boots it
+ * without copying, and the download buffer only needs room for the packed
+ * part. A compressed kernel is staged as well and decompressed as before.
+ */
+
+/* The smallest page size, it always holds the whole header */
+#define BOOT_DIRECT_HDR_SIZE	2048
+
+struct boot_direct {
+	/* the sink is installed */
+	bool armed;
+	/* a complete image was received, its kernel and ramdisk are placed */
+	bool loaded;
+	uint8_t *base;
+	unsigned max;
+	unsigned total;
+	/* copy of the header, load addresses are worked out in it */
+	boot_img_hdr hdr;
+	/* image layout, 0 until the header was received */
+	unsigned page;
+	unsigned kernel_end;
+	unsigned ramdisk_end;
+	/* kernel bytes staged before its load address is known */
+	unsigned kernel_head;
+	bool placed;
+	bool kernel_staged;
+	addr_t kernel_addr;
+	addr_t ramdisk_addr;
+	/* download buffer offset of the data following the ramdisk */
+	unsigned tail;
+	/* download buffer bytes in use */
+	unsigned staged;
+};
+
+static struct boot_direct boot_direct;
+
+static bool boot_direct_allowed(void)
+{
+#if VERIFIED_BOOT || VERIFIED_BOOT_2
+	/* Never dma unverified data to the load addresses of a locked device */
+	if (!device.is_unlocked)
+		return false;
+#endif
+#if VERIFIED_BOOT_2
+	/* avb hashes the boot image as one contiguous buffer */
+	return false;
+#else
+	/* and so does signed kernel verification */
+	return !(target_use_signed_kernel() && !device.is_unlocked);
+#endif
+}
+
+static int boot_direct_parse_hdr(struct boot_direct *bd)
+{
+	boot_img_hdr *hdr = (boot_img_hdr *) bd->base;
+	unsigned page = page_size;
+	uint64_t ramdisk_end;
+
+	if (memcmp(hdr->magic, BOOT_MAGIC, BOOT_MAGIC_SIZE)) {
+		dprintf(CRITICAL, "boot direct: not a boot image\n");
+		return -1;
+	}
+
+	if (target_is_emmc_boot() && hdr->page_size)
+		page = hdr->page_size;
+	if (page < BOOT_DIRECT_HDR_SIZE || page > BOOT_IMG_MAX_PAGE_SIZE ||
+	    (page & (page - 1))) {
+		dprintf(CRITICAL, "boot direct: invalid page size %u\n", page);
+		return -1;
+	}
+
+	if (!hdr->kernel_size) {
+		dprintf(CRITICAL, "boot direct: image has no kernel\n");
+		return -1;
+	}
+
+	ramdisk_end = (uint64_t) page + ROUND_TO_PAGE(hdr->kernel_size, page - 1) +
+		      ROUND_TO_PAGE(hdr->ramdisk_size, page - 1);
+	if (ramdisk_end > bd->total) {
+		dprintf(CRITICAL, "boot direct: bootimage header fields are invalid\n");
+		return -1;
+	}
+
+	memcpy(&bd->hdr, hdr, sizeof(bd->hdr));
+	bd->kernel_end = page + ROUND_TO_PAGE(hdr->kernel_size, page - 1);
+	bd->ramdisk_end = ramdisk_end;
+	bd->page = page;
+	return 0;
+}
+
+static int boot_direct_check_range(struct boot_direct *bd, addr_t addr,
+				   unsigned size)
+{
+	addr_t base = (addr_t) bd->base;
+
+	if (!size)
+		return 0;
+
+	if (check_aboot_addr_range_overlap(addr, size) ||
+	    check_ddr_addr_range_bound(addr, size) ||
+	    (addr % CACHE_LINE) ||
+	    (addr < base + bd->max && addr + size > base)) {
+		dprintf(CRITICAL, "boot direct: load address 0x%lx is not valid\n",
+			(unsigned long) addr);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Called once the first kernel page was staged: picks the load addresses
+ * the way cmd_boot does and moves that page to the kernel load address.
+ */
+static int boot_direct_place(struct boot_direct *bd)
+{
+	uint8_t *kernel = bd->base + bd->page;
+	struct kernel64_hdr *kptr = (struct kernel64_hdr *) kernel;
+
+	update_ker_tags_rdisk_addr(&bd->hdr, IS_ARM64(kptr));
+	bd->kernel_addr = VA(bd->hdr.kernel_addr);
+	bd->ramdisk_addr = VA(bd->hdr.ramdisk_addr);
+
+	if (boot_direct_check_range(bd, bd->ramdisk_addr,
+				    bd->ramdisk_end - bd->kernel_end))
+		return -1;
+
+	bd->kernel_staged = is_compressed_package(kernel, bd->kernel_head);
+	if (bd->kernel_staged) {
+		bd->tail = bd->kernel_end;
+	} else {
+		if (boot_direct_check_range(bd, bd->kernel_addr,
+					    bd->kernel_end - bd->page))
+			return -1;
+		memcpy((void *) bd->kernel_addr, kernel, bd->kernel_head);
+		bd->tail = bd->page + bd->kernel_head;
+	}
+
+	bd->placed = true;
+	return 0;
+}
+
+static int boot_direct_start(void *cookie, void *base, unsigned max,
+			     unsigned total)
+{
+	struct boot_direct *bd = cookie;
+
+	if (total < BOOT_DIRECT_HDR_SIZE || max < BOOT_DIRECT_HDR_SIZE) {
+		dprintf(CRITICAL, "boot direct: image too small\n");
+		return -1;
+	}
+
+	bd->loaded = false;
+	bd->base = base;
+	bd->max = max;
+	bd->total = total;
+	bd->page = 0;
+	bd->kernel_head = 0;
+	bd->placed = false;
+	bd->kernel_staged = false;
+	bd->tail = 0;
+	bd->staged = 0;
+	return 0;
+}
+
+static int boot_direct_map(void *cookie, unsigned offset, void **dest,
+			   unsigned *len)
+{
+	struct boot_direct *bd = cookie;
+	unsigned at;
+
+	if (offset && !bd->page && boot_direct_parse_hdr(bd))
+		return -1;
+
+	if (!offset) {
+		at = 0;
+		*len = BOOT_DIRECT_HDR_SIZE;
+	} else if (offset < bd->page) {
+		/* Rest of a larger header page */
+		at = offset;
+		*len = bd->page - offset;
+	} else if (offset == bd->page) {
+		/* First kernel page, it tells where the kernel goes */
+		at = offset;
+		*len = MIN(bd->page, bd->kernel_end - offset);
+		bd->kernel_head = *len;
+	} else {
+		if (!bd->placed && boot_direct_place(bd))
+			return -1;
+
+		if (offset < bd->kernel_end && !bd->kernel_staged) {
+			*dest = (void *) (bd->kernel_addr + offset - bd->page);
+			*len = bd->kernel_end - offset;
+			return 0;
+		} else if (offset < bd->kernel_end) {
+			at = offset;
+			*len = bd->kernel_end - offset;
+		} else if (offset < bd->ramdisk_end) {
+			*dest = (void *) (bd->ramdisk_addr + offset - bd->kernel_end);
+			*len = bd->ramdisk_end - offset;
+			return 0;
+		} else {
+			at = bd->tail + offset - bd->ramdisk_end;
+			*len = bd->total - offset;
+		}
+	}
+
+	if (at > bd->max || *len > bd->max - at) {
+		dprintf(CRITICAL, "boot direct: staged data exceeds download buffer\n");
+		return -1;
+	}
+
+	bd->staged = MAX(bd->staged, at + *len);
+	*dest = bd->base + at;
+	return 0;
+}
+
+static int boot_direct_finish(void *cookie)
+{
+	struct boot_direct *bd = cookie;
+
+	if (!bd->page && boot_direct_parse_hdr(bd))
+		return -1;
+
+	if (!bd->placed && boot_direct_place(bd))
+		return -1;
+
+	bd->loaded = true;
+	return 0;
+}
+
+static struct fastboot_scatter_sink boot_direct_sink = {
+	.start  = boot_direct_start,
+	.map    = boot_direct_map,
+	.finish = boot_direct_finish,
+	.cookie = &boot_direct,
+};
+
+void cmd_boot(const char *arg, void *data, unsigned sz)
+{
+	unsigned kernel_actual;
+	struct bs_trace trace;
+	unsigned ramdisk_actual;
+	unsigned second_actual;
+	uint32_t image_actual;
+	uint32_t dt_actual = 0;
+	boot_img_hdr *hdr = NULL;
+	struct kernel64_hdr *kptr = NULL;
+	char *ptr = ((char*) data);
+	int ret = 0;
+	uint8_t dtb_copied = 0;
+	unsigned int out_len = 0;
+	unsigned int out_avai_len = 0;
+	unsigned char *out_addr = NULL;
+	uint32_t dtb_offset = 0;
+	unsigned char *kernel_start_addr = NULL;
+	unsigned int kernel_size = 0;
+	unsigned int scratch_offset = 0;
+	unsigned int staged_actual = 0;
+	bool direct = false;
+	bool kernel_placed = false;
+#if VERIFIED_BOOT_2
+	void *dtbo_image_buf = NULL;
+	uint32_t dtbo_image_sz = 0;
+	void *vbmeta_image_buf = NULL;
+	uint32_t vbmeta_image_sz = 0;
+#endif
+#if !VERIFIED_BOOT_2
+	uint32_t sig_actual = 0;
+	uint32_t sig_size = 0;
+#ifdef MDTP_SUPPORT
+        static bool is_mdtp_activated = 0;
+#endif /* MDTP_SUPPORT */
+#endif
+
+#if FBCON_DISPLAY_MSG
+	/* Exit keys' detection thread firstly */
+	exit_menu_keys_detection();
+#endif
+
+#if VERIFIED_BOOT || VERIFIED_BOOT_2
+	if(target_build_variant_user() && !device.is_unlocked)
+	{
+		fastboot_fail("unlock device to use this command");
+		goto boot_failed;
+	}
+#endif
+
+	/* A boot direct download is good for one boot attempt */
+	if (boot_direct.loaded) {
+		boot_direct.loaded = false;
+		if (!boot_direct_allowed()) {
+			fastboot_fail("boot direct is not allowed");
+			goto boot_failed;
+		}
+		direct = true;
+		kernel_placed = !boot_direct.kernel_staged;
+		sz = boot_direct.total;
+	}
+
+	if (sz < sizeof(hdr)) {
+		fastboot_fail("invalid bootimage header");
+		goto boot_failed;
+	}
+
+	hdr = (boot_img_hdr *)data;
+
+	/* ensure commandline is terminated */
+	hdr->cmdline[BOOT_ARGS_SIZE-1] = 0;
+
+	if(target_is_emmc_boot() && hdr->page_size) {
+		page_size = hdr->page_size;
+		page_mask = page_size - 1;
 	}
 
 	kernel_actual = ROUND_TO_PAGE(hdr->kernel_size, page_mask);
@@ -3128,6 +3659,9 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 		goto boot_failed;
 	}
 
+	/* Download buffer bytes holding the image */
+	staged_actual = direct ? boot_direct.staged : image_actual;
+
 #if VERIFIED_BOOT_2
 	/* Pass size of boot partition, as imgsize, to avoid
 	read fewer bytes error */
@@ -3195,7 +3729,7 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 	/* Handle overflow if the input image size is greater than
 	 * boot image buffer can hold
 	 */
-	if ((target_get_max_flash_size() - page_size) < image_actual)
+	if ((target_get_max_flash_size() - page_size) < staged_actual)
 	{
 		fastboot_fail("booimage: size is greater than boot image buffer can hold");
 		goto boot_failed;
@@ -3246,20 +3780,21 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 	}
 #endif
 	/*
-	 * Check if the kernel image is a gzip package. If yes, need to decompress it.
-	 * If not, continue booting.
+	 * Check if the kernel image is a compressed (gzip, lz4 or zstd) package.
+	 * If yes, need to decompress it. If not, continue booting.
 	 */
-	if (is_gzip_package((unsigned char *)(data + page_size), hdr->kernel_size))
+	if (is_compressed_package((unsigned char *)(data + page_size), hdr->kernel_size))
 	{
 		out_addr = (unsigned char *)target_get_scratch_address();
-		out_addr = (unsigned char *)(out_addr + image_actual + page_size);
-		out_avai_len = target_get_max_flash_size() - image_actual - page_size;
+		out_addr = (unsigned char *)(out_addr + staged_actual + page_size);
+		out_avai_len = target_get_max_flash_size() - staged_actual - page_size;
 #if VERIFIED_BOOT_2
 		if (dtbo_image_sz)
 			out_avai_len -= DTBO_IMG_BUF;
 #endif
 		dprintf(INFO, "decompressing kernel image: start\n");
-		ret = decompress((unsigned char *)(ptr + page_size),
+		bs_trace_begin(&trace, "decompress");
+		ret = decompress_package((unsigned char *)(ptr + page_size),
 				hdr->kernel_size, out_addr, out_avai_len,
 				&dtb_offset, &out_len);
 		if (ret)
@@ -3268,6 +3803,7 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 			ASSERT(0);
 		}
 
+		bs_trace_end(&trace);
 		dprintf(INFO, "decompressing kernel image: done\n");
 		kptr = (struct kernel64_hdr *)out_addr;
 		kernel_start_addr = out_addr;
@@ -3302,9 +3838,15 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 	}
 
 #if DEVICE_TREE
-	scratch_offset = image_actual + page_size + out_len;
+	scratch_offset = staged_actual + page_size + out_len;
 	/* find correct dtb and copy it to right location */
-	ret = copy_dtb(data, scratch_offset);
+	if (!direct)
+		ret = copy_dtb(data, scratch_offset);
+	else if (dt_size)
+		ret = copy_dtb_table(hdr, (struct dt_table *)(ptr + boot_direct.tail +
+				     second_actual), scratch_offset);
+	else
+		ret = -1;
 
 	dtb_copied = !ret ? 1 : 0;
 #else
@@ -3316,9 +3858,11 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 	}
 #endif
 
-	/* Load ramdisk & kernel */
-	memmove((void*) hdr->ramdisk_addr, ptr + page_size + kernel_actual, hdr->ramdisk_size);
-	memmove((void*) hdr->kernel_addr, (char*) (kernel_start_addr), kernel_size);
+	/* Load ramdisk & kernel, unless boot direct received them in place */
+	if (!direct)
+		memmove((void*) hdr->ramdisk_addr, ptr + page_size + kernel_actual, hdr->ramdisk_size);
+	if (!kernel_placed)
+		memmove((void*) hdr->kernel_addr, (char*) (kernel_start_addr), kernel_size);
 
 #if DEVICE_TREE
 	if (check_aboot_addr_range_overlap(hdr->tags_addr, kernel_actual) ||
@@ -3336,7 +3880,8 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 	 */
 	if (!dtb_copied) {
 		void *dtb;
-		dtb = dev_tree_appended((void*)(ptr + page_size),
+		dtb = dev_tree_appended(kernel_placed ? (void*) hdr->kernel_addr :
+					(void*)(ptr + page_size),
 					hdr->kernel_size, dtb_offset,
 					(void *)hdr->tags_addr);
 		if (!dtb) {
@@ -4054,145 +4599,747 @@ void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 			data += (uint32_t)chunk_data_sz;
 			break;
 
-			case CHUNK_TYPE_FILL:
-			if(chunk_header->total_sz != (sparse_header->chunk_hdr_sz +
-											sizeof(uint32_t)))
-			{
-				fastboot_fail("Bogus chunk size for chunk type FILL");
-				return;
-			}
+			case CHUNK_TYPE_FILL:
+			if(chunk_header->total_sz != (sparse_header->chunk_hdr_sz +
+											sizeof(uint32_t)))
+			{
+				fastboot_fail("Bogus chunk size for chunk type FILL");
+				return;
+			}
+
+			blk_sz_actual = ROUNDUP(sparse_header->blk_sz, CACHE_LINE);
+			/* Integer overflow detected */
+			if (blk_sz_actual < sparse_header->blk_sz)
+			{
+				fastboot_fail("Invalid block size");
+				return;
+			}
+
+			fill_buf = (uint32_t *)memalign(CACHE_LINE, blk_sz_actual);
+			if (!fill_buf)
+			{
+				fastboot_fail("Malloc failed for: CHUNK_TYPE_FILL");
+				return;
+			}
+
+			if (data_end < (uintptr_t)data + sizeof(uint32_t)) {
+				fastboot_fail("buffer overreads occured due to invalid sparse header");
+				free(fill_buf);
+				return;
+			}
+			fill_val = *(uint32_t *)data;
+			data = (char *) data + sizeof(uint32_t);
+
+			for (i = 0; i < (sparse_header->blk_sz / sizeof(fill_val)); i++)
+			{
+				fill_buf[i] = fill_val;
+			}
+
+			if(total_blocks > (UINT_MAX - chunk_header->chunk_sz))
+			{
+				fastboot_fail("bogus size for chunk FILL type");
+				free(fill_buf);
+				return;
+			}
+
+			for (i = 0; i < chunk_header->chunk_sz; i++)
+			{
+				/* Make sure that the data written to partition does not exceed partition size */
+				if ((uint64_t)total_blocks * (uint64_t)sparse_header->blk_sz + sparse_header->blk_sz > size)
+				{
+					fastboot_fail("Chunk data size for fill type exceeds partition size");
+					free(fill_buf);
+					return;
+				}
+
+				if(mmc_write(ptn + ((uint64_t)total_blocks*sparse_header->blk_sz),
+							sparse_header->blk_sz,
+							fill_buf))
+				{
+					fastboot_fail("flash write failure");
+					free(fill_buf);
+					return;
+				}
+
+				total_blocks++;
+			}
+
+			free(fill_buf);
+			break;
+
+			case CHUNK_TYPE_DONT_CARE:
+			if(total_blocks > (UINT_MAX - chunk_header->chunk_sz)) {
+				fastboot_fail("bogus size for chunk DONT CARE type");
+				return;
+			}
+			total_blocks += chunk_header->chunk_sz;
+			break;
+
+			case CHUNK_TYPE_CRC:
+			if(chunk_header->total_sz != sparse_header->chunk_hdr_sz)
+			{
+				fastboot_fail("Bogus chunk size for chunk type CRC");
+				return;
+			}
+			if(total_blocks > (UINT_MAX - chunk_header->chunk_sz)) {
+				fastboot_fail("bogus size for chunk CRC type");
+				return;
+			}
+			total_blocks += chunk_header->chunk_sz;
+			if ((uintptr_t)data > UINT_MAX - chunk_data_sz) {
+				fastboot_fail("integer overflow occured");
+				return;
+			}
+			data += (uint32_t)chunk_data_sz;
+			if (data_end < (uintptr_t)data) {
+				fastboot_fail("buffer overreads occured due to invalid sparse header");
+				return;
+			}
+			break;
+
+			default:
+			dprintf(CRITICAL, "Unkown chunk type: %x\n",chunk_header->chunk_type);
+			fastboot_fail("Unknown chunk type");
+			return;
+		}
+	}
+
+	dprintf(INFO, "Wrote %d blocks, expected to write %d blocks\n",
+					total_blocks, sparse_header->total_blks);
+
+	if(total_blocks != sparse_header->total_blks)
+	{
+		fastboot_fail("sparse image write failure");
+	}
+
+	fastboot_okay("");
+	return;
+}
+
+static bool CheckVirtualAbCriticalPartition (const char *PartitionName)
+{
+	VirtualAbMergeStatus SnapshotMergeStatus;
+	uint32 Iter = 0;
+
+	SnapshotMergeStatus = GetSnapshotMergeStatus ();
+	if ((SnapshotMergeStatus == MERGING || SnapshotMergeStatus == SNAPSHOTTED)) {
+		for (Iter = 0; Iter < ARRAY_SIZE (VirtualAbCriticalPartitions); Iter++) {
+			if (!strncmp (PartitionName, VirtualAbCriticalPartitions[Iter],
+				strlen (VirtualAbCriticalPartitions[Iter])))
+				return true;
+		}
+	}
+	return false;
+}
+
+/* Lock state checks shared by every path that writes a partition */
+static bool flash_allowed(const char *arg)
+{
+	char FlashResultStr[MAX_RSP_SIZE] = "";
+
+#if VERIFIED_BOOT || VERIFIED_BOOT_2
+	if (target_build_variant_user())
+	{
+		/* if device is locked:
+		 * common partition will not allow to be flashed
+		 * critical partition will allow to flash image.
+		 */
+		if(!device.is_unlocked && !critical_flash_allowed(arg)) {
+			fastboot_fail("Partition flashing is not allowed");
+			return false;
+		}
+
+		/* if device critical is locked:
+		 * common partition will allow to be flashed
+		 * critical partition will not allow to flash image.
+		 */
+		if (VB_M <= target_get_vb_version() &&
+			!device.is_unlock_critical &&
+			critical_flash_allowed(arg)) {
+				fastboot_fail("Critical partition flashing is not allowed");
+				return false;
+		}
+	}
+#endif
+
+	if (target_virtual_ab_supported() && CheckVirtualAbCriticalPartition (arg)) {
+		snprintf(FlashResultStr, MAX_RSP_SIZE,"Flashing of %s is not allowed in %s state",
+				arg, SnapshotMergeState);
+		fastboot_fail(FlashResultStr);
+		return false;
+	}
+
+	return true;
+}
+
+/* Flashing super drops a pending virtual A/B snapshot merge */
+static bool flash_cancel_snapshot_merge(const char *arg)
+{
+	VirtualAbMergeStatus SnapshotMergeStatus;
+
+	if (!target_virtual_ab_supported())
+		return true;
+
+	SnapshotMergeStatus = GetSnapshotMergeStatus ();
+	if (((SnapshotMergeStatus == MERGING) || (SnapshotMergeStatus == SNAPSHOTTED)) &&
+		!strncmp (arg, "super", strlen ("super"))) {
+		if(SetSnapshotMergeStatus (CANCELLED))
+		{
+			fastboot_fail("Failed to update snapshot state to cancel");
+			return false;
+		}
+
+		//updating fbvar snapshot-merge-state
+		snprintf(SnapshotMergeState,strlen(VabSnapshotMergeStatus[NONE_MERGE_STATUS]) + 1,
+				"%s", VabSnapshotMergeStatus[NONE_MERGE_STATUS]);
+	}
+
+	return true;
+}
+
+/* Flashing system puts dm-verity back into enforcing mode */
+static void flash_reset_verity_mode(const char *arg)
+{
+#if VERIFIED_BOOT
+	if (VB_M <= target_get_vb_version() &&
+		(!strncmp(arg, "system", 6)) &&
+		!device.verity_mode)
+		// reset dm_verity mode to enforcing
+		device.verity_mode = 1;
+	write_device_info(&device);
+#endif
+}
+
+/*
+ * Streaming flash: with "oem stream-flash <partition>" armed, download data
+ * is parsed and written by sparse_stream_write() as it arrives instead of
+ * being staged in the download buffer first. Sparse and raw images are
+ * both accepted; the following flash:<partition> only reports the result
+ * and disarms streaming again. Partitions which cmd_flash_mmc() handles
+ * specially cannot be streamed, see stream_flash_allowed().
+ */
+enum sparse_stream_state {
+	SPARSE_STREAM_FILE_HDR,
+	SPARSE_STREAM_CHUNK_HDR,
+	SPARSE_STREAM_RAW,
+	SPARSE_STREAM_FILL_VAL,
+	SPARSE_STREAM_SKIP,
+	SPARSE_STREAM_DONE,
+};
+
+struct sparse_stream {
+	char name[MAX_GPT_NAME_SIZE];
+	unsigned long long ptn;
+	unsigned long long size;
+	uint8_t lun;
+	unsigned total;
+	bool is_sparse;
+	uint32_t blk_sz;
+	enum sparse_stream_state state;
+	sparse_header_t sparse_hdr;
+	chunk_header_t chunk_hdr;
+	uint32_t fill_val;
+	/* bytes collected of the header or fill value in progress */
+	unsigned hdr_fill;
+	/* bytes left in the raw data or skipped payload of the chunk */
+	uint64_t remaining;
+	uint32_t chunks_done;
+	uint32_t total_blocks;
+	/* partial block carried over between two download pieces */
+	uint8_t *carry;
+	unsigned carry_len;
+	unsigned carry_max;
+	/* the last download was written out in full */
+	bool written;
+};
+
+static struct sparse_stream sparse_stream;
+
+/* Collect up to @want bytes of a header split across download pieces */
+static bool sparse_stream_collect(struct sparse_stream *ss, void *dst, unsigned want,
+				  uint8_t **buf, unsigned *len)
+{
+	unsigned n = MIN(want - ss->hdr_fill, *len);
+
+	memcpy((uint8_t *) dst + ss->hdr_fill, *buf, n);
+	ss->hdr_fill += n;
+	*buf += n;
+	*len -= n;
+
+	if (ss->hdr_fill < want)
+		return false;
+
+	ss->hdr_fill = 0;
+	return true;
+}
+
+static int sparse_stream_commit(struct sparse_stream *ss, void *buf, uint32_t blocks)
+{
+	uint64_t offset = (uint64_t)ss->total_blocks * ss->blk_sz;
+	uint64_t bytes = (uint64_t)blocks * ss->blk_sz;
+
+	if (offset + bytes > ss->size) {
+		dprintf(CRITICAL, "stream flash: write exceeds partition size\n");
+		return -1;
+	}
+
+	if (mmc_write(ss->ptn + offset, (uint32_t)bytes, buf)) {
+		dprintf(CRITICAL, "stream flash: write failure at block %u\n",
+			ss->total_blocks);
+		return -1;
+	}
+
+	ss->total_blocks += blocks;
+	return 0;
+}
+
+static void sparse_stream_chunk_done(struct sparse_stream *ss)
+{
+	ss->chunks_done++;
+	if (ss->chunks_done == ss->sparse_hdr.total_chunks)
+		ss->state = SPARSE_STREAM_DONE;
+	else
+		ss->state = SPARSE_STREAM_CHUNK_HDR;
+}
+
+static int sparse_stream_file_hdr(struct sparse_stream *ss)
+{
+	sparse_header_t *hdr = &ss->sparse_hdr;
+
+	if (hdr->magic == META_HEADER_MAGIC) {
+		dprintf(CRITICAL, "stream flash: meta images cannot be streamed\n");
+		return -1;
+	}
+
+	if (hdr->magic != SPARSE_HEADER_MAGIC) {
+		/* Raw image: write the download as is, block by block */
+		ss->is_sparse = false;
+		ss->blk_sz = mmc_get_device_blocksize();
+		if (ss->total > ss->size) {
+			dprintf(CRITICAL, "stream flash: image larger than partition\n");
+			return -1;
+		}
+		ss->remaining = ss->total;
+		ss->state = SPARSE_STREAM_RAW;
+		return 0;
+	}
+
+	if (!hdr->blk_sz || (hdr->blk_sz % 4) || hdr->blk_sz > ss->carry_max ||
+	    (ss->carry_max % hdr->blk_sz)) {
+		dprintf(CRITICAL, "stream flash: invalid block size %u\n", hdr->blk_sz);
+		return -1;
+	}
+
+	if (((uint64_t)hdr->total_blks * (uint64_t)hdr->blk_sz) > ss->size) {
+		dprintf(CRITICAL, "stream flash: image larger than partition\n");
+		return -1;
+	}
+
+	if (hdr->file_hdr_sz != sizeof(sparse_header_t) ||
+	    hdr->chunk_hdr_sz != sizeof(chunk_header_t)) {
+		dprintf(CRITICAL, "stream flash: sparse header size mismatch\n");
+		return -1;
+	}
+
+	ss->is_sparse = true;
+	ss->blk_sz = hdr->blk_sz;
+	ss->state = hdr->total_chunks ? SPARSE_STREAM_CHUNK_HDR : SPARSE_STREAM_DONE;
+	return 0;
+}
+
+static int sparse_stream_chunk_hdr(struct sparse_stream *ss)
+{
+	chunk_header_t *chunk = &ss->chunk_hdr;
+	uint64_t chunk_data_sz = (uint64_t)ss->blk_sz * chunk->chunk_sz;
+
+	dprintf(SPEW, "stream flash: chunk type 0x%x blocks 0x%x total 0x%x\n",
+		chunk->chunk_type, chunk->chunk_sz, chunk->total_sz);
+
+	if (ss->total_blocks > (UINT_MAX - chunk->chunk_sz) ||
+	    (uint64_t)ss->total_blocks * ss->blk_sz + chunk_data_sz > ss->size) {
+		dprintf(CRITICAL, "stream flash: chunk exceeds partition size\n");
+		return -1;
+	}
+
+	switch (chunk->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if ((uint64_t)chunk->total_sz != sizeof(chunk_header_t) + chunk_data_sz) {
+			dprintf(CRITICAL, "stream flash: bogus raw chunk size\n");
+			return -1;
+		}
+		ss->remaining = chunk_data_sz;
+		ss->state = ss->remaining ? SPARSE_STREAM_RAW : SPARSE_STREAM_CHUNK_HDR;
+		break;
+	case CHUNK_TYPE_FILL:
+		if (chunk->total_sz != sizeof(chunk_header_t) + sizeof(uint32_t)) {
+			dprintf(CRITICAL, "stream flash: bogus fill chunk size\n");
+			return -1;
+		}
+		ss->state = SPARSE_STREAM_FILL_VAL;
+		return 0;
+	case CHUNK_TYPE_DONT_CARE:
+		if (chunk->total_sz != sizeof(chunk_header_t)) {
+			dprintf(CRITICAL, "stream flash: bogus don't care chunk size\n");
+			return -1;
+		}
+		ss->total_blocks += chunk->chunk_sz;
+		break;
+	case CHUNK_TYPE_CRC:
+		/* Covers no blocks, the crc32 payload is skipped unchecked */
+		if (chunk->chunk_sz ||
+		    chunk->total_sz != sizeof(chunk_header_t) + sizeof(uint32_t)) {
+			dprintf(CRITICAL, "stream flash: bogus crc chunk size\n");
+			return -1;
+		}
+		ss->remaining = sizeof(uint32_t);
+		ss->state = SPARSE_STREAM_SKIP;
+		break;
+	default:
+		dprintf(CRITICAL, "stream flash: unknown chunk type 0x%x\n",
+			chunk->chunk_type);
+		return -1;
+	}
+
+	if (ss->state == SPARSE_STREAM_CHUNK_HDR)
+		sparse_stream_chunk_done(ss);
+	return 0;
+}
+
+static int sparse_stream_fill(struct sparse_stream *ss)
+{
+	uint32_t *fill_buf = (uint32_t *) ss->carry;
+	uint32_t blocks_per_buf = ss->carry_max / ss->blk_sz;
+	uint32_t left = ss->chunk_hdr.chunk_sz;
+	uint32_t n;
+	uint32_t i;
+
+	for (i = 0; i < ss->carry_max / sizeof(uint32_t); i++)
+		fill_buf[i] = ss->fill_val;
+
+	while (left) {
+		n = MIN(left, blocks_per_buf);
+		if (sparse_stream_commit(ss, fill_buf, n))
+			return -1;
+		left -= n;
+	}
+
+	sparse_stream_chunk_done(ss);
+	return 0;
+}
+
+/* Write raw chunk data, going through the carry buffer only for split blocks */
+static int sparse_stream_raw(struct sparse_stream *ss, uint8_t **buf, unsigned *len)
+{
+	uint32_t blk_sz = ss->blk_sz;
+	uint64_t avail = MIN((uint64_t)*len, ss->remaining - ss->carry_len);
+	unsigned n;
+
+	if (ss->carry_len) {
+		n = MIN(blk_sz - ss->carry_len, (unsigned)avail);
+		memcpy(ss->carry + ss->carry_len, *buf, n);
+		ss->carry_len += n;
+		if (ss->carry_len == blk_sz || ss->carry_len == ss->remaining) {
+			if (ss->carry_len < blk_sz)
+				memset(ss->carry + ss->carry_len, 0, blk_sz - ss->carry_len);
+			if (sparse_stream_commit(ss, ss->carry, 1))
+				return -1;
+			ss->remaining -= ss->carry_len;
+			ss->carry_len = 0;
+		}
+	} else {
+		n = (unsigned)avail - ((unsigned)avail % blk_sz);
+		if (n) {
+			if (sparse_stream_commit(ss, *buf, n / blk_sz))
+				return -1;
+			ss->remaining -= n;
+		} else {
+			n = (unsigned)avail;
+			memcpy(ss->carry, *buf, n);
+			ss->carry_len = n;
+			if (ss->carry_len == ss->remaining) {
+				/* Tail of a raw image which is not block aligned */
+				memset(ss->carry + n, 0, blk_sz - n);
+				if (sparse_stream_commit(ss, ss->carry, 1))
+					return -1;
+				ss->remaining = 0;
+				ss->carry_len = 0;
+			}
+		}
+	}
+
+	*buf += n;
+	*len -= n;
+
+	if (!ss->remaining) {
+		if (ss->is_sparse)
+			sparse_stream_chunk_done(ss);
+		else
+			ss->state = SPARSE_STREAM_DONE;
+	}
+	return 0;
+}
+
+static int sparse_stream_start(void *cookie, unsigned total)
+{
+	struct sparse_stream *ss = cookie;
+
+	ss->state = SPARSE_STREAM_FILE_HDR;
+	ss->hdr_fill = 0;
+	ss->remaining = 0;
+	ss->chunks_done = 0;
+	ss->total_blocks = 0;
+	ss->carry_len = 0;
+	ss->total = total;
+	ss->written = false;
+
+	mmc_set_lun(ss->lun);
+	return 0;
+}
+
+static int sparse_stream_write(void *cookie, void *data, unsigned len)
+{
+	struct sparse_stream *ss = cookie;
+	uint8_t *buf = data;
+
+	while (len) {
+		switch (ss->state) {
+		case SPARSE_STREAM_FILE_HDR:
+			if (!sparse_stream_collect(ss, &ss->sparse_hdr,
+						   sizeof(sparse_header_t), &buf, &len))
+				break;
+			if (sparse_stream_file_hdr(ss))
+				return -1;
+			if (!ss->is_sparse) {
+				/* The header bytes are image data for a raw image */
+				uint8_t *hdr = (uint8_t *) &ss->sparse_hdr;
+				unsigned hdr_len = sizeof(sparse_header_t);
+
+				while (hdr_len && ss->state == SPARSE_STREAM_RAW)
+					if (sparse_stream_raw(ss, &hdr, &hdr_len))
+						return -1;
+			}
+			break;
+		case SPARSE_STREAM_CHUNK_HDR:
+			if (!sparse_stream_collect(ss, &ss->chunk_hdr,
+						   sizeof(chunk_header_t), &buf, &len))
+				break;
+			if (sparse_stream_chunk_hdr(ss))
+				return -1;
+			break;
+		case SPARSE_STREAM_FILL_VAL:
+			if (!sparse_stream_collect(ss, &ss->fill_val,
+						   sizeof(uint32_t), &buf, &len))
+				break;
+			if (sparse_stream_fill(ss))
+				return -1;
+			break;
+		case SPARSE_STREAM_RAW:
+			if (sparse_stream_raw(ss, &buf, &len))
+				return -1;
+			break;
+		case SPARSE_STREAM_SKIP:
+			if (len >= ss->remaining) {
+				buf += ss->remaining;
+				len -= ss->remaining;
+				ss->remaining = 0;
+				sparse_stream_chunk_done(ss);
+			} else {
+				ss->remaining -= len;
+				len = 0;
+			}
+			break;
+		case SPARSE_STREAM_DONE:
+			dprintf(CRITICAL, "stream flash: %u bytes past end of image\n", len);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int sparse_stream_finish(void *cookie)
+{
+	struct sparse_stream *ss = cookie;
+
+	if (ss->state != SPARSE_STREAM_DONE) {
+		dprintf(CRITICAL, "stream flash: image truncated\n");
+		return -1;
+	}
+
+	if (ss->is_sparse) {
+		dprintf(INFO, "Wrote %d blocks, expected to write %d blocks\n",
+			ss->total_blocks, ss->sparse_hdr.total_blks);
+		if (ss->total_blocks != ss->sparse_hdr.total_blks)
+			return -1;
+	}
+
+	ss->written = true;
+	return 0;
+}
+
+/*
+ * Only plain partitions are streamed, the ones cmd_flash_mmc() checks or
+ * transforms the image of before writing it need the whole download.
+ */
+static bool stream_flash_allowed(const char *arg)
+{
+#ifdef SSD_ENABLE
+	/* Downloads may have to be decrypted or encrypted first */
+	return false;
+#else
+	static const char *special[] = {
+		"partition", "frp-unlock", "avb_custom_key", "boot", "recovery",
+	};
+	unsigned i;
+
+	/* partition:lun names are not supported either */
+	if (strchr(arg, ':'))
+		return false;
 
-			blk_sz_actual = ROUNDUP(sparse_header->blk_sz, CACHE_LINE);
-			/* Integer overflow detected */
-			if (blk_sz_actual < sparse_header->blk_sz)
-			{
-				fastboot_fail("Invalid block size");
-				return;
-			}
+	for (i = 0; i < ARRAY_SIZE(special); i++)
+		if (!strncmp(arg, special[i], strlen(special[i])))
+			return false;
 
-			fill_buf = (uint32_t *)memalign(CACHE_LINE, blk_sz_actual);
-			if (!fill_buf)
-			{
-				fastboot_fail("Malloc failed for: CHUNK_TYPE_FILL");
-				return;
-			}
+#if VERIFIED_BOOT
+	if (!strcmp(arg, KEYSTORE_PTN_NAME))
+		return false;
+#endif
 
-			if (data_end < (uintptr_t)data + sizeof(uint32_t)) {
-				fastboot_fail("buffer overreads occured due to invalid sparse header");
-				free(fill_buf);
-				return;
-			}
-			fill_val = *(uint32_t *)data;
-			data = (char *) data + sizeof(uint32_t);
+	return true;
+#endif
+}
 
-			for (i = 0; i < (sparse_header->blk_sz / sizeof(fill_val)); i++)
-			{
-				fill_buf[i] = fill_val;
-			}
+static struct fastboot_stream_sink sparse_stream_sink = {
+	.start  = sparse_stream_start,
+	.write  = sparse_stream_write,
+	.finish = sparse_stream_finish,
+	.cookie = &sparse_stream,
+};
 
-			if(total_blocks > (UINT_MAX - chunk_header->chunk_sz))
-			{
-				fastboot_fail("bogus size for chunk FILL type");
-				free(fill_buf);
-				return;
-			}
+void cmd_oem_stream_flash(const char *arg, void *data, unsigned sz)
+{
+	struct sparse_stream *ss = &sparse_stream;
+	int index = INVALID_PTN;
 
-			for (i = 0; i < chunk_header->chunk_sz; i++)
-			{
-				/* Make sure that the data written to partition does not exceed partition size */
-				if ((uint64_t)total_blocks * (uint64_t)sparse_header->blk_sz + sparse_header->blk_sz > size)
-				{
-					fastboot_fail("Chunk data size for fill type exceeds partition size");
-					free(fill_buf);
-					return;
-				}
+	while (*arg == ' ')
+		arg++;
 
-				if(mmc_write(ptn + ((uint64_t)total_blocks*sparse_header->blk_sz),
-							sparse_header->blk_sz,
-							fill_buf))
-				{
-					fastboot_fail("flash write failure");
-					free(fill_buf);
-					return;
-				}
+	/* No partition name disarms streaming */
+	fastboot_set_stream_sink(NULL);
+	ss->name[0] = '\0';
+	ss->written = false;
+	if (!*arg) {
+		fastboot_okay("");
+		return;
+	}
 
-				total_blocks++;
-			}
+	if (!target_is_emmc_boot()) {
+		fastboot_fail("stream flash is not supported on nand");
+		return;
+	}
 
-			free(fill_buf);
-			break;
+	if (!stream_flash_allowed(arg)) {
+		fastboot_fail("partition cannot be stream flashed");
+		return;
+	}
 
-			case CHUNK_TYPE_DONT_CARE:
-			if(total_blocks > (UINT_MAX - chunk_header->chunk_sz)) {
-				fastboot_fail("bogus size for chunk DONT CARE type");
-				return;
-			}
-			total_blocks += chunk_header->chunk_sz;
-			break;
+	if (!flash_allowed(arg))
+		return;
 
-			case CHUNK_TYPE_CRC:
-			if(chunk_header->total_sz != sparse_header->chunk_hdr_sz)
-			{
-				fastboot_fail("Bogus chunk size for chunk type CRC");
-				return;
-			}
-			if(total_blocks > (UINT_MAX - chunk_header->chunk_sz)) {
-				fastboot_fail("bogus size for chunk CRC type");
-				return;
-			}
-			total_blocks += chunk_header->chunk_sz;
-			if ((uintptr_t)data > UINT_MAX - chunk_data_sz) {
-				fastboot_fail("integer overflow occured");
-				return;
-			}
-			data += (uint32_t)chunk_data_sz;
-			if (data_end < (uintptr_t)data) {
-				fastboot_fail("buffer overreads occured due to invalid sparse header");
-				return;
-			}
-			break;
+	/* Data is written as it arrives, so this has to happen now */
+	if (!flash_cancel_snapshot_merge(arg))
+		return;
 
-			default:
-			dprintf(CRITICAL, "Unkown chunk type: %x\n",chunk_header->chunk_type);
-			fastboot_fail("Unknown chunk type");
+	index = partition_get_index(arg);
+	ss->ptn = partition_get_offset(index);
+	if (ss->ptn == 0) {
+		fastboot_fail("partition table doesn't exist");
+		return;
+	}
+	ss->size = partition_get_size(index);
+	ss->lun = partition_get_lun(index);
+
+	/* Carry and fill buffer, a multiple of any sane sparse block size */
+	if (!ss->carry) {
+		ss->carry_max = MAX(mmc_get_device_blocksize(), 4096);
+		ss->carry = memalign(CACHE_LINE, ss->carry_max);
+		if (!ss->carry) {
+			fastboot_fail("Malloc failed for stream flash");
 			return;
 		}
 	}
 
-	dprintf(INFO, "Wrote %d blocks, expected to write %d blocks\n",
-					total_blocks, sparse_header->total_blks);
+	strlcpy(ss->name, arg, sizeof(ss->name));
+	fastboot_set_scatter_sink(NULL);
+	boot_direct.armed = false;
+	fastboot_set_stream_sink(&sparse_stream_sink);
+	fastboot_okay("");
+}
 
-	if(total_blocks != sparse_header->total_blks)
-	{
-		fastboot_fail("sparse image write failure");
+/* "oem boot-direct" arms direct boot downloads, "oem boot-direct off" disarms */
+void cmd_oem_boot_direct(const char *arg, void *data, unsigned sz)
+{
+	while (*arg == ' ')
+		arg++;
+
+	fastboot_set_scatter_sink(NULL);
+	boot_direct.armed = false;
+	boot_direct.loaded = false;
+	if (!strcmp(arg, "off")) {
+		fastboot_okay("");
+		return;
+	}
+
+	if (*arg) {
+		fastboot_fail("unknown boot-direct option");
+		return;
+	}
+
+	if (!boot_direct_allowed()) {
+		fastboot_fail("boot direct is not allowed");
+		return;
 	}
 
+	/* Streaming flash and direct boot both own the download path */
+	fastboot_set_stream_sink(NULL);
+	sparse_stream.name[0] = '\0';
+
+	boot_direct.armed = true;
+	fastboot_set_scatter_sink(&boot_direct_sink);
 	fastboot_okay("");
-	return;
 }
 
-static bool CheckVirtualAbCriticalPartition (const char *PartitionName)
+/*
+ * flash:<partition> after a streamed download, the data is already written.
+ * Either way streaming is disarmed, the next download is a normal one.
+ */
+static bool stream_flash_done(const char *arg, unsigned sz)
 {
-	VirtualAbMergeStatus SnapshotMergeStatus;
-	uint32 Iter = 0;
+	struct sparse_stream *ss = &sparse_stream;
 
-	SnapshotMergeStatus = GetSnapshotMergeStatus ();
-	if ((SnapshotMergeStatus == MERGING || SnapshotMergeStatus == SNAPSHOTTED)) {
-		for (Iter = 0; Iter < ARRAY_SIZE (VirtualAbCriticalPartitions); Iter++) {
-			if (!strncmp (PartitionName, VirtualAbCriticalPartitions[Iter],
-				strlen (VirtualAbCriticalPartitions[Iter])))
-				return true;
-		}
+	if (!ss->name[0])
+		return false;
+
+	if (strcmp(arg, ss->name)) {
+		fastboot_fail("stream flash armed for another partition");
+	} else if (!ss->written) {
+		fastboot_fail("no image was stream flashed");
+	} else {
+		flash_reset_verity_mode(arg);
+		fastboot_okay("");
 	}
-	return false;
+
+	fastboot_set_stream_sink(NULL);
+	ss->name[0] = '\0';
+	ss->written = false;
+	return true;
 }
 
+
 void cmd_flash_mmc(const char *arg, void *data, unsigned sz)
 {
 	sparse_header_t *sparse_header;
 	meta_header_t *meta_header;
-	VirtualAbMergeStatus SnapshotMergeStatus;
-	char FlashResultStr[MAX_RSP_SIZE] = "";
 
 #ifdef SSD_ENABLE
 	/* 8 Byte Magic + 2048 Byte xml + Encrypted Data */
@@ -4262,54 +5409,11 @@ void cmd_flash_mmc(const char *arg, void *data, unsigned sz)
 	}
 #endif /* SSD_ENABLE */
 
-#if VERIFIED_BOOT || VERIFIED_BOOT_2
-	if (target_build_variant_user())
-	{
-		/* if device is locked:
-		 * common partition will not allow to be flashed
-		 * critical partition will allow to flash image.
-		 */
-		if(!device.is_unlocked && !critical_flash_allowed(arg)) {
-			fastboot_fail("Partition flashing is not allowed");
-			return;
-		}
-
-		/* if device critical is locked:
-		 * common partition will allow to be flashed
-		 * critical partition will not allow to flash image.
-		 */
-		if (VB_M <= target_get_vb_version() &&
-			!device.is_unlock_critical &&
-			critical_flash_allowed(arg)) {
-				fastboot_fail("Critical partition flashing is not allowed");
-				return;
-		}
-	}
-#endif
-
-	if (target_virtual_ab_supported())
-	{
-		if (CheckVirtualAbCriticalPartition (arg)) {
-			snprintf(FlashResultStr, MAX_RSP_SIZE,"Flashing of %s is not allowed in %s state",
-					arg, SnapshotMergeState);
-			fastboot_fail(FlashResultStr);
-			return;
-		}
-
-		SnapshotMergeStatus = GetSnapshotMergeStatus ();
-		if (((SnapshotMergeStatus == MERGING) || (SnapshotMergeStatus == SNAPSHOTTED)) &&
-			!strncmp (arg, "super", strlen ("super"))) {
-			if(SetSnapshotMergeStatus (CANCELLED))
-			{
-				fastboot_fail("Failed to update snapshot state to cancel");
-				return;
-			}
+	if (!flash_allowed(arg))
+		return;
 
-			//updating fbvar snapshot-merge-state
-			snprintf(SnapshotMergeState,strlen(VabSnapshotMergeStatus[NONE_MERGE_STATUS]) + 1,
-					"%s", VabSnapshotMergeStatus[NONE_MERGE_STATUS]);
-		}
-	}
+	if (!flash_cancel_snapshot_merge(arg))
+		return;
 
 	if (!strncmp(arg, "avb_custom_key", strlen("avb_custom_key"))) {
 		dprintf(INFO, "flashing avb_custom_key\n");
@@ -4330,14 +5434,7 @@ void cmd_flash_mmc(const char *arg, void *data, unsigned sz)
 	else
 		cmd_flash_mmc_img(arg, data, sz);
 
-#if VERIFIED_BOOT
-	if (VB_M <= target_get_vb_version() &&
-		(!strncmp(arg, "system", 6)) &&
-		!device.verity_mode)
-		// reset dm_verity mode to enforcing
-		device.verity_mode = 1;
-		write_device_info(&device);
-#endif
+	flash_reset_verity_mode(arg);
 
 	return;
 }
@@ -4478,6 +5575,14 @@ static inline uint64_t validate_partition_size(struct ptentry *ptn)
 
 void cmd_flash(const char *arg, void *data, unsigned sz)
 {
+	if (stream_flash_done(arg, sz))
+		return;
+
+	if (boot_direct.armed) {
+		fastboot_fail("boot direct is armed, use 'oem boot-direct off'");
+		return;
+	}
+
 	if(target_is_emmc_boot())
 		cmd_flash_mmc(arg, data, sz);
 	else
@@ -4786,6 +5891,93 @@ void cmd_oem_devinfo(const char *arg, void *data, unsigned sz)
 	fastboot_okay("");
 }
 
+/* Room for the full report staged for "fastboot get_staged" */
+#define BOOT_TRACE_DUMP_SIZE	(16 * 1024)
+
+void cmd_oem_boot_trace(const char *arg, void *data, unsigned sz)
+{
+	static char *dump;
+	struct bs_trace_phase phase;
+#if MMC_SDHCI_SUPPORT
+	struct mmc_read_cache_stats ra;
+#endif
+	char response[MAX_RSP_SIZE];
+	unsigned len;
+	unsigned i;
+
+	for (i = 0; bs_trace_get_phase(i, &phase); i++) {
+		snprintf(response, sizeof(response), "\t%s: %u, %llu us, max %llu us",
+			phase.name, phase.count, bs_trace_ticks_to_us(phase.total),
+			bs_trace_ticks_to_us(phase.max));
+		fastboot_info(response);
+	}
+
+#if MMC_SDHCI_SUPPORT
+	mmc_read_cache_get_stats(&ra);
+	snprintf(response, sizeof(response), "\tmmc read-ahead: %u hits, %u misses, %u bypassed, %llu KB ahead",
+		ra.hits, ra.misses, ra.bypassed, ra.prefetched / 1024);
+	fastboot_info(response);
+#endif
+
+	if (!dump)
+		dump = memalign(CACHE_LINE, ROUNDUP(BOOT_TRACE_DUMP_SIZE, CACHE_LINE));
+	if (!dump) {
+		fastboot_fail("failed to allocate boot trace buffer");
+		return;
+	}
+
+	len = bs_trace_dump(dump, BOOT_TRACE_DUMP_SIZE);
+	/* cmd_upload invalidates the buffer before sending it */
+	arch_clean_cache_range((addr_t) dump, ROUNDUP(len, CACHE_LINE));
+	if (fboot_set_upload(dump, len)) {
+		fastboot_fail("failed to stage boot trace");
+		return;
+	}
+
+	fastboot_info("\tFull trace staged, use 'fastboot get_staged'");
+	fastboot_okay("");
+}
+
+#if ARM_WITH_CACHE
+/* oem cache-stats [on|off|reset|threshold <bytes>]
+ * With no argument prints the cache maintenance done per caller since the
+ * last reset; callers are return addresses, look them up in lk's symbols.
+ */
+void cmd_oem_cache_stats(const char *arg, void *data, unsigned sz)
+{
+	struct arm_cache_stats st;
+	char response[MAX_RSP_SIZE];
+	unsigned i;
+
+	while (*arg == ' ')
+		arg++;
+
+	if (!strcmp(arg, "on")) {
+		arm_cache_stats_enable(true);
+	} else if (!strcmp(arg, "off")) {
+		arm_cache_stats_enable(false);
+	} else if (!strcmp(arg, "reset")) {
+		arm_cache_stats_reset();
+	} else if (!strncmp(arg, "threshold", strlen("threshold"))) {
+		arm_cache_set_whole_threshold(atoi(arg + strlen("threshold")));
+	} else if (*arg) {
+		fastboot_fail("unknown cache-stats option");
+		return;
+	}
+
+	snprintf(response, sizeof(response), "\twhole cache threshold: %u",
+		(unsigned) arm_cache_get_whole_threshold());
+	fastboot_info(response);
+
+	for (i = 0; arm_cache_stats_get(i, &st); i++) {
+		snprintf(response, sizeof(response), "\t%p: %u calls, %llu KB, %u whole, %u skipped, %llu kcycles",
+			st.caller, st.calls, st.bytes / 1024, st.whole, st.skipped, st.cycles / 1000);
+		fastboot_info(response);
+	}
+	fastboot_okay("");
+}
+#endif
+
 void cmd_flashing_get_unlock_ability(const char *arg, void *data, unsigned sz)
 {
 	char response[MAX_RSP_SIZE];
@@ -5177,11 +6369,17 @@ void aboot_fastboot_register_commands(void)
 						{"flashing unlock_critical", cmd_flashing_unlock_critical},
 						{"flashing get_unlock_ability", cmd_flashing_get_unlock_ability},
 						{"oem device-info", cmd_oem_devinfo},
+						{"oem boot-trace", cmd_oem_boot_trace},
+#if ARM_WITH_CACHE
+						{"oem cache-stats", cmd_oem_cache_stats},
+#endif
 						{"preflash", cmd_preflash},
 						{"oem enable-charger-screen", cmd_oem_enable_charger_screen},
 						{"oem disable-charger-screen", cmd_oem_disable_charger_screen},
 						{"oem off-mode-charge", cmd_oem_off_mode_charger},
 						{"oem select-display-panel", cmd_oem_select_display_panel},
+						{"oem stream-flash", cmd_oem_stream_flash},
+						{"oem boot-direct", cmd_oem_boot_direct},
 						{"set_active",cmd_set_active},
 #if DYNAMIC_PARTITION_SUPPORT
 						{"reboot-fastboot",cmd_reboot_fastboot},
@@ -5345,28 +6543,13 @@ void aboot_init(const struct app_descriptor *app)
 		}
 	}
 
-	/* Display splash screen if enabled */
+	/* Display splash screen if enabled, in parallel with the boot */
 #if DISPLAY_SPLASH_SCREEN
 #if NO_ALARM_DISPLAY
 	if (!check_alarm_boot()) {
 #endif
-		dprintf(SPEW, "Display Init: Start\n");
-#if DISPLAY_HDMI_PRIMARY
-	if (!strlen(device.display_panel))
-		strlcpy(device.display_panel, DISPLAY_PANEL_HDMI,
-			sizeof(device.display_panel));
-#endif
-#if ENABLE_WBC
-		/* Wait if the display shutdown is in progress */
-		while(pm_app_display_shutdown_in_prgs());
-		if (!pm_appsbl_display_init_done())
-			target_display_init(device.display_panel);
-		else
-			display_image_on_screen();
-#else
-		target_display_init(device.display_panel);
-#endif
-		dprintf(SPEW, "Display Init: Done\n");
+		display_task_started = true;
+		init_task_start(&display_task);
 #if NO_ALARM_DISPLAY
 	}
 #endif
@@ -5516,6 +6699,12 @@ retry_boot:
 
 fastboot:
 	/* We are here means regular boot did not happen. Start fastboot. */
+	aboot_display_wait();
+
+	/* Nothing for the secondary cpus to do in fastboot, and with them
+	 * off the cache can be maintained by set/way again.
+	 */
+	smp_stop();
 
 	/* register aboot specific fastboot commands */
 	aboot_fastboot_register_commands();
@@ -5558,7 +6747,8 @@ static int aboot_save_boot_hash_mmc(uint32_t image_addr, uint32_t image_size)
 	uint32_t auth_algo = CRYPTO_AUTH_ALG_SHA256;
 #endif
 
-	target_crypto_init_params();
+	/* Crypto params were set up by boot_linux_from_mmc() before it
+	 * started hashing the image as it loaded. */
 	hash_find((unsigned char *) image_addr, image_size, (unsigned char *)&digest, auth_algo);
 
 	save_kernel_hash_cmd(digest);
@@ -62,7 +62,21 @@ typedef struct
 usb_controller_interface_t usb_if;
 
 #define MAX_USBFS_BULK_SIZE (32 * 1024)
+
+/* OUT requests kept queued on the chipidea controller while reading */
+#define HSUSB_READ_REQS     2
+/* Size of each of them, 64 dTDs */
+#define HSUSB_READ_CHUNK    (1024 * 1024)
 #define MAX_USBSS_BULK_SIZE (0x1000000)
+/* OUT requests kept queued in the dwc TRB ring while reading */
+#define USB30_READ_REQS     3
+#define USB30_READ_CHUNK    (4 * 1024 * 1024)
+/* How long a cancelled OUT request may take to come back, in ms */
+#define USB30_CANCEL_TIMEOUT 100
+
+/* Streaming download ring, carved out of the download buffer */
+#define STREAM_RING_SLOTS   4
+#define STREAM_SLOT_SIZE    (8 * 1024 * 1024)
 
 void boot_linux(void *bootimg, unsigned sz);
 static void fastboot_notify(struct udc_gadget *gadget, unsigned event);
@@ -170,6 +184,33 @@ static unsigned download_size;
 static void *upload_base_addr;
 static unsigned upload_size;
 
+struct stream_slot {
+	void *buf;
+	unsigned len;
+	event_t full;
+	event_t empty;
+};
+
+static struct fastboot_stream_sink *stream_sink;
+static struct stream_slot stream_ring[STREAM_RING_SLOTS];
+static event_t stream_done;
+static int stream_status;
+
+static struct fastboot_scatter_sink *scatter_sink;
+
+struct usb_read_slot {
+	struct udc_request *req;
+	unsigned char *data;
+	unsigned xfer;
+	int status;
+	event_t done;
+};
+
+static struct usb_read_slot hsusb_read_slots[HSUSB_READ_REQS];
+#ifdef USB30_SUPPORT
+static struct usb_read_slot usb30_read_slots[USB30_READ_REQS];
+#endif
+
 #define STATE_OFFLINE	0
 #define STATE_COMMAND	1
 #define STATE_COMPLETE	2
@@ -185,15 +226,56 @@ static void req_complete(struct udc_request *req, unsigned actual, int status)
 	event_signal(&txn_done, 0);
 }
 
+static void usb_read_complete(struct udc_request *req, unsigned actual, int status)
+{
+	struct usb_read_slot *slot = req->context;
+
+	slot->status = status;
+	req->length = actual;
+
+	event_signal(&slot->done, 0);
+}
+
 #ifdef USB30_SUPPORT
+static int usb30_read_init(void)
+{
+	unsigned i;
+
+	if (usb30_read_slots[0].req)
+		return 0;
+
+	for (i = 0; i < USB30_READ_REQS; i++) {
+		usb30_read_slots[i].req = usb30_udc_request_alloc();
+		if (!usb30_read_slots[i].req)
+			return -1;
+		usb30_read_slots[i].req->context = &usb30_read_slots[i];
+		event_init(&usb30_read_slots[i].done, 0, EVENT_FLAG_AUTOUNSIGNAL);
+	}
+
+	return 0;
+}
+
+/*
+ * Reads len bytes as a stream of USB30_READ_CHUNK requests. USB30_READ_REQS
+ * of them stay queued in the OUT endpoint's TRB ring, so the controller
+ * moves on to the next one without waiting for this thread to queue it.
+ *
+ * A short packet ends a request early while the controller goes on filling
+ * the requests queued behind it. Their data is moved down to close the gap
+ * as they complete, and queueing resumes right after the data once they
+ * have drained.
+ */
 static int usb30_usb_read(void *_buf, unsigned len)
 {
-	int r;
-	struct udc_request req;
-	uint32_t xfer;
+	struct usb_read_slot *slot;
+	unsigned char *buf = _buf;
+	unsigned queued = 0;
+	unsigned shift = 0;
+	unsigned head = 0;
+	unsigned inflight = 0;
+	unsigned xfer;
+	unsigned actual;
 	int count = 0;
-	uint32_t trans_len = len;
-	const char *buf = _buf;
 
 	ASSERT(buf);
 	ASSERT(len);
@@ -201,49 +283,74 @@ static int usb30_usb_read(void *_buf, unsigned len)
 	if (fastboot_state == STATE_ERROR)
 		goto oops;
 
+	if (usb30_read_init()) {
+		dprintf(CRITICAL, "usb_read() request alloc failed\n");
+		goto oops;
+	}
+
 	dprintf(SPEW, "usb_read(): len = %d\n", len);
 
-	while (len > 0)
-	{
-		xfer = (len > MAX_USBSS_BULK_SIZE) ? MAX_USBSS_BULK_SIZE : len;
+	for (;;) {
+		/* Keep the ring topped up, unless a gap is still being closed */
+		while (!shift && inflight < USB30_READ_REQS && queued < len) {
+			slot = &usb30_read_slots[(head + inflight) % USB30_READ_REQS];
+			xfer = MIN(len - queued, USB30_READ_CHUNK);
+			slot->xfer = xfer;
+			slot->data = buf + queued;
+			slot->req->buf = (void*) PA((addr_t)slot->data);
+			slot->req->length = xfer;
+			slot->req->complete = usb_read_complete;
+			/* A request failed on reset may have left this set */
+			event_unsignal(&slot->done);
+			if (usb30_udc_request_queue(out, slot->req) < 0) {
+				dprintf(CRITICAL, "usb_read() queue failed\n");
+				goto cancel;
+			}
+			queued += xfer;
+			inflight++;
+		}
 
-		req.buf      = (void*) PA((addr_t)buf);
-		req.length   = xfer;
-		req.complete = req_complete;
+		if (!inflight)
+			break;
 
-		r = usb30_udc_request_queue(out, &req);
-		if (r < 0)
-		{
-			dprintf(CRITICAL, "usb_read() queue failed. r = %d\n", r);
-			goto oops;
-		}
-		event_wait(&txn_done);
+		slot = &usb30_read_slots[head];
+		event_wait(&slot->done);
+		head = (head + 1) % USB30_READ_REQS;
+		inflight--;
 
-		if (txn_status < 0)
-		{
+		if (slot->status < 0) {
 			dprintf(CRITICAL, "usb_read() transaction failed. txn_status = %d\n",
-					txn_status);
-			goto oops;
+					slot->status);
+			goto cancel;
 		}
 
-		count += req.length;
-		buf += req.length;
-		len -= req.length;
+		/* Anything beyond xfer landed in the dwc pad buffer */
+		actual = MIN(slot->req->length, slot->xfer);
 
-		/* note: req.length is update by callback to reflect the amount of data
-		 * actually read.
-		 */
-		dprintf(SPEW, "usb_read(): DONE. req.length = %d\n\n", req.length);
-
-		/* For USB3.0 if the data transfer is less than MaxpacketSize, its
-		 * short packet and DWC layer generates transfer complete. App layer
-		 * shold handle this and continue trasnferring the data instead of treating
-		 * this as a transfer complete. This case is not applicable for transfers
-		 * which involve protocol communication to exchange information whose length
-		 * is always equal to MAX_RSP_SIZE. This check ensures that we dont abort
-		 * data transfers on short packet.
-		 */
-		if (req.length != xfer && trans_len == MAX_RSP_SIZE) break;
+		if (shift) {
+			arch_invalidate_cache_range((addr_t)slot->data, actual);
+			memmove(buf + count, slot->data, actual);
+			arch_clean_invalidate_cache_range((addr_t)(buf + count), actual);
+		}
+		count += actual;
+
+		dprintf(SPEW, "usb_read(): DONE. req.length = %d\n\n", actual);
+
+		if (actual != slot->xfer) {
+			/*
+			 * Protocol messages are always read with MAX_RSP_SIZE and
+			 * end with a short packet. For data, a short packet does
+			 * not mean the transfer is complete.
+			 */
+			if (len == MAX_RSP_SIZE)
+				break;
+			shift += slot->xfer - actual;
+		}
+
+		if (shift && !inflight) {
+			queued = count;
+			shift = 0;
+		}
 	}
 
 	/* invalidate any cached buf data (controller updates main memory) */
@@ -251,6 +358,17 @@ static int usb30_usb_read(void *_buf, unsigned len)
 
 	return count;
 
+cancel:
+	/*
+	 * Requests still in the TRB ring would go on filling buf after we
+	 * return. Ending the transfer fails all of them; wait for that so
+	 * the caller can reuse buf. If it already failed them, there is
+	 * nothing left to end and their completions are already in.
+	 */
+	if (inflight && !usb30_udc_request_cancel(out, usb30_read_slots[head].req)) {
+		for (; inflight; inflight--, head = (head + 1) % USB30_READ_REQS)
+			event_wait_timeout(&usb30_read_slots[head].done, USB30_CANCEL_TIMEOUT);
+	}
 oops:
 	fastboot_state = STATE_ERROR;
 	dprintf(CRITICAL, "usb_read(): DONE: ERROR: len = %d\n", len);
@@ -302,40 +420,91 @@ oops:
 }
 #endif
 
+static int hsusb_read_init(void)
+{
+	unsigned i;
+
+	if (hsusb_read_slots[0].req)
+		return 0;
+
+	for (i = 0; i < HSUSB_READ_REQS; i++) {
+		hsusb_read_slots[i].req = udc_request_alloc();
+		if (!hsusb_read_slots[i].req)
+			return -1;
+		hsusb_read_slots[i].req->context = &hsusb_read_slots[i];
+		event_init(&hsusb_read_slots[i].done, 0, EVENT_FLAG_AUTOUNSIGNAL);
+	}
+
+	return 0;
+}
+
+/*
+ * Reads len bytes as a stream of HSUSB_READ_CHUNK requests. HSUSB_READ_REQS
+ * of them stay queued on the OUT endpoint, so when one dTD chain retires the
+ * controller primes the next from its completion interrupt instead of
+ * waiting for this thread to wake up and queue it.
+ */
 static int hsusb_usb_read(void *_buf, unsigned len)
 {
-	int r;
-	unsigned xfer;
+	struct usb_read_slot *slot;
 	unsigned char *buf = _buf;
+	unsigned queued = 0;
+	unsigned head = 0;
+	unsigned inflight = 0;
+	unsigned xfer;
 	int count = 0;
 
 	if (fastboot_state == STATE_ERROR)
 		goto oops;
 
-	while (len > 0) {
-		xfer = (len > MAX_USBFS_BULK_SIZE) ? MAX_USBFS_BULK_SIZE : len;
-		req->buf = (unsigned char *)PA((addr_t)buf);
-		req->length = xfer;
-		req->complete = req_complete;
-		r = udc_request_queue(out, req);
-		if (r < 0) {
-			dprintf(INFO, "usb_read() queue failed\n");
-			goto oops;
+	if (hsusb_read_init()) {
+		dprintf(INFO, "usb_read() request alloc failed\n");
+		goto oops;
+	}
+
+	for (;;) {
+		/* Keep the queue topped up */
+		while (inflight < HSUSB_READ_REQS && queued < len) {
+			slot = &hsusb_read_slots[(head + inflight) % HSUSB_READ_REQS];
+			xfer = MIN(len - queued, HSUSB_READ_CHUNK);
+			slot->xfer = xfer;
+			slot->req->buf = (unsigned char *)PA((addr_t)(buf + queued));
+			slot->req->length = xfer;
+			slot->req->complete = usb_read_complete;
+			/* A request cancelled as it completed may have left this set */
+			event_unsignal(&slot->done);
+			if (udc_request_queue(out, slot->req) < 0) {
+				dprintf(INFO, "usb_read() queue failed\n");
+				goto cancel;
+			}
+			queued += xfer;
+			inflight++;
 		}
-		event_wait(&txn_done);
 
-		if (txn_status < 0) {
+		if (!inflight)
+			break;
+
+		slot = &hsusb_read_slots[head];
+		event_wait(&slot->done);
+		head = (head + 1) % HSUSB_READ_REQS;
+		inflight--;
+
+		if (slot->status < 0) {
 			dprintf(INFO, "usb_read() transaction failed\n");
-			goto oops;
+			goto cancel;
 		}
 
-		count += req->length;
-		buf += req->length;
-		len -= req->length;
+		count += slot->req->length;
 
 		/* short transfer? */
-		if (req->length != xfer) break;
+		if (slot->req->length != slot->xfer)
+			break;
 	}
+
+	/* The host ended the transfer early, nothing will land in the rest */
+	for (; inflight; inflight--, head = (head + 1) % HSUSB_READ_REQS)
+		udc_request_cancel(out, hsusb_read_slots[head].req);
+
 	/*
 	 * Force reload of buffer from memory
 	 * since transaction is complete now.
@@ -343,6 +512,9 @@ static int hsusb_usb_read(void *_buf, unsigned len)
 	arch_invalidate_cache_range((addr_t)_buf, ROUNDUP(count, CACHE_LINE));
 	return count;
 
+cancel:
+	for (; inflight; inflight--, head = (head + 1) % HSUSB_READ_REQS)
+		udc_request_cancel(out, hsusb_read_slots[head].req);
 oops:
 	fastboot_state = STATE_ERROR;
 	return -1;
@@ -471,6 +643,197 @@ static void cmd_getvar(const char *arg, void *data, unsigned sz)
 	fastboot_okay("");
 }
 
+void fastboot_set_stream_sink(struct fastboot_stream_sink *sink)
+{
+	stream_sink = sink;
+}
+
+/* Drains filled ring slots into the sink until the zero length end marker */
+static int stream_writer(void *arg)
+{
+	struct stream_slot *slot;
+	unsigned i = 0;
+
+	for (;;) {
+		slot = &stream_ring[i];
+		event_wait(&slot->full);
+		if (!slot->len)
+			break;
+
+		if (!stream_status)
+			stream_status = stream_sink->write(stream_sink->cookie,
+							   slot->buf, slot->len);
+
+		event_signal(&slot->empty, false);
+		i = (i + 1) % STREAM_RING_SLOTS;
+	}
+
+	event_signal(&stream_done, false);
+	return 0;
+}
+
+/* Hand a filled slot (or the end marker when len is 0) to the writer */
+static void stream_queue_slot(struct stream_slot *slot, unsigned len)
+{
+	slot->len = len;
+	event_signal(&slot->full, true);
+}
+
+/*
+ * Receive a download straight into the sink. USB fills one ring slot while
+ * the writer thread commits the previous ones, so the transfer costs about
+ * max(usb, storage) rather than their sum and is not bound by download_max.
+ */
+static void cmd_download_stream(unsigned len)
+{
+	STACKBUF_DMA_ALIGN(response, MAX_RSP_SIZE);
+	struct stream_slot *slot;
+	unsigned slot_size;
+	unsigned xfer;
+	unsigned i;
+	thread_t *thr;
+	int r;
+
+	slot_size = MIN(STREAM_SLOT_SIZE, download_max / STREAM_RING_SLOTS);
+	slot_size = ROUNDDOWN(slot_size, 4096);
+	if (!slot_size) {
+		fastboot_fail("download buffer too small for streaming");
+		return;
+	}
+
+	stream_status = stream_sink->start(stream_sink->cookie, len);
+	if (stream_status) {
+		fastboot_fail("stream start failed");
+		return;
+	}
+
+	for (i = 0; i < STREAM_RING_SLOTS; i++) {
+		stream_ring[i].buf = (uint8_t *) download_base + i * slot_size;
+		stream_ring[i].len = 0;
+		event_init(&stream_ring[i].full, false, EVENT_FLAG_AUTOUNSIGNAL);
+		event_init(&stream_ring[i].empty, true, EVENT_FLAG_AUTOUNSIGNAL);
+	}
+	event_init(&stream_done, false, EVENT_FLAG_AUTOUNSIGNAL);
+
+	thr = thread_create("fastboot_stream", stream_writer, NULL,
+			    DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+	if (!thr) {
+		fastboot_fail("stream thread create failed");
+		return;
+	}
+	thread_resume(thr);
+
+	i = 0;
+	snprintf((char *)response, MAX_RSP_SIZE, "DATA%08x", len);
+	if (usb_if.usb_write(response, strlen((const char *)response)) < 0) {
+		fastboot_state = STATE_ERROR;
+		goto stop_writer;
+	}
+
+	for (; len > 0; i = (i + 1) % STREAM_RING_SLOTS) {
+		slot = &stream_ring[i];
+		xfer = MIN(len, slot_size);
+
+		/* Wait for the writer to release this slot */
+		event_wait(&slot->empty);
+
+		arch_invalidate_cache_range((addr_t) slot->buf, ROUNDUP(xfer, CACHE_LINE));
+		r = usb_if.usb_read(slot->buf, xfer);
+		if ((r < 0) || ((unsigned) r != xfer)) {
+			fastboot_state = STATE_ERROR;
+			/* This slot is already ours, use it for the end marker */
+			stream_queue_slot(slot, 0);
+			goto wait_writer;
+		}
+
+		stream_queue_slot(slot, xfer);
+		len -= xfer;
+	}
+
+stop_writer:
+	event_wait(&stream_ring[i].empty);
+	stream_queue_slot(&stream_ring[i], 0);
+wait_writer:
+	event_wait(&stream_done);
+
+	if (fastboot_state == STATE_ERROR)
+		return;
+
+	if (!stream_status)
+		stream_status = stream_sink->finish(stream_sink->cookie);
+
+	if (stream_status)
+		fastboot_fail("stream write failed");
+	else
+		fastboot_okay("");
+}
+
+void fastboot_set_scatter_sink(struct fastboot_scatter_sink *sink)
+{
+	scatter_sink = sink;
+}
+
+/*
+ * Receive a download in segments placed by the sink, so data can land at
+ * its final address instead of being staged and copied there afterwards.
+ */
+static void cmd_download_scatter(unsigned len)
+{
+	STACKBUF_DMA_ALIGN(response, MAX_RSP_SIZE);
+	unsigned drain_max = ROUNDDOWN(download_max, FASTBOOT_SCATTER_ALIGN);
+	unsigned offset = 0;
+	unsigned xfer;
+	void *dest;
+	int status;
+	int r;
+
+	status = scatter_sink->start(scatter_sink->cookie, download_base,
+				     download_max, len);
+	if (status) {
+		fastboot_fail("scatter start failed");
+		return;
+	}
+
+	snprintf((char *)response, MAX_RSP_SIZE, "DATA%08x", len);
+	if (usb_if.usb_write(response, strlen((const char *)response)) < 0)
+		return;
+
+	while (offset < len) {
+		if (!status) {
+			status = scatter_sink->map(scatter_sink->cookie, offset,
+						   &dest, &xfer);
+			if (!status && (!xfer || xfer > len - offset ||
+			    ((xfer != len - offset) && (xfer % FASTBOOT_SCATTER_ALIGN)))) {
+				dprintf(CRITICAL, "scatter: bad segment of %u at %u\n",
+					xfer, offset);
+				status = -1;
+			}
+		}
+
+		/* After a failure the rest is read into the download buffer */
+		if (status) {
+			dest = download_base;
+			xfer = MIN(len - offset, drain_max);
+		}
+
+		arch_invalidate_cache_range((addr_t) dest, ROUNDUP(xfer, CACHE_LINE));
+		r = usb_if.usb_read(dest, xfer);
+		if ((r < 0) || ((unsigned) r != xfer)) {
+			fastboot_state = STATE_ERROR;
+			return;
+		}
+		offset += xfer;
+	}
+
+	if (!status)
+		status = scatter_sink->finish(scatter_sink->cookie);
+
+	if (status)
+		fastboot_fail("scatter download failed");
+	else
+		fastboot_okay("");
+}
+
 static void cmd_download(const char *arg, void *data, unsigned sz)
 {
 	STACKBUF_DMA_ALIGN(response, MAX_RSP_SIZE);
@@ -478,6 +841,16 @@ static void cmd_download(const char *arg, void *data, unsigned sz)
 	int r;
 
 	download_size = 0;
+	if (stream_sink) {
+		cmd_download_stream(len);
+		return;
+	}
+
+	if (scatter_sink) {
+		cmd_download_scatter(len);
+		return;
+	}
+
 	if (len > download_max) {
 		fastboot_fail("data too large");
 		return;
@@ -53,6 +53,53 @@ void fastboot_okay(const char *result);
 void fastboot_fail(const char *reason);
 void fastboot_info(const char *reason);
 
+/* streaming download sink
+ * - while a sink is installed, download: data is not staged in the
+ *   download buffer but handed to write() piece by piece from a worker
+ *   thread, while the next piece is still arriving over usb
+ * - start() is called with the total download length before data is
+ *   accepted, finish() once all of it was written
+ * - each callback returns 0 on success; after a failure the remainder of
+ *   the download is drained and discarded and the host gets a FAIL
+ */
+struct fastboot_stream_sink {
+	int (*start)(void *cookie, unsigned total);
+	int (*write)(void *cookie, void *buf, unsigned len);
+	int (*finish)(void *cookie);
+	void *cookie;
+};
+
+/* install (or remove with NULL) the streaming download sink */
+void fastboot_set_stream_sink(struct fastboot_stream_sink *sink);
+
+/* every scatter segment but the last is a multiple of the usb max packet */
+#define FASTBOOT_SCATTER_ALIGN  1024
+
+/* scatter download sink
+ * - while a sink is installed (and no stream sink is), download: data is
+ *   received in segments that usb dma places where map() says, rather
+ *   than as one block at the start of the download buffer
+ * - start() is called with the download buffer and the total download
+ *   length before data is accepted, finish() once all of it arrived
+ * - map() is called at each segment boundary with the download offset
+ *   reached so far; the data before it is already in memory. It returns
+ *   a cache line aligned destination and the segment length, which must
+ *   be a multiple of FASTBOOT_SCATTER_ALIGN unless it ends the download
+ * - the download buffer holds no image afterwards, command handlers see
+ *   a zero download size
+ * - each callback returns 0 on success; after a failure the remainder of
+ *   the download is drained and discarded and the host gets a FAIL
+ */
+struct fastboot_scatter_sink {
+	int (*start)(void *cookie, void *base, unsigned max, unsigned total);
+	int (*map)(void *cookie, unsigned offset, void **dest, unsigned *len);
+	int (*finish)(void *cookie);
+	void *cookie;
+};
+
+/* install (or remove with NULL) the scatter download sink */
+void fastboot_set_scatter_sink(struct fastboot_scatter_sink *sink);
+
 /* required for upload command
  * should be called before calling upload
  */
@@ -1,10 +1,11 @@
 LOCAL_DIR := $(GET_LOCAL_DIR)
 
-INCLUDES += -I$(LK_TOP_DIR)/platform/msm_shared/include -I$(LK_TOP_DIR)/lib/zlib_inflate
+INCLUDES += -I$(LK_TOP_DIR)/platform/msm_shared/include -I$(LK_TOP_DIR)/lib/zlib_inflate \
+	    -I$(LK_TOP_DIR)/lib/decompress
 
 DEFINES += ASSERT_ON_TAMPER=1
 
-MODULES += lib/zlib_inflate
+MODULES += lib/decompress
 
 OBJS += \
 	$(LOCAL_DIR)/aboot.o \
@@ -1,7 +1,9 @@
 LOCAL_DIR := $(GET_LOCAL_DIR)
 
 MODULES += \
-	lib/openssl
+	lib/openssl \
+	lib/sha2 \
+	lib/rsa
 
 ifeq ($(ENABLE_UNITTEST_FW), 1)
 MODULES += \
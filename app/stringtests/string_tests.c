@@ -39,52 +39,65 @@ static uint8_t *dst2;
 extern void *mymemcpy(void *dst, const void *src, size_t len);
 extern void *mymemset(void *dst, int c, size_t len);
 
-static void *null_memcpy(void *dst, const void *src, size_t len)
+/* bytewise memcmp, the generic C version, as the reference */
+static int mymemcmp(const void *s1, const void *s2, size_t len)
 {
-	return dst;
+	const unsigned char *p1 = s1, *p2 = s2;
+
+	for (; len > 0; p1++, p2++, len--)
+		if (*p1 != *p2)
+			return *p1 - *p2;
+	return 0;
+}
+
+/* sizes and alignments the bandwidth benchmarks sweep */
+static const size_t bench_sizes[] = { 16, 64, 256, 1024, 4096, 65536, BUFFER_SIZE };
+static const size_t bench_aligns[] = { 0, 1, 4, 8 };
+
+/* every measurement moves this many bytes, whatever the call size */
+#define BENCH_BYTES ((uint64_t)BUFFER_SIZE * ITERATIONS)
+
+static unsigned mbps(time_t msecs)
+{
+	if (!msecs)
+		msecs = 1;
+	return BENCH_BYTES * 1000ULL / msecs / (1024 * 1024);
 }
 
-static time_t bench_memcpy_routine(void *memcpy_routine(void *, const void *, size_t), size_t srcalign, size_t dstalign)
+static time_t bench_memcpy_routine(void *memcpy_routine(void *, const void *, size_t),
+		size_t size, size_t srcalign, size_t dstalign)
 {
-	int i;
+	size_t i, count = BENCH_BYTES / size;
 	time_t t0;
 
 	t0 = current_time();
-	for (i=0; i < ITERATIONS; i++) {
-		memcpy_routine(dst + dstalign, src + srcalign, BUFFER_SIZE);
+	for (i = 0; i < count; i++) {
+		memcpy_routine(dst + dstalign, src + srcalign, size);
 	}
 	return current_time() - t0;
 }
 
 static void bench_memcpy(void)
 {
-	time_t null, libc, mine;
-	size_t srcalign, dstalign;
-	
-	printf("memcpy speed test\n");
-	thread_sleep(200); // let the debug string clear the serial port
-
-	for (srcalign = 0; srcalign < 64; ) {
-		for (dstalign = 0; dstalign < 64; ) {
-
-			null = bench_memcpy_routine(&null_memcpy, srcalign, dstalign);
-			libc = bench_memcpy_routine(&memcpy, srcalign, dstalign);
-			mine = bench_memcpy_routine(&mymemcpy, srcalign, dstalign);
+	time_t libc, mine;
+	size_t s, sa, da;
 
-			printf("srcalign %lu, dstalign %lu\n", srcalign, dstalign);
-			printf("   null memcpy %u msecs\n", null);
-			printf("   libc memcpy %u msecs, %llu bytes/sec\n", libc, BUFFER_SIZE * ITERATIONS * 1000ULL / libc);
-			printf("   my   memcpy %u msecs, %llu bytes/sec\n", mine, BUFFER_SIZE * ITERATIONS * 1000ULL / mine);
+	printf("memcpy bandwidth in MB/s, libc against the integer-only my version\n");
+	thread_sleep(200); // let the debug string clear the serial port
 
-			if (dstalign == 0)
-				dstalign = 1;
-			else 
-				dstalign <<= 1;
+	for (s = 0; s < countof(bench_sizes); s++) {
+		for (sa = 0; sa < countof(bench_aligns); sa++) {
+			for (da = 0; da < countof(bench_aligns); da++) {
+				libc = bench_memcpy_routine(&memcpy, bench_sizes[s],
+						bench_aligns[sa], bench_aligns[da]);
+				mine = bench_memcpy_routine(&mymemcpy, bench_sizes[s],
+						bench_aligns[sa], bench_aligns[da]);
+
+				printf("size %7zu srcalign %zu dstalign %zu: libc %5u, my %5u\n",
+					bench_sizes[s], bench_aligns[sa], bench_aligns[da],
+					mbps(libc), mbps(mine));
+			}
 		}
-		if (srcalign == 0)
-			srcalign = 1;
-		else 
-			srcalign <<= 1;
 	}
 }
 
@@ -167,14 +180,15 @@ static void validate_memcpy_overlap(void)
 	}
 }
 
-static time_t bench_memset_routine(void *memset_routine(void *, int, size_t), size_t dstalign)
+static time_t bench_memset_routine(void *memset_routine(void *, int, size_t),
+		size_t size, size_t dstalign)
 {
-	int i;
+	size_t i, count = BENCH_BYTES / size;
 	time_t t0;
 
 	t0 = current_time();
-	for (i=0; i < ITERATIONS; i++) {
-		memset_routine(dst + dstalign, 0, BUFFER_SIZE);
+	for (i = 0; i < count; i++) {
+		memset_routine(dst + dstalign, 0, size);
 	}
 	return current_time() - t0;
 }
@@ -182,19 +196,60 @@ static time_t bench_memset_routine(void *memset_routine(void *, int, size_t), si
 static void bench_memset(void)
 {
 	time_t libc, mine;
-	size_t dstalign;
-	
-	printf("memset speed test\n");
+	size_t s, da;
+
+	printf("memset bandwidth in MB/s, libc against the integer-only my version\n");
 	thread_sleep(200); // let the debug string clear the serial port
 
-	for (dstalign = 0; dstalign < 64; dstalign++) {
+	for (s = 0; s < countof(bench_sizes); s++) {
+		for (da = 0; da < countof(bench_aligns); da++) {
+			libc = bench_memset_routine(&memset, bench_sizes[s], bench_aligns[da]);
+			mine = bench_memset_routine(&mymemset, bench_sizes[s], bench_aligns[da]);
 
-		libc = bench_memset_routine(&memset, dstalign);
-		mine = bench_memset_routine(&mymemset, dstalign);
+			printf("size %7zu dstalign %zu: libc %5u, my %5u\n",
+				bench_sizes[s], bench_aligns[da], mbps(libc), mbps(mine));
+		}
+	}
+}
 
-		printf("dstalign %lu\n", dstalign);
-		printf("   libc memset %u msecs, %llu bytes/sec\n", libc, BUFFER_SIZE * ITERATIONS * 1000ULL / libc);
-		printf("   my   memset %u msecs, %llu bytes/sec\n", mine, BUFFER_SIZE * ITERATIONS * 1000ULL / mine);
+static time_t bench_memcmp_routine(int memcmp_routine(const void *, const void *, size_t),
+		size_t size, size_t srcalign, size_t dstalign)
+{
+	size_t i, count = BENCH_BYTES / size;
+	time_t t0;
+
+	t0 = current_time();
+	for (i = 0; i < count; i++) {
+		memcmp_routine(dst + dstalign, src + srcalign, size);
+	}
+	return current_time() - t0;
+}
+
+static void bench_memcmp(void)
+{
+	time_t libc, mine;
+	size_t s, sa, da;
+
+	printf("memcmp bandwidth in MB/s, libc against the bytewise my version\n");
+	thread_sleep(200); // let the debug string clear the serial port
+
+	for (s = 0; s < countof(bench_sizes); s++) {
+		for (sa = 0; sa < countof(bench_aligns); sa++) {
+			for (da = 0; da < countof(bench_aligns); da++) {
+				/* equal buffers, so the whole length is compared */
+				memset(src + bench_aligns[sa], 0x5a, bench_sizes[s]);
+				memset(dst + bench_aligns[da], 0x5a, bench_sizes[s]);
+
+				libc = bench_memcmp_routine(&memcmp, bench_sizes[s],
+						bench_aligns[sa], bench_aligns[da]);
+				mine = bench_memcmp_routine(&mymemcmp, bench_sizes[s],
+						bench_aligns[sa], bench_aligns[da]);
+
+				printf("size %7zu srcalign %zu dstalign %zu: libc %5u, my %5u\n",
+					bench_sizes[s], bench_aligns[sa], bench_aligns[da],
+					mbps(libc), mbps(mine));
+			}
+		}
 	}
 }
 
@@ -226,6 +281,42 @@ static void validate_memset(void)
 	}
 }
 
+static int sign(int x)
+{
+	return (x > 0) - (x < 0);
+}
+
+static void validate_memcmp(void)
+{
+	size_t srcalign, dstalign, size, pos;
+	const size_t maxsize = 256;
+
+	printf("testing memcmp for correctness\n");
+
+	for (srcalign = 0; srcalign < 64; srcalign++) {
+		for (dstalign = 0; dstalign < 64; dstalign++) {
+			for (size = 0; size < maxsize; size++) {
+				fillbuf(src + srcalign, size, 567);
+				fillbuf(dst + dstalign, size, 567);
+
+				if (memcmp(dst + dstalign, src + srcalign, size) != 0)
+					printf("error! srcalign %zu, dstalign %zu, size %zu\n",
+						srcalign, dstalign, size);
+
+				/* a single differing byte at each end and in between */
+				for (pos = 0; pos < size; pos += (size / 3) ? (size / 3) : 1) {
+					dst[dstalign + pos] ^= 0x80;
+					if (sign(memcmp(dst + dstalign, src + srcalign, size)) !=
+					    sign(mymemcmp(dst + dstalign, src + srcalign, size)))
+						printf("error! srcalign %zu, dstalign %zu, size %zu, pos %zu\n",
+							srcalign, dstalign, size, pos);
+					dst[dstalign + pos] ^= 0x80;
+				}
+			}
+		}
+	}
+}
+
 #if defined(WITH_LIB_CONSOLE)
 #include <lib/console.h>
 
@@ -254,12 +345,20 @@ usage:
 			validate_memset();
 		} else if (!strcmp(argv[2].str, "memcpy_overlap")) {
 			validate_memcpy_overlap();
+		} else if (!strcmp(argv[2].str, "memcmp")) {
+			validate_memcmp();
 		}
 	} else if (!strcmp(argv[1].str, "bench")) {
 		if (!strcmp(argv[2].str, "memcpy")) {
 			bench_memcpy();
 		} else if (!strcmp(argv[2].str, "memset")) {
 			bench_memset();
+		} else if (!strcmp(argv[2].str, "memcmp")) {
+			bench_memcmp();
+		} else if (!strcmp(argv[2].str, "all")) {
+			bench_memcpy();
+			bench_memset();
+			bench_memcmp();
 		}
 	} else {
 		goto usage;
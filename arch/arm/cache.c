@@ -30,6 +30,10 @@
  #include <arch/defines.h>
  #include <stdlib.h>
  #include <arch/ops.h>
+ #include <arch/arm.h>
+ #include <arch/arm/mmu.h>
+ #include <kernel/smp.h>
+ #include <string.h>
 
  void cache_clean_invalidate_unaligned_start_addr(addr_t start, size_t size)
  {
@@ -41,3 +45,212 @@
 
 	arch_clean_invalidate_cache_range(actual_start, actual_size);
  }
+
+#if ARM_WITH_CACHE
+
+/* Ranges of at least this many bytes are cleaned through a set/way walk of
+ * the whole data cache instead of line by line. The walk costs about as much
+ * as maintaining a range the size of all cache levels together, which is at
+ * most around 1MB on the cores this runs on. Zero disables the walk.
+ */
+#ifndef ARM_CACHE_WHOLE_THRESHOLD
+#define ARM_CACHE_WHOLE_THRESHOLD	(2 * 1024 * 1024)
+#endif
+
+/* Per caller statistics, the last slot collects callers that did not fit */
+#define ARM_CACHE_STATS_CALLERS		16
+
+enum {
+	CACHE_OP_CLEAN,
+	CACHE_OP_CLEAN_INVALIDATE,
+	CACHE_OP_INVALIDATE,
+};
+
+static size_t whole_threshold = ARM_CACHE_WHOLE_THRESHOLD;
+static bool stats_enabled;
+static struct arm_cache_stats stats[ARM_CACHE_STATS_CALLERS];
+
+static inline uint32_t cache_irq_save(void)
+{
+	uint32_t cpsr;
+
+	__asm__ volatile("mrs %0, cpsr\n\tcpsid i" : "=r" (cpsr) :: "memory");
+	return cpsr;
+}
+
+static inline void cache_irq_restore(uint32_t cpsr)
+{
+	__asm__ volatile("msr cpsr_c, %0" :: "r" (cpsr) : "memory");
+}
+
+#if ARM_CPU_CORTEX_A8
+static inline uint32_t cache_cycles(void)
+{
+	uint32_t val;
+
+	__asm__ volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (val));
+	return val;
+}
+
+static void cache_cycles_enable(void)
+{
+	uint32_t val;
+
+	/* enable the PMU and its cycle counter */
+	__asm__ volatile("mrc p15, 0, %0, c9, c12, 0" : "=r" (val));
+	__asm__ volatile("mcr p15, 0, %0, c9, c12, 0" :: "r" (val | 0x1));
+	__asm__ volatile("mcr p15, 0, %0, c9, c12, 1" :: "r" (1U << 31));
+}
+#else
+static inline uint32_t cache_cycles(void)
+{
+	return 0;
+}
+
+static void cache_cycles_enable(void)
+{
+}
+#endif
+
+static void cache_stats_account(void *caller, size_t len, bool whole, bool skipped, uint32_t cycles)
+{
+	struct arm_cache_stats *st;
+	uint32_t cpsr;
+	unsigned i;
+
+	cpsr = cache_irq_save();
+
+	for (i = 0; i < ARM_CACHE_STATS_CALLERS - 1; i++) {
+		if (stats[i].caller == caller || !stats[i].caller)
+			break;
+	}
+
+	st = &stats[i];
+	if (i < ARM_CACHE_STATS_CALLERS - 1)
+		st->caller = caller;
+
+	st->calls++;
+	st->bytes += len;
+	st->cycles += cycles;
+	if (whole)
+		st->whole++;
+	if (skipped)
+		st->skipped++;
+
+	cache_irq_restore(cpsr);
+}
+
+static void cache_op(int op, addr_t start, size_t len, void *caller)
+{
+	bool whole = false;
+	bool skipped = false;
+	uint32_t begin = 0;
+
+	if (stats_enabled)
+		begin = cache_cycles();
+
+#if ARM_WITH_MMU
+	/* nothing of a non-cacheable mapping can be in the cache */
+	skipped = !arm_mmu_range_cacheable(start, len);
+#endif
+
+#if ARM_CPU_CORTEX_A8
+	/* Invalidation is never widened: discarding the whole cache loses
+	 * other dirty data, and cleaning it instead could write stale lines
+	 * over what a device has just put in memory.
+	 */
+	whole = !skipped && op != CACHE_OP_INVALIDATE &&
+			whole_threshold && len >= whole_threshold;
+#if WITH_SMP
+	/* the set/way walk only reaches this core's L1, lines another core
+	 * dirtied are only found by the range ops, which are broadcast
+	 */
+	if (smp_cpus_online() > 1)
+		whole = false;
+#endif
+#endif
+
+	if (skipped) {
+		/* order earlier accesses against the device as the range ops do */
+		dsb();
+	}
+#if ARM_CPU_CORTEX_A8
+	else if (whole) {
+		if (op == CACHE_OP_CLEAN)
+			arm_clean_dcache_all();
+		else
+			arm_clean_invalidate_dcache_all();
+	}
+#endif
+	else if (op == CACHE_OP_CLEAN)
+		arm_clean_cache_range_mva(start, len);
+	else if (op == CACHE_OP_CLEAN_INVALIDATE)
+		arm_clean_invalidate_cache_range_mva(start, len);
+	else
+		arm_invalidate_cache_range_mva(start, len);
+
+	if (stats_enabled)
+		cache_stats_account(caller, len, whole, skipped, cache_cycles() - begin);
+}
+
+void arch_clean_cache_range(addr_t start, size_t len)
+{
+	cache_op(CACHE_OP_CLEAN, start, len, __builtin_return_address(0));
+}
+
+void arch_clean_invalidate_cache_range(addr_t start, size_t len)
+{
+	cache_op(CACHE_OP_CLEAN_INVALIDATE, start, len, __builtin_return_address(0));
+}
+
+void arch_invalidate_cache_range(addr_t start, size_t len)
+{
+	cache_op(CACHE_OP_INVALIDATE, start, len, __builtin_return_address(0));
+}
+
+void arm_cache_set_whole_threshold(size_t len)
+{
+	whole_threshold = len;
+}
+
+size_t arm_cache_get_whole_threshold(void)
+{
+	return whole_threshold;
+}
+
+void arm_cache_stats_enable(bool enable)
+{
+	if (enable)
+		cache_cycles_enable();
+
+	stats_enabled = enable;
+}
+
+void arm_cache_stats_reset(void)
+{
+	uint32_t cpsr;
+
+	cpsr = cache_irq_save();
+	memset(stats, 0, sizeof(stats));
+	cache_irq_restore(cpsr);
+}
+
+bool arm_cache_stats_get(unsigned idx, struct arm_cache_stats *out)
+{
+	uint32_t cpsr;
+	bool ret = false;
+
+	if (idx >= ARM_CACHE_STATS_CALLERS)
+		return false;
+
+	cpsr = cache_irq_save();
+	if (stats[idx].calls) {
+		*out = stats[idx];
+		ret = true;
+	}
+	cache_irq_restore(cpsr);
+
+	return ret;
+}
+
+#endif // ARM_WITH_CACHE
@@ -77,6 +77,10 @@ void arm_syscall_handler(struct arm_fault_frame *frame)
 
 void arm_undefined_handler(struct arm_fault_frame *frame)
 {
+#if ARM_WITH_NEON
+	if (arm_neon_trap(frame))
+		return;
+#endif
 	exception_die(frame, -4, "undefined abort, halting\n");
 }
 
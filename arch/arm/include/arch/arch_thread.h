@@ -25,6 +25,13 @@
 
 struct arch_thread {
 	vaddr_t sp;
+#if ARM_WITH_NEON
+	/* d0-d31 and fpscr, saved when the thread is switched out after
+	 * using NEON, loaded again on its next NEON instruction
+	 */
+	uint64_t fpregs[32];
+	uint32_t fpscr;
+#endif
 };
 
 #endif
@@ -32,6 +32,11 @@ extern "C" {
 
 void arm_context_switch(vaddr_t *old_sp, vaddr_t new_sp);
 
+#if ARM_WITH_NEON
+/* set once arch_early_init has turned on VFP/NEON */
+extern uint32_t arm_neon_enabled;
+#endif
+
 static inline uint32_t read_cpsr() {
 	uint32_t cpsr;
 
@@ -91,6 +96,50 @@ void arm_write_mair1(uint32_t);
 void arm_write_ttbcr(uint32_t);
 void dump_fault_frame(struct arm_fault_frame *frame);
 
+#if ARM_WITH_NEON
+/* true if the undefined instruction was a NEON trap, see thread.c */
+bool arm_neon_trap(struct arm_fault_frame *frame);
+#endif
+
+#if ARM_ISA_ARMV7
+/* ARMv8 CRC32 instructions in AArch32, see arch/arm/crc32.S */
+int arm_has_crc32(void);
+uint32_t arm_crc32_update(uint32_t crc, const void *buf, size_t len);
+#endif
+
+#if ARM_WITH_CACHE
+/* Maintenance by MVA, see arch/arm/cache-ops.S. The arch_*_cache_range()
+ * calls in arch/arm/cache.c choose between these, a whole cache walk and
+ * no maintenance at all.
+ */
+void arm_clean_cache_range_mva(addr_t start, size_t len);
+void arm_clean_invalidate_cache_range_mva(addr_t start, size_t len);
+void arm_invalidate_cache_range_mva(addr_t start, size_t len);
+#if ARM_CPU_CORTEX_A8
+/* clean (and invalidate) every data cache level by set/way */
+void arm_clean_dcache_all(void);
+void arm_clean_invalidate_dcache_all(void);
+#endif
+
+/* Cache maintenance done on behalf of one caller since the last reset */
+struct arm_cache_stats {
+	void *caller;		/* return address, NULL for the overflow slot */
+	uint32_t calls;
+	uint32_t whole;		/* done as a whole cache walk */
+	uint32_t skipped;	/* range mapped non-cacheable */
+	uint64_t bytes;
+	uint64_t cycles;	/* cpu cycles, zero if there is no cycle counter */
+};
+
+/* ranges of at least len bytes are cleaned by a whole cache walk, 0 = never */
+void arm_cache_set_whole_threshold(size_t len);
+size_t arm_cache_get_whole_threshold(void);
+void arm_cache_stats_enable(bool enable);
+void arm_cache_stats_reset(void);
+/* Copies out caller slot idx, returns false once idx is past the last used slot */
+bool arm_cache_stats_get(unsigned idx, struct arm_cache_stats *out);
+#endif
+
 #if defined(__cplusplus)
 }
 #endif
@@ -52,6 +52,9 @@ void arm_mmu_init(void);
 #define MMU_MEMORY_APX_READ_ONLY    (0x1 << 15)
 
 #define MMU_MEMORY_XN               (0x1 << 4)
+
+/* map a range of 1MB sections, size in MB, with one tlb flush */
+void arm_mmu_map_range(addr_t paddr, addr_t vaddr, uint32_t num_of_sections, uint flags);
 #else /* LPAE */
 
 typedef enum
@@ -114,6 +117,8 @@ typedef enum
 #define MAIR1                  0xbbaaccff
 #include <mmu.h>
 void arm_mmu_map_entry(mmu_section_t *entry);
+/* map a table of entries with one tlb flush */
+void arm_mmu_map_entries(mmu_section_t *table, uint32_t count);
 #endif /* LPAE */
 
 #else
@@ -124,6 +129,8 @@ void arm_mmu_map_entry(mmu_section_t *entry);
 
 void arm_mmu_map_section(addr_t paddr, addr_t vaddr, uint flags);
 uint64_t virtual_to_physical_mapping(uint32_t vaddr);
+/* false only if the whole range is mapped with a non-cacheable type */
+bool arm_mmu_range_cacheable(addr_t start, size_t len);
 uint32_t physical_to_virtual_mapping(uint64_t paddr);
 
 #if defined(__cplusplus)
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __ARCH_ARM_SMP_H
+#define __ARCH_ARM_SMP_H
+
+/* Boot state for the secondary cores, filled in by arch_smp_prepare() and
+ * read by arm_secondary_entry with the mmu and caches still off.
+ */
+#define ARM_SMP_BOOT_SCTLR	0x00
+#define ARM_SMP_BOOT_VBAR	0x04
+#define ARM_SMP_BOOT_TTBCR	0x08
+#define ARM_SMP_BOOT_TTBR0_LO	0x0c
+#define ARM_SMP_BOOT_TTBR0_HI	0x10
+#define ARM_SMP_BOOT_DACR	0x14	/* MAIR0 with LPAE */
+#define ARM_SMP_BOOT_MAIR1	0x18
+#define ARM_SMP_BOOT_STACKS	0x1c
+
+#ifndef ASSEMBLY
+#include <sys/types.h>
+
+struct arm_smp_boot {
+	uint32_t sctlr;
+	uint32_t vbar;
+	uint32_t ttbcr;
+	uint32_t ttbr0_lo;
+	uint32_t ttbr0_hi;
+	uint32_t dacr;
+	uint32_t mair1;
+	uint32_t stacks[SMP_MAX_CPUS];
+};
+
+extern struct arm_smp_boot arm_smp_boot;
+
+void arm_secondary_entry(void);
+#endif
+
+#endif
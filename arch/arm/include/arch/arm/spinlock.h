@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __ARCH_ARM_SPINLOCK_H
+#define __ARCH_ARM_SPINLOCK_H
+
+#include <compiler.h>
+#include <arch/defines.h>
+
+static inline __ALWAYS_INLINE void arch_spin_lock(volatile unsigned int *lock)
+{
+	unsigned int tmp;
+
+	/* wait for the holder's sev while the lock is taken */
+	__asm__ volatile(
+		"1:	ldrex	%0, [%1]\n"
+		"	cmp	%0, #0\n"
+		"	beq	2f\n"
+		"	wfe\n"
+		"	b	1b\n"
+		"2:	strex	%0, %2, [%1]\n"
+		"	cmp	%0, #0\n"
+		"	bne	1b\n"
+		: "=&r" (tmp)
+		: "r" (lock), "r" (1)
+		: "cc", "memory");
+
+	dmb();
+}
+
+static inline __ALWAYS_INLINE int arch_spin_trylock(volatile unsigned int *lock)
+{
+	unsigned int tmp;
+
+	__asm__ volatile(
+		"1:	ldrex	%0, [%1]\n"
+		"	cmp	%0, #0\n"
+		"	bne	2f\n"
+		"	strex	%0, %2, [%1]\n"
+		"	cmp	%0, #0\n"
+		"	bne	1b\n"
+		"	b	3f\n"
+		"2:	clrex\n"
+		"3:\n"
+		: "=&r" (tmp)
+		: "r" (lock), "r" (1)
+		: "cc", "memory");
+
+	if (tmp)
+		return 0;
+
+	dmb();
+	return 1;
+}
+
+static inline __ALWAYS_INLINE void arch_spin_unlock(volatile unsigned int *lock)
+{
+	dmb();
+	*lock = 0;
+	dsb();
+	__asm__ volatile("sev" : : : "memory");
+}
+
+/* Sleep until another core signals an event (or an interrupt arrives) */
+static inline __ALWAYS_INLINE void arch_cpu_wait_event(void)
+{
+	__asm__ volatile("wfe" : : : "memory");
+}
+
+static inline __ALWAYS_INLINE void arch_cpu_send_event(void)
+{
+	dsb();
+	__asm__ volatile("sev" : : : "memory");
+}
+
+static inline __ALWAYS_INLINE unsigned int arch_irq_save(void)
+{
+	unsigned int cpsr;
+
+	__asm__ volatile("mrs	%0, cpsr\n"
+					 "cpsid	i\n" : "=r" (cpsr) : : "memory");
+	return cpsr;
+}
+
+static inline __ALWAYS_INLINE void arch_irq_restore(unsigned int cpsr)
+{
+	__asm__ volatile("msr	cpsr_c, %0" : : "r" (cpsr) : "memory");
+}
+
+#endif
@@ -25,9 +25,11 @@
 #include <compiler.h>
 #include <arch.h>
 #include <arch/arm.h>
+#include <arch/ops.h>
 #include <arch/defines.h>
 #include <arch/arm/mmu.h>
 #include <platform.h>
+#include <stdlib.h>
 
 #if ARM_WITH_MMU
 
@@ -44,12 +46,54 @@ static uint32_t *tt = (void *)MMU_TRANSLATION_TABLE_ADDR;
 static uint32_t tt[4096] __ALIGNED(16384);
 #endif
 
-void arm_mmu_map_section(addr_t paddr, addr_t vaddr, uint flags)
+/* a supersection maps 16MB and is repeated in 16 consecutive entries */
+#define SUPERSECTION_SECTIONS 16
+#define SUPERSECTION_SIZE (SUPERSECTION_SECTIONS * MB)
+#define MMU_SUPERSECTION (1<<18)
+
+static int supersections = -1;
+
+static bool arm_mmu_supersections(void)
 {
-	int index;
+	uint32_t mmfr3;
 
-	/* Get the index into the translation table */
-	index = vaddr / MB;
+	if (supersections < 0) {
+		/* ID_MMFR3[31:28] reads 0xf when supersections are not supported */
+		__asm__ volatile("mrc p15, 0, %0, c0, c1, 7" : "=r" (mmfr3));
+		supersections = ((mmfr3 >> 28) != 0xf);
+	}
+
+	return supersections;
+}
+
+static bool arm_mmu_enabled(void)
+{
+	return arm_read_cr1() & 0x1;
+}
+
+/* Turn the supersection covering index (if any) back into 16 sections
+ * with the same attributes, so that one of them can be replaced.
+ */
+static void arm_mmu_split_supersection(uint32_t index)
+{
+	uint32_t first = index & ~(SUPERSECTION_SECTIONS - 1);
+	uint32_t entry = tt[first];
+	uint32_t base;
+	uint32_t i;
+
+	if ((entry & 0x3) != 2 || !(entry & MMU_SUPERSECTION))
+		return;
+
+	base = entry & ~(SUPERSECTION_SIZE - 1);
+	entry &= (MB - 1) & ~MMU_SUPERSECTION;
+
+	for (i = 0; i < SUPERSECTION_SECTIONS; i++)
+		tt[first + i] = (base + i * MB) | entry;
+}
+
+static void arm_mmu_write_section(uint32_t index, addr_t paddr, uint flags)
+{
+	arm_mmu_split_supersection(index);
 
 	/* Set the entry value:
 	 * (2<<0): Section entry
@@ -57,14 +101,114 @@ void arm_mmu_map_section(addr_t paddr, addr_t vaddr, uint flags)
 	 *  flags: TEX, CB and AP bit settings provided by the caller.
 	 */
 	tt[index] = (paddr & ~(MB-1)) | (0<<5) | (2<<0) | flags;
+}
+
+static void arm_mmu_write_supersection(uint32_t index, addr_t paddr, uint flags)
+{
+	uint32_t i;
+
+	/* supersections are always in domain 0, bits [8:5] and [23:20]
+	 * hold physical address bits above 4GB which are left zero.
+	 */
+	for (i = 0; i < SUPERSECTION_SECTIONS; i++)
+		tt[index + i] = (paddr & ~(SUPERSECTION_SIZE-1)) | MMU_SUPERSECTION | (2<<0) | flags;
+}
+
+/* Make table updates for entries [index, index + count) visible to the
+ * table walk. While the mmu is off there is nothing to do, arm_mmu_init
+ * invalidates the tlb once before turning it on.
+ */
+static void arm_mmu_sync(uint32_t index, uint32_t count)
+{
+	uint32_t first;
+	uint32_t last;
+
+	if (!arm_mmu_enabled())
+		return;
+
+	/* a split may have rewritten the whole supersection group */
+	first = ROUNDDOWN(index, SUPERSECTION_SECTIONS);
+	last = ROUNDUP(index + count, SUPERSECTION_SECTIONS);
 
+	arch_clean_invalidate_cache_range((addr_t)&tt[first], (last - first) * sizeof(tt[0]));
 	arm_invalidate_tlb();
 }
 
-void arm_mmu_init(void)
+void arm_mmu_map_section(addr_t paddr, addr_t vaddr, uint flags)
+{
+	uint32_t index;
+
+	/* Get the index into the translation table */
+	index = vaddr / MB;
+
+	arm_mmu_write_section(index, paddr, flags);
+	arm_mmu_sync(index, 1);
+}
+
+/* Map num_of_sections MB starting at vaddr to paddr. 16MB aligned parts
+ * of the range use supersections when the cpu has them, and the tlb is
+ * flushed once for the whole range.
+ */
+void arm_mmu_map_range(addr_t paddr, addr_t vaddr, uint32_t num_of_sections, uint flags)
 {
-	int i;
+	uint32_t index = vaddr / MB;
+	uint32_t end;
+
+	ASSERT(num_of_sections <= 4096 - index);
+	end = index + num_of_sections;
+
+	while (index < end) {
+		if (!(index % SUPERSECTION_SECTIONS) &&
+			!(paddr & (SUPERSECTION_SIZE - 1)) &&
+			(end - index) >= SUPERSECTION_SECTIONS &&
+			arm_mmu_supersections()) {
+			arm_mmu_write_supersection(index, paddr, flags);
+			index += SUPERSECTION_SECTIONS;
+			paddr += SUPERSECTION_SIZE;
+		} else {
+			arm_mmu_write_section(index, paddr, flags);
+			index++;
+			paddr += MB;
+		}
+	}
 
+	arm_mmu_sync(vaddr / MB, num_of_sections);
+}
+
+/* Whether any part of [start, start + len) may be held in the data cache.
+ * Anything that is not a section is treated as cacheable.
+ */
+bool arm_mmu_range_cacheable(addr_t start, size_t len)
+{
+	uint32_t index = start / MB;
+	uint32_t last = (start + (len ? len - 1 : 0)) / MB;
+	uint32_t entry;
+
+	if (!arm_mmu_enabled() || last < index)
+		return true;
+
+	for (; index <= last; index++) {
+		entry = tt[index];
+
+		if ((entry & 0x3) != 2)
+			return true;
+
+		/* TEX[2] set: inner policy in C,B and outer policy in TEX[1:0],
+		 * otherwise only the C bit marks a cacheable type.
+		 */
+		if (entry & (0x4 << 12)) {
+			if (entry & ((0x3 << 12) | (0x3 << 2)))
+				return true;
+		} else if (entry & (1<<3)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void arm_mmu_init(void)
+{
 	/* set some mmu specific control bits:
 	 * access flag disabled, TEX remap disabled, mmu disabled
 	 */
@@ -75,11 +219,8 @@ void arm_mmu_init(void)
 		/* set up an identity-mapped translation table with
 		 * strongly ordered memory type and read/write access.
 		 */
-		for (i=0; i < 4096; i++) {
-			arm_mmu_map_section(i * MB,
-								i * MB,
-								MMU_MEMORY_TYPE_STRONGLY_ORDERED | MMU_MEMORY_AP_READ_WRITE);
-		}
+		arm_mmu_map_range(0, 0, 4096,
+						  MMU_MEMORY_TYPE_STRONGLY_ORDERED | MMU_MEMORY_AP_READ_WRITE);
 	}
 
 	platform_init_mmu_mappings();
@@ -90,6 +231,9 @@ void arm_mmu_init(void)
 	/* set up the domain access register */
 	arm_write_dacr(0x00000001);
 
+	/* the table was written with the mmu off, drop stale tlb entries once */
+	arm_invalidate_tlb();
+
 	/* turn on the mmu */
 	arm_write_cr1(arm_read_cr1() | 0x1);
 }
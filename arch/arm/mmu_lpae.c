@@ -44,30 +44,37 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define LPAE_MASK               (LPAE_SIZE - 1)
 #define L1_PT_INDEX             0x7FC0000000
 #define PT_TABLE_DESC_BIT       0x2
-#define SIZE_1GB                (0x400000000UL)
+#define SIZE_1GB                (0x40000000ULL)
 #define SIZE_2MB                (0x200000)
+#define SIZE_1MB                (0x100000)
 #define MMU_L2_PT_SIZE          512
 #define MMU_PT_BLOCK_DESCRIPTOR 0x1
 #define MMU_PT_TABLE_DESCRIPTOR 0x3
 #define MMU_AP_FLAG             (0x1 << 10)
 #define L2_PT_MASK              0xFFFFE00000
 #define L2_INDEX_MASK           0x3FE00000
+#define BLOCK_ATTR_MASK         (~0xFFFFFFF003ULL)
 
 uint64_t mmu_l1_pagetable[ROUNDUP(L1_PT_SZ, CACHE_LINE)] __attribute__ ((aligned(4096))); /* Max is 8 */
 uint64_t mmu_l2_pagetable[ROUNDUP(L2_PT_SZ*MMU_L2_PT_SIZE, CACHE_LINE)] __attribute__ ((aligned(4096))); /* Macro from target code * 512 */
 uint64_t avail_l2_pt = L2_PT_SZ;
 uint64_t *empty_l2_pt = mmu_l2_pagetable;
 
-/************************************************************/
-/* MAP 2MB granules in 1GB section in L2 page table */
-/***********************************************************/
+static bool arm_mmu_enabled(void)
+{
+	return arm_read_cr1() & 0x1;
+}
 
-static void mmu_map_l2_entry(mmu_section_t *block)
+/* Return the L2 page table of the 1GB region at l1_index. An empty L1
+ * entry gets a fresh table, an L1 block is split into 2MB blocks with the
+ * same attributes so that the rest of the region stays mapped.
+ */
+static uint64_t *mmu_get_l2_pt(uint32_t l1_index)
 {
 	uint64_t *l2_pt = NULL;
-	uint64_t  address_start;
-	uint64_t  address_end;
-	uint64_t  p_addr;
+	uint64_t l1_entry = mmu_l1_pagetable[l1_index];
+	uint64_t p_addr;
+	uint32_t i;
 
 	/* First initialize the first level descriptor for each 1 GB
 	 * Bits[47:12] provide the physical base address of the level 2 page table
@@ -81,63 +88,116 @@ static void mmu_map_l2_entry(mmu_section_t *block)
 	 * AP: Access protection
 	 */
 
-	/* Convert the virtual address[38:30] into an index of the L1 page table */
-	address_start = (block->vaddress & LPAE_MASK) >> 30;
+	/* Entry has L2 page table mapped already, so just get the existing L2 page table address */
+	if ((l1_entry & MMU_PT_TABLE_DESCRIPTOR) == MMU_PT_TABLE_DESCRIPTOR)
+		return (uint64_t *) (uintptr_t)(l1_entry & 0xFFFFFFF000);
 
-	 /* Check if this 1GB entry has L2 page table mapped already
-	 * if L1 entry hasn't mapped any L2 page table, allocate a L2 page table for it
-	 */
+	ASSERT(avail_l2_pt);
 
-	if((mmu_l1_pagetable[address_start] & PT_TABLE_DESC_BIT) == 0)
-	{
-		ASSERT(avail_l2_pt);
+	/* Get the first l2 empty page table */
+	l2_pt = empty_l2_pt;
 
-		/* Get the first l2 empty page table and fill in the L1 PTE with a table descriptor,
-		 * The l2_pt address bits 12:39 are used for L1 PTE entry
-		 */
-		l2_pt = empty_l2_pt;
+	if ((l1_entry & MMU_PT_TABLE_DESCRIPTOR) == MMU_PT_BLOCK_DESCRIPTOR)
+	{
+		p_addr = l1_entry & L1_PT_INDEX;
 
-		/* Bits 39.12 of the page table address are mapped into the L1 PTE entry */
-		mmu_l1_pagetable[address_start] = ((uint64_t)(uintptr_t)l2_pt & 0x0FFFFFFF000) | MMU_PT_TABLE_DESCRIPTOR;
+		for (i = 0; i < MMU_L2_PT_SIZE; i++)
+			l2_pt[i] = (p_addr + i * SIZE_2MB) | (l1_entry & BLOCK_ATTR_MASK) | MMU_PT_BLOCK_DESCRIPTOR;
 
-		/* Advance pointer to next empty l2 page table */
-		empty_l2_pt += MMU_L2_PT_SIZE;
-		avail_l2_pt--;
-		arch_clean_invalidate_cache_range((addr_t) mmu_l1_pagetable, L1_PT_SZ);
+		arch_clean_invalidate_cache_range((addr_t) l2_pt, MMU_L2_PT_SIZE * sizeof(uint64_t));
 	}
-	else
-	{
-		/* Entry has L2 page table mapped already, so just get the existing L2 page table address */
-		l2_pt = (uint64_t *) (uintptr_t)(mmu_l1_pagetable[address_start] & 0xFFFFFFF000);
-    }
 
-	/* Get the physical address of 2MB sections, bits 21:39 are used to populate the L2 entry */
-	p_addr = block->paddress & L2_PT_MASK;
+	/* Fill in the L1 PTE with a table descriptor, bits 39.12 of the page table address are mapped into it */
+	mmu_l1_pagetable[l1_index] = ((uint64_t)(uintptr_t)l2_pt & 0x0FFFFFFF000) | MMU_PT_TABLE_DESCRIPTOR;
 
-	/* Start index into the L2 page table for this section using the virtual address[29:21]*/
-	address_start  = (block->vaddress & L2_INDEX_MASK) >> 21;
+	/* Advance pointer to next empty l2 page table */
+	empty_l2_pt += MMU_L2_PT_SIZE;
+	avail_l2_pt--;
+	arch_clean_invalidate_cache_range((addr_t) mmu_l1_pagetable, L1_PT_SZ);
 
-	/* The end index for the given section. size given is in MB convert it to number of 2MB segments */
-	address_end = address_start + ((block->size) >> 1);
+	return l2_pt;
+}
 
+static void mmu_write_l1_block(uint32_t l1_index, uint64_t p_addr, uint64_t flags)
+{
 	/*
-	 *      ___________________________________________________________________________________________________________________
-	 *     |       |        |  |   |    |        |                  |        |  |  |       |       |  |             |          |
-	 *     |63---59|58----55|54|53 |52  |51----40|39--------------21|20----12|11|10|9     8|7     6|5 |4-----------2|  1   0   |
-	 *     |Ignored|Reserved|XN|PXN|Cont|UNK|SBZP|Output addr[39:21]|UNK|SBZP|nG|AF|SH[1:0]|AP[2:1]|NS|AttrIndx[2:0]|Descriptor|
-	 *     |_______|________|__|___|____|________|__________________|________|__|__|_______|_______|__|_____________|__________|
+	 *    A Block descriptor for first stage, level one is as follows (Descriptor = 0b01):
+	 *         ___________________________________________________________________________________________________________________
+	 *        |       |        |  |	  |    |        |                  |        |  |  |       |       |  |             |          |
+	 *        |63---59|58----55|54|53 |52  |51----40|39--------------30|n-1 --12|11|10|9     8|7     6|5 |4-----------2|  1   0   |
+	 *        |Ignored|Reserved|XN|PXN|Cont|UNK/SBZP|Output addr[47:30]|UNK/SBZP|nG|AF|SH[1:0]|AP[2:1]|NS|AttrIndx[2:0]|Descriptor|
+	 *        |_______|________|__|___|____|________|__________________|________|__|__|_______|_______|__|_____________|__________|
 	 */
+	mmu_l1_pagetable[l1_index] = (p_addr & L1_PT_INDEX) | flags | MMU_AP_FLAG | MMU_PT_BLOCK_DESCRIPTOR;
+}
+
+/************************************************************/
+/* MAP 2MB granules, using 1GB L1 blocks where aligned */
+/***********************************************************/
+
+static void mmu_map_l2_entry(mmu_section_t *block)
+{
+	uint64_t *l2_pt = NULL;
+	uint64_t  address_start;
+	uint64_t  address_end;
+	uint64_t  p_addr;
+	uint64_t  v_addr;
+	uint64_t  size;
+	uint64_t  chunk;
+	uint64_t  i;
+	uint32_t  l1_index;
 
-	/* Map all the 2MB segments in the 1GB section */
-	while (address_start < address_end)
+	/* Get the physical address of 2MB sections, bits 21:39 are used to populate the L2 entry */
+	p_addr = block->paddress & L2_PT_MASK;
+	v_addr = block->vaddress & LPAE_MASK;
+	size = block->size;
+
+	while (size >= 2)
 	{
-		l2_pt[address_start] =  (p_addr) | MMU_PT_BLOCK_DESCRIPTOR | MMU_AP_FLAG | block->flags;
-		address_start++;
-		/* Increment to the next 2MB segment in current L2 page table*/
-		p_addr += SIZE_2MB;
-		arm_invalidate_tlb();
+		/* Convert the virtual address[38:30] into an index of the L1 page table */
+		l1_index = v_addr >> 30;
+
+		/* A whole aligned 1GB is mapped with a single L1 block, unless
+		 * the region already has finer grained mappings in an L2 table.
+		 */
+		if (!(v_addr & (SIZE_1GB - 1)) && !(p_addr & (SIZE_1GB - 1)) &&
+			size >= (SIZE_1GB / SIZE_1MB) &&
+			(mmu_l1_pagetable[l1_index] & MMU_PT_TABLE_DESCRIPTOR) != MMU_PT_TABLE_DESCRIPTOR)
+		{
+			mmu_write_l1_block(l1_index, p_addr, block->flags);
+			arch_clean_invalidate_cache_range((addr_t) mmu_l1_pagetable, L1_PT_SZ);
+			chunk = SIZE_1GB / SIZE_1MB;
+		}
+		else
+		{
+			l2_pt = mmu_get_l2_pt(l1_index);
+
+			/* Map up to the end of this 1GB region, size is in MB */
+			chunk = MIN(size, (SIZE_1GB - (v_addr & (SIZE_1GB - 1))) / SIZE_1MB) & ~1ULL;
+
+			/* Start and end index into the L2 page table using the virtual address[29:21]*/
+			address_start = (v_addr & L2_INDEX_MASK) >> 21;
+			address_end = address_start + (chunk >> 1);
+
+			/*
+			 *      ___________________________________________________________________________________________________________________
+			 *     |       |        |  |   |    |        |                  |        |  |  |       |       |  |             |          |
+			 *     |63---59|58----55|54|53 |52  |51----40|39--------------21|20----12|11|10|9     8|7     6|5 |4-----------2|  1   0   |
+			 *     |Ignored|Reserved|XN|PXN|Cont|UNK|SBZP|Output addr[39:21]|UNK|SBZP|nG|AF|SH[1:0]|AP[2:1]|NS|AttrIndx[2:0]|Descriptor|
+			 *     |_______|________|__|___|____|________|__________________|________|__|__|_______|_______|__|_____________|__________|
+			 */
+
+			/* Map all the 2MB segments in this part of the 1GB section */
+			for (i = address_start; i < address_end; i++)
+				l2_pt[i] = (p_addr + (i - address_start) * SIZE_2MB) | MMU_PT_BLOCK_DESCRIPTOR | MMU_AP_FLAG | block->flags;
+
+			arch_clean_invalidate_cache_range((addr_t) &l2_pt[address_start], (address_end - address_start) * sizeof(uint64_t));
+		}
+
+		p_addr += chunk * SIZE_1MB;
+		v_addr += chunk * SIZE_1MB;
+		size -= chunk;
 	}
-	arch_clean_invalidate_cache_range((addr_t) mmu_l2_pagetable, (L2_PT_SZ*MMU_L2_PT_SIZE));
 }
 
 /************************************************************/
@@ -160,25 +220,15 @@ static void mmu_map_l1_entry(mmu_section_t *block)
 
 	while(address_start < address_end)
 	{
-	 /*
-	 *    A Block descriptor for first stage, level one is as follows (Descriptor = 0b01):
-	 *         ___________________________________________________________________________________________________________________
-	 *        |       |        |  |	  |    |        |                  |        |  |  |       |       |  |             |          |
-	 *        |63---59|58----55|54|53 |52  |51----40|39--------------30|n-1 --12|11|10|9     8|7     6|5 |4-----------2|  1   0   |
-	 *        |Ignored|Reserved|XN|PXN|Cont|UNK/SBZP|Output addr[47:30]|UNK/SBZP|nG|AF|SH[1:0]|AP[2:1]|NS|AttrIndx[2:0]|Descriptor|
-	 *        |_______|________|__|___|____|________|__________________|________|__|__|_______|_______|__|_____________|__________|
-	 */
-
-		mmu_l1_pagetable[address_start] =  (p_addr) | block->flags | MMU_AP_FLAG | MMU_PT_BLOCK_DESCRIPTOR;
+		mmu_write_l1_block(address_start, p_addr, block->flags);
 
 		p_addr += SIZE_1GB; /* Point to next level */
 		address_start++;
-		arm_invalidate_tlb();
 	}
 	arch_clean_invalidate_cache_range((addr_t) mmu_l1_pagetable, L1_PT_SZ);
 }
 
-void arm_mmu_map_entry(mmu_section_t *entry)
+static void mmu_map(mmu_section_t *entry)
 {
 	ASSERT(entry);
 
@@ -190,6 +240,84 @@ void arm_mmu_map_entry(mmu_section_t *entry)
 		dprintf(CRITICAL, "Invalid mapping type in the mmu table: %d\n", entry->type);
 }
 
+/* The tables are cleaned as they are written, what is left is to drop
+ * stale tlb entries. While the mmu is off arm_mmu_init does that once.
+ */
+static void mmu_sync(void)
+{
+	if (arm_mmu_enabled())
+		arm_invalidate_tlb();
+}
+
+void arm_mmu_map_entry(mmu_section_t *entry)
+{
+	mmu_map(entry);
+	mmu_sync();
+}
+
+/* map a table of entries with a single tlb flush */
+void arm_mmu_map_entries(mmu_section_t *table, uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		mmu_map(&table[i]);
+
+	mmu_sync();
+}
+
+/* Whether the MAIR attribute selected by a block descriptor is cacheable */
+static bool mmu_attr_cacheable(uint64_t desc)
+{
+	uint32_t index = (desc >> 2) & 0x7;
+	uint32_t attr;
+
+	attr = (index < 4 ? MAIR0 >> (index * 8) : MAIR1 >> ((index - 4) * 8)) & 0xff;
+
+	/* device memory has a zero upper nibble, 0x44 is normal non cacheable */
+	return (attr & 0xf0) && attr != 0x44;
+}
+
+/* Whether any part of [start, start + len) may be held in the data cache.
+ * Unmapped addresses are treated as cacheable.
+ */
+bool arm_mmu_range_cacheable(addr_t start, size_t len)
+{
+	uint64_t vaddr = start;
+	uint64_t end = (uint64_t) start + (len ? len : 1);
+	uint64_t l1_entry;
+	uint64_t *l2_pt;
+
+	if (!arm_mmu_enabled())
+		return true;
+
+	while (vaddr < end)
+	{
+		l1_entry = mmu_l1_pagetable[(vaddr & LPAE_MASK) >> 30];
+
+		if ((l1_entry & MMU_PT_TABLE_DESCRIPTOR) == MMU_PT_BLOCK_DESCRIPTOR)
+		{
+			if (mmu_attr_cacheable(l1_entry))
+				return true;
+			vaddr = ROUNDDOWN(vaddr, SIZE_1GB) + SIZE_1GB;
+		}
+		else if ((l1_entry & MMU_PT_TABLE_DESCRIPTOR) == MMU_PT_TABLE_DESCRIPTOR)
+		{
+			l2_pt = (uint64_t *) (uintptr_t) (l1_entry & 0x0FFFFFFF000);
+			if ((l2_pt[(vaddr & L2_INDEX_MASK) >> 21] & MMU_PT_TABLE_DESCRIPTOR) != MMU_PT_BLOCK_DESCRIPTOR ||
+				mmu_attr_cacheable(l2_pt[(vaddr & L2_INDEX_MASK) >> 21]))
+				return true;
+			vaddr = ROUNDDOWN(vaddr, SIZE_2MB) + SIZE_2MB;
+		}
+		else
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void arm_mmu_init(void)
 {
 	/* set some mmu specific control bits:
@@ -212,6 +340,9 @@ void arm_mmu_init(void)
 	/* Enable TRE */
 	arm_write_cr1(arm_read_cr1() | (1<<28));
 
+	/* the tables were written with the mmu off, drop stale tlb entries once */
+	arm_invalidate_tlb();
+
 	/* turn on the mmu */
 	arm_write_cr1(arm_read_cr1() | 0x1);
 }
@@ -91,12 +91,19 @@ OBJS += \
 	$(LOCAL_DIR)/asm.o \
 	$(LOCAL_DIR)/cache.o \
 	$(LOCAL_DIR)/cache-ops.o \
+	$(LOCAL_DIR)/crc32.o \
 	$(LOCAL_DIR)/ops.o \
 	$(LOCAL_DIR)/exceptions.o \
 	$(LOCAL_DIR)/faults.o \
 	$(LOCAL_DIR)/thread.o \
 	$(LOCAL_DIR)/dcc.o
 
+ifeq ($(ENABLE_SMP), 1)
+OBJS += \
+	$(LOCAL_DIR)/smp.o \
+	$(LOCAL_DIR)/smp_entry.o
+endif
+
 ifeq ($(ENABLE_LPAE_SUPPORT), 1)
 OBJS +=  $(LOCAL_DIR)/mmu_lpae.o
 else
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <debug.h>
+#include <arch/arm.h>
+#include <arch/defines.h>
+#include <arch/ops.h>
+#include <arch/arm/smp.h>
+#include <kernel/smp.h>
+
+#if !ARM_CPU_CORTEX_A8
+#error "secondary core bring-up needs the v7 set/way cache clean"
+#endif
+
+struct arm_smp_boot arm_smp_boot __ALIGNED(CACHE_LINE);
+
+void arch_smp_prepare(uint cpu, addr_t stack_top)
+{
+	struct arm_smp_boot *b = &arm_smp_boot;
+
+	__asm__ volatile("mrc p15, 0, %0, c1, c0, 0" : "=r" (b->sctlr));
+	__asm__ volatile("mrc p15, 0, %0, c12, c0, 0" : "=r" (b->vbar));
+	__asm__ volatile("mrc p15, 0, %0, c2, c0, 2" : "=r" (b->ttbcr));
+#if LPAE
+	__asm__ volatile("mrrc p15, 0, %0, %1, c2" : "=r" (b->ttbr0_lo), "=r" (b->ttbr0_hi));
+	__asm__ volatile("mrc p15, 0, %0, c10, c2, 0" : "=r" (b->dacr));
+	__asm__ volatile("mrc p15, 0, %0, c10, c2, 1" : "=r" (b->mair1));
+#else
+	__asm__ volatile("mrc p15, 0, %0, c2, c0, 0" : "=r" (b->ttbr0_lo));
+	__asm__ volatile("mrc p15, 0, %0, c3, c0, 0" : "=r" (b->dacr));
+#endif
+
+	ASSERT(cpu < SMP_MAX_CPUS);
+	b->stacks[cpu] = stack_top;
+
+	/* The new core reads this and walks the translation tables with its
+	 * caches off. Only this core wrote either, so a set/way clean of its
+	 * own caches covers both.
+	 */
+	arm_clean_dcache_all();
+}
+
+addr_t arch_smp_entry(void)
+{
+	/* lk runs identity mapped, the physical entry point is the same */
+	return (addr_t) arm_secondary_entry;
+}
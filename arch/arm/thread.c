@@ -26,6 +26,7 @@
 #include <debug.h>
 #include <kernel/thread.h>
 #include <arch/arm.h>
+#include <arch/defines.h>
 
 struct context_switch_frame {
 	vaddr_t r4;
@@ -42,6 +43,24 @@ struct context_switch_frame {
 };
 
 extern void arm_context_switch(addr_t *old_sp, addr_t new_sp);
+#if ARM_WITH_NEON
+extern void arm_neon_save(uint64_t *regs);
+extern void arm_neon_restore(uint64_t *regs);
+
+#define FPEXC_EN (1<<30)
+
+static inline uint32_t arm_read_fpexc(void)
+{
+	uint32_t val;
+	__asm__ volatile("mrc  p10, 7, %0, c8, c0, 0" : "=r" (val));
+	return val;
+}
+
+static inline void arm_write_fpexc(uint32_t val)
+{
+	__asm__ volatile("mcr  p10, 7, %0, c8, c0, 0" :: "r" (val));
+}
+#endif
 
 static void initial_thread_func(void) __NO_RETURN;
 static void initial_thread_func(void)
@@ -78,11 +97,56 @@ void arch_thread_initialize(thread_t *t)
 	
 	// set the stack pointer
 	t->arch.sp = (vaddr_t)frame;
+
+#if ARM_WITH_NEON
+	memset(t->arch.fpregs, 0, sizeof(t->arch.fpregs));
+	t->arch.fpscr = 0;
+#endif
 }
 
 void arch_context_switch(thread_t *oldthread, thread_t *newthread)
 {
 //	dprintf("arch_context_switch: old %p (%s), new %p (%s)\n", oldthread, oldthread->name, newthread, newthread->name);
+#if ARM_WITH_NEON
+	/* The compiler never touches these, but the inflate and string
+	 * routines do, so they are per thread state like r4-r11. Most
+	 * threads never get there though: the registers are only saved if
+	 * NEON was used since the thread was switched in, and NEON is left
+	 * off for the new one until arm_neon_trap() loads its registers.
+	 */
+	uint32_t fpexc = arm_read_fpexc();
+
+	if (fpexc & FPEXC_EN) {
+		arm_neon_save(oldthread->arch.fpregs);
+		arm_write_fpexc(fpexc & ~FPEXC_EN);
+	}
+#endif
 	arm_context_switch(&oldthread->arch.sp, newthread->arch.sp);
 }
 
+#if ARM_WITH_NEON
+/* Undefined instruction with NEON off: the current thread's first NEON
+ * instruction since it was switched in. Turn NEON on with its registers
+ * and have the instruction retried. Returns false for anything else.
+ */
+bool arm_neon_trap(struct arm_fault_frame *frame)
+{
+	uint32_t fpexc;
+
+	if (!arm_neon_enabled)
+		return false;
+
+	fpexc = arm_read_fpexc();
+	if (fpexc & FPEXC_EN)
+		return false;
+
+	arm_write_fpexc(fpexc | FPEXC_EN);
+	isb();
+	arm_neon_restore(current_thread->arch.fpregs);
+
+	/* lr is 4 bytes past the instruction in arm state, 2 in thumb */
+	frame->pc -= (frame->spsr & (1<<5)) ? 2 : 4;
+	return true;
+}
+#endif
+
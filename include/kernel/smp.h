@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __KERNEL_SMP_H
+#define __KERNEL_SMP_H
+
+#include <sys/types.h>
+#include <compiler.h>
+
+/* Secondary cores do not run threads. Once started they wait for work
+ * items and run them to completion with interrupts off, while threads
+ * keep running on the boot core. A work function may only compute on
+ * memory that is already mapped: it must not block, allocate, print,
+ * take mutexes or critical sections, or do cache maintenance. Anything
+ * shared with other cores is protected with spinlocks.
+ *
+ * Without secondary cores (SMP off, or none came up) work items run
+ * inline in smp_work_queue().
+ */
+typedef void (*smp_work_func)(void *arg);
+
+struct smp_work {
+	smp_work_func func;
+	void *arg;
+
+	/* Private */
+	volatile int state;
+	struct smp_work *next;
+};
+
+#if WITH_SMP
+void smp_init(void);
+int smp_stop(void);
+uint smp_cpus_online(void);
+#else
+static inline void smp_init(void) { }
+static inline int smp_stop(void) { return 0; }
+static inline uint smp_cpus_online(void) { return 1; }
+#endif
+
+void smp_work_init(struct smp_work *work, smp_work_func func, void *arg);
+/* Hand the work to the next idle core */
+void smp_work_queue(struct smp_work *work);
+/* Wait for the work to finish, running it here if no core took it yet */
+void smp_work_wait(struct smp_work *work);
+
+/* Provided by the arch: the secondary entry point and its boot state */
+void arch_smp_prepare(uint cpu, addr_t stack_top);
+addr_t arch_smp_entry(void);
+/* Called on the secondary core by the arch entry code */
+void smp_secondary_main(uint cpu) __NO_RETURN;
+
+/* Provided by the platform */
+uint platform_smp_curr_cpu(void);
+int platform_smp_cpu_on(uint cpu, addr_t entry);
+void platform_smp_cpu_off(void);
+bool platform_smp_cpu_is_off(uint cpu);
+
+#endif
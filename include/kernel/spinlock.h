@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __KERNEL_SPINLOCK_H
+#define __KERNEL_SPINLOCK_H
+
+#include <arch/arm/spinlock.h>
+
+/* Rules for Spinlocks:
+ * - Spinlocks are the only lock shared with the secondary cores, which
+ *   run work items outside of the scheduler (see kernel/smp.h).
+ * - Hold them briefly, and take the irqsave flavour from thread context
+ *   so that an interrupt cannot spin on a lock its cpu already holds.
+ * - Spinlocks are non-recursive.
+ */
+typedef volatile unsigned int spin_lock_t;
+typedef unsigned int spin_lock_saved_state_t;
+
+#define SPIN_LOCK_INITIAL_VALUE		(0)
+
+static inline void spin_lock_init(spin_lock_t *lock)
+{
+	*lock = SPIN_LOCK_INITIAL_VALUE;
+}
+
+static inline void spin_lock(spin_lock_t *lock)
+{
+	arch_spin_lock(lock);
+}
+
+static inline int spin_trylock(spin_lock_t *lock)
+{
+	return arch_spin_trylock(lock);
+}
+
+static inline void spin_unlock(spin_lock_t *lock)
+{
+	arch_spin_unlock(lock);
+}
+
+static inline void spin_lock_irqsave(spin_lock_t *lock, spin_lock_saved_state_t *state)
+{
+	*state = arch_irq_save();
+	arch_spin_lock(lock);
+}
+
+static inline void spin_unlock_irqrestore(spin_lock_t *lock, spin_lock_saved_state_t state)
+{
+	arch_spin_unlock(lock);
+	arch_irq_restore(state);
+}
+
+#endif
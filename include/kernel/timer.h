@@ -35,7 +35,7 @@ typedef enum handler_return (*timer_callback)(struct timer *, time_t now, void *
 
 typedef struct timer {
 	int magic;
-	struct list_node node;
+	uint heap_index;	/* slot in the timer queue + 1, 0 if not queued */
 
 	time_t scheduled_time;
 	time_t periodic_time;
@@ -48,7 +48,8 @@ typedef struct timer {
  * - Timer callbacks occur from interrupt context
  * - Timers may be programmed or canceled from interrupt or thread context
  * - Timers may be canceled or reprogrammed from within their callback
- * - Timers currently are dispatched from a 10ms periodic tick
+ * - Timers are dispatched from a 10ms periodic tick, or at their deadline
+ *   when the platform has a dynamic (one shot) timer
 */
 void timer_initialize(timer_t *);
 void timer_set_oneshot(timer_t *, time_t delay, timer_callback, void *arg);
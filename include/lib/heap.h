@@ -31,6 +31,22 @@ void heap_free(void *);
 
 void heap_init(void);
 
+struct heap_stats {
+	size_t size;
+	size_t used;			// bytes handed out by the list allocator
+	size_t peak_used;
+	size_t free;
+	size_t largest_free;
+	unsigned int free_chunks;
+	unsigned int allocs;
+	unsigned int failed_allocs;
+	size_t slab_size;		// bytes held by slabs
+	size_t slab_used;		// bytes of slab objects in use
+	unsigned int slab_allocs;
+};
+
+void heap_get_stats(struct heap_stats *stats);
+
 
 
 #endif
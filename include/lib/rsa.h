@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __LIB_RSA_H
+#define __LIB_RSA_H
+
+#include <sys/types.h>
+
+/* Parsed RSA public key: the modulus as words plus the Montgomery
+ * constants n0inv and R^2 mod n, ready for repeated verifies.
+ */
+struct rsa_key;
+
+/* Moduli up to this many bits are accepted */
+#define RSA_MAX_BITS	8192
+
+/* Look up or build the context for the public key (n, e). n and rr are
+ * big endian, n_len bytes each. rr and n0inv are the precomputed R^2 mod n
+ * and -1 / n[0] mod 2^32 some key formats carry; pass NULL and 0 to have
+ * them computed. Contexts are cached by a SHA-256 of all of the above, so
+ * verifying against the same key again skips the setup.
+ * Returns NULL for a malformed key or when out of memory. Not thread safe,
+ * call from the boot thread only.
+ */
+struct rsa_key *rsa_key_get(const uint8_t *n, size_t n_len, uint32_t e,
+			    const uint8_t *rr, uint32_t n0inv);
+
+/* Drop a reference from rsa_key_get(). The context stays cached until
+ * the cache needs its slot.
+ */
+void rsa_key_put(struct rsa_key *key);
+
+/* Size of the modulus, and so of signatures, in bytes */
+size_t rsa_key_len(const struct rsa_key *key);
+
+/* out = in ^ e mod n, both big endian and rsa_key_len() bytes long.
+ * Returns NO_ERROR, ERR_INVALID_ARGS if in is not below n, or
+ * ERR_NO_MEMORY.
+ */
+int rsa_public(const struct rsa_key *key, const uint8_t *in, uint8_t *out);
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef __LIB_SHA2_H
+#define __LIB_SHA2_H
+
+#include <sys/types.h>
+
+#define SHA256_BLOCK_LEN	64
+#define SHA256_DIGEST_LEN	32
+#define SHA512_BLOCK_LEN	128
+#define SHA512_DIGEST_LEN	64
+
+/* Compression functions: run whole big endian message blocks through the
+ * state words. Padding and the final length block are up to the caller.
+ */
+typedef void (*sha256_blocks_func)(uint32_t state[8], const uint8_t *data, size_t blocks);
+typedef void (*sha512_blocks_func)(uint64_t state[8], const uint8_t *data, size_t blocks);
+
+struct sha2_backend {
+	const char *name;
+	sha256_blocks_func sha256_blocks;	// NULL if not implemented
+	sha512_blocks_func sha512_blocks;	// NULL if not implemented
+	bool (*usable)(void);			// NULL if any cpu can run it
+};
+
+/* All backends built in, fastest first. The list ends with the portable
+ * C one and then an entry with a NULL name.
+ */
+extern const struct sha2_backend sha2_backends[];
+
+/* The fastest backend this cpu can run, chosen on first use */
+void sha256_blocks(uint32_t state[8], const uint8_t *data, size_t blocks);
+void sha512_blocks(uint64_t state[8], const uint8_t *data, size_t blocks);
+const char *sha256_backend_name(void);
+const char *sha512_backend_name(void);
+
+void sha256_blocks_portable(uint32_t state[8], const uint8_t *data, size_t blocks);
+void sha512_blocks_portable(uint64_t state[8], const uint8_t *data, size_t blocks);
+
+/* Streaming SHA-256 on top of sha256_blocks() */
+struct sha256_ctx {
+	uint32_t state[8];
+	uint64_t len;
+	uint8_t buf[SHA256_BLOCK_LEN];
+};
+
+void sha256_init(struct sha256_ctx *ctx);
+void sha256_update(struct sha256_ctx *ctx, const void *data, size_t len);
+void sha256_final(struct sha256_ctx *ctx, uint8_t digest[SHA256_DIGEST_LEN]);
+void sha256(const void *data, size_t len, uint8_t digest[SHA256_DIGEST_LEN]);
+
+#endif
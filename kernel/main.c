@@ -33,6 +33,7 @@
 #include <kernel/thread.h>
 #include <kernel/timer.h>
 #include <kernel/dpc.h>
+#include <kernel/smp.h>
 #include <boot_stats.h>
 
 extern void *__ctor_list;
@@ -145,6 +146,10 @@ static int bootstrap2(void *arg)
 	dprintf(SPEW, "initializing platform\n");
 	platform_init();
 
+	// bring up the secondary cpus, the mmu mappings are final now
+	dprintf(SPEW, "initializing smp\n");
+	smp_init();
+
 	// initialize the target
 	dprintf(SPEW, "initializing target\n");
 	target_init();
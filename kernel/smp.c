@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * @brief  Secondary core work queue
+ *
+ * Secondary cores are powered up by the platform and enter
+ * smp_secondary_main() with the boot core's mmu setup and NEON enabled
+ * (arch/arm/smp_entry.S). They take work items off a queue shared with
+ * the boot core, and power themselves off again in smp_stop(), before
+ * fastboot or the kernel is started.
+ *
+ * This is not an SMP scheduler: there are no per-cpu run queues, the
+ * thread code stays on the boot core and its critical sections remain a
+ * global interrupt-disable count. Only the queue itself is shared, under
+ * a spinlock. Its one user so far is the AVB hash descriptor hashing in
+ * avb_slot_verify.c.
+ */
+#include <debug.h>
+#include <malloc.h>
+#include <arch/ops.h>
+#include <arch/defines.h>
+#include <kernel/thread.h>
+#include <kernel/spinlock.h>
+#include <kernel/smp.h>
+#include <platform.h>
+
+#define SMP_WORK_IDLE		0
+#define SMP_WORK_QUEUED		1
+#define SMP_WORK_RUNNING	2
+#define SMP_WORK_DONE		3
+
+static spin_lock_t smp_work_lock = SPIN_LOCK_INITIAL_VALUE;
+static struct smp_work *smp_work_head;
+static struct smp_work *smp_work_tail;
+
+#if WITH_SMP
+#define SMP_STACK_SIZE		16384
+#define SMP_START_TIMEOUT	100	/* ms */
+#define SMP_STOP_TIMEOUT	100	/* ms */
+
+static volatile int smp_online;
+static volatile bool smp_stopping;
+static bool smp_started[SMP_MAX_CPUS];
+static void *smp_stack[SMP_MAX_CPUS];
+#endif
+
+void smp_work_init(struct smp_work *work, smp_work_func func, void *arg)
+{
+	work->func = func;
+	work->arg = arg;
+	work->state = SMP_WORK_IDLE;
+	work->next = NULL;
+}
+
+static void smp_work_run(struct smp_work *work)
+{
+	work->func(work->arg);
+
+	/* results before the state, the waiter reads them in that order */
+	dmb();
+	work->state = SMP_WORK_DONE;
+	arch_cpu_send_event();
+}
+
+void smp_work_queue(struct smp_work *work)
+{
+	spin_lock_saved_state_t state;
+
+	DEBUG_ASSERT(work->state != SMP_WORK_QUEUED && work->state != SMP_WORK_RUNNING);
+
+	if (smp_cpus_online() < 2) {
+		work->state = SMP_WORK_RUNNING;
+		smp_work_run(work);
+		return;
+	}
+
+	work->next = NULL;
+	work->state = SMP_WORK_QUEUED;
+
+	spin_lock_irqsave(&smp_work_lock, &state);
+	if (smp_work_tail)
+		smp_work_tail->next = work;
+	else
+		smp_work_head = work;
+	smp_work_tail = work;
+	spin_unlock_irqrestore(&smp_work_lock, state);
+}
+
+/* Take the given work item off the queue, or the first one if NULL */
+static struct smp_work *smp_work_dequeue(struct smp_work *work)
+{
+	struct smp_work **pp;
+	struct smp_work *prev = NULL;
+	spin_lock_saved_state_t state;
+
+	spin_lock_irqsave(&smp_work_lock, &state);
+	for (pp = &smp_work_head; *pp; prev = *pp, pp = &(*pp)->next) {
+		if (work && *pp != work)
+			continue;
+
+		work = *pp;
+		*pp = work->next;
+		if (smp_work_tail == work)
+			smp_work_tail = prev;
+		work->state = SMP_WORK_RUNNING;
+		spin_unlock_irqrestore(&smp_work_lock, state);
+		return work;
+	}
+	spin_unlock_irqrestore(&smp_work_lock, state);
+
+	return NULL;
+}
+
+void smp_work_wait(struct smp_work *work)
+{
+	/* Nobody took it yet, the boot core is as good as any */
+	if (work->state == SMP_WORK_QUEUED && smp_work_dequeue(work))
+		smp_work_run(work);
+
+	while (work->state != SMP_WORK_DONE) {
+		/* let other threads run, then sleep until the worker's sev or
+		 * the next interrupt
+		 */
+		thread_yield();
+		if (work->state != SMP_WORK_DONE)
+			arch_cpu_wait_event();
+	}
+
+	dmb();
+	work->state = SMP_WORK_IDLE;
+}
+
+#if WITH_SMP
+uint smp_cpus_online(void)
+{
+	return smp_online + 1;
+}
+
+void smp_secondary_main(uint cpu)
+{
+	struct smp_work *work;
+
+	atomic_add(&smp_online, 1);
+	arch_cpu_send_event();
+
+	for (;;) {
+		work = smp_work_dequeue(NULL);
+		if (work) {
+			smp_work_run(work);
+			continue;
+		}
+
+		if (smp_stopping)
+			break;
+
+		arch_cpu_wait_event();
+	}
+
+	atomic_add(&smp_online, -1);
+	arch_cpu_send_event();
+
+	platform_smp_cpu_off();
+
+	for (;;)
+		arch_cpu_wait_event();
+}
+
+/**
+ * @brief  Power up the secondary cores
+ *
+ * Called once the heap and the final mmu mappings are in place: the cores
+ * copy the boot core's translation table setup, and later mapping changes
+ * are not broadcast to them.
+ */
+void smp_init(void)
+{
+	uint boot_cpu = platform_smp_curr_cpu();
+	int started = 0;
+	time_t start;
+	void *stack;
+	uint cpu;
+
+	for (cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+		if (cpu == boot_cpu)
+			continue;
+
+		stack = memalign(CACHE_LINE, SMP_STACK_SIZE);
+		if (!stack) {
+			dprintf(CRITICAL, "smp: no stack for cpu %u\n", cpu);
+			break;
+		}
+
+		arch_smp_prepare(cpu, (addr_t) stack + SMP_STACK_SIZE);
+		if (platform_smp_cpu_on(cpu, arch_smp_entry())) {
+			dprintf(INFO, "smp: cpu %u did not power up\n", cpu);
+			free(stack);
+			continue;
+		}
+
+		smp_stack[cpu] = stack;
+		smp_started[cpu] = true;
+		started++;
+	}
+
+	start = current_time();
+	while (smp_online < started && current_time() - start < SMP_START_TIMEOUT)
+		arch_cpu_wait_event();
+
+	dprintf(INFO, "smp: %d of %d secondary cpus online\n", smp_online, started);
+}
+
+/**
+ * @brief  Power the secondary cores off again
+ *
+ * The kernel expects to bring them up itself, so this is done before
+ * jumping to it, and before fastboot, which has no work for them. Queued
+ * work is finished first. Cores power themselves off (PSCI CPU_OFF only
+ * works on the calling core), so one that is stuck cannot be forced.
+ *
+ * @return 0 once all of them are off, -1 if some did not power down in time.
+ */
+int smp_stop(void)
+{
+	time_t start;
+	uint cpu;
+	int ret = 0;
+
+	smp_stopping = true;
+	arch_cpu_send_event();
+
+	start = current_time();
+	while (smp_online && current_time() - start < SMP_STOP_TIMEOUT)
+		;
+
+	for (cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+		if (!smp_started[cpu])
+			continue;
+
+		while (!platform_smp_cpu_is_off(cpu) &&
+			current_time() - start < SMP_STOP_TIMEOUT)
+			;
+
+		if (!platform_smp_cpu_is_off(cpu)) {
+			/* still started, so the next smp_stop() fails as well */
+			dprintf(CRITICAL, "smp: cpu %u did not power down\n", cpu);
+			ret = -1;
+			continue;
+		}
+		smp_started[cpu] = false;
+
+		/* only now is nothing running on it any more */
+		free(smp_stack[cpu]);
+		smp_stack[cpu] = NULL;
+	}
+
+	return ret;
+}
+#endif
@@ -37,13 +37,24 @@
  * @{
  */
 #include <debug.h>
-#include <list.h>
 #include <kernel/thread.h>
 #include <kernel/timer.h>
 #include <platform/timer.h>
 #include <platform.h>
 
-static struct list_node timer_queue;
+/* The timer queue is a binary min-heap on scheduled_time, so that setting
+ * and canceling a timer is O(log n) and the next one to fire is at the
+ * root. Timers are set from interrupt context and inside critical
+ * sections, so the heap is a fixed array: at most one timer per blocked
+ * thread plus the few driver and scheduler ones are queued at a time.
+ * Targets with more can raise TIMER_HEAP_SIZE.
+ */
+#ifndef TIMER_HEAP_SIZE
+#define TIMER_HEAP_SIZE		64
+#endif
+
+static timer_t *timer_heap[TIMER_HEAP_SIZE];
+static uint timer_heap_count;
 
 static enum handler_return timer_tick(void *arg, time_t now);
 
@@ -53,28 +64,89 @@ static enum handler_return timer_tick(void *arg, time_t now);
 void timer_initialize(timer_t *timer)
 {
 	timer->magic = TIMER_MAGIC;
-	list_clear_node(&timer->node);
+	timer->heap_index = 0;
 	timer->scheduled_time = 0;
 	timer->periodic_time = 0;
 	timer->callback = 0;
 	timer->arg = 0;
 }
 
-static void insert_timer_in_queue(timer_t *timer)
+static inline bool timer_queued(timer_t *timer)
 {
-	timer_t *entry;
+	return timer->heap_index != 0;
+}
 
-//	TRACEF("timer %p, scheduled %d, periodic %d\n", timer, timer->scheduled_time, timer->periodic_time);
+static inline timer_t *timer_queue_head(void)
+{
+	return timer_heap_count ? timer_heap[0] : NULL;
+}
 
-	list_for_every_entry(&timer_queue, entry, timer_t, node) {
-		if (TIME_GT(entry->scheduled_time, timer->scheduled_time)) {
-			list_add_before(&entry->node, &timer->node);
-			return;
-		}
+static inline void timer_heap_place(timer_t *timer, uint i)
+{
+	timer_heap[i] = timer;
+	timer->heap_index = i + 1;
+}
+
+static void timer_heap_sift_up(uint i)
+{
+	timer_t *timer = timer_heap[i];
+	uint parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (!TIME_LT(timer->scheduled_time, timer_heap[parent]->scheduled_time))
+			break;
+		timer_heap_place(timer_heap[parent], i);
+		i = parent;
+	}
+	timer_heap_place(timer, i);
+}
+
+static void timer_heap_sift_down(uint i)
+{
+	timer_t *timer = timer_heap[i];
+	uint child;
+
+	for (;;) {
+		child = 2 * i + 1;
+		if (child >= timer_heap_count)
+			break;
+		if (child + 1 < timer_heap_count &&
+			TIME_LT(timer_heap[child + 1]->scheduled_time, timer_heap[child]->scheduled_time))
+			child++;
+		if (!TIME_LT(timer_heap[child]->scheduled_time, timer->scheduled_time))
+			break;
+		timer_heap_place(timer_heap[child], i);
+		i = child;
 	}
+	timer_heap_place(timer, i);
+}
 
-	/* walked off the end of the list */
-	list_add_tail(&timer_queue, &timer->node);
+static void insert_timer_in_queue(timer_t *timer)
+{
+//	TRACEF("timer %p, scheduled %d, periodic %d\n", timer, timer->scheduled_time, timer->periodic_time);
+
+	if (timer_heap_count == TIMER_HEAP_SIZE)
+		panic("timer queue full, raise TIMER_HEAP_SIZE (%u)\n", TIMER_HEAP_SIZE);
+
+	timer_heap[timer_heap_count] = timer;
+	timer_heap_sift_up(timer_heap_count++);
+}
+
+static void remove_timer_from_queue(timer_t *timer)
+{
+	uint i = timer->heap_index - 1;
+	timer_t *last;
+
+	timer->heap_index = 0;
+	last = timer_heap[--timer_heap_count];
+	if (last == timer)
+		return;
+
+	/* move the last entry into the hole, it may belong above or below it */
+	timer_heap_place(last, i);
+	timer_heap_sift_up(i);
+	timer_heap_sift_down(last->heap_index - 1);
 }
 
 static void timer_set(timer_t *timer, time_t delay, time_t period, timer_callback callback, void *arg)
@@ -85,7 +157,7 @@ static void timer_set(timer_t *timer, time_t delay, time_t period, timer_callbac
 
 	DEBUG_ASSERT(timer->magic == TIMER_MAGIC);	
 
-	if (list_in_list(&timer->node)) {
+	if (timer_queued(timer)) {
 		panic("timer %p already in list\n", timer);
 	}
 
@@ -102,7 +174,7 @@ static void timer_set(timer_t *timer, time_t delay, time_t period, timer_callbac
 	insert_timer_in_queue(timer);
 
 #if PLATFORM_HAS_DYNAMIC_TIMER
-	if (list_peek_head_type(&timer_queue, timer_t, node) == timer) {
+	if (timer_queue_head() == timer) {
 		/* we just modified the head of the timer queue */
 //		TRACEF("setting new timer for %u msecs\n", (uint)delay);
 		platform_set_oneshot_timer(timer_tick, NULL, delay);
@@ -164,11 +236,11 @@ void timer_cancel(timer_t *timer)
 	enter_critical_section();
 
 #if PLATFORM_HAS_DYNAMIC_TIMER
-	timer_t *oldhead = list_peek_head_type(&timer_queue, timer_t, node);
+	timer_t *oldhead = timer_queue_head();
 #endif
 
-	if (list_in_list(&timer->node))
-		list_delete(&timer->node);
+	if (timer_queued(timer))
+		remove_timer_from_queue(timer);
 
 	/* to keep it from being reinserted into the queue if called from 
 	 * periodic timer callback.
@@ -179,7 +251,7 @@ void timer_cancel(timer_t *timer)
 
 #if PLATFORM_HAS_DYNAMIC_TIMER
 	/* see if we've just modified the head of the timer queue */
-	timer_t *newhead = list_peek_head_type(&timer_queue, timer_t, node);
+	timer_t *newhead = timer_queue_head();
 	if (newhead == NULL) {
 //		TRACEF("clearing old hw timer, nothing in the queue\n");
 		platform_stop_timer();
@@ -214,15 +286,13 @@ static enum handler_return timer_tick(void *arg, time_t now)
 
 	for (;;) {
 		/* see if there's an event to process */
-		timer = list_peek_head_type(&timer_queue, timer_t, node);
+		timer = timer_queue_head();
 		if (likely(!timer || TIME_LT(now, timer->scheduled_time)))
 			break;
 
 		/* process it */
 		DEBUG_ASSERT(timer->magic == TIMER_MAGIC);
-		list_delete(&timer->node);
-//		timer = list_remove_head_type(&timer_queue, timer_t, node);
-//		ASSERT(timer);
+		remove_timer_from_queue(timer);
 
 //		TRACEF("dequeued timer %p, scheduled %d periodic %d\n", timer, timer->scheduled_time, timer->periodic_time);
 
@@ -239,7 +309,7 @@ static enum handler_return timer_tick(void *arg, time_t now)
 		/* if it was a periodic timer and it hasn't been requeued
 		 * by the callback put it back in the list
 		 */
-		if (periodic && !list_in_list(&timer->node) && timer->periodic_time > 0) {
+		if (periodic && !timer_queued(timer) && timer->periodic_time > 0) {
 //			TRACEF("periodic timer, period %u\n", (uint)timer->periodic_time);
 			timer->scheduled_time = now + timer->periodic_time;
 			insert_timer_in_queue(timer);
@@ -248,12 +318,15 @@ static enum handler_return timer_tick(void *arg, time_t now)
 
 #if PLATFORM_HAS_DYNAMIC_TIMER
 	/* reset the timer to the next event */
-	timer = list_peek_head_type(&timer_queue, timer_t, node);
+	timer = timer_queue_head();
 	if (timer) {
 		/* has to be the case or it would have fired already */
 		ASSERT(TIME_GT(timer->scheduled_time, now));
 
-		time_t delay = timer->scheduled_time - now;
+		/* the callbacks took time, measure from the present */
+		time_t cur = current_time();
+		time_t delay = TIME_GT(timer->scheduled_time, cur) ?
+			timer->scheduled_time - cur : 0;
 
 //		TRACEF("setting new timer for %u msecs for event %p\n", (uint)delay, timer);
 		platform_set_oneshot_timer(timer_tick, NULL, delay);
@@ -272,10 +345,11 @@ static enum handler_return timer_tick(void *arg, time_t now)
 
 void timer_init(void)
 {
-	list_initialize(&timer_queue);
-
+#if !PLATFORM_HAS_DYNAMIC_TIMER
 	/* register for a periodic timer tick */
 	platform_set_periodic_timer(timer_tick, NULL, 10); /* 10ms */
+#endif
+	/* otherwise the hw timer is programmed for the first timer set */
 }
 
 
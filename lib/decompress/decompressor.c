@@ -0,0 +1,84 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <debug.h>
+#include <compiler.h>
+#include <string.h>
+#include <decompress.h>
+#include <decompressor.h>
+#if WITH_LIB_LZ4
+#include <lz4.h>
+#endif
+#if WITH_LIB_ZSTD
+#include <zstd.h>
+#endif
+
+/* Formats a boot image kernel or dtb may be packed with, in the order their
+ * magic is checked.
+ */
+static const struct decompressor decompressors[] = {
+	{ "gzip", is_gzip_package, decompress },
+#if WITH_LIB_LZ4
+	{ "lz4", is_lz4_package, lz4_decompress },
+#endif
+#if WITH_LIB_ZSTD
+	{ "zstd", is_zstd_package, zstd_decompress },
+#endif
+};
+
+const struct decompressor *decompressor_find(unsigned char *buf, unsigned int len)
+{
+	unsigned int i;
+
+	for (i = 0; i < countof(decompressors); i++) {
+		if (decompressors[i].detect(buf, len))
+			return &decompressors[i];
+	}
+
+	return NULL;
+}
+
+int is_compressed_package(unsigned char *buf, unsigned int len)
+{
+	return decompressor_find(buf, len) != NULL;
+}
+
+int decompress_package(unsigned char *in_buf, unsigned int in_len,
+		       unsigned char *out_buf, unsigned int out_buf_len,
+		       unsigned int *pos, unsigned int *out_len)
+{
+	const struct decompressor *d = decompressor_find(in_buf, in_len);
+
+	if (!d) {
+		dprintf(CRITICAL, "Unknown compression format\n");
+		return -1;
+	}
+
+	dprintf(INFO, "%s compressed package\n", d->name);
+
+	return d->decompress(in_buf, in_len, out_buf, out_buf_len, pos, out_len);
+}
@@ -0,0 +1,47 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __LIB_DECOMPRESSOR_H
+#define __LIB_DECOMPRESSOR_H
+
+struct decompressor {
+	const char *name;
+	/* Non zero if buf holds a package in this format */
+	int (*detect)(unsigned char *buf, unsigned int len);
+	/* Same contract as decompress(): pos is the end of the compressed data */
+	int (*decompress)(unsigned char *in_buf, unsigned int in_len,
+			  unsigned char *out_buf, unsigned int out_buf_len,
+			  unsigned int *pos, unsigned int *out_len);
+};
+
+const struct decompressor *decompressor_find(unsigned char *buf, unsigned int len);
+int is_compressed_package(unsigned char *buf, unsigned int len);
+int decompress_package(unsigned char *in_buf, unsigned int in_len,
+		       unsigned char *out_buf, unsigned int out_buf_len,
+		       unsigned int *pos, unsigned int *out_len);
+
+#endif /* __LIB_DECOMPRESSOR_H */
@@ -0,0 +1,11 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+INCLUDES += -I$(LOCAL_DIR) -I$(LK_TOP_DIR)/lib/zlib_inflate
+
+MODULES += \
+	lib/zlib_inflate \
+	lib/lz4 \
+	lib/zstd
+
+OBJS += \
+	$(LOCAL_DIR)/decompressor.o
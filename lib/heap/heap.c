@@ -40,6 +40,15 @@
 #define ROUNDUP(a, b) (((a) + ((b)-1)) & ~((b)-1))
 
 #define HEAP_MAGIC 'HEAP'
+#define SLAB_MAGIC 'SLAB'
+
+// small allocations are served from per size class slabs carved out of the heap,
+// classes are powers of two from 1 << SLAB_MIN_SHIFT up to SLAB_MAX_SIZE bytes
+#define SLAB_SIZE 8192
+#define SLAB_MIN_SHIFT 4
+#define SLAB_NUM_CLASSES 6
+#define SLAB_MAX_SIZE (1 << (SLAB_MIN_SHIFT + SLAB_NUM_CLASSES - 1))
+#define SLAB_ALIGN 8
 
 #if WITH_STATIC_HEAP
 
@@ -67,8 +76,35 @@ struct heap {
 	void *base;
 	size_t len;
 	struct list_node free_list;
+
+	// statistics of the list allocator, slabs count as allocated chunks
+	size_t used;
+	size_t peak_used;
+	unsigned int allocs;
+	unsigned int failed_allocs;
+};
+
+struct slab_class {
+	size_t size;			// usable size of an object
+	size_t stride;			// object size including its alloc_struct_begin
+	struct list_node partial;	// slabs with free objects
+	unsigned int slabs;
+	unsigned int inuse;
+	unsigned int peak_inuse;
+	unsigned int allocs;
 };
 
+// header at the start of every slab, followed by the objects
+struct slab {
+	struct list_node node;
+	struct slab_class *cls;
+	void *free;			// singly linked list of free objects
+	unsigned int inuse;
+	unsigned int count;
+};
+
+static struct slab_class slab_classes[SLAB_NUM_CLASSES];
+
 // heap static vars
 static struct heap theheap;
 
@@ -100,6 +136,62 @@ static void heap_dump(void)
 	}
 }
 
+void heap_get_stats(struct heap_stats *stats)
+{
+	struct free_heap_chunk *chunk;
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+
+	enter_critical_section();
+
+	stats->size = theheap.len;
+	stats->used = theheap.used;
+	stats->peak_used = theheap.peak_used;
+	stats->allocs = theheap.allocs;
+	stats->failed_allocs = theheap.failed_allocs;
+
+	list_for_every_entry(&theheap.free_list, chunk, struct free_heap_chunk, node) {
+		stats->free += chunk->len;
+		stats->free_chunks++;
+		if (chunk->len > stats->largest_free)
+			stats->largest_free = chunk->len;
+	}
+
+	for (i = 0; i < SLAB_NUM_CLASSES; i++) {
+		stats->slab_allocs += slab_classes[i].allocs;
+		stats->slab_used += slab_classes[i].inuse * slab_classes[i].size;
+		stats->slab_size += slab_classes[i].slabs * SLAB_SIZE;
+	}
+
+	exit_critical_section();
+}
+
+static void heap_dump_stats(void)
+{
+	struct heap_stats stats;
+	int i;
+
+	heap_get_stats(&stats);
+
+	dprintf(INFO, "Heap stats:\n");
+	dprintf(INFO, "\tsize 0x%zx, used 0x%zx, peak 0x%zx, free 0x%zx\n",
+			stats.size, stats.used, stats.peak_used, stats.free);
+	dprintf(INFO, "\tfree chunks %u, largest 0x%zx, fragmentation %u%%\n",
+			stats.free_chunks, stats.largest_free,
+			stats.free ? (unsigned int)(100 - (uint64_t)stats.largest_free * 100 / stats.free) : 0);
+	dprintf(INFO, "\tallocs %u (failed %u), slab allocs %u\n",
+			stats.allocs, stats.failed_allocs, stats.slab_allocs);
+	dprintf(INFO, "\tslabs: 0x%zx bytes, 0x%zx in use\n", stats.slab_size, stats.slab_used);
+
+	for (i = 0; i < SLAB_NUM_CLASSES; i++) {
+		struct slab_class *cls = &slab_classes[i];
+
+		dprintf(INFO, "\t\tclass %4zu: slabs %u, objects %u, peak %u\n",
+				cls->size, cls->slabs, cls->inuse, cls->peak_inuse);
+	}
+}
+
 static void heap_test(void)
 {
 	void *ptr[16];
@@ -224,7 +316,7 @@ struct free_heap_chunk *heap_create_free_chunk(void *ptr, size_t len)
 	return chunk;
 }
 
-void *heap_alloc(size_t size, unsigned int alignment)
+static void *heap_list_alloc(size_t size, unsigned int alignment)
 {
 	void *ptr;
 #if DEBUG_HEAP
@@ -335,10 +427,18 @@ void *heap_alloc(size_t size, unsigned int alignment)
 			memset(as->padding_start, PADDING_FILL, as->padding_size);
 #endif
 
+			theheap.used += size;
+			if (theheap.used > theheap.peak_used)
+				theheap.peak_used = theheap.used;
+			theheap.allocs++;
+
 			break;
 		}
 	}
 
+	if (!ptr)
+		theheap.failed_allocs++;
+
 	LTRACEF("returning ptr %p\n", ptr);
 
 //	heap_dump();
@@ -348,17 +448,161 @@ void *heap_alloc(size_t size, unsigned int alignment)
 	return ptr;
 }
 
+static void heap_list_free(struct alloc_struct_begin *as)
+{
+	enter_critical_section();
+	theheap.used -= as->size;
+	heap_insert_free_chunk(heap_create_free_chunk(as->ptr, as->size));
+	exit_critical_section();
+}
+
+static struct slab *slab_create(struct slab_class *cls)
+{
+	struct slab *slab;
+	addr_t obj, end;
+
+	slab = heap_list_alloc(SLAB_SIZE, 0);
+	if (!slab)
+		return NULL;
+
+	slab->cls = cls;
+	slab->free = NULL;
+	slab->inuse = 0;
+	slab->count = 0;
+
+	// objects are SLAB_ALIGN aligned, with their alloc_struct_begin in front
+	obj = ROUNDUP((addr_t)(slab + 1) + sizeof(struct alloc_struct_begin), SLAB_ALIGN);
+	end = (addr_t)slab + SLAB_SIZE;
+
+	for (; obj + cls->size <= end; obj += cls->stride) {
+		*(void **)obj = slab->free;
+		slab->free = (void *)obj;
+		slab->count++;
+	}
+
+	list_add_head(&cls->partial, &slab->node);
+	cls->slabs++;
+
+	return slab;
+}
+
+static void *slab_alloc(size_t size)
+{
+	struct slab_class *cls;
+	struct slab *slab;
+	unsigned int i = 0;
+	void *ptr;
+
+	while ((1U << (SLAB_MIN_SHIFT + i)) < size)
+		i++;
+	cls = &slab_classes[i];
+
+	enter_critical_section();
+
+	slab = list_peek_head_type(&cls->partial, struct slab, node);
+	if (!slab)
+		slab = slab_create(cls);
+	if (!slab) {
+		exit_critical_section();
+		return NULL;
+	}
+
+	ptr = slab->free;
+	slab->free = *(void **)ptr;
+	slab->inuse++;
+
+	// full slabs leave the partial list until an object is freed
+	if (!slab->free)
+		list_delete(&slab->node);
+
+	cls->inuse++;
+	if (cls->inuse > cls->peak_inuse)
+		cls->peak_inuse = cls->inuse;
+	cls->allocs++;
+
+	exit_critical_section();
+
+	struct alloc_struct_begin *as = (struct alloc_struct_begin *)ptr;
+	as--;
+	as->magic = SLAB_MAGIC;
+	as->ptr = slab;
+	as->size = cls->size;
+#if DEBUG_HEAP
+	as->padding_start = NULL;
+	as->padding_size = 0;
+	memset(ptr, ALLOC_FILL, cls->size);
+#endif
+
+	return ptr;
+}
+
+static void slab_free(void *ptr, struct alloc_struct_begin *as)
+{
+	struct slab *slab = as->ptr;
+	struct slab_class *cls = slab->cls;
+
+	as->magic = 0;
+#if DEBUG_HEAP
+	memset(ptr, FREE_FILL, cls->size);
+#endif
+
+	enter_critical_section();
+
+	// a full slab goes back on the partial list
+	if (!slab->free)
+		list_add_head(&cls->partial, &slab->node);
+
+	*(void **)ptr = slab->free;
+	slab->free = ptr;
+	slab->inuse--;
+	cls->inuse--;
+
+	// give empty slabs back to the heap, keeping one around per class so that
+	// an alloc/free pattern at a slab boundary doesn't bounce
+	if (!slab->inuse && (cls->partial.next != &slab->node || slab->node.next != &cls->partial)) {
+		list_delete(&slab->node);
+		cls->slabs--;
+		exit_critical_section();
+
+		as = (struct alloc_struct_begin *)slab;
+		heap_list_free(as - 1);
+		return;
+	}
+
+	exit_critical_section();
+}
+
+void *heap_alloc(size_t size, unsigned int alignment)
+{
+	// alignment must be power of 2
+	if (alignment & (alignment - 1))
+		return NULL;
+
+	if (alignment <= SLAB_ALIGN && size <= SLAB_MAX_SIZE) {
+		void *ptr = slab_alloc(size);
+		if (ptr)
+			return ptr;
+	}
+
+	return heap_list_alloc(size, alignment);
+}
+
 void *heap_realloc(void *ptr, size_t size)
 {
 	void * tmp_ptr = NULL;
-	size_t min_size;
+	size_t min_size, old_size;
 	struct alloc_struct_begin *as = (struct alloc_struct_begin *)ptr;
 	as--;
 
 	if (size != 0){
 		tmp_ptr = heap_alloc(size, 0);
 		if (ptr != NULL && tmp_ptr != NULL){
-			min_size = (size < as->size) ? size : as->size;
+			// as->size of a list allocation is the whole chunk, header included
+			if (as->magic == SLAB_MAGIC)
+				old_size = as->size;
+			else
+				old_size = (addr_t)as->ptr + as->size - (addr_t)ptr;
+			min_size = (size < old_size) ? size : old_size;
 			memcpy(tmp_ptr, ptr, min_size);
 			heap_free(ptr);
 		}
@@ -380,7 +624,12 @@ void heap_free(void *ptr)
 	// check for the old allocation structure
 	struct alloc_struct_begin *as = (struct alloc_struct_begin *)ptr;
 	as--;
-	
+
+	if (as->magic == SLAB_MAGIC) {
+		slab_free(ptr, as);
+		return;
+	}
+
 	DEBUG_ASSERT(as->magic == HEAP_MAGIC);
 
 #if DEBUG_HEAP
@@ -401,15 +650,15 @@ void heap_free(void *ptr)
 	LTRACEF("allocation was %zd bytes long at ptr %p\n", as->size, as->ptr);
 
 	// looks good, create a free chunk and add it to the pool
-	enter_critical_section();
-	heap_insert_free_chunk(heap_create_free_chunk(as->ptr, as->size));
-	exit_critical_section();
+	heap_list_free(as);
 
 //	heap_dump();
 }
 
 void heap_init(void)
 {
+	int i;
+
 	LTRACE_ENTRY;
 
 	// set the heap range
@@ -424,6 +673,15 @@ void heap_init(void)
 	// create an initial free chunk
 	heap_insert_free_chunk(heap_create_free_chunk(theheap.base, theheap.len));
 
+	// set up the slab size classes
+	for (i = 0; i < SLAB_NUM_CLASSES; i++) {
+		struct slab_class *cls = &slab_classes[i];
+
+		cls->size = 1 << (SLAB_MIN_SHIFT + i);
+		cls->stride = ROUNDUP(cls->size + sizeof(struct alloc_struct_begin), SLAB_ALIGN);
+		list_initialize(&cls->partial);
+	}
+
 	// dump heap info
 //	heap_dump();
 
@@ -451,6 +709,9 @@ static int cmd_heap(int argc, const cmd_args *argv)
 
 	if (strcmp(argv[1].str, "info") == 0) {
 		heap_dump();
+		heap_dump_stats();
+	} else if (strcmp(argv[1].str, "stats") == 0) {
+		heap_dump_stats();
 	} else {
 		printf("unrecognized command\n");
 		return -1;
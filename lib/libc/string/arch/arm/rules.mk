@@ -6,6 +6,14 @@ OBJS += \
 	$(LOCAL_DIR)/memcpy.o \
 	$(LOCAL_DIR)/memset.o
 
+# memcmp only has an assembly version for cores with NEON
+ifneq ($(filter ARM_WITH_NEON=1,$(DEFINES)),)
+ASM_STRING_OPS += memcmp
+
+OBJS += \
+	$(LOCAL_DIR)/memcmp.o
+endif
+
 # filter out the C implementation
 C_STRING_OPS := $(filter-out $(ASM_STRING_OPS),$(C_STRING_OPS))
 
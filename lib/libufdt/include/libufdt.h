@@ -9,6 +9,35 @@
 #define false 0
 #define true 1
 
+/*
+ * BEGIN of ufdt_arena methods
+ */
+
+/*
+ * Initializes an empty arena. The first dto_malloc'd chunk has chunk_size
+ * bytes (at least a page), later ones grow.
+ */
+void ufdt_arena_init(struct ufdt_arena *arena, size_t chunk_size);
+
+/*
+ * Allocates size bytes, 8-byte aligned, from the arena.
+ *
+ * @return: a pointer to the space or
+ *          NULL if dto_malloc failed
+ *
+ * @Time: O(1)
+ */
+void *ufdt_arena_alloc(struct ufdt_arena *arena, size_t size);
+
+/*
+ * Frees everything allocated from the arena at once.
+ */
+void ufdt_arena_destroy(struct ufdt_arena *arena);
+
+/*
+ * END of ufdt_arena methods
+ */
+
 /*
  * BEGIN of ufdt_node_dict methods
  * Since in the current implementation, it's actually a hash table.
@@ -87,26 +116,24 @@ void ufdt_node_dict_print(struct ufdt_node_dict *dict);
  */
 
 /*
- * Allocates spaces for new ufdt_node who represents a fdt node at fdt_tag_ptr.
+ * Allocates spaces from arena for new ufdt_node who represents a fdt node at
+ * fdt_tag_ptr.
  * In order to get name pointer, it's neccassary to give the pointer to the
  * entire fdt it belongs to.
+ * The node goes away with the arena, there's no way to free it alone.
  *
  *
  * @return: a pointer to the newly created ufdt_node or
  *          NULL if dto_malloc failed
  */
-struct ufdt_node *ufdt_node_construct(void *fdtp, fdt32_t *fdt_tag_ptr);
-
-/*
- * Frees all nodes in the subtree rooted at *node.
- * Also dto_frees those ufdt_node_dicts in each node.
- */
-void ufdt_node_destruct(struct ufdt_node *node);
+struct ufdt_node *ufdt_node_construct(void *fdtp, fdt32_t *fdt_tag_ptr,
+                                      struct ufdt_arena *arena);
 
 /*
  * Adds the child as a subnode of the parent.
  * It's been done by add entries in parent->prop_list or node_list depending on
  * the tag type of child.
+ * A lazy parent has to be ufdt_node_expand()ed first.
  *
  * @return: 0 if success
  *          < 0 otherwise
@@ -209,25 +236,34 @@ uint32_t ufdt_node_get_phandle(const struct ufdt_node *node);
  */
 
 /*
- * Constructs a ufdt whose base fdt is fdtp.
+ * Constructs a ufdt whose base fdt is fdtp, allocated from arena.
  * Note that this function doesn't construct the entire tree.
- * To get the whole tree please call `fdt_to_ufdt(fdtp, fdt_size)`
+ * To get the whole tree please call `fdt_to_ufdt(fdtp, fdt_size, arena)`
+ * There's no destructor, the tree, its ufdt_nodes and the
+ * static_phandle_table go away with ufdt_arena_destroy().
  *
- * @return: an empty ufdt with base fdtp = fdtp
+ * @return: an empty ufdt with base fdtp = fdtp or
+ *          NULL if dto_malloc failed
  */
-struct ufdt *ufdt_construct(void *fdtp);
+struct ufdt *ufdt_construct(void *fdtp, struct ufdt_arena *arena);
 
 /*
- * Frees the space occupied by the ufdt, including all ufdt_nodes and
- * ufdt_node_dicts along
- * with static_phandle_table.
+ * Builds the children of a lazy node (see fdt_to_ufdt_lazy()) from the FDT.
+ * Its subnodes are lazy in turn. Does nothing for other nodes.
+ *
+ * @return: 0 if success
+ *          < 0 otherwise
+ *
+ * @Time: O(size of the subtree in the FDT)
  */
-void ufdt_destruct(struct ufdt *tree);
+int ufdt_node_expand(struct ufdt *tree, struct ufdt_node *node);
 
 /*
  * Gets the pointer to the ufdt_node in tree with phandle = phandle.
  * The function do a binary search in tree->phandle_table.
  *
+ * In a lazy tree the node is expanded, as are the nodes above it.
+ *
  * @return: a pointer to the target ufdt_node
  *          NULL if no ufdt_node has phandle = phandle
  *
@@ -242,6 +278,7 @@ struct ufdt_node *ufdt_get_node_by_phandle(struct ufdt *tree, uint32_t phandle);
  * In later example, some_alias is a property in "/aliases" with data is a path
  * to some node X. Then the funcion will return node with relative
  * path = "to/node" w.r.t. X.
+ * In a lazy tree all nodes on the path are expanded, the target included.
  *
  * @return: a pointer to the target ufdt_node or
  *          NULL if such dnt doesn't exist.
@@ -275,6 +312,8 @@ bool node_name_eq(const struct ufdt_node *node, const char *name, int len);
 
 /*
  * Merges tree_b into tree_a with tree_b has all nodes except root disappeared.
+ * tree_a is part of tree, it and the subnodes that are merged into are
+ * expanded first if they're lazy.
  * Overwrite property in tree_a if there's one with same name in tree_b.
  * Otherwise add the property to tree_a.
  * For subnodes with the same name, recursively run this function.
@@ -323,7 +362,8 @@ bool node_name_eq(const struct ufdt_node *node, const char *name, int len);
  *
  * @Time: O(# of nodes in tree_b + total length of all names in tree_b) w.h.p.
  */
-int merge_ufdt_into(struct ufdt_node *tree_a, struct ufdt_node *tree_b);
+int merge_ufdt_into(struct ufdt *tree, struct ufdt_node *tree_a,
+                    struct ufdt_node *tree_b);
 
 /*
  * BEGIN of ufdt output functions
@@ -335,47 +375,46 @@ int merge_ufdt_into(struct ufdt_node *tree_a, struct ufdt_node *tree_b);
  * phandle table as
  * well.
  *
+ * All of it is allocated from arena.
+ *
  * @return: the ufdt T representing fdtp or
- *          T with T.fdtp == NULL if fdtp is unvalid.
+ *          T with T.fdtp == NULL if fdtp is unvalid or
+ *          NULL if dto_malloc failed.
  *
  * @Time: O(fdt_size + nlogn) where n = # of nodes in fdt.
  */
-struct ufdt *fdt_to_ufdt(void *fdtp, size_t fdt_size);
+struct ufdt *fdt_to_ufdt(void *fdtp, size_t fdt_size,
+                         struct ufdt_arena *arena);
 
 /*
- * Sequentially dumps the tree rooted at *node to FDT buffer fdtp.
- * Basically it calls functions provided by libfdt/fdt_sw.c.
+ * Like fdt_to_ufdt(), but only builds a lazy root node: a FDT_BEGIN_NODE
+ * whose children are left in the FDT. The tree lookups (by path or phandle)
+ * and merge_ufdt_into() expand the nodes they pass, everything else stays
+ * as it is in fdtp and is copied from there by ufdt_to_fdt().
+ * The ufdt_node_* functions see a lazy node as one without children.
+ * The phandle table is built from the FDT directly.
+ * FDTs older than version 17 are built in full.
  *
- * All those functions works fast.
- * But when it comes to dump property node to fdt, the function they
- * provide(fdt_property()) is really slow. Since it runs through all strings
- * stored in fdt to find the right `nameoff` for the property node.
- *
- * So we implement our own fdt_property() called `output_property_to_fdt()`, the
- * basic
- * idea is that we keep a hash table that we can search for the nameoff of the
- * string in constant time instead of O(total length of strings) search.
- *
- * @return: 0 if successfully dump or
- *          < 0 otherwise
+ * @return: the same as fdt_to_ufdt()
  *
- * @Time: O(total length of all names + # of nodes in subtree rooted at *root)
+ * @Time: O(fdt_size + plogp) where p = # of nodes with phandle in fdt.
  */
-int output_ufdt_node_to_fdt(struct ufdt_node *node, void *fdtp,
-                            struct ufdt_node_dict *all_props);
+struct ufdt *fdt_to_ufdt_lazy(void *fdtp, size_t fdt_size,
+                              struct ufdt_arena *arena);
 
 /*
- * Sequentially dumps the whole ufdt to FDT buffer fdtp with buffer size
- * buf_size.
- * Basically it calls functions provided by libfdt/fdt_sw.c.
- * The main overhead here is to dump the tree to fdtp by calling
- * output_ufdt_node_to_fdt().
+ * Dumps the whole ufdt to FDT buffer buf with buffer size buf_size.
+ * The mem rsvmap and the strings block of tree->fdtp are copied as they
+ * are, as is the FDT of every lazy node. Other nodes are written one
+ * property at a time, the names of properties merged in from another FDT
+ * are appended to the strings block.
+ * buf must not overlap tree->fdtp or any FDT merged into it.
  *
  *
  * @return: 0 if successfully dump or
  *          < 0 otherwise
  *
- * @Time: O(total length of all names + # of nodes in tree)
+ * @Time: O(fdt_size + total length of all new names + # of built nodes)
  */
 int ufdt_to_fdt(struct ufdt *tree, void *buf, int buf_size);
 
@@ -22,4 +22,15 @@ struct fdt_header *ufdt_apply_overlay(struct fdt_header *main_fdt_header,
                                       void *overlay_fdtp,
                                       size_t overlay_size);
 
+/* Same as ufdt_apply_overlay(), but writes the new FDT to the out_fdtp
+ * buffer of out_fdt_size bytes rather than to a dto_malloc'd one.
+ * fdt_totalsize(main_fdt_header) + overlay_size bytes are always enough.
+ * out_fdtp must not overlap the other two buffers.
+ * Returns 0, or -1 in case of error.
+ */
+int ufdt_apply_overlay_into(struct fdt_header *main_fdt_header,
+                            size_t main_fdt_size, void *overlay_fdtp,
+                            size_t overlay_size, void *out_fdtp,
+                            size_t out_fdt_size);
+
 #endif /* UFDT_OVERLAY_H */
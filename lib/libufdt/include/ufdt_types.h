@@ -68,7 +68,9 @@ struct fdt_node_ufdt_node {
 
 struct phandle_table_entry {
   uint32_t phandle;
+  /* NULL until first looked up if the tree was built by fdt_to_ufdt_lazy() */
   struct ufdt_node *node;
+  int offset;
 };
 
 struct static_phandle_table {
@@ -76,10 +78,24 @@ struct static_phandle_table {
   struct phandle_table_entry *data;
 };
 
+struct ufdt_arena_chunk;
+
+/*
+ * Bump allocator for all ufdt_nodes of an overlay session. Nothing is freed
+ * on its own, ufdt_arena_destroy() returns every chunk at once.
+ */
+struct ufdt_arena {
+  struct ufdt_arena_chunk *chunks;
+  size_t chunk_size;
+  size_t size; /* bytes obtained with dto_malloc */
+  size_t used; /* bytes handed out */
+};
+
 struct ufdt {
   void *fdtp;
   struct ufdt_node *root;
   struct static_phandle_table phandle_table;
+  struct ufdt_arena *arena;
 };
 
 typedef void func_on_ufdt_node(struct ufdt_node *, void *);
@@ -94,4 +110,13 @@ static uint32_t tag_of(const struct ufdt_node *node) {
   return fdt32_to_cpu(*node->fdt_tag_ptr);
 }
 
+/*
+ * A FDT_BEGIN_NODE whose children have not been built yet, see
+ * fdt_to_ufdt_lazy(). It gets its last_child_p in ufdt_node_expand().
+ */
+static int ufdt_node_is_lazy(const struct ufdt_node *node) {
+  return tag_of(node) == FDT_BEGIN_NODE &&
+         ((const struct fdt_node_ufdt_node *)node)->last_child_p == NULL;
+}
+
 #endif /* UFDT_TYPES_H */
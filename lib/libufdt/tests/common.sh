@@ -13,6 +13,12 @@ command_exists () {
   type "$1" &> /dev/null;
 }
 
+# Picks the seconds out of the "...: took X secs" line the overlay
+# programs print.
+took_secs() {
+  sed -n 's/.*took \([0-9.]*\) secs$/\1/p'
+}
+
 remove_local_fixups() {
   sed '/__local_fixups__/ {s/^\s*__local_fixups__\s*//; :again;N; s/{[^{}]*};//; /^$/ !b again; d}' $1
 }
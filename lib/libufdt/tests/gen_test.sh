@@ -25,6 +25,7 @@ IN_DATA_DIR="testdata"
 TEMP_DIR=`mktemp -d`
 # The script will exit directly if any command fails.
 set -e
+set -o pipefail
 trap on_exit EXIT
 
 # Global variables
@@ -37,6 +38,8 @@ OVL_MERGED_DTS="$TEMP_DIR/${TESTCASE_NAME}-ovl-merged.dts"
 #
 # Complie and diff
 #
-$SCRIPT_DIR/apply_overlay.sh --fdt "$BASE_DTS" "$OVERLAY_DTS" "$REF_MERGED_DTS"
-$SCRIPT_DIR/apply_overlay.sh --ufdt "$BASE_DTS" "$OVERLAY_DTS" "$OVL_MERGED_DTS"
+FDT_SECS=$($SCRIPT_DIR/apply_overlay.sh --fdt "$BASE_DTS" "$OVERLAY_DTS" "$REF_MERGED_DTS" | took_secs)
+UFDT_SECS=$($SCRIPT_DIR/apply_overlay.sh --ufdt "$BASE_DTS" "$OVERLAY_DTS" "$OVL_MERGED_DTS" | took_secs)
 dts_diff "$REF_MERGED_DTS" "$OVL_MERGED_DTS"
+
+alert "${TESTCASE_NAME}: fdt_apply_overlay ${FDT_SECS} secs, ufdt_apply_overlay ${UFDT_SECS} secs"
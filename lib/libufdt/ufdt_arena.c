@@ -0,0 +1,71 @@
+#include "libufdt.h"
+
+#include "fdt_internal.h"
+
+
+/*
+ * Every allocation is rounded up to this, so ufdt_nodes and the
+ * phandle_table_entry arrays can be carved from the same chunk.
+ */
+#define UFDT_ARENA_ALIGN 8
+#define UFDT_ARENA_MIN_CHUNK 4096
+
+struct ufdt_arena_chunk {
+  struct ufdt_arena_chunk *next;
+  size_t size;
+  size_t used;
+};
+
+#define UFDT_ARENA_CHUNK_HDR \
+  FDT_ALIGN(sizeof(struct ufdt_arena_chunk), UFDT_ARENA_ALIGN)
+
+void ufdt_arena_init(struct ufdt_arena *arena, size_t chunk_size) {
+  arena->chunks = NULL;
+  arena->chunk_size =
+      chunk_size < UFDT_ARENA_MIN_CHUNK ? UFDT_ARENA_MIN_CHUNK : chunk_size;
+  arena->size = 0;
+  arena->used = 0;
+}
+
+void *ufdt_arena_alloc(struct ufdt_arena *arena, size_t size) {
+  struct ufdt_arena_chunk *chunk = arena->chunks;
+
+  size = FDT_ALIGN(size, UFDT_ARENA_ALIGN);
+  if (chunk == NULL || chunk->size - chunk->used < size) {
+    size_t chunk_size = arena->chunk_size;
+    while (chunk_size < size) chunk_size <<= 1;
+
+    chunk = dto_malloc(UFDT_ARENA_CHUNK_HDR + chunk_size);
+    if (chunk == NULL) {
+      dto_error("failed to grow the arena by %zu bytes\n", chunk_size);
+      return NULL;
+    }
+    chunk->next = arena->chunks;
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    arena->chunks = chunk;
+    arena->size += chunk_size;
+    /*
+     * The first guess was too small, don't go back to dto_malloc for
+     * every other chunk's worth of nodes.
+     */
+    arena->chunk_size = chunk_size << 1;
+  }
+
+  void *res = (char *)chunk + UFDT_ARENA_CHUNK_HDR + chunk->used;
+  chunk->used += size;
+  arena->used += size;
+  return res;
+}
+
+void ufdt_arena_destroy(struct ufdt_arena *arena) {
+  struct ufdt_arena_chunk *chunk = arena->chunks;
+  while (chunk) {
+    struct ufdt_arena_chunk *next = chunk->next;
+    dto_free(chunk);
+    chunk = next;
+  }
+  arena->chunks = NULL;
+  arena->size = 0;
+  arena->used = 0;
+}
@@ -4,20 +4,20 @@
 #include "ufdt_util.h"
 
 
-struct ufdt *ufdt_construct(void *fdtp) {
-  struct ufdt *res_ufdt = dto_malloc(sizeof(struct ufdt));
+struct ufdt *ufdt_construct(void *fdtp, struct ufdt_arena *arena) {
+  struct ufdt *res_ufdt = ufdt_arena_alloc(arena, sizeof(struct ufdt));
+  if (res_ufdt == NULL) return NULL;
   res_ufdt->fdtp = fdtp;
   res_ufdt->root = NULL;
+  res_ufdt->phandle_table.len = 0;
+  res_ufdt->phandle_table.data = NULL;
+  res_ufdt->arena = arena;
 
   return res_ufdt;
 }
 
-void ufdt_destruct(struct ufdt *tree) {
-  ufdt_node_destruct(tree->root);
-  dto_free(tree->phandle_table.data);
-}
-
-static struct ufdt_node *ufdt_new_node(void *fdtp, int node_offset) {
+static struct ufdt_node *ufdt_new_node(void *fdtp, int node_offset,
+                                       struct ufdt_arena *arena) {
   if (fdtp == NULL) {
     dto_error("Failed to get new_node because tree is NULL\n");
     return NULL;
@@ -25,11 +25,148 @@ static struct ufdt_node *ufdt_new_node(void *fdtp, int node_offset) {
 
   fdt32_t *fdt_tag_ptr =
       (fdt32_t *)fdt_offset_ptr(fdtp, node_offset, sizeof(fdt32_t));
-  struct ufdt_node *res = ufdt_node_construct(fdtp, fdt_tag_ptr);
+  struct ufdt_node *res = ufdt_node_construct(fdtp, fdt_tag_ptr, arena);
   return res;
 }
 
-static struct ufdt_node *fdt_to_ufdt_tree(void *fdtp, int cur_fdt_tag_offset,
+/*
+ * Offset of the node's tag in the struct block of tree->fdtp.
+ */
+static int ufdt_node_offset(const struct ufdt *tree,
+                            const struct ufdt_node *node) {
+  return (const char *)node->fdt_tag_ptr - (const char *)tree->fdtp -
+         fdt_off_dt_struct(tree->fdtp);
+}
+
+/*
+ * Whether the node was built from tree->fdtp, rather than merged in from
+ * an overlay.
+ */
+static bool ufdt_node_in_fdt(const struct ufdt *tree,
+                             const struct ufdt_node *node) {
+  const char *start = (const char *)tree->fdtp + fdt_off_dt_struct(tree->fdtp);
+  const char *tag = (const char *)node->fdt_tag_ptr;
+  return tag >= start && tag < start + fdt_size_dt_struct(tree->fdtp);
+}
+
+/*
+ * Returns the offset right behind the FDT_END_NODE that closes the node at
+ * offset, or < 0 if the struct block ends before.
+ */
+static int ufdt_fdt_subtree_end(const void *fdtp, int offset) {
+  int depth = 0;
+  uint32_t tag;
+
+  do {
+    tag = fdt_next_tag(fdtp, offset, &offset);
+    if (tag == FDT_BEGIN_NODE)
+      depth++;
+    else if (tag == FDT_END_NODE)
+      depth--;
+    else if (tag == FDT_END)
+      return -FDT_ERR_BADSTRUCTURE;
+  } while (depth > 0);
+
+  return offset;
+}
+
+int ufdt_node_expand(struct ufdt *tree, struct ufdt_node *node) {
+  if (!ufdt_node_is_lazy(node)) return 0;
+
+  struct fdt_node_ufdt_node *res = (struct fdt_node_ufdt_node *)node;
+  int offset = ufdt_node_offset(tree, node);
+  int next_offset;
+  uint32_t tag;
+
+  res->last_child_p = &res->child;
+  fdt_next_tag(tree->fdtp, offset, &next_offset);
+  for (;;) {
+    offset = next_offset;
+    tag = fdt_next_tag(tree->fdtp, offset, &next_offset);
+    if (tag == FDT_END_NODE) break;
+    if (tag == FDT_NOP) continue;
+    if (tag != FDT_PROP && tag != FDT_BEGIN_NODE) {
+      dto_error("Bad structure below node %s\n", name_of(node));
+      return -1;
+    }
+
+    struct ufdt_node *child = ufdt_new_node(tree->fdtp, offset, tree->arena);
+    if (child == NULL) return -1;
+
+    if (tag == FDT_BEGIN_NODE) {
+      /* Subnodes stay lazy, skip over what they contain. */
+      ((struct fdt_node_ufdt_node *)child)->last_child_p = NULL;
+      next_offset = ufdt_fdt_subtree_end(tree->fdtp, offset);
+      if (next_offset < 0) {
+        dto_error("Bad structure below node %s\n", name_of(child));
+        return -1;
+      }
+    }
+    ufdt_node_add_child(node, child);
+  }
+
+  return 0;
+}
+
+/*
+ * ufdt_node_get_node_by_path_len() that expands every node on the way,
+ * including the one it returns.
+ */
+static struct ufdt_node *ufdt_walk_path_len(struct ufdt *tree,
+                                            struct ufdt_node *node,
+                                            const char *path, int len) {
+  const char *end = path + len;
+
+  struct ufdt_node *cur = node;
+
+  while (cur) {
+    if (ufdt_node_expand(tree, cur) < 0) return NULL;
+
+    while (path < end && path[0] == '/') path++;
+    if (path == end) return cur;
+
+    const char *next_slash;
+    next_slash = dto_memchr(path, '/', end - path);
+    if (!next_slash) next_slash = end;
+
+    cur = ufdt_node_get_subnode_by_name_len(cur, path, next_slash - path);
+    path = next_slash;
+  }
+
+  return NULL;
+}
+
+/*
+ * Finds the node at offset in tree->fdtp by descending from the root,
+ * expanding only the nodes on the way.
+ */
+static struct ufdt_node *ufdt_get_node_by_offset(struct ufdt *tree,
+                                                 int offset) {
+  struct ufdt_node *cur = tree->root;
+
+  while (cur) {
+    if (ufdt_node_expand(tree, cur) < 0) return NULL;
+    if (ufdt_node_offset(tree, cur) == offset) return cur;
+
+    /*
+     * Subnodes from the FDT are in offset order, the one the node is in
+     * is the last one starting before it.
+     */
+    struct ufdt_node *next = NULL;
+    struct ufdt_node **it;
+    for_each_node(it, cur) {
+      if (!ufdt_node_in_fdt(tree, *it)) continue;
+      if (ufdt_node_offset(tree, *it) > offset) break;
+      next = *it;
+    }
+    cur = next;
+  }
+
+  return NULL;
+}
+
+static struct ufdt_node *fdt_to_ufdt_tree(void *fdtp, struct ufdt_arena *arena,
+                                          int cur_fdt_tag_offset,
                                           int *next_fdt_tag_offset,
                                           int cur_tag) {
   if (fdtp == NULL) {
@@ -49,16 +186,16 @@ static struct ufdt_node *fdt_to_ufdt_tree(void *fdtp, int cur_fdt_tag_offset,
       break;
 
     case FDT_PROP:
-      res = ufdt_new_node(fdtp, cur_fdt_tag_offset);
+      res = ufdt_new_node(fdtp, cur_fdt_tag_offset, arena);
       break;
 
     case FDT_BEGIN_NODE:
-      res = ufdt_new_node(fdtp, cur_fdt_tag_offset);
+      res = ufdt_new_node(fdtp, cur_fdt_tag_offset, arena);
 
       do {
         cur_fdt_tag_offset = *next_fdt_tag_offset;
         tag = fdt_next_tag(fdtp, cur_fdt_tag_offset, next_fdt_tag_offset);
-        child_node = fdt_to_ufdt_tree(fdtp, cur_fdt_tag_offset,
+        child_node = fdt_to_ufdt_tree(fdtp, arena, cur_fdt_tag_offset,
                                       next_fdt_tag_offset, tag);
         ufdt_node_add_child(res, child_node);
       } while (tag != FDT_END_NODE);
@@ -94,7 +231,7 @@ struct ufdt_node *ufdt_get_node_by_path_len(struct ufdt *tree, const char *path,
     if (!next_slash) next_slash = end;
 
     struct ufdt_node *aliases_node =
-        ufdt_node_get_node_by_path(tree->root, "/aliases");
+        ufdt_walk_path_len(tree, tree->root, "/aliases", 8);
     aliases_node = ufdt_node_get_property_by_name_len(aliases_node, path,
                                                       next_slash - path);
 
@@ -108,12 +245,11 @@ struct ufdt_node *ufdt_get_node_by_path_len(struct ufdt *tree, const char *path,
     }
 
     struct ufdt_node *target_node =
-        ufdt_node_get_node_by_path_len(tree->root, alias_path, path_len);
+        ufdt_walk_path_len(tree, tree->root, alias_path, path_len);
 
-    return ufdt_node_get_node_by_path_len(target_node, next_slash,
-                                          end - next_slash);
+    return ufdt_walk_path_len(tree, target_node, next_slash, end - next_slash);
   }
-  return ufdt_node_get_node_by_path_len(tree->root, path, len);
+  return ufdt_walk_path_len(tree, tree->root, path, len);
 }
 
 struct ufdt_node *ufdt_get_node_by_path(struct ufdt *tree, const char *path) {
@@ -137,12 +273,16 @@ struct ufdt_node *ufdt_get_node_by_phandle(struct ufdt *tree,
       s = mid;
   }
   if (e - s > 0) {
-    res = tree->phandle_table.data[s].node;
+    struct phandle_table_entry *entry = &tree->phandle_table.data[s];
+    if (entry->node == NULL)
+      entry->node = ufdt_get_node_by_offset(tree, entry->offset);
+    res = entry->node;
   }
   return res;
 }
 
-int merge_children(struct ufdt_node *node_a, struct ufdt_node *node_b) {
+int merge_children(struct ufdt *tree, struct ufdt_node *node_a,
+                   struct ufdt_node *node_b) {
   int err = 0;
   struct ufdt_node *it;
   for (it = ((struct fdt_node_ufdt_node *)node_b)->child; it;) {
@@ -158,30 +298,32 @@ int merge_children(struct ufdt_node *node_a, struct ufdt_node *node_b) {
     if (target_node == NULL) {
       err = ufdt_node_add_child(node_a, cur_node);
     } else {
-      err = merge_ufdt_into(target_node, cur_node);
+      err = merge_ufdt_into(tree, target_node, cur_node);
     }
     if (err < 0) return -1;
   }
   /*
-   * The ufdt_node* in node_b will be copied to node_a.
-   * To prevent the ufdt_node from being freed twice
-   * (main_tree and overlay_tree) at the end of function
-   * ufdt_apply_overlay(), set this node in node_b
-   * (overlay_tree) to NULL.
+   * The ufdt_node* in node_b now belong to node_a.
+   * Detach them from node_b (overlay_tree) so they aren't
+   * reachable from both trees.
    */
   ((struct fdt_node_ufdt_node *)node_b)->child = NULL;
 
   return 0;
 }
 
-int merge_ufdt_into(struct ufdt_node *node_a, struct ufdt_node *node_b) {
+int merge_ufdt_into(struct ufdt *tree, struct ufdt_node *node_a,
+                    struct ufdt_node *node_b) {
   if (tag_of(node_a) == FDT_PROP) {
     node_a->fdt_tag_ptr = node_b->fdt_tag_ptr;
     return 0;
   }
 
   int err = 0;
-  err = merge_children(node_a, node_b);
+  err = ufdt_node_expand(tree, node_a);
+  if (err < 0) return -1;
+
+  err = merge_children(tree, node_a, node_b);
   if (err < 0) return -1;
 
   return 0;
@@ -209,6 +351,7 @@ static void set_phandle_table_entry(struct ufdt_node *node,
   if (ph > 0) {
     data[*cur].phandle = ph;
     data[*cur].node = node;
+    data[*cur].offset = -1;
     (*cur)++;
   }
   struct ufdt_node **it;
@@ -230,7 +373,12 @@ int phandle_table_entry_cmp(const void *pa, const void *pb) {
 struct static_phandle_table build_phandle_table(struct ufdt *tree) {
   struct static_phandle_table res;
   res.len = count_phandle_node(tree->root);
-  res.data = dto_malloc(sizeof(struct phandle_table_entry) * res.len);
+  res.data = ufdt_arena_alloc(tree->arena,
+                              sizeof(struct phandle_table_entry) * res.len);
+  if (res.data == NULL) {
+    res.len = 0;
+    return res;
+  }
   int cur = 0;
   set_phandle_table_entry(tree->root, res.data, &cur);
   dto_qsort(res.data, res.len, sizeof(struct phandle_table_entry),
@@ -238,10 +386,12 @@ struct static_phandle_table build_phandle_table(struct ufdt *tree) {
   return res;
 }
 
-struct ufdt *fdt_to_ufdt(void *fdtp, size_t fdt_size) {
+struct ufdt *fdt_to_ufdt(void *fdtp, size_t fdt_size,
+                         struct ufdt_arena *arena) {
   (void)(fdt_size); // unused parameter
 
-  struct ufdt *res_tree = ufdt_construct(fdtp);
+  struct ufdt *res_tree = ufdt_construct(fdtp, arena);
+  if (res_tree == NULL) return NULL;
 
   int start_offset = fdt_path_offset(fdtp, "/");
   if (start_offset < 0) {
@@ -251,40 +401,288 @@ struct ufdt *fdt_to_ufdt(void *fdtp, size_t fdt_size) {
 
   int end_offset;
   int start_tag = fdt_next_tag(fdtp, start_offset, &end_offset);
-  res_tree->root = fdt_to_ufdt_tree(fdtp, start_offset, &end_offset, start_tag);
+  res_tree->root =
+      fdt_to_ufdt_tree(fdtp, arena, start_offset, &end_offset, start_tag);
 
   res_tree->phandle_table = build_phandle_table(res_tree);
+  if (res_tree->root == NULL || res_tree->phandle_table.data == NULL)
+    res_tree->fdtp = NULL;
 
   return res_tree;
 }
 
-int ufdt_to_fdt(struct ufdt *tree, void *buf, int buf_size) {
-  int err;
-  err = fdt_create(buf, buf_size);
-  if (err < 0) return -1;
+/*
+ * Collects the phandles of all nodes in fdtp to data, in FDT order, without
+ * building any ufdt_node. Like ufdt_node_get_phandle(), "phandle" wins over
+ * "linux,phandle". Properties precede the subnodes of a node in the FDT, so
+ * a node is done at the next FDT_BEGIN_NODE or FDT_END_NODE.
+ *
+ * @return: the number of entries (also with data == NULL) or
+ *          < 0 if the struct block is broken
+ */
+static int scan_phandle_table(void *fdtp, struct phandle_table_entry *data) {
+  int len = 0;
+  int node_offset = -1;
+  uint32_t phandle = 0;
+  int phandle_rank = 0;
+  int offset = 0, next_offset;
+  uint32_t tag;
+
+  do {
+    tag = fdt_next_tag(fdtp, offset, &next_offset);
+    if (next_offset < 0) return next_offset;
+
+    if (tag == FDT_PROP) {
+      const struct fdt_property *prop =
+          fdt_offset_ptr(fdtp, offset, sizeof(struct fdt_property));
+      if (node_offset >= 0 &&
+          fdt32_to_cpu(prop->len) == sizeof(fdt32_t)) {
+        const char *name = fdt_string(fdtp, fdt32_to_cpu(prop->nameoff));
+        int rank = 0;
+        if (name && dto_strcmp(name, "phandle") == 0)
+          rank = 2;
+        else if (name && dto_strcmp(name, "linux,phandle") == 0)
+          rank = 1;
+        if (rank > phandle_rank) {
+          phandle = fdt32_to_cpu(*(const fdt32_t *)prop->data);
+          phandle_rank = rank;
+        }
+      }
+    } else if (tag != FDT_NOP) {
+      if (node_offset >= 0 && phandle > 0) {
+        if (data) {
+          data[len].phandle = phandle;
+          data[len].node = NULL;
+          data[len].offset = node_offset;
+        }
+        len++;
+      }
+      node_offset = tag == FDT_BEGIN_NODE ? offset : -1;
+      phandle = 0;
+      phandle_rank = 0;
+    }
+
+    offset = next_offset;
+  } while (tag != FDT_END);
 
-  int n_mem_rsv = fdt_num_mem_rsv(tree->fdtp);
-  for (int i = 0; i < n_mem_rsv; i++) {
-    uint64_t addr, size;
-    fdt_get_mem_rsv(tree->fdtp, i, &addr, &size);
-    fdt_add_reservemap_entry(buf, addr, size);
+  return len;
+}
+
+struct ufdt *fdt_to_ufdt_lazy(void *fdtp, size_t fdt_size,
+                              struct ufdt_arena *arena) {
+  /*
+   * Lazy nodes are told apart from merged ones by where they point to, which
+   * needs size_dt_struct.
+   */
+  if (fdt_version(fdtp) < 17) return fdt_to_ufdt(fdtp, fdt_size, arena);
+
+  struct ufdt *res_tree = ufdt_construct(fdtp, arena);
+  if (res_tree == NULL) return NULL;
+
+  int start_offset = fdt_path_offset(fdtp, "/");
+  if (start_offset < 0) goto fail;
+
+  res_tree->root = ufdt_new_node(fdtp, start_offset, arena);
+  if (res_tree->root == NULL) goto fail;
+  ((struct fdt_node_ufdt_node *)res_tree->root)->last_child_p = NULL;
+
+  struct static_phandle_table *table = &res_tree->phandle_table;
+  table->len = scan_phandle_table(fdtp, NULL);
+  if (table->len < 0) goto fail;
+  table->data =
+      ufdt_arena_alloc(arena, sizeof(struct phandle_table_entry) * table->len);
+  if (table->data == NULL) goto fail;
+  scan_phandle_table(fdtp, table->data);
+  dto_qsort(table->data, table->len, sizeof(struct phandle_table_entry),
+            phandle_table_entry_cmp);
+
+  return res_tree;
+
+fail:
+  res_tree->fdtp = NULL;
+  return res_tree;
+}
+
+/*
+ * State of ufdt_to_fdt(). The struct block is written at buf[off...].
+ * Property names that aren't in the strings block of tree->fdtp yet get
+ * a nameoff behind it, and are collected in new_names until the strings
+ * block can be written after the struct block.
+ */
+struct ufdt_fdt_writer {
+  struct ufdt *tree;
+  char *buf;
+  int buf_size;
+  int off;
+  const char *strings;
+  int strings_size;
+  int new_strings_size;
+  struct ufdt_node_dict new_names;
+};
+
+static void *writer_grab(struct ufdt_fdt_writer *w, int len) {
+  int aligned_len = FDT_TAGALIGN(len);
+  if (len < 0 || aligned_len > w->buf_size - w->off) return NULL;
+
+  char *res = w->buf + w->off;
+  dto_memset(res + len, 0, aligned_len - len);
+  w->off += aligned_len;
+  return res;
+}
+
+static int writer_add_property(struct ufdt_fdt_writer *w,
+                               struct ufdt_node *prop_node) {
+  int len = 0;
+  const char *data = ufdt_node_get_fdt_prop_data(prop_node, &len);
+  const char *name = name_of(prop_node);
+  struct ufdt_node *same_name_prop = NULL;
+  int nameoff;
+
+  if (name >= w->strings && name < w->strings + w->strings_size) {
+    nameoff = name - w->strings;
+  } else {
+    same_name_prop = ufdt_node_dict_find_node(&w->new_names, name);
+    if (same_name_prop != NULL) {
+      const struct fdt_property *prop =
+          (const struct fdt_property *)same_name_prop->fdt_tag_ptr;
+      nameoff = fdt32_to_cpu(prop->nameoff);
+    } else {
+      nameoff = w->strings_size + w->new_strings_size;
+      w->new_strings_size += dto_strlen(name) + 1;
+    }
   }
 
-  err = fdt_finish_reservemap(buf);
-  if (err < 0) return -1;
+  struct fdt_property *prop =
+      writer_grab(w, sizeof(struct fdt_property) + len);
+  if (prop == NULL) return -FDT_ERR_NOSPACE;
+
+  prop->tag = cpu_to_fdt32(FDT_PROP);
+  prop->len = cpu_to_fdt32(len);
+  prop->nameoff = cpu_to_fdt32(nameoff);
+  dto_memcpy(prop->data, data, len);
+
+  if (nameoff >= w->strings_size && same_name_prop == NULL) {
+    /*
+     * Modifies prop_node->fdt_tag_ptr to point to the node in buf, where
+     * its nameoff can be found for the following props with this name.
+     */
+    prop_node->fdt_tag_ptr = (fdt32_t *)prop;
+    if (ufdt_node_dict_add(&w->new_names, prop_node) < 0) return -1;
+  }
+
+  return 0;
+}
 
+static int writer_add_node(struct ufdt_fdt_writer *w, struct ufdt_node *node) {
   /*
-   * Obtains all props for later use because getting them from
-   * FDT requires complicated manipulation.
-  */
-  struct ufdt_node_dict all_props = ufdt_node_dict_construct();
-  err = output_ufdt_node_to_fdt(tree->root, buf, &all_props);
-  if (err < 0) return -1;
+   * Nothing below a lazy node has changed, it's still as in the FDT.
+   */
+  if (ufdt_node_is_lazy(node)) {
+    int start = ufdt_node_offset(w->tree, node);
+    int end = ufdt_fdt_subtree_end(w->tree->fdtp, start);
+    if (end < 0) return end;
+
+    void *dst = writer_grab(w, end - start);
+    if (dst == NULL) return -FDT_ERR_NOSPACE;
+    dto_memcpy(dst, node->fdt_tag_ptr, end - start);
+    return 0;
+  }
 
-  ufdt_node_dict_destruct(&all_props);
+  const char *name = name_of(node);
+  int name_len = dto_strlen(name) + 1;
+  fdt32_t *tag = writer_grab(w, FDT_TAGSIZE + name_len);
+  if (tag == NULL) return -FDT_ERR_NOSPACE;
+  *tag = cpu_to_fdt32(FDT_BEGIN_NODE);
+  dto_memcpy(tag + 1, name, name_len);
 
-  err = fdt_finish(buf);
-  if (err < 0) return -1;
+  int err;
+  struct ufdt_node **it;
+  for_each_prop(it, node) {
+    err = writer_add_property(w, *it);
+    if (err < 0) return err;
+  }
+
+  for_each_node(it, node) {
+    err = writer_add_node(w, *it);
+    if (err < 0) return err;
+  }
+
+  tag = writer_grab(w, FDT_TAGSIZE);
+  if (tag == NULL) return -FDT_ERR_NOSPACE;
+  *tag = cpu_to_fdt32(FDT_END_NODE);
+
+  return 0;
+}
+
+int ufdt_to_fdt(struct ufdt *tree, void *buf, int buf_size) {
+  if (tree->fdtp == NULL || tree->root == NULL) return -1;
+
+  void *fdtp = tree->fdtp;
+  char *out = buf;
+  int rsvmap_off = FDT_ALIGN(sizeof(struct fdt_header), 8);
+  int rsvmap_size =
+      (fdt_num_mem_rsv(fdtp) + 1) * sizeof(struct fdt_reserve_entry);
+  if (rsvmap_off + rsvmap_size > buf_size) return -1;
+
+  dto_memset(out, 0, rsvmap_off);
+  dto_memcpy(out + rsvmap_off, (char *)fdtp + fdt_off_mem_rsvmap(fdtp),
+             rsvmap_size);
+
+  struct ufdt_fdt_writer w;
+  w.tree = tree;
+  w.buf = out;
+  w.buf_size = buf_size;
+  w.off = rsvmap_off + rsvmap_size;
+  w.strings = (const char *)fdtp + fdt_off_dt_strings(fdtp);
+  w.strings_size = fdt_size_dt_strings(fdtp);
+  w.new_strings_size = 0;
+  w.new_names = ufdt_node_dict_construct();
+
+  int struct_off = w.off;
+  int err = writer_add_node(&w, tree->root);
+  if (err == 0) {
+    fdt32_t *tag = writer_grab(&w, FDT_TAGSIZE);
+    if (tag == NULL)
+      err = -FDT_ERR_NOSPACE;
+    else
+      *tag = cpu_to_fdt32(FDT_END);
+  }
+
+  int strings_off = w.off;
+  int strings_size = w.strings_size + w.new_strings_size;
+  if (err == 0 && strings_size > buf_size - strings_off)
+    err = -FDT_ERR_NOSPACE;
+  if (err < 0) {
+    dto_error("Failed to write the device tree: %d\n", err);
+    ufdt_node_dict_destruct(&w.new_names);
+    return -1;
+  }
+
+  /*
+   * Keeps the strings of the original FDT where they are, the names new
+   * to it follow at the nameoff they were given.
+   */
+  dto_memcpy(out + strings_off, w.strings, w.strings_size);
+  struct ufdt_node **it;
+  for_each(it, &w.new_names) {
+    const struct fdt_property *prop =
+        (const struct fdt_property *)(*it)->fdt_tag_ptr;
+    const char *name = name_of(*it);
+    dto_memcpy(out + strings_off + fdt32_to_cpu(prop->nameoff), name,
+               dto_strlen(name) + 1);
+  }
+  ufdt_node_dict_destruct(&w.new_names);
+
+  fdt_set_magic(out, FDT_MAGIC);
+  fdt_set_totalsize(out, strings_off + strings_size);
+  fdt_set_off_dt_struct(out, struct_off);
+  fdt_set_off_dt_strings(out, strings_off);
+  fdt_set_off_mem_rsvmap(out, rsvmap_off);
+  fdt_set_version(out, FDT_LAST_SUPPORTED_VERSION);
+  fdt_set_last_comp_version(out, FDT_FIRST_SUPPORTED_VERSION);
+  fdt_set_boot_cpuid_phys(out, fdt_boot_cpuid_phys(fdtp));
+  fdt_set_size_dt_strings(out, strings_size);
+  fdt_set_size_dt_struct(out, strings_off - struct_off);
 
   /*
    * IMPORTANT: fdt_totalsize(buf) might be less than buf_size
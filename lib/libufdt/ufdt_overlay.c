@@ -300,9 +300,9 @@ static int ufdt_overlay_do_fixups(struct ufdt *main_tree,
 /*
  * Overlay the overlay_node over target_node.
  */
-static int ufdt_overlay_node(struct ufdt_node *target_node,
+static int ufdt_overlay_node(struct ufdt *tree, struct ufdt_node *target_node,
                              struct ufdt_node *overlay_node) {
-  return merge_ufdt_into(target_node, overlay_node);
+  return merge_ufdt_into(tree, target_node, overlay_node);
 }
 
 /*
@@ -360,7 +360,7 @@ static enum overlay_result ufdt_apply_fragment(struct ufdt *tree,
     return OVERLAY_RESULT_MISSING_OVERLAY;
   }
 
-  int err = ufdt_overlay_node(target_node, overlay_node);
+  int err = ufdt_overlay_node(tree, target_node, overlay_node);
 
   if (err < 0) {
     dto_error("failed to overlay node %s to target %s\n", name_of(overlay_node),
@@ -497,7 +497,7 @@ static int ufdt_overlay_root_node(struct ufdt *tree,
                ufdt_node_get_property_by_name(target_node, name_of(*it_prop));
 
           if (target_prop) {
-               if(merge_ufdt_into(target_prop, *it_prop))
+               if(merge_ufdt_into(tree, target_prop, *it_prop))
                     return -1;
           }
      }
@@ -613,6 +613,63 @@ struct fdt_header *ufdt_install_blob(void *blob, size_t blob_size) {
   return pHeader;
 }
 
+int ufdt_apply_overlay_into(struct fdt_header *main_fdt_header,
+                            size_t main_fdt_size, void *overlay_fdtp,
+                            size_t overlay_size, void *out_fdtp,
+                            size_t out_fdt_size) {
+  if (main_fdt_header == NULL) {
+    return -1;
+  }
+
+  if (overlay_size < 8 || overlay_size != fdt_totalsize(overlay_fdtp)) {
+    dto_error("Bad overlay size!\n");
+    return -1;
+  }
+
+  if (main_fdt_size < 8 || main_fdt_size != fdt_totalsize(main_fdt_header)) {
+    dto_error("Bad fdt size!\n");
+    return -1;
+  }
+
+  /*
+   * Both trees live in one arena that is released in one go. The overlay
+   * is built in full, the main tree only where the overlay reaches into it,
+   * so the overlay size is about what the session needs.
+   */
+  struct ufdt_arena arena;
+  ufdt_arena_init(&arena, overlay_size);
+
+  struct ufdt *main_tree, *overlay_tree;
+  int err = -1;
+
+  main_tree = fdt_to_ufdt_lazy(main_fdt_header, main_fdt_size, &arena);
+
+  overlay_tree = fdt_to_ufdt(overlay_fdtp, overlay_size, &arena);
+
+  if (main_tree == NULL || main_tree->fdtp == NULL || overlay_tree == NULL ||
+      overlay_tree->fdtp == NULL) {
+    dto_error("Failed to build the device trees\n");
+    goto out;
+  }
+
+  err = ufdt_overlay_apply(main_tree, overlay_tree, overlay_size);
+  if (err < 0) {
+    goto out;
+  }
+
+  err = ufdt_to_fdt(main_tree, out_fdtp, out_fdt_size);
+  if (err < 0) {
+    dto_error("Failed to dump the device tree to out_fdtp\n");
+    goto out;
+  }
+
+  dto_debug("%zu of %zu arena bytes used\n", arena.used, arena.size);
+
+out:
+  ufdt_arena_destroy(&arena);
+  return err < 0 ? -1 : 0;
+}
+
 /*
 * From Google, based on dt_overlay_apply() logic
 * Will dto_malloc a new fdt blob and return it. Will not dto_free parameters.
@@ -627,16 +684,6 @@ struct fdt_header *ufdt_apply_overlay(struct fdt_header *main_fdt_header,
     return NULL;
   }
 
-  if (overlay_size < 8 || overlay_size != fdt_totalsize(overlay_fdtp)) {
-    dto_error("Bad overlay size!\n");
-    return NULL;
-  }
-
-  if (main_fdt_size < 8 || main_fdt_size != fdt_totalsize(main_fdt_header)) {
-    dto_error("Bad fdt size!\n");
-    return NULL;
-  }
-
   out_fdt_size = fdt_totalsize(main_fdt_header) + overlay_size;
   /* It's actually more than enough */
   struct fdt_header *out_fdt_header = dto_malloc(out_fdt_size);
@@ -646,30 +693,12 @@ struct fdt_header *ufdt_apply_overlay(struct fdt_header *main_fdt_header,
     return NULL;
   }
 
-  struct ufdt *main_tree, *overlay_tree;
-
-  main_tree = fdt_to_ufdt(main_fdt_header, main_fdt_size);
-
-  overlay_tree = fdt_to_ufdt(overlay_fdtp, overlay_size);
-
-  int err = ufdt_overlay_apply(main_tree, overlay_tree, overlay_size);
-  if (err < 0) {
-    goto fail;
-  }
-
-  err = ufdt_to_fdt(main_tree, out_fdt_header, out_fdt_size);
-  if (err < 0) {
-    dto_error("Failed to dump the device tree to out_fdt_header\n");
-    goto fail;
+  if (ufdt_apply_overlay_into(main_fdt_header, main_fdt_size, overlay_fdtp,
+                              overlay_size, out_fdt_header,
+                              out_fdt_size) < 0) {
+    dto_free(out_fdt_header);
+    return NULL;
   }
-  ufdt_destruct(main_tree);
-  ufdt_destruct(overlay_tree);
 
   return out_fdt_header;
-
-fail:
-  ufdt_destruct(main_tree);
-  ufdt_destruct(overlay_tree);
-  dto_free(out_fdt_header);
-  return NULL;
 }
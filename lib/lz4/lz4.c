@@ -0,0 +1,326 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lz4.h>
+
+#define LZ4_MAGIC               0x184D2204
+#define LZ4_LEGACY_MAGIC        0x184C2102
+
+#define LZ4_LEGACY_BLOCK_SIZE   (8 * 1024 * 1024)
+/* Worst case size of a compressed legacy block */
+#define LZ4_LEGACY_BOUND        (LZ4_LEGACY_BLOCK_SIZE + LZ4_LEGACY_BLOCK_SIZE / 255 + 16)
+
+/* Frame descriptor flags */
+#define LZ4_FLG_VERSION_MASK    0xC0
+#define LZ4_FLG_VERSION         0x40
+#define LZ4_FLG_BLOCK_CHECKSUM  0x10
+#define LZ4_FLG_CONTENT_SIZE    0x08
+#define LZ4_FLG_CONTENT_CHECKSUM 0x04
+#define LZ4_FLG_DICT_ID         0x01
+
+#define LZ4_BLOCK_UNCOMPRESSED  0x80000000
+
+#define LZ4_MIN_MATCH           4
+
+static uint32_t lz4_get_le32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Decode one lz4 block of in_len bytes at in to out. Matches may reach
+ * back to out_base, which lets linked blocks refer to the earlier ones.
+ * Returns the number of bytes produced or -1 if the block is corrupt or
+ * does not fit in out_len.
+ */
+int lz4_decompress_block(const unsigned char *in, unsigned int in_len,
+			 unsigned char *out, unsigned int out_len,
+			 const unsigned char *out_base)
+{
+	const unsigned char *ip = in;
+	const unsigned char *iend = in + in_len;
+	unsigned char *op = out;
+	unsigned char *oend = out + out_len;
+	const unsigned char *match;
+	unsigned int token;
+	unsigned int len;
+	unsigned int offset;
+	unsigned int b;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		/* literals */
+		len = token >> 4;
+		if (len == 15) {
+			do {
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				len += b;
+			} while (b == 255);
+		}
+
+		if (len > (unsigned int)(iend - ip) || len > (unsigned int)(oend - op))
+			return -1;
+
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		/* the last sequence has no match */
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		if (!offset || offset > (unsigned int)(op - out_base))
+			return -1;
+		match = op - offset;
+
+		len = token & 15;
+		if (len == 15) {
+			do {
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				len += b;
+			} while (b == 255);
+		}
+		len += LZ4_MIN_MATCH;
+
+		if (len > (unsigned int)(oend - op))
+			return -1;
+
+		if (offset >= len) {
+			memcpy(op, match, len);
+			op += len;
+		} else {
+			/* overlapping match repeats the last offset bytes */
+			while (len--)
+				*op++ = *match++;
+		}
+	}
+
+	return op - out;
+}
+
+/* The kernel build appends the decompressed size after the stream */
+static unsigned int lz4_skip_size_trailer(const unsigned char *ip, const unsigned char *iend,
+					  unsigned int out_len)
+{
+	if (iend - ip >= 4 && lz4_get_le32(ip) == out_len)
+		return 4;
+
+	return 0;
+}
+
+/* Legacy frames (lz4 -l, used for kernel images) are a sequence of blocks
+ * that each decompress to 8MB, except the last one. There is no end mark:
+ * the stream ends with a short block or with a block size that cannot be.
+ */
+static int lz4_decompress_legacy(const unsigned char *in, unsigned int in_len,
+				 unsigned char *out, unsigned int out_buf_len,
+				 unsigned int *pos, unsigned int *out_len)
+{
+	const unsigned char *ip = in + 4;
+	const unsigned char *iend = in + in_len;
+	unsigned char *op = out;
+	uint32_t block_size;
+	int ret;
+
+	while (iend - ip >= 4) {
+		block_size = lz4_get_le32(ip);
+
+		/* concatenated legacy streams */
+		if (block_size == LZ4_LEGACY_MAGIC) {
+			ip += 4;
+			continue;
+		}
+
+		if (!block_size || block_size > LZ4_LEGACY_BOUND ||
+		    block_size > (uint32_t)(iend - ip - 4))
+			break;
+
+		ip += 4;
+		ret = lz4_decompress_block(ip, block_size, op,
+					   MIN(out_buf_len - (op - out), LZ4_LEGACY_BLOCK_SIZE), op);
+		if (ret < 0) {
+			dprintf(CRITICAL, "lz4: corrupt block at offset %u\n", (unsigned int)(ip - in));
+			return -1;
+		}
+
+		ip += block_size;
+		op += ret;
+
+		if (ret < LZ4_LEGACY_BLOCK_SIZE)
+			break;
+	}
+
+	if (op == out)
+		return -1;
+
+	ip += lz4_skip_size_trailer(ip, iend, op - out);
+
+	if (pos)
+		*pos = ip - in;
+	if (out_len)
+		*out_len = op - out;
+
+	return 0;
+}
+
+static int lz4_decompress_frame(const unsigned char *in, unsigned int in_len,
+				unsigned char *out, unsigned int out_buf_len,
+				unsigned int *pos, unsigned int *out_len)
+{
+	const unsigned char *ip = in + 4;
+	const unsigned char *iend = in + in_len;
+	unsigned char *op = out;
+	unsigned int hdr_len = 3;
+	uint32_t block_size;
+	unsigned char flg;
+	int ret;
+
+	if (iend - ip < 3)
+		return -1;
+
+	flg = ip[0];
+	if ((flg & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION) {
+		dprintf(CRITICAL, "lz4: unsupported frame version\n");
+		return -1;
+	}
+	if (flg & LZ4_FLG_DICT_ID) {
+		dprintf(CRITICAL, "lz4: dictionaries are not supported\n");
+		return -1;
+	}
+	if (flg & LZ4_FLG_CONTENT_SIZE)
+		hdr_len += 8;
+
+	/* FLG, BD, optional content size and the header checksum */
+	if ((unsigned int)(iend - ip) < hdr_len)
+		return -1;
+	ip += hdr_len;
+
+	for (;;) {
+		if (iend - ip < 4)
+			return -1;
+		block_size = lz4_get_le32(ip);
+		ip += 4;
+
+		/* end mark */
+		if (!block_size)
+			break;
+
+		if ((block_size & ~LZ4_BLOCK_UNCOMPRESSED) > (uint32_t)(iend - ip))
+			return -1;
+
+		if (block_size & LZ4_BLOCK_UNCOMPRESSED) {
+			block_size &= ~LZ4_BLOCK_UNCOMPRESSED;
+			if (block_size > out_buf_len - (op - out))
+				return -1;
+			memcpy(op, ip, block_size);
+			ret = block_size;
+		} else {
+			/* Independent or linked, matches can reach back to the
+			 * start of the frame since it all lands in one buffer.
+			 */
+			ret = lz4_decompress_block(ip, block_size, op,
+						   out_buf_len - (op - out), out);
+			if (ret < 0) {
+				dprintf(CRITICAL, "lz4: corrupt block at offset %u\n",
+					(unsigned int)(ip - in));
+				return -1;
+			}
+		}
+
+		ip += block_size;
+		op += ret;
+
+		/* Checksums are not verified: the image is authenticated as a whole */
+		if (flg & LZ4_FLG_BLOCK_CHECKSUM)
+			ip += 4;
+	}
+
+	if (flg & LZ4_FLG_CONTENT_CHECKSUM)
+		ip += 4;
+
+	if (ip > iend)
+		return -1;
+
+	ip += lz4_skip_size_trailer(ip, iend, op - out);
+
+	if (pos)
+		*pos = ip - in;
+	if (out_len)
+		*out_len = op - out;
+
+	return 0;
+}
+
+/* Return 1 if buf starts with a lz4 frame or legacy stream */
+int is_lz4_package(unsigned char *buf, unsigned int len)
+{
+	uint32_t magic;
+
+	if (!buf || len < 8)
+		return 0;
+
+	magic = lz4_get_le32(buf);
+
+	return magic == LZ4_MAGIC || magic == LZ4_LEGACY_MAGIC;
+}
+
+/* Decompress the lz4 package in in_buf, same contract as decompress():
+ * pos is set to the end of the compressed data, out_len to the size of
+ * the decompressed data. Returns 0 on success, -1 on failure.
+ */
+int lz4_decompress(unsigned char *in_buf, unsigned int in_len,
+		   unsigned char *out_buf, unsigned int out_buf_len,
+		   unsigned int *pos, unsigned int *out_len)
+{
+	int ret;
+
+	if (!is_lz4_package(in_buf, in_len))
+		return -1;
+
+	if (lz4_get_le32(in_buf) == LZ4_LEGACY_MAGIC)
+		ret = lz4_decompress_legacy(in_buf, in_len, out_buf, out_buf_len, pos, out_len);
+	else
+		ret = lz4_decompress_frame(in_buf, in_len, out_buf, out_buf_len, pos, out_len);
+
+	if (ret)
+		dprintf(CRITICAL, "lz4: decompression failed\n");
+
+	return ret;
+}
@@ -0,0 +1,6 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+INCLUDES += -I$(LOCAL_DIR)
+
+OBJS += \
+	$(LOCAL_DIR)/lz4.o
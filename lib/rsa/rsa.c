@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <list.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lib/rsa.h>
+#include <lib/sha2.h>
+
+/* How many contexts are kept around for reuse */
+#define RSA_KEY_CACHE_SIZE	8
+
+struct rsa_key {
+	struct list_node node;
+	uint8_t id[SHA256_DIGEST_LEN];
+	int refs;
+	size_t bytes;		/* modulus size as handed in */
+	unsigned len;		/* words in n[] and rr[] */
+	uint32_t n0inv;		/* -1 / n[0] mod 2^32 */
+	uint32_t e;
+	uint32_t *n;		/* least significant word first */
+	uint32_t *rr;		/* R^2 mod n, R = 2^(32 * len) */
+};
+
+/* Most recently used first */
+static struct list_node rsa_key_cache = LIST_INITIAL_VALUE(rsa_key_cache);
+static unsigned rsa_key_cached;
+
+/* c[] = (c[] + a * b[] + d * n[]) / 2^32, with d picked to make the
+ * division exact. Returns the carry out of the top word.
+ */
+static __UNUSED uint32_t rsa_mont_row_portable(uint32_t *c, uint32_t a,
+					       const uint32_t *b,
+					       const uint32_t *n,
+					       uint32_t n0inv, unsigned len)
+{
+	uint64_t A = (uint64_t)a * b[0] + c[0];
+	uint32_t d = (uint32_t)A * n0inv;
+	uint64_t B = (uint64_t)d * n[0] + (uint32_t)A;
+	unsigned i;
+
+	for (i = 1; i < len; i++) {
+		A = (A >> 32) + (uint64_t)a * b[i] + c[i];
+		B = (B >> 32) + (uint64_t)d * n[i] + (uint32_t)A;
+		c[i - 1] = (uint32_t)B;
+	}
+
+	A = (A >> 32) + (B >> 32);
+	c[len - 1] = (uint32_t)A;
+	return A >> 32;
+}
+
+#if ARCH_ARM && (ARM_ISA_ARMV6 || ARM_ISA_ARMV7)
+/* arch/arm/mont.S, two UMAAL per word */
+uint32_t rsa_mont_row(uint32_t *c, uint32_t a, const uint32_t *b,
+		      const uint32_t *n, uint32_t n0inv, unsigned len);
+#else
+#define rsa_mont_row rsa_mont_row_portable
+#endif
+
+/* a[] -= n[] */
+static void rsa_sub_mod(const struct rsa_key *key, uint32_t *a)
+{
+	int64_t A = 0;
+	unsigned i;
+
+	for (i = 0; i < key->len; i++) {
+		A += (uint64_t)a[i] - key->n[i];
+		a[i] = (uint32_t)A;
+		A >>= 32;
+	}
+}
+
+/* a[] >= n[] */
+static bool rsa_ge_mod(const struct rsa_key *key, const uint32_t *a)
+{
+	unsigned i = key->len;
+
+	while (i--) {
+		if (a[i] != key->n[i])
+			return a[i] > key->n[i];
+	}
+	return true;
+}
+
+/* c[] = a[] * b[] / R mod n, c must not alias a or b */
+static void rsa_mont_mul(const struct rsa_key *key, uint32_t *c,
+			 const uint32_t *a, const uint32_t *b)
+{
+	unsigned i;
+
+	memset(c, 0, key->len * sizeof(uint32_t));
+	for (i = 0; i < key->len; i++) {
+		if (rsa_mont_row(c, a[i], b, key->n, key->n0inv, key->len))
+			rsa_sub_mod(key, c);
+	}
+}
+
+static void rsa_from_bytes(uint32_t *w, unsigned len, const uint8_t *p,
+			   size_t bytes)
+{
+	size_t i;
+
+	memset(w, 0, len * sizeof(uint32_t));
+	for (i = 0; i < bytes; i++)
+		w[i / 4] |= (uint32_t)p[bytes - 1 - i] << (8 * (i % 4));
+}
+
+static void rsa_to_bytes(uint8_t *p, size_t bytes, const uint32_t *w)
+{
+	size_t i;
+
+	for (i = 0; i < bytes; i++)
+		p[bytes - 1 - i] = w[i / 4] >> (8 * (i % 4));
+}
+
+/* R^2 mod n for keys that do not carry it: doubling 1 gets 2^s * R mod n
+ * for a small s, then each Montgomery squaring takes 2^k * R to
+ * 2^2k * R until the exponent reaches 32 * len.
+ */
+static int rsa_compute_rr(struct rsa_key *key)
+{
+	unsigned bits = 32 * key->len;
+	unsigned s = bits, squarings = 0;
+	uint32_t *rr = key->rr;
+	uint32_t *t;
+	uint32_t top;
+	unsigned i, j;
+
+	while (!(s & 1) && s > 64) {
+		s >>= 1;
+		squarings++;
+	}
+
+	t = malloc(key->len * sizeof(uint32_t));
+	if (!t)
+		return ERR_NO_MEMORY;
+
+	memset(rr, 0, key->len * sizeof(uint32_t));
+	rr[0] = 1;
+	for (i = 0; i < bits + s; i++) {
+		top = rr[key->len - 1] >> 31;
+		for (j = key->len - 1; j > 0; j--)
+			rr[j] = (rr[j] << 1) | (rr[j - 1] >> 31);
+		rr[0] <<= 1;
+		if (top || rsa_ge_mod(key, rr))
+			rsa_sub_mod(key, rr);
+	}
+
+	for (i = 0; i < squarings; i++) {
+		rsa_mont_mul(key, t, rr, rr);
+		memcpy(rr, t, key->len * sizeof(uint32_t));
+	}
+	if (rsa_ge_mod(key, rr))
+		rsa_sub_mod(key, rr);
+
+	free(t);
+	return NO_ERROR;
+}
+
+static void rsa_key_id(uint8_t id[SHA256_DIGEST_LEN], const uint8_t *n,
+		       size_t n_len, uint32_t e, const uint8_t *rr,
+		       uint32_t n0inv)
+{
+	struct sha256_ctx ctx;
+	uint32_t v[3] = { n_len, e, rr ? n0inv : 0 };
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, v, sizeof(v));
+	sha256_update(&ctx, n, n_len);
+	if (rr)
+		sha256_update(&ctx, rr, n_len);
+	sha256_final(&ctx, id);
+}
+
+/* Make room for one more context by dropping the least recently used
+ * one nobody holds.
+ */
+static void rsa_key_cache_trim(void)
+{
+	struct rsa_key *key;
+	struct rsa_key *victim = NULL;
+
+	if (rsa_key_cached < RSA_KEY_CACHE_SIZE)
+		return;
+
+	list_for_every_entry(&rsa_key_cache, key, struct rsa_key, node) {
+		if (!key->refs)
+			victim = key;
+	}
+	if (!victim)
+		return;
+
+	list_delete(&victim->node);
+	rsa_key_cached--;
+	free(victim);
+}
+
+struct rsa_key *rsa_key_get(const uint8_t *n, size_t n_len, uint32_t e,
+			    const uint8_t *rr, uint32_t n0inv)
+{
+	uint8_t id[SHA256_DIGEST_LEN];
+	struct rsa_key *key;
+	unsigned len;
+	uint32_t x;
+	int i;
+
+	if (!n || !n_len || n_len > RSA_MAX_BITS / 8)
+		return NULL;
+	/* n must be odd for Montgomery, e odd and above one for RSA */
+	if (!(n[n_len - 1] & 1) || !(e & 1) || e < 3)
+		return NULL;
+
+	rsa_key_id(id, n, n_len, e, rr, n0inv);
+
+	list_for_every_entry(&rsa_key_cache, key, struct rsa_key, node) {
+		if (!memcmp(key->id, id, sizeof(id))) {
+			list_delete(&key->node);
+			list_add_head(&rsa_key_cache, &key->node);
+			key->refs++;
+			return key;
+		}
+	}
+
+	len = (n_len + 3) / 4;
+	key = malloc(sizeof(*key) + 2 * len * sizeof(uint32_t));
+	if (!key)
+		return NULL;
+
+	memcpy(key->id, id, sizeof(id));
+	key->refs = 1;
+	key->bytes = n_len;
+	key->len = len;
+	key->e = e;
+	key->n = (uint32_t *)(key + 1);
+	key->rr = key->n + len;
+	rsa_from_bytes(key->n, len, n, n_len);
+
+	if (rr) {
+		key->n0inv = n0inv;
+		rsa_from_bytes(key->rr, len, rr, n_len);
+	} else {
+		/* Newton's iteration for 1 / n[0]: n * n == 1 mod 8 gives the
+		 * first three bits and every step doubles them.
+		 */
+		x = key->n[0];
+		for (i = 0; i < 4; i++)
+			x *= 2 - key->n[0] * x;
+		key->n0inv = -x;
+
+		if (rsa_compute_rr(key)) {
+			free(key);
+			return NULL;
+		}
+	}
+
+	rsa_key_cache_trim();
+	list_add_head(&rsa_key_cache, &key->node);
+	rsa_key_cached++;
+	return key;
+}
+
+void rsa_key_put(struct rsa_key *key)
+{
+	if (!key)
+		return;
+
+	ASSERT(key->refs > 0);
+	key->refs--;
+}
+
+size_t rsa_key_len(const struct rsa_key *key)
+{
+	return key->bytes;
+}
+
+int rsa_public(const struct rsa_key *key, const uint8_t *in, uint8_t *out)
+{
+	unsigned len = key->len;
+	uint32_t *a, *aR, *acc, *t, *swap;
+	int bit;
+
+	a = malloc(4 * len * sizeof(uint32_t));
+	if (!a)
+		return ERR_NO_MEMORY;
+	aR = a + len;
+	acc = aR + len;
+	t = acc + len;
+
+	rsa_from_bytes(a, len, in, key->bytes);
+	if (rsa_ge_mod(key, a)) {
+		free(a);
+		return ERR_INVALID_ARGS;
+	}
+
+	/* Left to right square and multiply in the Montgomery domain. The
+	 * last multiply, for the low bit of the odd exponent, uses plain a
+	 * and so leaves the domain at the same time.
+	 */
+	rsa_mont_mul(key, aR, a, key->rr);
+	memcpy(acc, aR, len * sizeof(uint32_t));
+	for (bit = 30 - __builtin_clz(key->e); bit >= 0; bit--) {
+		rsa_mont_mul(key, t, acc, acc);
+		swap = acc;
+		acc = t;
+		t = swap;
+		if (key->e & (1u << bit)) {
+			rsa_mont_mul(key, t, acc, bit ? aR : a);
+			swap = acc;
+			acc = t;
+			t = swap;
+		}
+	}
+
+	/* at most one n too large */
+	if (rsa_ge_mod(key, acc))
+		rsa_sub_mod(key, acc);
+
+	rsa_to_bytes(out, key->bytes, acc);
+	free(a);
+	return NO_ERROR;
+}
+
+#if WITH_LIB_CONSOLE
+#include <lib/console.h>
+#include <rand.h>
+
+#define RSA_TEST_WORDS	128
+
+/* Cross check the Montgomery row in use against the portable one, over
+ * lengths up to a 4096 bit key and random operands.
+ */
+static int rsa_test(void)
+{
+	static const unsigned lens[] = { 1, 2, 3, 8, 64, RSA_TEST_WORDS };
+	uint32_t *c, *r, *b, *n;
+	uint32_t a, x, n0inv, carry_c, carry_r;
+	unsigned i, j, k;
+	int failed = 0;
+
+	c = malloc(4 * RSA_TEST_WORDS * sizeof(uint32_t));
+	if (!c) {
+		printf("out of memory\n");
+		return -1;
+	}
+	r = c + RSA_TEST_WORDS;
+	b = r + RSA_TEST_WORDS;
+	n = b + RSA_TEST_WORDS;
+
+	for (i = 0; i < countof(lens); i++) {
+		for (k = 0; k < 16; k++) {
+			for (j = 0; j < lens[i]; j++) {
+				c[j] = r[j] = ((uint32_t)rand() << 16) ^ rand();
+				b[j] = ((uint32_t)rand() << 16) ^ rand();
+				n[j] = ((uint32_t)rand() << 16) ^ rand();
+			}
+			/* all ones operands push every carry to its limit */
+			if (k == 0) {
+				memset(c, 0xff, lens[i] * sizeof(uint32_t));
+				memset(r, 0xff, lens[i] * sizeof(uint32_t));
+				memset(b, 0xff, lens[i] * sizeof(uint32_t));
+				memset(n, 0xff, lens[i] * sizeof(uint32_t));
+			}
+			n[0] |= 1;
+			a = k ? ((uint32_t)rand() << 16) ^ rand() : ~0u;
+
+			x = n[0];
+			for (j = 0; j < 4; j++)
+				x *= 2 - n[0] * x;
+			n0inv = -x;
+
+			carry_c = rsa_mont_row(c, a, b, n, n0inv, lens[i]);
+			carry_r = rsa_mont_row_portable(r, a, b, n, n0inv,
+							lens[i]);
+			if (carry_c != carry_r ||
+			    memcmp(c, r, lens[i] * sizeof(uint32_t))) {
+				printf("mont row %u words: mismatch\n",
+				       lens[i]);
+				failed++;
+			}
+		}
+	}
+
+	free(c);
+	printf("rsa test %s\n", failed ? "FAILED" : "passed");
+	return failed ? -1 : 0;
+}
+
+static int cmd_rsa(int argc, const cmd_args *argv);
+
+STATIC_COMMAND_START
+{ "rsa", "rsa montgomery row", &cmd_rsa },
+STATIC_COMMAND_END(rsa);
+
+static int cmd_rsa(int argc, const cmd_args *argv)
+{
+	if (argc < 2) {
+		printf("not enough arguments\n");
+		return -1;
+	}
+
+	if (strcmp(argv[1].str, "test") == 0) {
+		return rsa_test();
+	} else {
+		printf("unrecognized command\n");
+		return -1;
+	}
+}
+
+#endif
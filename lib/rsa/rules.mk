@@ -0,0 +1,9 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+OBJS += \
+	$(LOCAL_DIR)/rsa.o
+
+ifeq ($(ARCH),arm)
+OBJS += \
+	$(LOCAL_DIR)/arch/arm/mont.o
+endif
@@ -0,0 +1,14 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+OBJS += \
+	$(LOCAL_DIR)/sha2.o \
+	$(LOCAL_DIR)/sha256.o \
+	$(LOCAL_DIR)/sha512.o
+
+ifeq ($(ARCH),arm)
+ifneq ($(filter ARM_WITH_NEON=1,$(DEFINES)),)
+OBJS += \
+	$(LOCAL_DIR)/arch/arm/sha256-ce.o \
+	$(LOCAL_DIR)/arch/arm/sha512-neon.o
+endif
+endif
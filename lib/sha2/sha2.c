@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lib/sha2.h>
+#if ARM_WITH_NEON
+#include <arch/arm.h>
+#endif
+
+#if ARM_WITH_NEON
+void sha256_blocks_armv8_ce(uint32_t state[8], const uint8_t *data, size_t blocks);
+void sha512_blocks_neon(uint64_t state[8], const uint8_t *data, size_t blocks);
+
+static bool sha2_neon_usable(void)
+{
+	return arm_neon_enabled;
+}
+
+/* ID_ISAR5.SHA2 reads as zero on cores without the crypto extension, and
+ * the whole register does on ARMv7.
+ */
+static bool sha2_armv8_ce_usable(void)
+{
+	uint32_t isar5;
+
+	if (!arm_neon_enabled)
+		return false;
+
+	__asm__ volatile("mrc p15, 0, %0, c0, c2, 5" : "=r" (isar5));
+	return ((isar5 >> 12) & 0xf) != 0;
+}
+#endif
+
+const struct sha2_backend sha2_backends[] = {
+#if ARM_WITH_NEON
+	{ "armv8-ce", sha256_blocks_armv8_ce, NULL, sha2_armv8_ce_usable },
+	{ "neon", NULL, sha512_blocks_neon, sha2_neon_usable },
+#endif
+	{ "c", sha256_blocks_portable, sha512_blocks_portable, NULL },
+	{ NULL, NULL, NULL, NULL },
+};
+
+/* Filled in on first use. Secondary cpus may race the boot cpu for it,
+ * they all pick the same backend so whoever stores last does no harm.
+ */
+static const struct sha2_backend *sha256_backend;
+static const struct sha2_backend *sha512_backend;
+
+static const struct sha2_backend *sha2_select(bool want_sha512)
+{
+	const struct sha2_backend *b;
+
+	for (b = sha2_backends; b->name; b++) {
+		if (want_sha512 ? !b->sha512_blocks : !b->sha256_blocks)
+			continue;
+		if (!b->usable || b->usable())
+			return b;
+	}
+
+	/* the portable entry implements both */
+	ASSERT(0);
+	return NULL;
+}
+
+void sha256_blocks(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+	if (!sha256_backend)
+		sha256_backend = sha2_select(false);
+	sha256_backend->sha256_blocks(state, data, blocks);
+}
+
+void sha512_blocks(uint64_t state[8], const uint8_t *data, size_t blocks)
+{
+	if (!sha512_backend)
+		sha512_backend = sha2_select(true);
+	sha512_backend->sha512_blocks(state, data, blocks);
+}
+
+const char *sha256_backend_name(void)
+{
+	if (!sha256_backend)
+		sha256_backend = sha2_select(false);
+	return sha256_backend->name;
+}
+
+const char *sha512_backend_name(void)
+{
+	if (!sha512_backend)
+		sha512_backend = sha2_select(true);
+	return sha512_backend->name;
+}
+
+static const uint32_t sha256_h0[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+void sha256_init(struct sha256_ctx *ctx)
+{
+	memcpy(ctx->state, sha256_h0, sizeof(ctx->state));
+	ctx->len = 0;
+}
+
+void sha256_update(struct sha256_ctx *ctx, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t used = ctx->len % SHA256_BLOCK_LEN;
+	size_t n;
+
+	ctx->len += len;
+
+	if (used) {
+		n = MIN(len, SHA256_BLOCK_LEN - used);
+		memcpy(ctx->buf + used, p, n);
+		p += n;
+		len -= n;
+		if (used + n < SHA256_BLOCK_LEN)
+			return;
+		sha256_blocks(ctx->state, ctx->buf, 1);
+	}
+
+	/* whole blocks straight from the caller's buffer */
+	n = len / SHA256_BLOCK_LEN;
+	if (n) {
+		sha256_blocks(ctx->state, p, n);
+		p += n * SHA256_BLOCK_LEN;
+		len -= n * SHA256_BLOCK_LEN;
+	}
+
+	memcpy(ctx->buf, p, len);
+}
+
+void sha256_final(struct sha256_ctx *ctx, uint8_t digest[SHA256_DIGEST_LEN])
+{
+	size_t used = ctx->len % SHA256_BLOCK_LEN;
+	uint64_t bits = ctx->len * 8;
+	int i;
+
+	ctx->buf[used++] = 0x80;
+	if (used > SHA256_BLOCK_LEN - 8) {
+		memset(ctx->buf + used, 0, SHA256_BLOCK_LEN - used);
+		sha256_blocks(ctx->state, ctx->buf, 1);
+		used = 0;
+	}
+	memset(ctx->buf + used, 0, SHA256_BLOCK_LEN - 8 - used);
+	for (i = 0; i < 8; i++)
+		ctx->buf[SHA256_BLOCK_LEN - 1 - i] = bits >> (8 * i);
+	sha256_blocks(ctx->state, ctx->buf, 1);
+
+	for (i = 0; i < 8; i++) {
+		digest[4 * i] = ctx->state[i] >> 24;
+		digest[4 * i + 1] = ctx->state[i] >> 16;
+		digest[4 * i + 2] = ctx->state[i] >> 8;
+		digest[4 * i + 3] = ctx->state[i];
+	}
+}
+
+void sha256(const void *data, size_t len, uint8_t digest[SHA256_DIGEST_LEN])
+{
+	struct sha256_ctx ctx;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, data, len);
+	sha256_final(&ctx, digest);
+}
+
+#if WITH_LIB_CONSOLE
+
+#include <platform.h>
+#include <lib/console.h>
+
+#define SHA2_BENCH_LEN	(1024 * 1024)
+#define SHA2_BENCH_LOOPS	16
+
+static const uint64_t sha512_h0[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+	0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static void sha2_bench_print(const char *name, const char *alg, bigtime_t us)
+{
+	unsigned kbps;
+
+	if (!us)
+		us = 1;
+	kbps = (uint64_t)SHA2_BENCH_LEN * SHA2_BENCH_LOOPS * 1000 / 1024 / us;
+	printf("%-10s %s: %u.%03u MB/s\n", name, alg, kbps / 1024,
+	       (kbps % 1024) * 1000 / 1024);
+}
+
+static int sha2_bench(void)
+{
+	const struct sha2_backend *b;
+	uint32_t s256[8];
+	uint64_t s512[8];
+	uint8_t *buf;
+	bigtime_t t;
+	int i;
+
+	buf = malloc(SHA2_BENCH_LEN);
+	if (!buf) {
+		printf("out of memory\n");
+		return -1;
+	}
+	memset(buf, 0x5a, SHA2_BENCH_LEN);
+
+	for (b = sha2_backends; b->name; b++) {
+		if (b->usable && !b->usable())
+			continue;
+
+		if (b->sha256_blocks) {
+			memcpy(s256, sha256_h0, sizeof(s256));
+			t = current_time_hires();
+			for (i = 0; i < SHA2_BENCH_LOOPS; i++)
+				b->sha256_blocks(s256, buf,
+						 SHA2_BENCH_LEN / SHA256_BLOCK_LEN);
+			sha2_bench_print(b->name, "sha256", current_time_hires() - t);
+		}
+
+		if (b->sha512_blocks) {
+			memcpy(s512, sha512_h0, sizeof(s512));
+			t = current_time_hires();
+			for (i = 0; i < SHA2_BENCH_LOOPS; i++)
+				b->sha512_blocks(s512, buf,
+						 SHA2_BENCH_LEN / SHA512_BLOCK_LEN);
+			sha2_bench_print(b->name, "sha512", current_time_hires() - t);
+		}
+	}
+
+	printf("selected: sha256 %s, sha512 %s\n", sha256_backend_name(),
+	       sha512_backend_name());
+
+	free(buf);
+	return 0;
+}
+
+/* Cross check every usable backend against the portable code, over block
+ * counts that exercise the unrolled paths and the loop around them.
+ */
+static int sha2_test(void)
+{
+	static const uint8_t abc256[SHA256_DIGEST_LEN] = {
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+		0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+		0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+		0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+	};
+	static const unsigned counts[] = { 1, 2, 3, 7, 16 };
+	const struct sha2_backend *b;
+	uint32_t s256[8], r256[8];
+	uint64_t s512[8], r512[8];
+	uint8_t digest[SHA256_DIGEST_LEN];
+	uint8_t *buf;
+	unsigned i;
+	int failed = 0;
+
+	buf = malloc(16 * SHA512_BLOCK_LEN);
+	if (!buf) {
+		printf("out of memory\n");
+		return -1;
+	}
+	for (i = 0; i < 16 * SHA512_BLOCK_LEN; i++)
+		buf[i] = i * 131 + (i >> 8);
+
+	for (b = sha2_backends; b->name; b++) {
+		if (b->usable && !b->usable())
+			continue;
+
+		for (i = 0; i < countof(counts); i++) {
+			if (b->sha256_blocks) {
+				memcpy(s256, sha256_h0, sizeof(s256));
+				memcpy(r256, sha256_h0, sizeof(r256));
+				b->sha256_blocks(s256, buf, counts[i]);
+				sha256_blocks_portable(r256, buf, counts[i]);
+				if (memcmp(s256, r256, sizeof(s256))) {
+					printf("%s sha256 %u blocks: mismatch\n",
+					       b->name, counts[i]);
+					failed++;
+				}
+			}
+			if (b->sha512_blocks) {
+				memcpy(s512, sha512_h0, sizeof(s512));
+				memcpy(r512, sha512_h0, sizeof(r512));
+				b->sha512_blocks(s512, buf, counts[i]);
+				sha512_blocks_portable(r512, buf, counts[i]);
+				if (memcmp(s512, r512, sizeof(s512))) {
+					printf("%s sha512 %u blocks: mismatch\n",
+					       b->name, counts[i]);
+					failed++;
+				}
+			}
+		}
+	}
+
+	sha256("abc", 3, digest);
+	if (memcmp(digest, abc256, sizeof(digest))) {
+		printf("sha256(\"abc\"): mismatch\n");
+		failed++;
+	}
+
+	free(buf);
+	printf("sha2 test %s\n", failed ? "FAILED" : "passed");
+	return failed ? -1 : 0;
+}
+
+static int cmd_sha2(int argc, const cmd_args *argv);
+
+STATIC_COMMAND_START
+{ "sha2", "sha2 digest backends", &cmd_sha2 },
+STATIC_COMMAND_END(sha2);
+
+static int cmd_sha2(int argc, const cmd_args *argv)
+{
+	if (argc < 2) {
+		printf("not enough arguments\n");
+		return -1;
+	}
+
+	if (strcmp(argv[1].str, "bench") == 0) {
+		return sha2_bench();
+	} else if (strcmp(argv[1].str, "test") == 0) {
+		return sha2_test();
+	} else {
+		printf("unrecognized command\n");
+		return -1;
+	}
+}
+
+#endif
@@ -58,6 +58,144 @@ static void *zlib_alloc(voidpf qpaque, uInt items, size_t size)
 	return malloc(items * size);
 }
 
+struct gunzip_stream {
+	struct z_stream_s stream;
+	unsigned char *in_buf;
+	unsigned int in_len;	/* bytes of in_buf handed to the stream so far */
+	int started;		/* gzip header skipped, inflate initialized */
+	int rc;			/* last inflate() return code */
+};
+
+/* Skip over the gzip header once enough of it has arrived.
+ * Return 1 once inflate is set up, 0 if more input is needed,
+ * -1 on a bad header.
+ */
+static int gunzip_start(struct gunzip_stream *gz, unsigned int in_len)
+{
+	unsigned int hdr_len = GZIP_HEADER_LEN;
+	int rc;
+
+	if (in_len < GZIP_HEADER_LEN)
+		return 0;
+
+	/* skip over asciz filename */
+	if (gz->in_buf[3] & 0x8) {
+		while (hdr_len < in_len && gz->in_buf[hdr_len]) {
+			if (hdr_len - GZIP_HEADER_LEN >= GZIP_FILENAME_LIMIT) {
+				dprintf(INFO, "header error\n");
+				return -1;
+			}
+			hdr_len++;
+		}
+		if (hdr_len == in_len)
+			return 0;
+		hdr_len++;
+	}
+
+	gz->stream.next_in = gz->in_buf + hdr_len;
+	gz->stream.avail_in = in_len - hdr_len;
+	gz->in_len = in_len;
+
+	rc = inflateInit2(&gz->stream, -MAX_WBITS);
+	if (rc != Z_OK) {
+		dprintf(INFO, "inflateInit2 failed!\n");
+		return -1;
+	}
+
+	gz->started = 1;
+	return 1;
+}
+
+/* Start inflating a gzip package that is still being loaded into in_buf,
+ * the output goes to out_buf. Returns NULL on failure.
+ * Feed the stream with decompress_stream_update() as data lands and
+ * collect the result with decompress_stream_end().
+ */
+struct gunzip_stream *decompress_stream_begin(unsigned char *in_buf,
+					      unsigned char *out_buf,
+					      unsigned int out_buf_len)
+{
+	struct gunzip_stream *gz;
+
+	gz = malloc(sizeof(*gz));
+	if (gz == NULL) {
+		dprintf(INFO, "allocating z_stream failed.\n");
+		return NULL;
+	}
+
+	memset(gz, 0, sizeof(*gz));
+	gz->in_buf = in_buf;
+	gz->rc = Z_OK;
+	gz->stream.zalloc = zlib_alloc;
+	gz->stream.zfree = zlib_free;
+	gz->stream.next_out = out_buf;
+	gz->stream.avail_out = out_buf_len;
+
+	return gz;
+}
+
+/* The first in_len bytes of in_buf are now valid, inflate as far as they go.
+ * Return 0 if the stream is still fine (done or waiting for more input),
+ * -1 on error.
+ */
+int decompress_stream_update(struct gunzip_stream *gz, unsigned int in_len)
+{
+	int rc;
+
+	if (gz->rc == Z_STREAM_END)
+		return 0;
+	if (gz->rc != Z_OK)
+		return -1;
+
+	if (!gz->started) {
+		rc = gunzip_start(gz, in_len);
+		if (rc <= 0) {
+			if (rc < 0)
+				gz->rc = Z_DATA_ERROR;
+			return rc;
+		}
+	} else if (in_len > gz->in_len) {
+		gz->stream.avail_in += in_len - gz->in_len;
+		gz->in_len = in_len;
+	}
+
+	rc = inflate(&gz->stream, Z_NO_FLUSH);
+	/* Z_BUF_ERROR only means no progress, more input may still come */
+	if (rc == Z_BUF_ERROR && gz->stream.avail_out)
+		rc = Z_OK;
+	if (rc != Z_OK && rc != Z_STREAM_END) {
+		dprintf(INFO, "uncompression error \n");
+		gz->rc = rc;
+		return -1;
+	}
+
+	gz->rc = rc;
+	return 0;
+}
+
+/* Finish the stream and free it, see decompress() for pos and out_len.
+ * Return 0 if the whole package was inflated, -1 otherwise.
+ */
+int decompress_stream_end(struct gunzip_stream *gz,
+			  unsigned int *pos,
+			  unsigned int *out_len)
+{
+	int rc = (gz->rc == Z_STREAM_END) ? 0 : -1;
+
+	if (gz->started) {
+		inflateEnd(&gz->stream);
+		if (pos)
+			/* alculation the length of the compressed package */
+			*pos = gz->stream.next_in - gz->in_buf + 8;
+
+		if (out_len)
+			*out_len = gz->stream.total_out;
+	}
+
+	free(gz);
+	return rc; /* returns 0 if decompressed successful */
+}
+
 /* decompress gzip file "in_buf", return 0 if decompressed successful,
  * return -1 if decompressed failed.
  * in_buf - input gzip file
@@ -72,70 +210,27 @@ int decompress(unsigned char *in_buf, unsigned int in_len,
 		       unsigned int out_buf_len,
 		       unsigned int *pos,
 		       unsigned int *out_len) {
-	struct z_stream_s *stream;
-	int rc = -1;
-	int i;
+	struct gunzip_stream *gz;
 
 	if (in_len < GZIP_HEADER_LEN) {
 		dprintf(INFO, "the input data is not a gzip package.\n");
-		return rc;
+		return -1;
 	}
 	if (out_buf_len < in_len) {
 		dprintf(INFO, "the avaiable length of out_buf is not enough.\n");
-		return rc;
+		return -1;
 	}
 
-	stream = malloc(sizeof(*stream));
-	if (stream == NULL) {
-		dprintf(INFO, "allocating z_stream failed.\n");
-		return rc;
-	}
+	gz = decompress_stream_begin(in_buf, out_buf, out_buf_len);
+	if (gz == NULL)
+		return -1;
 
-	stream->zalloc = zlib_alloc;
-	stream->zfree = zlib_free;
-	stream->next_out = out_buf;
-	stream->avail_out = out_buf_len;
+	/* The whole package is in memory. As before, the input is not bounded
+	 * by in_len: the stream ends where the deflate data does.
+	 */
+	decompress_stream_update(gz, out_buf_len);
 
-	/* skip over gzip header */
-	stream->next_in = in_buf + GZIP_HEADER_LEN;
-	stream->avail_in = out_buf_len - GZIP_HEADER_LEN;
-	/* skip over asciz filename */
-	if (in_buf[3] & 0x8) {
-		for (i = 0; i < GZIP_FILENAME_LIMIT && *stream->next_in++; i++) {
-			if (stream->avail_in == 0) {
-				dprintf(INFO, "header error\n");
-				goto gunzip_end;
-			}
-			--stream->avail_in;
-		}
-	}
-
-	rc = inflateInit2(stream, -MAX_WBITS);
-	if (rc != Z_OK) {
-		dprintf(INFO, "inflateInit2 failed!\n");
-		goto gunzip_end;
-	}
-
-	rc = inflate(stream, 0);
-	/* Z_STREAM_END is "we unpacked it all" */
-	if (rc == Z_STREAM_END) {
-		rc = 0;
-	} else if (rc != Z_OK) {
-		dprintf(INFO, "uncompression error \n");
-		rc = -1;
-	}
-
-	inflateEnd(stream);
-	if (pos)
-		/* alculation the length of the compressed package */
-		*pos = stream->next_in - in_buf + 8;
-
-	if (out_len)
-		*out_len = stream->total_out;
-
-gunzip_end:
-	free(stream);
-	return rc; /* returns 0 if decompressed successful */
+	return decompress_stream_end(gz, pos, out_len);
 }
 
 /* check if the input "buf" file was a gzip package.
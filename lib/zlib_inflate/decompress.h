@@ -32,4 +32,10 @@
 int is_gzip_package(unsigned char *, unsigned int);
 
 int decompress(unsigned char *, unsigned int, unsigned char *, unsigned int, unsigned int *, unsigned int *);
+
+/* Inflate a gzip package while it is being loaded */
+struct gunzip_stream;
+struct gunzip_stream *decompress_stream_begin(unsigned char *in_buf, unsigned char *out_buf, unsigned int out_buf_len);
+int decompress_stream_update(struct gunzip_stream *gz, unsigned int in_len);
+int decompress_stream_end(struct gunzip_stream *gz, unsigned int *pos, unsigned int *out_len);
 #endif /* __PLATFORM_MSM_SHARED_DECOMPRESS_H */
@@ -0,0 +1,980 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Minimal single-shot zstd decoder (RFC 8878) for boot images.
+ *
+ * The whole frame is decoded into one flat output buffer, so no window
+ * buffer is kept: matches are copied straight from the output. Dictionaries
+ * are not supported and checksums are not verified, the image is
+ * authenticated as a whole.
+ */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <zstd.h>
+
+#define ZSTD_MAGIC              0xFD2FB528
+#define ZSTD_SKIPPABLE_MAGIC    0x184D2A50
+#define ZSTD_SKIPPABLE_MASK     0xFFFFFFF0
+
+#define ZSTD_BLOCK_MAX          (128 * 1024)
+
+#define ZSTD_BLOCK_RAW          0
+#define ZSTD_BLOCK_RLE          1
+#define ZSTD_BLOCK_COMPRESSED   2
+
+#define ZSTD_LIT_RAW            0
+#define ZSTD_LIT_RLE            1
+#define ZSTD_LIT_COMPRESSED     2
+#define ZSTD_LIT_TREELESS       3
+
+#define ZSTD_SEQ_PREDEFINED     0
+#define ZSTD_SEQ_RLE            1
+#define ZSTD_SEQ_FSE            2
+#define ZSTD_SEQ_REPEAT         3
+
+#define HUF_MAX_BITS            11
+#define HUF_MAX_SYMBOLS         256
+
+#define FSE_MAX_LOG             9
+#define LL_MAX_LOG              9
+#define ML_MAX_LOG              9
+#define OF_MAX_LOG              8
+#define HUF_WEIGHT_MAX_LOG      6
+
+#define LL_MAX_SYMBOL           35
+#define ML_MAX_SYMBOL           52
+#define OF_MAX_SYMBOL           31
+
+struct fse_entry {
+	uint8_t symbol;
+	uint8_t nb_bits;
+	uint16_t new_state;
+};
+
+struct fse_table {
+	unsigned int log;
+	struct fse_entry e[1 << FSE_MAX_LOG];
+};
+
+struct huf_entry {
+	uint8_t symbol;
+	uint8_t nb_bits;
+};
+
+struct huf_table {
+	unsigned int max_bits;      /* 0 if no table has been read yet */
+	struct huf_entry e[1 << HUF_MAX_BITS];
+};
+
+struct zstd_ctx {
+	struct huf_table huf;
+	struct fse_table ll;
+	struct fse_table ml;
+	struct fse_table of;
+	int ll_valid, ml_valid, of_valid;
+	uint32_t rep[3];
+	unsigned char lit[ZSTD_BLOCK_MAX];
+};
+
+/* Bitstream read backwards from its end, as used by the huffman and fse
+ * coded parts. pos counts the bits left; bits below 0 read as zero.
+ */
+struct bit_reader {
+	const unsigned char *buf;
+	int pos;
+};
+
+static const int16_t ll_default_norm[LL_MAX_SYMBOL + 1] = {
+	4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+	-1, -1, -1, -1
+};
+
+static const int16_t ml_default_norm[ML_MAX_SYMBOL + 1] = {
+	1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+	-1, -1, -1, -1, -1
+};
+
+static const int16_t of_default_norm[29] = {
+	1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1
+};
+
+static const uint32_t ll_base[LL_MAX_SYMBOL + 1] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096,
+	8192, 16384, 32768, 65536
+};
+
+static const uint8_t ll_bits[LL_MAX_SYMBOL + 1] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+	13, 14, 15, 16
+};
+
+static const uint32_t ml_base[ML_MAX_SYMBOL + 1] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+	19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+	35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+	4099, 8195, 16387, 32771, 65539
+};
+
+static const uint8_t ml_bits[ML_MAX_SYMBOL + 1] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+	12, 13, 14, 15, 16
+};
+
+static uint32_t zstd_get_le32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static unsigned int highbit(uint32_t v)
+{
+	return 31 - __builtin_clz(v);
+}
+
+/* Bits [start, start + n) of the little endian stream in buf, n <= 32 */
+static uint32_t bits_at(const unsigned char *buf, int start, unsigned int n)
+{
+	uint64_t v = 0;
+	int first = start >> 3;
+	int last = (start + n - 1) >> 3;
+	int i;
+
+	if (!n)
+		return 0;
+
+	for (i = last; i >= first; i--)
+		v = (v << 8) | buf[i];
+
+	return (uint32_t)(v >> (start & 7)) & (uint32_t)(((uint64_t)1 << n) - 1);
+}
+
+static int br_init(struct bit_reader *br, const unsigned char *buf, unsigned int len)
+{
+	if (!len || !buf[len - 1])
+		return -1;
+
+	br->buf = buf;
+	/* skip the padding down to and including the end mark */
+	br->pos = (len - 1) * 8 + highbit(buf[len - 1]);
+
+	return 0;
+}
+
+static uint32_t br_peek(struct bit_reader *br, unsigned int n)
+{
+	if (br->pos >= (int)n)
+		return bits_at(br->buf, br->pos - n, n);
+	if (br->pos <= 0)
+		return 0;
+
+	return bits_at(br->buf, 0, br->pos) << (n - br->pos);
+}
+
+static uint32_t br_read(struct bit_reader *br, unsigned int n)
+{
+	uint32_t v = br_peek(br, n);
+
+	br->pos -= n;
+
+	return v;
+}
+
+/* Build the decoding table from normalized counts, RFC 8878 4.1.1 */
+static int fse_build(struct fse_table *t, const int16_t *norm, unsigned int max_symbol,
+		     unsigned int log)
+{
+	uint16_t next[256];
+	unsigned int size = 1 << log;
+	unsigned int high = size - 1;
+	unsigned int step = (size >> 1) + (size >> 3) + 3;
+	unsigned int mask = size - 1;
+	unsigned int pos = 0;
+	unsigned int s, i;
+	uint16_t state;
+
+	t->log = log;
+
+	for (s = 0; s <= max_symbol; s++) {
+		if (norm[s] == -1) {
+			t->e[high--].symbol = s;
+			next[s] = 1;
+		} else {
+			next[s] = norm[s];
+		}
+	}
+
+	for (s = 0; s <= max_symbol; s++) {
+		for (i = 0; norm[s] > 0 && i < (unsigned int)norm[s]; i++) {
+			t->e[pos].symbol = s;
+			do {
+				pos = (pos + step) & mask;
+			} while (pos > high);
+		}
+	}
+
+	if (pos)
+		return -1;
+
+	for (i = 0; i < size; i++) {
+		state = next[t->e[i].symbol]++;
+		t->e[i].nb_bits = log - highbit(state);
+		t->e[i].new_state = (state << t->e[i].nb_bits) - size;
+	}
+
+	return 0;
+}
+
+static void fse_build_rle(struct fse_table *t, uint8_t symbol)
+{
+	t->log = 0;
+	t->e[0].symbol = symbol;
+	t->e[0].nb_bits = 0;
+	t->e[0].new_state = 0;
+}
+
+/* Read a FSE table description, RFC 8878 4.1.1. Returns the number of
+ * bytes it took or -1.
+ */
+static int fse_read_table(struct fse_table *t, const unsigned char *in, unsigned int in_len,
+			  unsigned int max_symbol, unsigned int max_log)
+{
+	int16_t norm[256];
+	unsigned int bit, bits, log, symbol = 0;
+	uint32_t val, lower_mask, threshold, repeat;
+	int remaining, count;
+
+	if (in_len < 1)
+		return -1;
+
+	log = (in[0] & 0xF) + 5;
+	if (log > max_log)
+		return -1;
+	bit = 4;
+
+	remaining = 1 << log;
+
+	while (remaining > 0) {
+		if (symbol > max_symbol)
+			return -1;
+
+		bits = highbit(remaining + 1) + 1;
+		if ((bit + bits + 7) / 8 > in_len)
+			return -1;
+
+		val = bits_at(in, bit, bits);
+		bit += bits;
+		lower_mask = (1 << (bits - 1)) - 1;
+		threshold = (1 << bits) - 1 - (remaining + 1);
+
+		if ((val & lower_mask) < threshold) {
+			/* small values only take bits - 1 bits */
+			bit--;
+			val &= lower_mask;
+		} else if (val > lower_mask) {
+			val -= threshold;
+		}
+
+		count = (int)val - 1;
+		remaining -= count < 0 ? -count : count;
+		norm[symbol++] = count;
+
+		if (count)
+			continue;
+
+		/* runs of zero probability symbols */
+		do {
+			if ((bit + 2 + 7) / 8 > in_len)
+				return -1;
+			repeat = bits_at(in, bit, 2);
+			bit += 2;
+			while (repeat-- && symbol <= max_symbol)
+				norm[symbol++] = 0;
+		} while (bits_at(in, bit - 2, 2) == 3);
+	}
+
+	if (remaining)
+		return -1;
+
+	while (symbol <= max_symbol)
+		norm[symbol++] = 0;
+
+	if (fse_build(t, norm, max_symbol, log))
+		return -1;
+
+	return (bit + 7) / 8;
+}
+
+/* Read the huffman tree description, RFC 8878 4.2.1. Returns the number of
+ * bytes it took or -1.
+ */
+static int huf_read_table(struct huf_table *t, const unsigned char *in, unsigned int in_len)
+{
+	uint8_t weights[HUF_MAX_SYMBOLS];
+	uint32_t rank_start[HUF_MAX_BITS + 2];
+	unsigned int num_weights = 0;
+	unsigned int header, used, i, j;
+	unsigned int max_bits, len;
+	uint32_t total = 0, rest;
+	struct fse_table *ft;
+	struct bit_reader br;
+	uint16_t state1, state2;
+	int ret;
+
+	if (in_len < 1)
+		return -1;
+
+	header = in[0];
+
+	if (header >= 128) {
+		/* 4-bit direct weights */
+		num_weights = header - 127;
+		used = 1 + (num_weights + 1) / 2;
+		if (used > in_len)
+			return -1;
+		for (i = 0; i < num_weights; i++)
+			weights[i] = (i & 1) ? (in[1 + i / 2] & 0xF) : (in[1 + i / 2] >> 4);
+	} else {
+		/* FSE compressed weights, two interleaved states */
+		used = 1 + header;
+		if (used > in_len)
+			return -1;
+
+		ft = malloc(sizeof(*ft));
+		if (!ft)
+			return -1;
+
+		ret = fse_read_table(ft, in + 1, header, 255, HUF_WEIGHT_MAX_LOG);
+		if (ret < 0 || br_init(&br, in + 1 + ret, header - ret)) {
+			free(ft);
+			return -1;
+		}
+
+		state1 = br_read(&br, ft->log);
+		state2 = br_read(&br, ft->log);
+
+		for (;;) {
+			if (num_weights >= HUF_MAX_SYMBOLS - 1)
+				break;
+			weights[num_weights++] = ft->e[state1].symbol;
+			state1 = ft->e[state1].new_state + br_read(&br, ft->e[state1].nb_bits);
+			if (br.pos < 0) {
+				weights[num_weights++] = ft->e[state2].symbol;
+				break;
+			}
+
+			if (num_weights >= HUF_MAX_SYMBOLS - 1)
+				break;
+			weights[num_weights++] = ft->e[state2].symbol;
+			state2 = ft->e[state2].new_state + br_read(&br, ft->e[state2].nb_bits);
+			if (br.pos < 0) {
+				weights[num_weights++] = ft->e[state1].symbol;
+				break;
+			}
+		}
+
+		free(ft);
+
+		if (br.pos >= 0)
+			return -1;
+	}
+
+	for (i = 0; i < num_weights; i++) {
+		if (weights[i] > HUF_MAX_BITS)
+			return -1;
+		if (weights[i])
+			total += 1 << (weights[i] - 1);
+	}
+
+	if (!total)
+		return -1;
+
+	/* the last weight is implied by the sum of the others */
+	max_bits = highbit(total) + 1;
+	if (max_bits > HUF_MAX_BITS)
+		return -1;
+	rest = (1 << max_bits) - total;
+	if (rest & (rest - 1))
+		return -1;
+	weights[num_weights++] = highbit(rest) + 1;
+
+	memset(rank_start, 0, sizeof(rank_start));
+	for (i = 0; i < num_weights; i++)
+		rank_start[weights[i]]++;
+
+	/* lowest weights (longest codes) take the lowest table slots */
+	for (i = 1, j = 0; i <= max_bits; i++) {
+		len = rank_start[i] << (i - 1);
+		rank_start[i] = j;
+		j += len;
+	}
+
+	for (i = 0; i < num_weights; i++) {
+		if (!weights[i])
+			continue;
+		len = (1 << weights[i]) >> 1;
+		for (j = rank_start[weights[i]]; j < rank_start[weights[i]] + len; j++) {
+			t->e[j].symbol = i;
+			t->e[j].nb_bits = max_bits + 1 - weights[i];
+		}
+		rank_start[weights[i]] += len;
+	}
+
+	t->max_bits = max_bits;
+
+	return used;
+}
+
+static int huf_decode_stream(struct huf_table *t, const unsigned char *in, unsigned int in_len,
+			     unsigned char *out, unsigned int out_len)
+{
+	struct bit_reader br;
+	struct huf_entry *e;
+	unsigned int i;
+
+	if (br_init(&br, in, in_len))
+		return -1;
+
+	for (i = 0; i < out_len; i++) {
+		e = &t->e[br_peek(&br, t->max_bits)];
+		out[i] = e->symbol;
+		br.pos -= e->nb_bits;
+	}
+
+	return br.pos ? -1 : 0;
+}
+
+/* Decode the literals section into ctx->lit. Returns the number of bytes
+ * it took or -1, *lit_len is set to the number of literals.
+ */
+static int zstd_read_literals(struct zstd_ctx *ctx, const unsigned char *in, unsigned int in_len,
+			      unsigned int *lit_len)
+{
+	unsigned int type, size_format;
+	unsigned int regen, comp, hdr, used;
+	unsigned int streams = 1;
+	unsigned int seg, s, off;
+	unsigned int sizes[4];
+	int ret;
+
+	if (in_len < 1)
+		return -1;
+
+	type = in[0] & 3;
+	size_format = (in[0] >> 2) & 3;
+
+	if (type == ZSTD_LIT_RAW || type == ZSTD_LIT_RLE) {
+		switch (size_format) {
+		case 1:
+			hdr = 2;
+			if (in_len < hdr)
+				return -1;
+			regen = (in[0] >> 4) + (in[1] << 4);
+			break;
+		case 3:
+			hdr = 3;
+			if (in_len < hdr)
+				return -1;
+			regen = (in[0] >> 4) + (in[1] << 4) + (in[2] << 12);
+			break;
+		default:
+			hdr = 1;
+			regen = in[0] >> 3;
+			break;
+		}
+
+		if (regen > ZSTD_BLOCK_MAX)
+			return -1;
+
+		if (type == ZSTD_LIT_RAW) {
+			if (in_len < hdr + regen)
+				return -1;
+			memcpy(ctx->lit, in + hdr, regen);
+			*lit_len = regen;
+			return hdr + regen;
+		}
+
+		if (in_len < hdr + 1)
+			return -1;
+		memset(ctx->lit, in[hdr], regen);
+		*lit_len = regen;
+		return hdr + 1;
+	}
+
+	switch (size_format) {
+	case 0:
+	case 1:
+		hdr = 3;
+		if (in_len < hdr)
+			return -1;
+		regen = ((in[0] >> 4) | (in[1] << 4) | (in[2] << 12)) & 0x3FF;
+		comp = ((in[1] >> 6) | (in[2] << 2)) & 0x3FF;
+		streams = size_format ? 4 : 1;
+		break;
+	case 2:
+		hdr = 4;
+		if (in_len < hdr)
+			return -1;
+		regen = (zstd_get_le32(in) >> 4) & 0x3FFF;
+		comp = zstd_get_le32(in) >> 18;
+		streams = 4;
+		break;
+	default:
+		hdr = 5;
+		if (in_len < hdr)
+			return -1;
+		regen = (zstd_get_le32(in) >> 4) & 0x3FFFF;
+		comp = (zstd_get_le32(in) >> 22) | (in[4] << 10);
+		streams = 4;
+		break;
+	}
+
+	if (regen > ZSTD_BLOCK_MAX || in_len < hdr + comp)
+		return -1;
+
+	in += hdr;
+	used = hdr + comp;
+
+	if (type == ZSTD_LIT_COMPRESSED) {
+		ret = huf_read_table(&ctx->huf, in, comp);
+		if (ret < 0)
+			return -1;
+		in += ret;
+		comp -= ret;
+	} else if (!ctx->huf.max_bits) {
+		return -1;
+	}
+
+	if (streams == 1) {
+		if (huf_decode_stream(&ctx->huf, in, comp, ctx->lit, regen))
+			return -1;
+	} else {
+		if (comp < 6)
+			return -1;
+		sizes[0] = in[0] | (in[1] << 8);
+		sizes[1] = in[2] | (in[3] << 8);
+		sizes[2] = in[4] | (in[5] << 8);
+		if (sizes[0] + sizes[1] + sizes[2] + 6 > comp)
+			return -1;
+		sizes[3] = comp - 6 - sizes[0] - sizes[1] - sizes[2];
+
+		seg = (regen + 3) / 4;
+		if (seg * 3 > regen)
+			return -1;
+
+		in += 6;
+		for (s = 0, off = 0; s < 4; s++) {
+			if (huf_decode_stream(&ctx->huf, in, sizes[s], ctx->lit + off,
+					      s < 3 ? seg : regen - 3 * seg))
+				return -1;
+			in += sizes[s];
+			off += seg;
+		}
+	}
+
+	*lit_len = regen;
+	return used;
+}
+
+/* Set up one of the sequence tables for the given mode. Returns the bytes
+ * it took or -1.
+ */
+static int zstd_seq_table(struct fse_table *t, int *valid, unsigned int mode,
+			  const unsigned char *in, unsigned int in_len,
+			  const int16_t *default_norm, unsigned int default_max,
+			  unsigned int default_log, unsigned int max_symbol, unsigned int max_log)
+{
+	int ret = 0;
+
+	switch (mode) {
+	case ZSTD_SEQ_PREDEFINED:
+		if (fse_build(t, default_norm, default_max, default_log))
+			return -1;
+		break;
+	case ZSTD_SEQ_RLE:
+		if (in_len < 1 || in[0] > max_symbol)
+			return -1;
+		fse_build_rle(t, in[0]);
+		ret = 1;
+		break;
+	case ZSTD_SEQ_FSE:
+		ret = fse_read_table(t, in, in_len, max_symbol, max_log);
+		if (ret < 0)
+			return -1;
+		break;
+	default:
+		if (!*valid)
+			return -1;
+		break;
+	}
+
+	*valid = 1;
+	return ret;
+}
+
+static int zstd_decode_block(struct zstd_ctx *ctx, const unsigned char *in, unsigned int in_len,
+			     unsigned char *out_start, unsigned char **op_ptr, unsigned char *oend)
+{
+	unsigned char *op = *op_ptr;
+	const unsigned char *lit;
+	const unsigned char *lit_end;
+	const unsigned char *match;
+	unsigned int lit_len;
+	unsigned int nb_seq;
+	unsigned int i, idx;
+	uint32_t ll_state, ml_state, of_state;
+	uint32_t ll, ml, of, offset;
+	struct fse_entry *ll_e, *ml_e, *of_e;
+	struct bit_reader br;
+	int ret;
+
+	ret = zstd_read_literals(ctx, in, in_len, &lit_len);
+	if (ret < 0)
+		return -1;
+	in += ret;
+	in_len -= ret;
+
+	lit = ctx->lit;
+	lit_end = ctx->lit + lit_len;
+
+	if (in_len < 1)
+		return -1;
+
+	if (in[0] < 128) {
+		nb_seq = in[0];
+		in += 1;
+		in_len -= 1;
+	} else if (in[0] < 255) {
+		if (in_len < 2)
+			return -1;
+		nb_seq = ((in[0] - 128) << 8) + in[1];
+		in += 2;
+		in_len -= 2;
+	} else {
+		if (in_len < 3)
+			return -1;
+		nb_seq = in[1] + (in[2] << 8) + 0x7F00;
+		in += 3;
+		in_len -= 3;
+	}
+
+	if (nb_seq) {
+		if (in_len < 1 || (in[0] & 3))
+			return -1;
+
+		i = in[0];
+		in += 1;
+		in_len -= 1;
+
+		ret = zstd_seq_table(&ctx->ll, &ctx->ll_valid, i >> 6, in, in_len,
+				     ll_default_norm, LL_MAX_SYMBOL, 6, LL_MAX_SYMBOL, LL_MAX_LOG);
+		if (ret < 0)
+			return -1;
+		in += ret;
+		in_len -= ret;
+
+		ret = zstd_seq_table(&ctx->of, &ctx->of_valid, (i >> 4) & 3, in, in_len,
+				     of_default_norm, 28, 5, OF_MAX_SYMBOL, OF_MAX_LOG);
+		if (ret < 0)
+			return -1;
+		in += ret;
+		in_len -= ret;
+
+		ret = zstd_seq_table(&ctx->ml, &ctx->ml_valid, (i >> 2) & 3, in, in_len,
+				     ml_default_norm, ML_MAX_SYMBOL, 6, ML_MAX_SYMBOL, ML_MAX_LOG);
+		if (ret < 0)
+			return -1;
+		in += ret;
+		in_len -= ret;
+
+		if (br_init(&br, in, in_len))
+			return -1;
+
+		ll_state = br_read(&br, ctx->ll.log);
+		of_state = br_read(&br, ctx->of.log);
+		ml_state = br_read(&br, ctx->ml.log);
+
+		for (i = 0; i < nb_seq; i++) {
+			ll_e = &ctx->ll.e[ll_state];
+			ml_e = &ctx->ml.e[ml_state];
+			of_e = &ctx->of.e[of_state];
+
+			if (ll_e->symbol > LL_MAX_SYMBOL || ml_e->symbol > ML_MAX_SYMBOL ||
+			    of_e->symbol > OF_MAX_SYMBOL)
+				return -1;
+
+			of = ((uint32_t)1 << of_e->symbol) + br_read(&br, of_e->symbol);
+			ml = ml_base[ml_e->symbol] + br_read(&br, ml_bits[ml_e->symbol]);
+			ll = ll_base[ll_e->symbol] + br_read(&br, ll_bits[ll_e->symbol]);
+
+			if (of > 3) {
+				offset = of - 3;
+				ctx->rep[2] = ctx->rep[1];
+				ctx->rep[1] = ctx->rep[0];
+				ctx->rep[0] = offset;
+			} else {
+				idx = of - 1 + (ll == 0);
+				if (idx == 0) {
+					offset = ctx->rep[0];
+				} else {
+					offset = (idx == 3) ? ctx->rep[0] - 1 : ctx->rep[idx];
+					if (idx != 1)
+						ctx->rep[2] = ctx->rep[1];
+					ctx->rep[1] = ctx->rep[0];
+					ctx->rep[0] = offset;
+				}
+			}
+
+			if (i + 1 < nb_seq) {
+				ll_state = ll_e->new_state + br_read(&br, ll_e->nb_bits);
+				ml_state = ml_e->new_state + br_read(&br, ml_e->nb_bits);
+				of_state = of_e->new_state + br_read(&br, of_e->nb_bits);
+			}
+
+			if (br.pos < 0)
+				return -1;
+
+			/* literals, then the match */
+			if (ll > (uint32_t)(lit_end - lit) || ll > (uint32_t)(oend - op))
+				return -1;
+			memcpy(op, lit, ll);
+			op += ll;
+			lit += ll;
+
+			if (!offset || offset > (uint32_t)(op - out_start) ||
+			    ml > (uint32_t)(oend - op))
+				return -1;
+			match = op - offset;
+			if (offset >= ml) {
+				memcpy(op, match, ml);
+				op += ml;
+			} else {
+				while (ml--)
+					*op++ = *match++;
+			}
+		}
+
+		if (br.pos)
+			return -1;
+	} else if (in_len) {
+		return -1;
+	}
+
+	/* the literals left over */
+	lit_len = lit_end - lit;
+	if (lit_len > (unsigned int)(oend - op))
+		return -1;
+	memcpy(op, lit, lit_len);
+	op += lit_len;
+
+	*op_ptr = op;
+	return 0;
+}
+
+static int zstd_decode_frame(struct zstd_ctx *ctx, const unsigned char *in, unsigned int in_len,
+			     unsigned char *out, unsigned int out_buf_len,
+			     unsigned int *used, unsigned int *produced)
+{
+	const unsigned char *ip = in + 4;
+	const unsigned char *iend = in + in_len;
+	unsigned char *op = out;
+	unsigned char *oend = out + out_buf_len;
+	unsigned int fhd, fcs_flag, single_segment, dict_flag, checksum;
+	unsigned int hdr_len;
+	uint32_t bh, block_size, last, type;
+	static const unsigned int dict_id_len[4] = { 0, 1, 2, 4 };
+	static const unsigned int fcs_len[4] = { 0, 2, 4, 8 };
+
+	if (iend - ip < 1)
+		return -1;
+
+	fhd = ip[0];
+	fcs_flag = fhd >> 6;
+	single_segment = (fhd >> 5) & 1;
+	checksum = (fhd >> 2) & 1;
+	dict_flag = fhd & 3;
+
+	if (fhd & 0x08)
+		return -1;
+
+	if (dict_flag) {
+		dprintf(CRITICAL, "zstd: dictionaries are not supported\n");
+		return -1;
+	}
+
+	hdr_len = 1 + !single_segment + dict_id_len[dict_flag] + fcs_len[fcs_flag];
+	if (!fcs_flag && single_segment)
+		hdr_len += 1;
+
+	if ((unsigned int)(iend - ip) < hdr_len)
+		return -1;
+	ip += hdr_len;
+
+	ctx->huf.max_bits = 0;
+	ctx->ll_valid = ctx->ml_valid = ctx->of_valid = 0;
+	ctx->rep[0] = 1;
+	ctx->rep[1] = 4;
+	ctx->rep[2] = 8;
+
+	do {
+		if (iend - ip < 3)
+			return -1;
+
+		bh = ip[0] | (ip[1] << 8) | (ip[2] << 16);
+		ip += 3;
+		last = bh & 1;
+		type = (bh >> 1) & 3;
+		block_size = bh >> 3;
+
+		switch (type) {
+		case ZSTD_BLOCK_RAW:
+			if (block_size > (uint32_t)(iend - ip) || block_size > (uint32_t)(oend - op))
+				return -1;
+			memcpy(op, ip, block_size);
+			op += block_size;
+			ip += block_size;
+			break;
+		case ZSTD_BLOCK_RLE:
+			if (iend - ip < 1 || block_size > (uint32_t)(oend - op))
+				return -1;
+			memset(op, ip[0], block_size);
+			op += block_size;
+			ip += 1;
+			break;
+		case ZSTD_BLOCK_COMPRESSED:
+			if (block_size > ZSTD_BLOCK_MAX || block_size > (uint32_t)(iend - ip))
+				return -1;
+			if (zstd_decode_block(ctx, ip, block_size, out, &op, oend)) {
+				dprintf(CRITICAL, "zstd: corrupt block at offset %u\n",
+					(unsigned int)(ip - in));
+				return -1;
+			}
+			ip += block_size;
+			break;
+		default:
+			return -1;
+		}
+	} while (!last);
+
+	/* content checksum is not verified */
+	if (checksum) {
+		if (iend - ip < 4)
+			return -1;
+		ip += 4;
+	}
+
+	*used = ip - in;
+	*produced = op - out;
+
+	return 0;
+}
+
+/* Return 1 if buf starts with a zstd frame */
+int is_zstd_package(unsigned char *buf, unsigned int len)
+{
+	if (!buf || len < 8)
+		return 0;
+
+	return zstd_get_le32(buf) == ZSTD_MAGIC;
+}
+
+/* Decompress the zstd frames at the start of in_buf, same contract as
+ * decompress(): pos is set to the end of the compressed data, out_len to the
+ * size of the decompressed data. Returns 0 on success, -1 on failure.
+ */
+int zstd_decompress(unsigned char *in_buf, unsigned int in_len,
+		    unsigned char *out_buf, unsigned int out_buf_len,
+		    unsigned int *pos, unsigned int *out_len)
+{
+	struct zstd_ctx *ctx;
+	unsigned int in_pos = 0, out_pos = 0;
+	unsigned int used, produced;
+	uint32_t magic;
+	int ret = 0;
+
+	if (!is_zstd_package(in_buf, in_len))
+		return -1;
+
+	ctx = malloc(sizeof(*ctx));
+	if (!ctx) {
+		dprintf(CRITICAL, "zstd: failed to allocate the decoder\n");
+		return -1;
+	}
+
+	/* Concatenated and skippable frames, up to whatever follows them */
+	while (in_len - in_pos >= 8) {
+		magic = zstd_get_le32(in_buf + in_pos);
+
+		if ((magic & ZSTD_SKIPPABLE_MASK) == ZSTD_SKIPPABLE_MAGIC) {
+			used = zstd_get_le32(in_buf + in_pos + 4);
+			if (used > in_len - in_pos - 8)
+				break;
+			in_pos += 8 + used;
+			continue;
+		}
+
+		if (magic != ZSTD_MAGIC)
+			break;
+
+		if (zstd_decode_frame(ctx, in_buf + in_pos, in_len - in_pos,
+				      out_buf + out_pos, out_buf_len - out_pos, &used, &produced)) {
+			dprintf(CRITICAL, "zstd: decompression failed\n");
+			ret = -1;
+			break;
+		}
+
+		in_pos += used;
+		out_pos += produced;
+	}
+
+	free(ctx);
+
+	if (ret)
+		return ret;
+
+	/* The kernel build appends the decompressed size after the stream */
+	if (in_len - in_pos >= 4 && zstd_get_le32(in_buf + in_pos) == out_pos)
+		in_pos += 4;
+
+	if (pos)
+		*pos = in_pos;
+	if (out_len)
+		*out_len = out_pos;
+
+	return 0;
+}
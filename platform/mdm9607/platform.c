@@ -245,23 +245,16 @@ addr_t platform_get_phys_to_virt_mapping(addr_t phys_addr)
 void platform_init_mmu_mappings(void)
 {
 	uint32_t i;
-	uint32_t sections;
 	uint32_t table_size = ARRAY_SIZE(mmu_section_table);
 
 	/* Configure the MMU page entries for memory read from the
            mmu_section_table */
 	for (i = 0; i < table_size; i++)
 	{
-		sections = mmu_section_table[i].num_of_sections;
-
-		while (sections--)
-		{
-			arm_mmu_map_section(mmu_section_table[i].paddress +
-								sections * MB,
-								mmu_section_table[i].vaddress +
-								sections * MB,
-								mmu_section_table[i].flags);
-		}
+		arm_mmu_map_range(mmu_section_table[i].paddress,
+						  mmu_section_table[i].vaddress,
+						  mmu_section_table[i].num_of_sections,
+						  mmu_section_table[i].flags);
 	}
 }
 
@@ -269,22 +262,15 @@ void platform_init_mmu_mappings(void)
 static void ddr_based_mmu_mappings(mmu_section_t *table,uint32_t table_size)
 {
 	uint32_t i;
-	uint32_t sections;
 
 	/* Configure the MMU page entries for memory read from the
 		 mmu_section_table */
 	for (i = 0; i < table_size; i++)
 	{
-		sections = table->num_of_sections;
-
-		while (sections--)
-		{
-			arm_mmu_map_section(table->paddress +
-								sections * MB,
-								table->vaddress +
-								sections * MB,
-								table->flags);
-		}
+		arm_mmu_map_range(table->paddress,
+						  table->vaddress,
+						  table->num_of_sections,
+						  table->flags);
 	table++;
 	}
 }
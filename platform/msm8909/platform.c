@@ -111,7 +111,6 @@ int platform_use_identity_mmu_mappings(void)
 void platform_init_mmu_mappings(void)
 {
 	uint32_t i;
-	uint32_t sections;
 	uint32_t table_size = ARRAY_SIZE(mmu_section_table);
 	ram_partition ptn_entry;
 	uint32_t len = 0;
@@ -133,16 +132,11 @@ void platform_init_mmu_mappings(void)
 				/* Check to ensure that start address is 1MB aligned */
 				ASSERT((ptn_entry.start & (MB-1)) == 0);
 
-				sections = (ptn_entry.size) / MB;
-				while(sections--)
-				{
-						arm_mmu_map_section(ptn_entry.start +
-										sections * MB,
-										ptn_entry.start +
-										sections * MB,
-										(MMU_MEMORY_TYPE_NORMAL_WRITE_BACK_ALLOCATE | \
-										MMU_MEMORY_AP_READ_WRITE | MMU_MEMORY_XN));
-				}
+				arm_mmu_map_range(ptn_entry.start,
+								  ptn_entry.start,
+								  ptn_entry.size / MB,
+								  (MMU_MEMORY_TYPE_NORMAL_WRITE_BACK_ALLOCATE |
+								  MMU_MEMORY_AP_READ_WRITE | MMU_MEMORY_XN));
 			}
 		}
 	}
@@ -151,16 +145,10 @@ void platform_init_mmu_mappings(void)
 		mmu_section_table */
 	for (i = 0; i < table_size; i++)
 	{
-		sections = mmu_section_table[i].num_of_sections;
-
-		while (sections--)
-		{
-			arm_mmu_map_section(mmu_section_table[i].paddress +
-								sections * MB,
-								mmu_section_table[i].vaddress +
-								sections * MB,
-								mmu_section_table[i].flags);
-		}
+		arm_mmu_map_range(mmu_section_table[i].paddress,
+						  mmu_section_table[i].vaddress,
+						  mmu_section_table[i].num_of_sections,
+						  mmu_section_table[i].flags);
 	}
 }
 
@@ -121,18 +121,13 @@ int platform_use_identity_mmu_mappings(void)
 void platform_init_mmu_mappings(void)
 {
 	uint32_t i;
-	uint32_t sections;
 	uint32_t table_size;
 	uint32_t ddr_start = get_ddr_start();
 	uint32_t smem_addr = platform_get_smem_base_addr();
 	mmu_section_t *table_addr;
 
 	/*Mapping the ddr start address for loading the kernel about 90 MB*/
-	sections = 90;
-	while(sections--)
-	{
-		arm_mmu_map_section(ddr_start + sections * MB, ddr_start + sections* MB, SCRATCH_MEMORY);
-	}
+	arm_mmu_map_range(ddr_start, ddr_start, 90, SCRATCH_MEMORY);
 
 
 	/* Mapping the SMEM addr */
@@ -153,16 +148,10 @@ void platform_init_mmu_mappings(void)
 
 	for (i = 0; i < table_size; i++)
 	{
-		sections = table_addr->num_of_sections;
-
-		while (sections--)
-		{
-			arm_mmu_map_section(table_addr->paddress +
-								sections * MB,
-								table_addr->vaddress +
-								sections * MB,
-								table_addr->flags);
-		}
+		arm_mmu_map_range(table_addr->paddress,
+						  table_addr->vaddress,
+						  table_addr->num_of_sections,
+						  table_addr->flags);
 		table_addr++;
 	}
 
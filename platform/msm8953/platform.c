@@ -122,17 +122,12 @@ int platform_use_identity_mmu_mappings(void)
 void platform_init_mmu_mappings(void)
 {
 	uint32_t i;
-	uint32_t sections;
 	uint32_t table_size = ARRAY_SIZE(mmu_section_table);
 	uint32_t ddr_start = DDR_START;
 	uint32_t smem_addr = platform_get_smem_base_addr();
 
 	/*Mapping the ddr start address for loading the kernel about 90 MB*/
-	sections = 90;
-	while(sections--)
-	{
-		arm_mmu_map_section(ddr_start + sections * MB, ddr_start + sections* MB, COMMON_MEMORY);
-	}
+	arm_mmu_map_range(ddr_start, ddr_start, 90, COMMON_MEMORY);
 
 
 	/* Mapping the SMEM addr */
@@ -142,16 +137,10 @@ void platform_init_mmu_mappings(void)
 	   mmu_section_table */
 	for (i = 0; i < table_size; i++)
 	{
-		sections = mmu_section_table[i].num_of_sections;
-
-		while (sections--)
-		{
-			arm_mmu_map_section(mmu_section_table[i].paddress +
-								sections * MB,
-								mmu_section_table[i].vaddress +
-								sections * MB,
-								mmu_section_table[i].flags);
-		}
+		arm_mmu_map_range(mmu_section_table[i].paddress,
+						  mmu_section_table[i].vaddress,
+						  mmu_section_table[i].num_of_sections,
+						  mmu_section_table[i].flags);
 	}
 }
 
@@ -10,9 +10,14 @@ DEFINES += ARM_CORE_V8
 MMC_SLOT         := 1
 
 DEFINES += PERIPH_BLK_BLSP=1
+DEFINES += PLATFORM_HAS_DYNAMIC_TIMER=1
 DEFINES += WITH_CPU_EARLY_INIT=0 WITH_CPU_WARM_BOOT=0 \
            MMC_SLOT=$(MMC_SLOT) SSD_ENABLE
 
+ifeq ($(ENABLE_SMP),1)
+DEFINES += WITH_SMP=1 SMP_MAX_CPUS=8 SMP_CPUS_PER_CLUSTER=4
+endif
+
 INCLUDES += -I$(LOCAL_DIR)/include -I$(LK_TOP_DIR)/platform/msm_shared/include
 
 DEVS += fbcon
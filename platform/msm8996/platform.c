@@ -113,7 +113,6 @@ int platform_use_identity_mmu_mappings(void)
 /* Setup memory for this platform */
 void platform_init_mmu_mappings(void)
 {
-	int i;
 	int table_sz = ARRAY_SIZE(default_mmu_section_table);
 	mmu_section_t kernel_mmu_section_table;
 	uint64_t ddr_size = smem_get_ddr_size();
@@ -141,16 +140,12 @@ void platform_init_mmu_mappings(void)
 	arm_mmu_map_entry(&kernel_mmu_section_table);
 
 	/* Map default memory needed for lk , scratch, rpmb & iomap */
-	for (i = 0 ; i < table_sz; i++)
-		arm_mmu_map_entry(&default_mmu_section_table[i]);
+	arm_mmu_map_entries(default_mmu_section_table, table_sz);
 
 	if (scm_device_enter_dload())
 	{
 		/* TZ & Hyp memory can be mapped only while entering the download mode */
-		table_sz = ARRAY_SIZE(dload_mmu_section_table);
-
-		for (i = 0 ; i < table_sz; i++)
-			arm_mmu_map_entry(&dload_mmu_section_table[i]);
+		arm_mmu_map_entries(dload_mmu_section_table, ARRAY_SIZE(dload_mmu_section_table));
 	}
 }
 
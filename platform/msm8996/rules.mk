@@ -9,6 +9,7 @@ DEFINES += ARM_CPU_CORE_KRYO
 MMC_SLOT         := 1
 
 DEFINES += PERIPH_BLK_BLSP=1
+DEFINES += PLATFORM_HAS_DYNAMIC_TIMER=1
 DEFINES += WITH_CPU_EARLY_INIT=0 WITH_CPU_WARM_BOOT=0 \
 	   MMC_SLOT=$(MMC_SLOT)
 
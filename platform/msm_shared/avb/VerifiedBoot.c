@@ -40,6 +40,7 @@
 #include <err.h>
 #include <target.h>
 #include <libavb/avb_sha.h>
+#include <boot_stats.h>
 
 #ifndef DTB_PAD_SIZE
 #define DTB_PAD_SIZE            2048
@@ -438,6 +439,7 @@ static EFI_STATUS load_image_and_authVB2(bootinfo *Info)
 	const CHAR8 *BootSecurityLevelStr = NULL;
 	size_t BootSecurityLevelStrSize = 0;
 	INT32 BootSecurityLevel = 0;
+	struct bs_trace Trace;
 
 	HeaderVersion = Info->header_version;
 	Info->boot_state = RED;
@@ -498,9 +500,11 @@ static EFI_STATUS load_image_and_authVB2(bootinfo *Info)
 				AVB_HASHTREE_ERROR_MODE_RESTART :
 				AVB_HASHTREE_ERROR_MODE_EIO;
 
+	bs_trace_begin(&Trace, "avb_slot_verify");
 	Result = avb_slot_verify(Ops, RequestedPartition, SlotSuffix,
 				VerifyFlags, VerityFlags,
 				&SlotData);
+	bs_trace_end(&Trace);
 
 	if (AllowVerificationError && ResultShouldContinue(Result)) {
 		dprintf(CRITICAL, "State: Unlocked, AvbSlotVerify returned "
@@ -0,0 +1,140 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <string.h>
+#include <kernel/smp.h>
+#include "libavb/libavb.h"
+#include <libavb/avb_sha.h>
+#include "verifiedboot.h"
+
+#if WITH_LIB_CONSOLE
+#include <lib/console.h>
+
+#define AVB_HASH_TEST_IMAGES	4
+
+static const uint8_t avb_hash_test_salt[32] = {
+	0x8b, 0x31, 0x5e, 0x0d, 0x92, 0x4f, 0xc7, 0x16,
+	0x3a, 0xe0, 0x55, 0x79, 0x21, 0xbd, 0x08, 0x6c,
+	0xf3, 0x4a, 0x97, 0x1e, 0x60, 0xd2, 0x2b, 0x85,
+	0xc9, 0x04, 0x7e, 0xa3, 0x38, 0xef, 0x51, 0x1b
+};
+
+/* Runs avb_verify_hash_images() on images laid out as the preloaded
+ * ones are, behind a SALT_BUFF_OFFSET gap filled with junk, with
+ * different sizes so that with several cpus online some of them go to
+ * the secondaries. A corrupted copy of the last image must then fail.
+ */
+static int avb_hash_test(void)
+{
+	static const uint32_t sizes[AVB_HASH_TEST_IMAGES] = {
+		256 * 1024, 64 * 1024 + 7, 4096, 100 * 1024 + 3
+	};
+	uint8_t expected[AVB_HASH_TEST_IMAGES][AVB_SHA512_DIGEST_SIZE];
+	AvbHashImage images[AVB_HASH_TEST_IMAGES];
+	AvbSHA256Ctx sha256_ctx;
+	AvbSHA512Ctx sha512_ctx;
+	uint8_t *data;
+	unsigned n, i;
+	int failed = 0;
+
+	memset(images, 0, sizeof(images));
+
+	for (n = 0; n < AVB_HASH_TEST_IMAGES; n++) {
+		images[n].image_buf = malloc(SALT_BUFF_OFFSET + sizes[n]);
+		if (!images[n].image_buf) {
+			printf("out of memory\n");
+			failed++;
+			goto out;
+		}
+		memset(images[n].image_buf, 0xa5, SALT_BUFF_OFFSET);
+		data = ADD_SALT_BUFF_OFFSET(images[n].image_buf);
+		for (i = 0; i < sizes[n]; i++)
+			data[i] = (uint8_t)(i * 31 + n);
+
+		images[n].partition_name = "avb_hash_test";
+		images[n].image_size = sizes[n];
+		images[n].salt = avb_hash_test_salt;
+		images[n].salt_len = sizeof(avb_hash_test_salt);
+		images[n].digest = expected[n];
+		images[n].is_sha512 = (n == AVB_HASH_TEST_IMAGES - 1);
+
+		if (images[n].is_sha512) {
+			avb_sha512_init(&sha512_ctx);
+			avb_sha512_update(&sha512_ctx, avb_hash_test_salt,
+					  sizeof(avb_hash_test_salt));
+			avb_sha512_update(&sha512_ctx, data, sizes[n]);
+			memcpy(expected[n], avb_sha512_final(&sha512_ctx),
+			       AVB_SHA512_DIGEST_SIZE);
+			images[n].digest_len = AVB_SHA512_DIGEST_SIZE;
+		} else {
+			avb_sha256_init(&sha256_ctx);
+			avb_sha256_update(&sha256_ctx, avb_hash_test_salt,
+					  sizeof(avb_hash_test_salt));
+			avb_sha256_update(&sha256_ctx, data, sizes[n]);
+			memcpy(expected[n], avb_sha256_final(&sha256_ctx),
+			       AVB_SHA256_DIGEST_SIZE);
+			images[n].digest_len = AVB_SHA256_DIGEST_SIZE;
+		}
+	}
+
+	printf("avb_hash_test: %u cpus online\n", smp_cpus_online());
+
+	if (avb_verify_hash_images(images, AVB_HASH_TEST_IMAGES) !=
+	    AVB_SLOT_VERIFY_RESULT_OK) {
+		printf("avb_hash_test: good images rejected\n");
+		failed++;
+	}
+
+	data = ADD_SALT_BUFF_OFFSET(images[AVB_HASH_TEST_IMAGES - 1].image_buf);
+	data[sizes[AVB_HASH_TEST_IMAGES - 1] / 2] ^= 1;
+	if (avb_verify_hash_images(images, AVB_HASH_TEST_IMAGES) !=
+	    AVB_SLOT_VERIFY_RESULT_ERROR_VERIFICATION) {
+		printf("avb_hash_test: corrupted image accepted\n");
+		failed++;
+	}
+
+out:
+	for (n = 0; n < AVB_HASH_TEST_IMAGES; n++)
+		free(images[n].image_buf);
+
+	printf("avb_hash_test %s\n", failed ? "FAILED" : "passed");
+	return failed ? -1 : 0;
+}
+
+static int cmd_avb_hash_test(int argc, const cmd_args *argv)
+{
+	return avb_hash_test();
+}
+
+STATIC_COMMAND_START
+{ "avb_hash_test", "verify hash descriptor images on all cpus", &cmd_avb_hash_test },
+STATIC_COMMAND_END(avb_hash_test);
+
+#endif
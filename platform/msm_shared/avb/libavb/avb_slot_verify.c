@@ -59,6 +59,7 @@
 #include "avb_util.h"
 #include "avb_vbmeta_image.h"
 #include "avb_version.h"
+#include <kernel/smp.h>
 
 /* Maximum allow length (in bytes) of a partition name, including
  * ab_suffix.
@@ -97,13 +98,65 @@ static inline bool result_should_continue(AvbSlotVerifyResult result) {
   return false;
 }
 
+/* Hash descriptors are not checked as they are met. Their images are
+ * looked up while the vbmeta images are walked, chained ones included,
+ * and all of them are hashed together once the walk is done: SHA-512
+ * images, and SHA-256 ones other than the largest, on the secondary
+ * cores and the largest SHA-256 image on the crypto engine meanwhile.
+ */
+typedef struct {
+  struct smp_work work;
+  char part_name[PART_NAME_MAX_SIZE];
+  const char* found;
+  const uint8_t* salt;
+  uint32_t salt_len;
+  const uint8_t* expected_digest;
+  size_t digest_len;
+  bool is_sha512;
+  bool on_engine;
+  uint8_t* image_buf;
+  uint64_t image_size;
+  uint64_t hash_size;
+  uint8_t digest[AVB_SHA512_DIGEST_SIZE];
+} AvbHashJob;
+
+typedef struct {
+  AvbHashJob jobs[MAX_NUMBER_OF_LOADED_PARTITIONS];
+  size_t num_jobs;
+} AvbHashJobs;
+
+/* May run on a secondary core, so software hashing and nothing else.
+ * Like on the engine path, the image starts SALT_BUFF_OFFSET bytes into
+ * image_buf, the gap in front of it is reserved for the salt.
+ */
+static void hash_job_run(void* arg) {
+  AvbHashJob* job = (AvbHashJob*)arg;
+  const uint8_t* data = ADD_SALT_BUFF_OFFSET(job->image_buf);
+
+  if (job->is_sha512) {
+    AvbSHA512Ctx sha512_ctx;
+    avb_sha512_init(&sha512_ctx);
+    avb_sha512_update(&sha512_ctx, job->salt, job->salt_len);
+    avb_sha512_update(&sha512_ctx, data, job->hash_size);
+    avb_memcpy(job->digest, avb_sha512_final(&sha512_ctx),
+               AVB_SHA512_DIGEST_SIZE);
+  } else {
+    AvbSHA256Ctx sha256_ctx;
+    avb_sha256_init(&sha256_ctx);
+    avb_sha256_update(&sha256_ctx, job->salt, job->salt_len);
+    avb_sha256_update(&sha256_ctx, data, job->hash_size);
+    avb_memcpy(job->digest, avb_sha256_final(&sha256_ctx),
+               AVB_SHA256_DIGEST_SIZE);
+  }
+}
+
 static AvbSlotVerifyResult load_and_verify_hash_partition(
     AvbOps* ops,
     const char* const* requested_partitions,
     const char* ab_suffix,
     bool allow_verification_error,
     const AvbDescriptor* descriptor,
-    AvbSlotVerifyData* slot_data) {
+    AvbHashJobs* hash_jobs) {
   AvbHashDescriptor hash_desc;
   const uint8_t* desc_partition_name = NULL;
   const uint8_t* desc_salt;
@@ -113,10 +166,11 @@ static AvbSlotVerifyResult load_and_verify_hash_partition(
   AvbIOResult io_ret;
   uint8_t* image_buf = NULL;
   size_t part_num_read;
-  uint8_t* digest = NULL;
   size_t digest_len;
+  bool is_sha512;
   const char* found = NULL;
   uint64_t image_size;
+  AvbHashJob* job;
 
   if (!avb_hash_descriptor_validate_and_byteswap(
           (const AvbHashDescriptor*)descriptor, &hash_desc)) {
@@ -156,6 +210,38 @@ static AvbSlotVerifyResult load_and_verify_hash_partition(
     goto out;
   }
 
+  if (avb_strncmp((const char*)hash_desc.hash_algorithm, "sha256",
+                  avb_strlen ("sha256")) == 0) {
+    if (hash_desc.salt_len > SALT_BUFF_OFFSET) {
+      avb_errorv(part_name, ": Salt does not fit before the image\n", NULL);
+      ret = AVB_SLOT_VERIFY_RESULT_ERROR_IO;
+      goto out;
+    }
+    is_sha512 = false;
+    digest_len = AVB_SHA256_DIGEST_SIZE;
+  } else if (avb_strncmp((const char*)hash_desc.hash_algorithm, "sha512",
+                  avb_strlen ("sha512")) == 0) {
+    is_sha512 = true;
+    digest_len = AVB_SHA512_DIGEST_SIZE;
+  } else {
+    avb_errorv(part_name, ": Unsupported hash algorithm.\n", NULL);
+    ret = AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_METADATA;
+    goto out;
+  }
+
+  if (digest_len != hash_desc.digest_len) {
+    avb_errorv(
+        part_name, ": Digest in descriptor not of expected size.\n", NULL);
+    ret = AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_METADATA;
+    goto out;
+  }
+
+  if (hash_jobs->num_jobs == MAX_NUMBER_OF_LOADED_PARTITIONS) {
+    avb_errorv(part_name, ": Too many loaded partitions.\n", NULL);
+    ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
+    goto out;
+  }
+
   /* If we're allowing verification errors then hash_desc.image_size
    * may no longer match what's in the partition... so in this case
    * just load the entire partition.
@@ -203,85 +289,120 @@ static AvbSlotVerifyResult load_and_verify_hash_partition(
     goto out;
   }
 
-  if (avb_strncmp((const char*)hash_desc.hash_algorithm, "sha256",
-                  avb_strlen ("sha256")) == 0) {
-    uint32_t complete_len = hash_desc.salt_len + hash_desc.image_size;
-    digest = avb_malloc(AVB_SHA256_DIGEST_SIZE);
-    if(digest == NULL || hash_desc.salt_len > SALT_BUFF_OFFSET )
-    {
-        avb_errorv(part_name, ": Failed to allocate memory\n", NULL);
-        ret = AVB_SLOT_VERIFY_RESULT_ERROR_IO;
-        goto out;
-    }
-    image_buf = ADD_SALT_BUFF_OFFSET(image_buf) - hash_desc.salt_len;
-    avb_memcpy(image_buf, desc_salt, hash_desc.salt_len);
-    hash_find(image_buf, complete_len, digest, CRYPTO_AUTH_ALG_SHA256);
-    image_buf = SUB_SALT_BUFF_OFFSET(image_buf) +  hash_desc.salt_len;
-    digest_len = AVB_SHA256_DIGEST_SIZE;
-  } else if (avb_strncmp((const char*)hash_desc.hash_algorithm, "sha512",
-                  avb_strlen ("sha512")) == 0) {
-    AvbSHA512Ctx sha512_ctx;
-    uint8_t *dig;
-    digest = avb_malloc(AVB_SHA512_DIGEST_SIZE);
-    if(digest == NULL)
-    {
-        avb_errorv(part_name, ": Failed to allocate memory\n", NULL);
-        ret = AVB_SLOT_VERIFY_RESULT_ERROR_IO;
-        goto out;
+  /* The descriptor stays valid with its vbmeta image in slot_data. */
+  job = &hash_jobs->jobs[hash_jobs->num_jobs++];
+  avb_memcpy(job->part_name, part_name, sizeof part_name);
+  job->found = found;
+  job->salt = desc_salt;
+  job->salt_len = hash_desc.salt_len;
+  job->expected_digest = desc_digest;
+  job->digest_len = digest_len;
+  job->is_sha512 = is_sha512;
+  job->image_buf = image_buf;
+  job->image_size = image_size;
+  job->hash_size = hash_desc.image_size;
+
+  ret = AVB_SLOT_VERIFY_RESULT_OK;
+
+out:
+  //remove avb_free() as memory allocated from scratch region
+  return ret;
+}
+
+/* Hashes every queued image and checks it against its descriptor. The
+ * images are handed to slot_data in descriptor order, as they were
+ * when each one was verified on its own.
+ */
+static AvbSlotVerifyResult verify_hash_jobs(AvbHashJobs* hash_jobs,
+                                            bool allow_verification_error,
+                                            AvbSlotVerifyData* slot_data) {
+  AvbSlotVerifyResult ret = AVB_SLOT_VERIFY_RESULT_OK;
+  AvbHashJob* engine_job = NULL;
+  size_t n;
+
+  /* Without spare cores everything SHA-256 goes to the crypto engine. */
+  for (n = 0; n < hash_jobs->num_jobs; n++) {
+    AvbHashJob* job = &hash_jobs->jobs[n];
+
+    if (job->is_sha512)
+      continue;
+    if (smp_cpus_online() < 2) {
+      job->on_engine = true;
+    } else if (engine_job == NULL || job->hash_size > engine_job->hash_size) {
+      if (engine_job != NULL)
+        engine_job->on_engine = false;
+      job->on_engine = true;
+      engine_job = job;
     }
-    avb_sha512_init(&sha512_ctx);
-    avb_sha512_update(&sha512_ctx, desc_salt, hash_desc.salt_len);
-    avb_sha512_update(&sha512_ctx, image_buf, hash_desc.image_size);
-    dig = avb_sha512_final(&sha512_ctx);
-    digest_len = AVB_SHA512_DIGEST_SIZE;
-    avb_memcpy(digest, dig, AVB_SHA512_DIGEST_SIZE);
-  } else {
-    avb_errorv(part_name, ": Unsupported hash algorithm.\n", NULL);
-    ret = AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_METADATA;
-    goto out;
   }
 
-  if (digest_len != hash_desc.digest_len) {
-    avb_errorv(
-        part_name, ": Digest in descriptor not of expected size.\n", NULL);
-    ret = AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_METADATA;
-    goto out;
-  }
+  for (n = 0; n < hash_jobs->num_jobs; n++) {
+    AvbHashJob* job = &hash_jobs->jobs[n];
 
-  if (avb_safe_memcmp(digest, desc_digest, digest_len) != 0) {
-    avb_errorv(part_name,
-               ": Hash of data does not match digest in descriptor.\n",
-               NULL);
-    ret = AVB_SLOT_VERIFY_RESULT_ERROR_VERIFICATION;
-    goto out;
-  } else {
-    avb_debugv(part_name, ": success: Image verification completed.\n", NULL);
+    if (!job->on_engine) {
+      smp_work_init(&job->work, hash_job_run, job);
+      smp_work_queue(&job->work);
+    }
   }
 
-  ret = AVB_SLOT_VERIFY_RESULT_OK;
+  for (n = 0; n < hash_jobs->num_jobs; n++) {
+    AvbHashJob* job = &hash_jobs->jobs[n];
+    uint8_t* buf;
 
-out:
-  if (digest)
-    avb_free(digest);
-  /* If it worked and something was loaded, copy to slot_data. */
-  if ((ret == AVB_SLOT_VERIFY_RESULT_OK || result_should_continue(ret)) &&
-      image_buf != NULL) {
+    if (!job->on_engine)
+      continue;
+    buf = ADD_SALT_BUFF_OFFSET(job->image_buf) - job->salt_len;
+    avb_memcpy(buf, job->salt, job->salt_len);
+    hash_find(buf, job->salt_len + job->hash_size, job->digest,
+              CRYPTO_AUTH_ALG_SHA256);
+  }
+
+  for (n = 0; n < hash_jobs->num_jobs; n++) {
+    AvbHashJob* job = &hash_jobs->jobs[n];
+    AvbSlotVerifyResult sub_ret = AVB_SLOT_VERIFY_RESULT_OK;
     AvbPartitionData* loaded_partition;
+
+    if (!job->on_engine)
+      smp_work_wait(&job->work);
+
+    if (avb_safe_memcmp(job->digest, job->expected_digest,
+                        job->digest_len) != 0) {
+      avb_errorv(job->part_name,
+                 ": Hash of data does not match digest in descriptor.\n",
+                 NULL);
+      sub_ret = AVB_SLOT_VERIFY_RESULT_ERROR_VERIFICATION;
+    } else {
+      avb_debugv(job->part_name,
+                 ": success: Image verification completed.\n", NULL);
+    }
+
     if (slot_data->num_loaded_partitions == MAX_NUMBER_OF_LOADED_PARTITIONS) {
-      avb_errorv(part_name, ": Too many loaded partitions.\n", NULL);
-      ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
-      goto fail;
+      avb_errorv(job->part_name, ": Too many loaded partitions.\n", NULL);
+      sub_ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
+    } else {
+      loaded_partition =
+          &slot_data->loaded_partitions[slot_data->num_loaded_partitions++];
+      loaded_partition->partition_name = avb_strdup(job->found);
+      loaded_partition->data_size = job->image_size;
+      loaded_partition->data = job->image_buf;
+    }
+
+    if (sub_ret != AVB_SLOT_VERIFY_RESULT_OK) {
+      ret = sub_ret;
+      if (!allow_verification_error || !result_should_continue(ret)) {
+        n++;
+        break;
+      }
     }
-    loaded_partition =
-        &slot_data->loaded_partitions[slot_data->num_loaded_partitions++];
-    loaded_partition->partition_name = avb_strdup(found);
-    loaded_partition->data_size = image_size;
-    loaded_partition->data = image_buf;
-    image_buf = NULL;
   }
 
-fail:
-  //remove avb_free() as memory allocated from scratch region
+  /* Nothing may still be hashing into a job once they are dropped. */
+  for (; n < hash_jobs->num_jobs; n++) {
+    if (!hash_jobs->jobs[n].on_engine)
+      smp_work_wait(&hash_jobs->jobs[n].work);
+  }
+  hash_jobs->num_jobs = 0;
+
   return ret;
 }
 
@@ -379,6 +500,7 @@ static AvbSlotVerifyResult load_and_verify_vbmeta(
     const uint8_t* expected_public_key,
     size_t expected_public_key_length,
     AvbSlotVerifyData* slot_data,
+    AvbHashJobs* hash_jobs,
     AvbAlgorithmType* out_algorithm_type) {
   char full_partition_name[PART_NAME_MAX_SIZE];
   AvbSlotVerifyResult ret;
@@ -533,6 +655,7 @@ static AvbSlotVerifyResult load_and_verify_vbmeta(
                                    NULL /* expected_public_key */,
                                    0 /* expected_public_key_length */,
                                    slot_data,
+                                   hash_jobs,
                                    out_algorithm_type);
       goto out;
     } else {
@@ -795,7 +918,7 @@ static AvbSlotVerifyResult load_and_verify_vbmeta(
                                                  ab_suffix,
                                                  allow_verification_error,
                                                  descriptors[n],
-                                                 slot_data);
+                                                 hash_jobs);
         if (sub_ret != AVB_SLOT_VERIFY_RESULT_OK) {
           ret = sub_ret;
           if (!allow_verification_error || !result_should_continue(ret)) {
@@ -853,6 +976,7 @@ static AvbSlotVerifyResult load_and_verify_vbmeta(
                                          chain_public_key,
                                          chain_desc.public_key_len,
                                          slot_data,
+                                         hash_jobs,
                                          NULL /* out_algorithm_type */);
         if (sub_ret != AVB_SLOT_VERIFY_RESULT_OK) {
           ret = sub_ret;
@@ -1406,6 +1530,7 @@ AvbSlotVerifyResult avb_slot_verify(AvbOps* ops,
                                     AvbSlotVerifyData** out_data) {
   AvbSlotVerifyResult ret;
   AvbSlotVerifyData* slot_data = NULL;
+  AvbHashJobs* hash_jobs = NULL;
   AvbAlgorithmType algorithm_type = AVB_ALGORITHM_TYPE_NONE;
   bool using_boot_for_vbmeta = false;
   AvbVBMetaImageHeader toplevel_vbmeta;
@@ -1466,6 +1591,11 @@ AvbSlotVerifyResult avb_slot_verify(AvbOps* ops,
     ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
     goto fail;
   }
+  hash_jobs = avb_calloc(sizeof(AvbHashJobs));
+  if (hash_jobs == NULL) {
+    ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
+    goto fail;
+  }
 
   if (flags & AVB_SLOT_VERIFY_FLAGS_NO_VBMETA_PARTITION) {
     if (requested_partitions == NULL || requested_partitions[0] == NULL) {
@@ -1490,6 +1620,7 @@ AvbSlotVerifyResult avb_slot_verify(AvbOps* ops,
                                    NULL /* expected_public_key */,
                                    0 /* expected_public_key_length */,
                                    slot_data,
+                                   hash_jobs,
                                    &algorithm_type);
       if (!allow_verification_error && ret != AVB_SLOT_VERIFY_RESULT_OK) {
         goto fail;
@@ -1510,6 +1641,7 @@ AvbSlotVerifyResult avb_slot_verify(AvbOps* ops,
                                  NULL /* expected_public_key */,
                                  0 /* expected_public_key_length */,
                                  slot_data,
+                                 hash_jobs,
                                  &algorithm_type);
     if (!allow_verification_error && ret != AVB_SLOT_VERIFY_RESULT_OK) {
       goto fail;
@@ -1519,6 +1651,21 @@ AvbSlotVerifyResult avb_slot_verify(AvbOps* ops,
   if (!result_should_continue(ret)) {
     goto fail;
   }
+
+  /* All vbmeta images are in, hash the images they describe. */
+  if (hash_jobs->num_jobs > 0) {
+    AvbSlotVerifyResult sub_ret;
+    sub_ret = verify_hash_jobs(hash_jobs, allow_verification_error, slot_data);
+    if (sub_ret != AVB_SLOT_VERIFY_RESULT_OK) {
+      ret = sub_ret;
+      if (!allow_verification_error || !result_should_continue(ret)) {
+        goto fail;
+      }
+    }
+  }
+  avb_free(hash_jobs);
+  hash_jobs = NULL;
+
   /* If things check out, mangle the kernel command-line as needed. */
   if (!(flags & AVB_SLOT_VERIFY_FLAGS_NO_VBMETA_PARTITION)) {
     if (avb_strcmp(slot_data->vbmeta_images[0].partition_name, "vbmeta") != 0) {
@@ -1605,6 +1752,9 @@ AvbSlotVerifyResult avb_slot_verify(AvbOps* ops,
   return ret;
 
 fail:
+  if (hash_jobs != NULL) {
+    avb_free(hash_jobs);
+  }
   if (slot_data != NULL) {
     avb_slot_verify_data_free(slot_data);
   }
@@ -1689,3 +1839,60 @@ const char* avb_slot_verify_result_to_string(AvbSlotVerifyResult result) {
 
   return ret;
 }
+
+AvbSlotVerifyResult avb_verify_hash_images(const AvbHashImage* images,
+                                           size_t num_images) {
+  AvbSlotVerifyResult ret = AVB_SLOT_VERIFY_RESULT_ERROR_OOM;
+  AvbHashJobs* hash_jobs = NULL;
+  AvbSlotVerifyData* slot_data = NULL;
+  size_t n;
+
+  if (num_images > MAX_NUMBER_OF_LOADED_PARTITIONS)
+    return AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_ARGUMENT;
+
+  hash_jobs = avb_calloc(sizeof(AvbHashJobs));
+  slot_data = avb_calloc(sizeof(AvbSlotVerifyData));
+  if (hash_jobs == NULL || slot_data == NULL)
+    goto out;
+  slot_data->loaded_partitions = avb_calloc(sizeof(AvbPartitionData) *
+                                            MAX_NUMBER_OF_LOADED_PARTITIONS);
+  if (slot_data->loaded_partitions == NULL)
+    goto out;
+
+  for (n = 0; n < num_images; n++) {
+    const AvbHashImage* image = &images[n];
+    AvbHashJob* job = &hash_jobs->jobs[n];
+
+    if (!avb_str_concat(job->part_name, sizeof job->part_name,
+                        image->partition_name,
+                        avb_strlen(image->partition_name), "", 0) ||
+        image->digest_len != (image->is_sha512 ? AVB_SHA512_DIGEST_SIZE
+                                               : AVB_SHA256_DIGEST_SIZE) ||
+        (!image->is_sha512 && image->salt_len > SALT_BUFF_OFFSET)) {
+      ret = AVB_SLOT_VERIFY_RESULT_ERROR_INVALID_ARGUMENT;
+      goto out;
+    }
+    job->found = image->partition_name;
+    job->salt = image->salt;
+    job->salt_len = image->salt_len;
+    job->expected_digest = image->digest;
+    job->digest_len = image->digest_len;
+    job->is_sha512 = image->is_sha512;
+    job->image_buf = image->image_buf;
+    job->image_size = image->image_size;
+    job->hash_size = image->image_size;
+  }
+  hash_jobs->num_jobs = num_images;
+
+  ret = verify_hash_jobs(hash_jobs, false, slot_data);
+
+out:
+  if (slot_data != NULL && slot_data->loaded_partitions != NULL) {
+    for (n = 0; n < slot_data->num_loaded_partitions; n++)
+      avb_free(slot_data->loaded_partitions[n].partition_name);
+    avb_free(slot_data->loaded_partitions);
+  }
+  avb_free(slot_data);
+  avb_free(hash_jobs);
+  return ret;
+}
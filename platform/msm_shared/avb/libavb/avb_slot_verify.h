@@ -352,6 +352,30 @@ AvbSlotVerifyResult avb_slot_verify(AvbOps* ops,
                                     AvbHashtreeErrorMode hashtree_error_mode,
                                     AvbSlotVerifyData** out_data);
 
+/* An image for avb_verify_hash_images(), with the hash descriptor
+ * fields it is checked against. |image_buf| is laid out like the
+ * partitions avb_slot_verify() loads: the |image_size| bytes of data
+ * start SALT_BUFF_OFFSET bytes in and the gap in front is scratch.
+ */
+typedef struct {
+  const char* partition_name;
+  uint8_t* image_buf;
+  uint64_t image_size;
+  const uint8_t* salt;
+  uint32_t salt_len;
+  const uint8_t* digest;
+  size_t digest_len;
+  bool is_sha512;
+} AvbHashImage;
+
+/* Hashes |num_images| images the way avb_slot_verify() hashes the ones
+ * named by hash descriptors, spread over the crypto engine and any
+ * secondary cores, and checks each against its digest. The images stay
+ * owned by the caller. Returns AVB_SLOT_VERIFY_RESULT_OK if all match.
+ */
+AvbSlotVerifyResult avb_verify_hash_images(const AvbHashImage* images,
+                                           size_t num_images);
+
 #ifdef __cplusplus
 }
 #endif
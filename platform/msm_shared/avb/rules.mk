@@ -23,3 +23,4 @@ OBJS += $(LOCAL_DIR)/libavb/avb_chain_partition_descriptor.o \
 		$(LOCAL_DIR)/libavb/avb_util.o \
 		$(LOCAL_DIR)/libavb/avb_version.o \
 		$(LOCAL_DIR)/VerifiedBoot.o \
+		$(LOCAL_DIR)/avb_hash_test.o \
@@ -31,6 +31,12 @@
 #include <reg.h>
 #include <platform/iomap.h>
 #include <platform.h>
+#include <qtimer.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <compiler.h>
+#include <kernel/thread.h>
 
 static uint32_t kernel_load_start;
 void bs_set_timestamp(enum bs_entry bs_id)
@@ -75,3 +81,208 @@ void bs_set_timestamp(enum bs_entry bs_id)
 		}
 	}
 }
+
+/* Largest trace clock count, deltas wrap at this */
+static uint64_t bs_trace_cnt_max = QTMR_PHY_CNT_MAX_VALUE;
+
+/* Platforms without a qtimer fall back on the 32 bit sleep clock for the
+ * trace, which wraps much earlier than the 56 bit qtimer.
+ */
+__WEAK uint64_t qtimer_get_phy_timer_cnt()
+{
+	bs_trace_cnt_max = 0xFFFFFFFF;
+	return platform_get_sclk_count();
+}
+
+__WEAK uint32_t qtimer_tick_rate()
+{
+	return 32768;
+}
+
+static struct bs_trace_span bs_trace_ring[BS_TRACE_RING_SIZE];
+static uint32_t bs_trace_head;          /* Spans ever completed */
+static struct bs_trace_phase bs_trace_phases[BS_TRACE_MAX_PHASES];
+static uint32_t bs_trace_num_phases;
+static uint32_t bs_trace_lost;          /* Spans whose phase did not fit */
+
+static const char *bs_trace_hist_name[BS_TRACE_HIST_BUCKETS] = {
+	"<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s",
+};
+
+void bs_trace_begin(struct bs_trace *t, const char *name)
+{
+	t->name = name;
+	t->start = qtimer_get_phy_timer_cnt();
+}
+
+uint64_t bs_trace_ticks_to_us(uint64_t ticks)
+{
+	uint32_t rate = qtimer_tick_rate();
+
+	if (!rate)
+		return 0;
+
+	return (ticks * 1000000) / rate;
+}
+
+static struct bs_trace_phase *bs_trace_find_phase(const char *name)
+{
+	uint32_t i;
+
+	for (i = 0; i < bs_trace_num_phases; i++) {
+		if (bs_trace_phases[i].name == name ||
+			!strcmp(bs_trace_phases[i].name, name))
+			return &bs_trace_phases[i];
+	}
+
+	if (bs_trace_num_phases == BS_TRACE_MAX_PHASES)
+		return NULL;
+
+	bs_trace_phases[bs_trace_num_phases].name = name;
+	return &bs_trace_phases[bs_trace_num_phases++];
+}
+
+void bs_trace_end(struct bs_trace *t)
+{
+	uint64_t end = qtimer_get_phy_timer_cnt();
+	uint64_t delta = (end - t->start) & bs_trace_cnt_max;
+	uint64_t us = bs_trace_ticks_to_us(delta);
+	struct bs_trace_span *span;
+	struct bs_trace_phase *phase;
+	uint32_t bucket = 0;
+
+	while (bucket < BS_TRACE_HIST_BUCKETS - 1 && us >= 10) {
+		us /= 10;
+		bucket++;
+	}
+
+	enter_critical_section();
+
+	span = &bs_trace_ring[bs_trace_head++ % BS_TRACE_RING_SIZE];
+	span->name = t->name;
+	span->start = t->start;
+	span->end = end;
+
+	phase = bs_trace_find_phase(t->name);
+	if (phase) {
+		phase->count++;
+		phase->total += delta;
+		if (delta > phase->max)
+			phase->max = delta;
+		phase->hist[bucket]++;
+	} else {
+		bs_trace_lost++;
+	}
+
+	exit_critical_section();
+}
+
+bool bs_trace_get_phase(unsigned idx, struct bs_trace_phase *out)
+{
+	bool ret = false;
+
+	enter_critical_section();
+	if (idx < bs_trace_num_phases) {
+		memcpy(out, &bs_trace_phases[idx], sizeof(*out));
+		ret = true;
+	}
+	exit_critical_section();
+
+	return ret;
+}
+
+/* snprintf that keeps appending at buf + *pos and never runs past len */
+static void bs_trace_printf(char *buf, unsigned len, unsigned *pos,
+	const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	if (*pos + 1 >= len)
+		return;
+
+	va_start(ap, fmt);
+	n = vsnprintf(buf + *pos, len - *pos, fmt, ap);
+	va_end(ap);
+
+	if (n < 0)
+		return;
+	*pos += MIN((unsigned)n, len - *pos - 1);
+}
+
+unsigned bs_trace_dump(char *buf, unsigned len)
+{
+	struct bs_trace_phase phase;
+	struct bs_trace_span span;
+	unsigned pos = 0;
+	uint32_t i, j, first, head;
+
+	if (!len)
+		return 0;
+	buf[0] = '\0';
+
+	bs_trace_printf(buf, len, &pos, "# phase count total_us max_us");
+	for (j = 0; j < BS_TRACE_HIST_BUCKETS; j++)
+		bs_trace_printf(buf, len, &pos, " %s", bs_trace_hist_name[j]);
+	bs_trace_printf(buf, len, &pos, "\n");
+
+	for (i = 0; bs_trace_get_phase(i, &phase); i++) {
+		bs_trace_printf(buf, len, &pos, "%s %u %llu %llu", phase.name,
+			phase.count, bs_trace_ticks_to_us(phase.total),
+			bs_trace_ticks_to_us(phase.max));
+		for (j = 0; j < BS_TRACE_HIST_BUCKETS; j++)
+			bs_trace_printf(buf, len, &pos, " %u", phase.hist[j]);
+		bs_trace_printf(buf, len, &pos, "\n");
+	}
+	if (bs_trace_lost)
+		bs_trace_printf(buf, len, &pos, "# %u spans had no phase slot\n",
+			bs_trace_lost);
+
+	head = bs_trace_head;
+	first = head > BS_TRACE_RING_SIZE ? head - BS_TRACE_RING_SIZE : 0;
+	bs_trace_printf(buf, len, &pos, "# span start_us duration_us (%u of %u)\n",
+		head - first, head);
+	for (i = first; i < head; i++) {
+		enter_critical_section();
+		memcpy(&span, &bs_trace_ring[i % BS_TRACE_RING_SIZE], sizeof(span));
+		exit_critical_section();
+		bs_trace_printf(buf, len, &pos, "%s %llu %llu\n", span.name,
+			bs_trace_ticks_to_us(span.start),
+			bs_trace_ticks_to_us((span.end - span.start) & bs_trace_cnt_max));
+	}
+
+	return pos;
+}
+
+unsigned bs_trace_summary(char *buf, unsigned len)
+{
+	static const char prefix[] = " lk.boot_trace=";
+	struct bs_trace_phase phase;
+	char entry[64];
+	unsigned pos;
+	unsigned n;
+	uint32_t i;
+
+	if (len < sizeof(prefix))
+		return 0;
+
+	memcpy(buf, prefix, sizeof(prefix));
+	pos = sizeof(prefix) - 1;
+
+	/* Whole phases only: stop at the first one that does not fit */
+	for (i = 0; bs_trace_get_phase(i, &phase); i++) {
+		n = snprintf(entry, sizeof(entry), "%s%s:%llu/%u", i ? "," : "",
+			phase.name, bs_trace_ticks_to_us(phase.total), phase.count);
+		if (pos + n + 1 > len)
+			break;
+		memcpy(buf + pos, entry, n + 1);
+		pos += n;
+	}
+
+	if (!i) {
+		buf[0] = '\0';
+		return 0;
+	}
+
+	return pos;
+}
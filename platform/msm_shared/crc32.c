@@ -27,7 +27,20 @@
  */
 
 #include <stdlib.h>
-#include <debug.h>
+#include <crc32.h>
+#include <arch/defines.h>
+#include <kernel/spinlock.h>
+#if ARM_ISA_ARMV7
+#include <arch/arm.h>
+#endif
+
+/*
+ * Slice-by-8 CRC32 (IEEE 802.3, reflected 0xedb88320), shared by GPT
+ * parsing, A/B metadata, UBI and libavb. crc32_table is the classic byte
+ * table; crc32_slice[k] advances a byte through k further zero bytes so
+ * eight input bytes fold in with one round of lookups. On ARMv8 cores
+ * running AArch32 the CRC32 instructions are used when ID_ISAR5 says so.
+ */
 
 static
 const uint32_t crc32_table[256] = {
@@ -85,11 +98,102 @@ const uint32_t crc32_table[256] = {
 	0x2d02ef8dL
 };
 
-uint32_t crc32(uint32_t crc, const void *buf, size_t size)
+static uint32_t crc32_slice[7][256];
+static volatile bool crc32_ready;
+static spin_lock_t crc32_lock = SPIN_LOCK_INITIAL_VALUE;
+
+#if ARM_ISA_ARMV7
+static int crc32_has_hw;
+#endif
+
+/*
+ * The first caller builds the slice tables and probes for the CRC32
+ * instructions; secondaries may hash images at the same time, so the
+ * setup runs once under crc32_lock and is published after a barrier.
+ */
+static void crc32_init(void)
+{
+	spin_lock_saved_state_t state;
+	uint32_t c;
+	int i, k;
+
+	spin_lock_irqsave(&crc32_lock, &state);
+
+	if (!crc32_ready) {
+		for (i = 0; i < 256; i++) {
+			c = crc32_table[i];
+			for (k = 0; k < 7; k++) {
+				c = crc32_table[c & 0xff] ^ (c >> 8);
+				crc32_slice[k][i] = c;
+			}
+		}
+#if ARM_ISA_ARMV7
+		crc32_has_hw = arm_has_crc32();
+#endif
+		dmb();
+		crc32_ready = true;
+	}
+
+	spin_unlock_irqrestore(&crc32_lock, state);
+}
+
+static inline void crc32_setup(void)
+{
+	if (!crc32_ready)
+		crc32_init();
+	/* pairs with the barrier before crc32_ready is set */
+	dmb();
+}
+
+uint32_t crc32_bytewise(uint32_t crc, const void *buf, size_t size)
+{
+	const uint8_t *p = buf;
+
+	while (size--)
+		crc = crc32_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+/* Little endian word loads: LK runs the ARM cores little endian */
+uint32_t crc32_slice8(uint32_t crc, const void *buf, size_t size)
 {
 	const uint8_t *p = buf;
+	uint32_t lo, hi;
+
+	crc32_setup();
+
+	while (size && ((uintptr_t)p & 3)) {
+		crc = crc32_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+		size--;
+	}
+
+	while (size >= 8) {
+		lo = *(const uint32_t *)p ^ crc;
+		hi = *(const uint32_t *)(p + 4);
+		crc = crc32_slice[6][lo & 0xff] ^
+		      crc32_slice[5][(lo >> 8) & 0xff] ^
+		      crc32_slice[4][(lo >> 16) & 0xff] ^
+		      crc32_slice[3][lo >> 24] ^
+		      crc32_slice[2][hi & 0xff] ^
+		      crc32_slice[1][(hi >> 8) & 0xff] ^
+		      crc32_slice[0][(hi >> 16) & 0xff] ^
+		      crc32_table[hi >> 24];
+		p += 8;
+		size -= 8;
+	}
 
 	while (size--)
 		crc = crc32_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
 	return crc;
 }
+
+uint32_t crc32(uint32_t crc, const void *buf, size_t size)
+{
+#if ARM_ISA_ARMV7
+	crc32_setup();
+
+	if (crc32_has_hw)
+		return arm_crc32_update(crc, buf, size);
+#endif
+	return crc32_slice8(crc, buf, size);
+}
@@ -380,6 +380,25 @@ crypto_get_digest(unsigned char *digest_ptr, unsigned int *ret_status,
 	return;
 }
 
+/*
+ * This engine is polled by the CPU, so there is nothing to overlap with:
+ * the "async" submit completes the transfer and the wait is a no-op.
+ */
+
+void
+crypto_send_data_async(void *ctx_ptr, unsigned char *data_ptr,
+		       unsigned int buff_size, unsigned int bytes_to_write,
+		       unsigned int *ret_status)
+{
+	crypto_send_data(ctx_ptr, data_ptr, buff_size, bytes_to_write,
+			 ret_status);
+}
+
+void crypto_wait_data(unsigned int *ret_status)
+{
+	*ret_status = CRYPTO_ERR_NONE;
+}
+
 /* Function to restore auth_bytecnt registers for ctx_ptr */
 
 void crypto_get_ctx(void *ctx_ptr)
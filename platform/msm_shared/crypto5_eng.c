@@ -472,9 +472,17 @@ static void crypto5_set_auth_cfg(struct crypto_dev *dev, uint8_t **buffer,
 	REG_WRITE_EXEC(&dev->bam, 1, CRYPTO_WRITE_PIPE_INDEX);
 }
 
-uint32_t crypto5_send_data(struct crypto_dev *dev,
-						   void *ctx_ptr,
-						   uint8_t *data_ptr)
+/* Function: crypto5_send_data_async
+ * Arg     : dev, ctx_ptr, data_ptr
+ * Return  : CRYPTO_ERR_NONE once the descriptors are queued.
+ * Flow    : Queues the data and the result dump descriptors on the BAM pipes
+ *           and returns without waiting for the engine. The caller must not
+ *           touch data_ptr or start another operation until
+ *           crypto5_wait_data() returns.
+ */
+uint32_t crypto5_send_data_async(struct crypto_dev *dev,
+								 void *ctx_ptr,
+								 uint8_t *data_ptr)
 {
 	uint32_t bam_status;
 	crypto_SHA256_ctx *sha256_ctx = (crypto_SHA256_ctx *) ctx_ptr;
@@ -518,19 +526,46 @@ uint32_t crypto5_send_data(struct crypto_dev *dev,
 		goto CRYPTO_SEND_DATA_ERR;
 	}
 
+	return CRYPTO_ERR_NONE;
+
+CRYPTO_SEND_DATA_ERR:
+
+	crypto5_unlock_pipes(dev);
+
+	return ret_status;
+}
+
+/* Function: crypto5_wait_data
+ * Arg     : dev
+ * Return  : CRYPTO_ERR_NONE
+ * Flow    : Waits for the descriptors queued by crypto5_send_data_async()
+ *           to be consumed and makes the result dump visible to the CPU.
+ */
+uint32_t crypto5_wait_data(struct crypto_dev *dev)
+{
 	crypto_wait_for_data(&dev->bam, CRYPTO_WRITE_PIPE_INDEX);
 
 	crypto_wait_for_data(&dev->bam, CRYPTO_READ_PIPE_INDEX);
 
 	arch_clean_invalidate_cache_range((addr_t) (dev->dump), sizeof(struct output_dump));
 
-	ret_status = CRYPTO_ERR_NONE;
+	crypto5_unlock_pipes(dev);
 
-CRYPTO_SEND_DATA_ERR:
+	return CRYPTO_ERR_NONE;
+}
 
-	crypto5_unlock_pipes(dev);
+uint32_t crypto5_send_data(struct crypto_dev *dev,
+						   void *ctx_ptr,
+						   uint8_t *data_ptr)
+{
+	uint32_t ret_status;
 
-	return ret_status;
+	ret_status = crypto5_send_data_async(dev, ctx_ptr, data_ptr);
+
+	if (ret_status != CRYPTO_ERR_NONE)
+		return ret_status;
+
+	return crypto5_wait_data(dev);
 }
 
 void crypto5_unlock_pipes(struct crypto_dev *dev)
@@ -100,6 +100,20 @@ void crypto_send_data(void *ctx_ptr,
 	*ret_status = crypto5_send_data(&dev, ctx_ptr, data_ptr);
 }
 
+void crypto_send_data_async(void *ctx_ptr,
+							unsigned char *data_ptr,
+							unsigned int buff_size,
+							unsigned int bytes_to_write,
+							unsigned int *ret_status)
+{
+	*ret_status = crypto5_send_data_async(&dev, ctx_ptr, data_ptr);
+}
+
+void crypto_wait_data(unsigned int *ret_status)
+{
+	*ret_status = crypto5_wait_data(&dev);
+}
+
 void crypto_get_digest(unsigned char *digest_ptr,
 					   unsigned int *ret_status,
 					   crypto_auth_alg_type auth_alg,
@@ -30,14 +30,33 @@
 #include <sha.h>
 #include <debug.h>
 #include <sys/types.h>
+#include <boot_stats.h>
+#include <lib/sha2.h>
 #include "crypto_hash.h"
 
 static crypto_SHA256_ctx g_sha256_ctx;
 static crypto_SHA1_ctx g_sha1_ctx;
 static bool crypto_init_done;
 
+/* State of the image currently being hashed while it loads. */
+static struct {
+	bool active;
+	bool pending;		/* a chunk is queued on the crypto engine */
+	crypto_auth_alg_type auth_alg;
+	crypto_engine_type ce_type;
+	unsigned char *addr;
+	unsigned int loaded;	/* bytes at addr filled in so far */
+	unsigned int hashed;	/* bytes at addr already fed to the hash */
+	crypto_SHA256_ctx ce_ctx;
+	struct sha256_ctx sw_sha256_ctx;
+	SHA_CTX sw_sha1_ctx;
+} hash_stream;
+
 extern void ce_clock_init(void);
 
+static bool hash_stream_finish(unsigned char *addr, unsigned int size,
+			       unsigned char *digest, unsigned char auth_alg);
+
 /*
  * Top level function which calculates SHAx digest with given data and size.
  * Digest varies based on the authentication algorithm.
@@ -50,6 +69,14 @@ hash_find(unsigned char *addr, unsigned int size, unsigned char *digest,
 {
 	crypto_result_type ret_val = CRYPTO_SHA_ERR_NONE;
 	crypto_engine_type platform_ce_type = board_ce_type();
+	struct bs_trace trace;
+
+	bs_trace_begin(&trace, "hash_find");
+
+	if (hash_stream_finish(addr, size, digest, auth_alg)) {
+		bs_trace_end(&trace);
+		return;
+	}
 
 	if (auth_alg == CRYPTO_AUTH_ALG_SHA1) {
 		if(platform_ce_type == CRYPTO_ENGINE_TYPE_SW)
@@ -62,7 +89,7 @@ hash_find(unsigned char *addr, unsigned int size, unsigned char *digest,
 	} else if (auth_alg == CRYPTO_AUTH_ALG_SHA256) {
 		if(platform_ce_type == CRYPTO_ENGINE_TYPE_SW)
 			/* Hardware CE is not present , use software hashing */
-			digest = SHA256(addr, size, digest);
+			sha256(addr, size, digest);
 		else if (platform_ce_type == CRYPTO_ENGINE_TYPE_HW)
 			ret_val = crypto_sha256(addr, size, digest);
 		else
@@ -74,6 +101,8 @@ hash_find(unsigned char *addr, unsigned int size, unsigned char *digest,
 	if (ret_val != CRYPTO_SHA_ERR_NONE) {
 		dprintf(CRITICAL, "crypto_sha256 returns error %d\n", ret_val);
 	}
+
+	bs_trace_end(&trace);
 }
 
 /*
@@ -405,3 +434,197 @@ calc_num_bytes_to_send(void *ctx_ptr, unsigned int buff_size, bool last)
 	}
 	return bytes_to_write;
 }
+
+/*
+ * Collects the result of the chunk queued on the crypto engine, if any.
+ * The intermediate digest and byte count go back into the stream context
+ * so the next chunk can continue from them.
+ */
+
+static crypto_result_type hash_stream_wait(void)
+{
+	unsigned int ret_val = CRYPTO_ERR_NONE;
+
+	if (!hash_stream.pending)
+		return CRYPTO_SHA_ERR_NONE;
+
+	hash_stream.pending = FALSE;
+
+	crypto_wait_data(&ret_val);
+
+	if (ret_val == CRYPTO_ERR_NONE)
+		crypto_get_digest((unsigned char *)(hash_stream.ce_ctx.auth_iv),
+				  &ret_val, hash_stream.auth_alg, FALSE);
+
+	if (ret_val != CRYPTO_ERR_NONE) {
+		dprintf(CRITICAL, "hash_stream: crypto engine error, dropping stream\n");
+		hash_stream.active = FALSE;
+		return CRYPTO_SHA_ERR_FAIL;
+	}
+
+	crypto_get_ctx(&hash_stream.ce_ctx);
+
+	return CRYPTO_SHA_ERR_NONE;
+}
+
+void hash_stream_begin(unsigned char *addr, unsigned char auth_alg)
+{
+	crypto_engine_type platform_ce_type = board_ce_type();
+
+	hash_stream_abort();
+
+	if ((auth_alg != CRYPTO_AUTH_ALG_SHA1 &&
+	     auth_alg != CRYPTO_AUTH_ALG_SHA256) ||
+	    (platform_ce_type != CRYPTO_ENGINE_TYPE_SW &&
+	     platform_ce_type != CRYPTO_ENGINE_TYPE_HW))
+		return;
+
+	hash_stream.auth_alg = auth_alg;
+	hash_stream.ce_type = platform_ce_type;
+	hash_stream.addr = addr;
+	hash_stream.loaded = 0;
+	hash_stream.hashed = 0;
+
+	if (platform_ce_type == CRYPTO_ENGINE_TYPE_SW) {
+		if (auth_alg == CRYPTO_AUTH_ALG_SHA1)
+			SHA1_Init(&hash_stream.sw_sha1_ctx);
+		else
+			sha256_init(&hash_stream.sw_sha256_ctx);
+	} else {
+		crypto_init();
+		if (auth_alg == CRYPTO_AUTH_ALG_SHA1)
+			crypto_sha1_init((crypto_SHA1_ctx *) &hash_stream.ce_ctx);
+		else
+			crypto_sha256_init(&hash_stream.ce_ctx);
+	}
+
+	hash_stream.active = TRUE;
+}
+
+void hash_stream_update(unsigned char *buf, unsigned int len)
+{
+	unsigned int ret_val = CRYPTO_ERR_NONE;
+	unsigned int max_blk;
+	unsigned int bytes;
+	unsigned int end;
+
+	if (!hash_stream.active || !len)
+		return;
+
+	if (buf != hash_stream.addr + hash_stream.loaded) {
+		dprintf(CRITICAL, "hash_stream: out of order update, dropping stream\n");
+		hash_stream_abort();
+		return;
+	}
+
+	hash_stream.loaded += len;
+
+	/* Hold back the last block (partial or not) for the final update */
+	end = (hash_stream.loaded - 1) & ~(CRYPTO_SHA_BLOCK_SIZE - 1);
+
+	if (end <= hash_stream.hashed)
+		return;
+
+	if (hash_stream.ce_type == CRYPTO_ENGINE_TYPE_SW) {
+		if (hash_stream.auth_alg == CRYPTO_AUTH_ALG_SHA1)
+			SHA1_Update(&hash_stream.sw_sha1_ctx,
+				    hash_stream.addr + hash_stream.hashed,
+				    end - hash_stream.hashed);
+		else
+			sha256_update(&hash_stream.sw_sha256_ctx,
+				      hash_stream.addr + hash_stream.hashed,
+				      end - hash_stream.hashed);
+		hash_stream.hashed = end;
+		return;
+	}
+
+	max_blk = crypto_get_max_auth_blk_size() & ~(CRYPTO_SHA_BLOCK_SIZE - 1);
+
+	while (hash_stream.hashed < end) {
+		if (hash_stream_wait() != CRYPTO_SHA_ERR_NONE)
+			return;
+
+		bytes = end - hash_stream.hashed;
+		if (bytes > max_blk)
+			bytes = max_blk;
+
+		crypto_set_sha_ctx(&hash_stream.ce_ctx, bytes,
+				   hash_stream.auth_alg,
+				   (hash_stream.hashed == 0), FALSE);
+
+		crypto_send_data_async(&hash_stream.ce_ctx,
+				       hash_stream.addr + hash_stream.hashed,
+				       bytes, bytes, &ret_val);
+
+		if (ret_val != CRYPTO_ERR_NONE) {
+			dprintf(CRITICAL, "hash_stream: crypto_send_data failed, dropping stream\n");
+			hash_stream.active = FALSE;
+			return;
+		}
+
+		hash_stream.pending = TRUE;
+		hash_stream.hashed += bytes;
+	}
+}
+
+void hash_stream_abort(void)
+{
+	hash_stream_wait();
+	hash_stream.active = FALSE;
+}
+
+/*
+ * Completes the stream if [addr, addr + size) is the streamed image,
+ * possibly with extra data appended after it. Returns FALSE when the
+ * caller has to hash the range itself.
+ */
+
+static bool hash_stream_finish(unsigned char *addr, unsigned int size,
+			       unsigned char *digest, unsigned char auth_alg)
+{
+	crypto_result_type ret_val;
+	unsigned char *tail;
+	unsigned int tail_len;
+
+	if (!hash_stream.active)
+		return FALSE;
+
+	/* The engine is shared, let the queued chunk finish first */
+	if (hash_stream_wait() != CRYPTO_SHA_ERR_NONE)
+		return FALSE;
+
+	if (addr != hash_stream.addr || auth_alg != hash_stream.auth_alg ||
+	    size < hash_stream.loaded)
+		return FALSE;
+
+	hash_stream.active = FALSE;
+
+	tail = addr + hash_stream.hashed;
+	tail_len = size - hash_stream.hashed;
+
+	if (hash_stream.ce_type == CRYPTO_ENGINE_TYPE_SW) {
+		if (auth_alg == CRYPTO_AUTH_ALG_SHA1) {
+			SHA1_Update(&hash_stream.sw_sha1_ctx, tail, tail_len);
+			SHA1_Final(digest, &hash_stream.sw_sha1_ctx);
+		} else {
+			sha256_update(&hash_stream.sw_sha256_ctx, tail, tail_len);
+			sha256_final(&hash_stream.sw_sha256_ctx, digest);
+		}
+		return TRUE;
+	}
+
+	crypto_init();
+
+	ret_val = do_sha_update(&hash_stream.ce_ctx, tail, tail_len, auth_alg,
+				(hash_stream.hashed == 0), TRUE);
+
+	if (ret_val != CRYPTO_SHA_ERR_NONE) {
+		dprintf(CRITICAL, "hash_stream: final update failed %d\n", ret_val);
+		return FALSE;
+	}
+
+	memcpy(digest, (unsigned char *)(hash_stream.ce_ctx.auth_iv),
+	       (auth_alg == CRYPTO_AUTH_ALG_SHA1) ? 20 : 32);
+
+	return TRUE;
+}
@@ -746,9 +746,146 @@ static void dt_entry_list_delete(struct dt_entry_node *dt_node_member)
 	}
 }
 
-static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_node *dtb_list)
+/* Root node properties dev_tree_compatible() looks at */
+struct dtb_root_props {
+	const void *model;
+	int model_len;
+	const void *msm_id;
+	int msm_id_len;
+	const void *board_id;
+	int board_id_len;
+	const void *pmic_id;
+	int pmic_id_len;
+};
+
+static uint32_t dtb_get_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static bool dtb_prop_name_is(const char *name, uint32_t max_len, const char *str)
+{
+	uint32_t len = strlen(str) + 1;
+
+	return len <= max_len && !memcmp(name, str, len);
+}
+
+/*
+ * Pick the root node properties in one pass over the structure block rather
+ * than a fdt_path_offset() and a separate fdt_getprop() walk for each one.
+ * The root properties all come before its first subnode, so the walk stops
+ * there. Returns -1 if the blob doesn't have the layout this relies on.
+ */
+static int dtb_scan_root_props(const void *dtb, struct dtb_root_props *props)
+{
+	const uint8_t *base = dtb;
+	const uint8_t *p, *end;
+	const char *strings, *name;
+	uint32_t size_strings;
+	uint32_t tag, len, nameoff;
+
+	/* size_dt_struct is only there from version 17 on */
+	if (fdt_version(dtb) < 17)
+		return -1;
+
+	p = base + fdt_off_dt_struct(dtb);
+	end = p + fdt_size_dt_struct(dtb);
+	strings = (const char *)base + fdt_off_dt_strings(dtb);
+	size_strings = fdt_size_dt_strings(dtb);
+
+	/* root node, its name is empty */
+	do {
+		if ((uint32_t)(end - p) < 2 * FDT_TAGSIZE)
+			return -1;
+		tag = dtb_get_be32(p);
+		p += FDT_TAGSIZE;
+	} while (tag == FDT_NOP);
+
+	if (tag != FDT_BEGIN_NODE || *p)
+		return -1;
+	p += FDT_TAGSIZE;
+
+	while ((uint32_t)(end - p) >= FDT_TAGSIZE) {
+		tag = dtb_get_be32(p);
+		p += FDT_TAGSIZE;
+
+		if (tag == FDT_NOP)
+			continue;
+		if (tag != FDT_PROP)
+			return 0;
+
+		if ((uint32_t)(end - p) < 2 * FDT_TAGSIZE)
+			return -1;
+		len = dtb_get_be32(p);
+		nameoff = dtb_get_be32(p + FDT_TAGSIZE);
+		p += 2 * FDT_TAGSIZE;
+
+		if (len > (uint32_t)(end - p) || nameoff >= size_strings)
+			return -1;
+
+		name = strings + nameoff;
+		if (dtb_prop_name_is(name, size_strings - nameoff, "model")) {
+			props->model = p;
+			props->model_len = len;
+		} else if (dtb_prop_name_is(name, size_strings - nameoff, "qcom,msm-id")) {
+			props->msm_id = p;
+			props->msm_id_len = len;
+		} else if (dtb_prop_name_is(name, size_strings - nameoff, "qcom,board-id")) {
+			props->board_id = p;
+			props->board_id_len = len;
+		} else if (dtb_prop_name_is(name, size_strings - nameoff, "qcom,pmic-id")) {
+			props->pmic_id = p;
+			props->pmic_id_len = len;
+		}
+
+		p += ROUNDUP(len, FDT_TAGSIZE);
+	}
+
+	return -1;
+}
+
+static int dtb_get_root_props(const void *dtb, struct dtb_root_props *props)
 {
 	int root_offset;
+
+	memset(props, 0, sizeof(*props));
+
+	/* both lookups below trust the block offsets and sizes */
+	if (fdt_check_header_ext(dtb))
+		return -1;
+
+	if (!dtb_scan_root_props(dtb, props))
+		return 0;
+
+	memset(props, 0, sizeof(*props));
+	root_offset = fdt_path_offset(dtb, "/");
+	if (root_offset < 0)
+		return -1;
+
+	props->model = fdt_getprop(dtb, root_offset, "model", &props->model_len);
+	props->msm_id = fdt_getprop(dtb, root_offset, "qcom,msm-id", &props->msm_id_len);
+	props->board_id = fdt_getprop(dtb, root_offset, "qcom,board-id", &props->board_id_len);
+	props->pmic_id = fdt_getprop(dtb, root_offset, "qcom,pmic-id", &props->pmic_id_len);
+
+	return 0;
+}
+
+/* True if any of the msm-id entries is for this SoC */
+static bool dtb_msm_id_matches(const char *plat_prop, int len_plat_id, int entry_size)
+{
+	uint32_t msm_id = board_platform_id() & 0x0000ffff;
+
+	for (; len_plat_id >= entry_size; len_plat_id -= entry_size, plat_prop += entry_size) {
+		if ((dtb_get_be32((const uint8_t *)plat_prop) & 0x0000ffff) == msm_id)
+			return true;
+	}
+
+	return false;
+}
+
+static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_node *dtb_list)
+{
+	struct dtb_root_props props;
 	const void *prop = NULL;
 	const char *plat_prop = NULL;
 	const char *board_prop = NULL;
@@ -772,11 +909,11 @@ static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_nod
 	uint32_t pmic_data_count;
 	uint32_t dtb_count = 0;;
 
-	root_offset = fdt_path_offset(dtb, "/");
-	if (root_offset < 0)
+	if (dtb_get_root_props(dtb, &props))
 		return false;
 
-	prop = fdt_getprop(dtb, root_offset, "model", &len);
+	prop = props.model;
+	len = props.model_len;
 	if (prop && len > 0) {
 		model = (char *) malloc(sizeof(char) * len);
 		ASSERT(model);
@@ -787,8 +924,10 @@ static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_nod
 	/* Find the pmic-id prop from DTB , if pmic-id is present then
 	* the DTB is version 3, otherwise find the board-id prop from DTB ,
 	* if board-id is present then the DTB is version 2 */
-	pmic_prop = (const char *)fdt_getprop(dtb, root_offset, "qcom,pmic-id", &len_pmic_id);
-	board_prop = (const char *)fdt_getprop(dtb, root_offset, "qcom,board-id", &len_board_id);
+	pmic_prop = (const char *)props.pmic_id;
+	len_pmic_id = props.pmic_id_len;
+	board_prop = (const char *)props.board_id;
+	len_board_id = props.board_id_len;
 	if (pmic_prop && (len_pmic_id > 0) && board_prop && (len_board_id > 0)) {
 		if ((len_pmic_id % PMIC_ID_SIZE) || (len_board_id % BOARD_ID_SIZE))
 		{
@@ -813,7 +952,8 @@ static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_nod
 	}
 
 	/* Get the msm-id prop from DTB */
-	plat_prop = (const char *)fdt_getprop(dtb, root_offset, "qcom,msm-id", &len_plat_id);
+	plat_prop = (const char *)props.msm_id;
+	len_plat_id = props.msm_id_len;
 	if (!plat_prop || len_plat_id <= 0) {
 		dprintf(INFO, "qcom,msm-id entry not found\n");
 		return false;
@@ -823,6 +963,14 @@ static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_nod
 		return false;
 	}
 
+	/* Most appended DTBs are for other SoCs and can't match absolutely,
+	 * drop them before building any entries */
+	if (!dtb_msm_id_matches(plat_prop, len_plat_id, min_plat_id_len)) {
+		if (model)
+			free(model);
+		return false;
+	}
+
 	/*
 	 * If DTB version is '1' look for <x y z> pair in the DTB
 	 * x: platform_id
@@ -873,10 +1021,9 @@ static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_nod
 					board_platform_id(),
 					board_hardware_id(),
 					board_soc_version());
-				plat_prop += DT_ENTRY_V1_SIZE;
-				len_plat_id -= DT_ENTRY_V1_SIZE;
-				continue;
 			}
+			plat_prop += DT_ENTRY_V1_SIZE;
+			len_plat_id -= DT_ENTRY_V1_SIZE;
 		}
 		free(cur_dt_entry);
 
@@ -889,8 +1036,9 @@ static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_nod
 	else if (dtb_ver == DEV_TREE_VERSION_V2 || dtb_ver == DEV_TREE_VERSION_V3) {
 		board_data_count = (len_board_id / BOARD_ID_SIZE);
 		msm_data_count = (len_plat_id / PLAT_ID_SIZE);
-		/* If dtb version is v2.0, the pmic_data_count will be <= 0 */
-		pmic_data_count = (len_pmic_id / PMIC_ID_SIZE);
+		/* If dtb version is v2.0, the pmic_data_count will be <= 0.
+		 * Each entry holds all four pmic revisions */
+		pmic_data_count = (len_pmic_id / sizeof(struct pmic_id));
 
 		/* If we are using dtb v3.0, then we have split board, msm & pmic data in the DTB
 		*  If we are using dtb v2.0, then we have split board & msmdata in the DTB
@@ -981,9 +1129,9 @@ static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_nod
 		dtb_count++;
 		for (i = 0; i < msm_data_count; i++) {
 			for (j = 0; j < board_data_count; j++) {
-				dt_entry_array[k].idx = dtb_count;
 				if (dtb_ver == DEV_TREE_VERSION_V3 && pmic_prop){
 					for (n = 0; n < pmic_data_count; n++) {
+						dt_entry_array[k].idx = dtb_count;
 						dt_entry_array[k].platform_id = platform_data[i].platform_id;
 						dt_entry_array[k].soc_rev = platform_data[i].soc_rev;
 						dt_entry_array[k].variant_id = board_data[j].variant_id;
@@ -998,6 +1146,7 @@ static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_nod
 					}
 
 				} else {
+					dt_entry_array[k].idx = dtb_count;
 					dt_entry_array[k].platform_id = platform_data[i].platform_id;
 					dt_entry_array[k].soc_rev = platform_data[i].soc_rev;
 					dt_entry_array[k].variant_id = board_data[j].variant_id;
@@ -1053,9 +1202,18 @@ static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_nod
 	return true;
 }
 
-/* function to handle the overlay in independent thread */
+static bool dtbo_overlaps(void *a, uint32_t a_size, void *b, uint32_t b_size)
+{
+	return (uintptr_t)a < (uintptr_t)b + b_size &&
+		(uintptr_t)b < (uintptr_t)a + a_size;
+}
+
+/* function to handle the overlay in independent thread, args is the tags buffer */
 static int dtb_overlay_handler(void *args)
 {
+	struct bs_trace trace;
+	uint32_t soc_size, board_size, out_size;
+
 	dprintf(SPEW, "thread %s() started\n", __func__);
 
 	soc_dtb_hdr = ufdt_install_blob(soc_dtb, fdt_totalsize(soc_dtb));
@@ -1065,8 +1223,28 @@ static int dtb_overlay_handler(void *args)
 		ret = DTBO_ERROR;
 		goto out;
 	}
-	final_dtb_hdr = ufdt_apply_overlay(soc_dtb_hdr, fdt_totalsize(soc_dtb_hdr),board_dtb,
-							fdt_totalsize(board_dtb));
+	soc_size = fdt_totalsize(soc_dtb_hdr);
+	board_size = fdt_totalsize(board_dtb);
+	out_size = soc_size + board_size;
+
+	bs_trace_begin(&trace, "ufdt_apply_overlay");
+	/*
+	 * Write the final dtb straight to the tags buffer rather than to a
+	 * temporary one, unless one of the inputs lies in the way.
+	 */
+	if (!dtbo_overlaps(args, out_size, soc_dtb_hdr, soc_size) &&
+		!dtbo_overlaps(args, out_size, board_dtb, board_size))
+	{
+		if (ufdt_apply_overlay_into(soc_dtb_hdr, soc_size, board_dtb, board_size,
+						args, out_size))
+			final_dtb_hdr = NULL;
+		else
+			final_dtb_hdr = args;
+	}
+	else
+		final_dtb_hdr = ufdt_apply_overlay(soc_dtb_hdr, soc_size, board_dtb,
+							board_size);
+	bs_trace_end(&trace);
 	if (!final_dtb_hdr)
 	{
 		dprintf(CRITICAL, "ERROR: UFDT apply overlay failed\n");
@@ -1125,7 +1303,7 @@ dtbo_error dev_tree_appended_with_dtbo(void *kernel, uint32_t kernel_size,
 			{
 				thread_t *thr = NULL;
 				event_init(&dtbo_event, 0, EVENT_FLAG_AUTOUNSIGNAL);
-				thr = thread_create("dtb_overlay", dtb_overlay_handler, 0,
+				thr = thread_create("dtb_overlay", dtb_overlay_handler, tags,
 							DEFAULT_PRIORITY, DTBO_STACK_SIZE);
 				if (!thr)
 				{
@@ -1146,8 +1324,9 @@ dtbo_error dev_tree_appended_with_dtbo(void *kernel, uint32_t kernel_size,
 			} /* dtbo_overlay_handler exited */
 
 		}
-		memscpy(tags, fdt_totalsize(final_dtb_hdr), final_dtb_hdr,
-						fdt_totalsize(final_dtb_hdr));
+		if (final_dtb_hdr != tags)
+			memscpy(tags, fdt_totalsize(final_dtb_hdr), final_dtb_hdr,
+							fdt_totalsize(final_dtb_hdr));
 		dprintf(INFO, "DTB overlay is successful\n");
 	}
 	else
@@ -1159,6 +1338,82 @@ out:
 	bs_set_timestamp(BS_DTB_OVERLAY_END);
 	return ret;
 }
+
+/*
+ * Queue up the absolute matches from the index the image tooling appended
+ * after the DTBs at dtb_start..dtb_end. Returns -1 if there is no usable
+ * index, the DTBs then have to be parsed.
+ */
+static int dev_tree_index_match(void *dtb_start, void *dtb_end, uintptr_t kernel_end,
+				uint32_t num_dtbs, struct dt_entry_node *dtb_list)
+{
+	struct dt_index_hdr hdr;
+	struct dt_index_entry entry;
+	struct dt_entry cur_dt_entry;
+	struct fdt_header dtb_hdr;
+	uintptr_t entries;
+	uint32_t dtb_area = (uintptr_t)dtb_end - (uintptr_t)dtb_start;
+	uint32_t i;
+
+	if (kernel_end - (uintptr_t)dtb_end < sizeof(hdr))
+		return -1;
+
+	/* may be unaligned, as the DTBs */
+	memcpy(&hdr, dtb_end, sizeof(hdr));
+	if (hdr.magic != DT_INDEX_MAGIC)
+		return -1;
+
+	entries = (uintptr_t)dtb_end + sizeof(hdr);
+	if (hdr.version != DT_INDEX_VERSION || hdr.num_dtbs != num_dtbs ||
+		hdr.num_entries > (kernel_end - entries) / sizeof(entry)) {
+		dprintf(CRITICAL, "Ignoring invalid DTB index\n");
+		return -1;
+	}
+
+	/* Check the whole index first so that a stale one can't leave a
+	 * partial list behind */
+	for (i = 0; i < hdr.num_entries; i++) {
+		memcpy(&entry, (void *)(entries + i * sizeof(entry)), sizeof(entry));
+		if (entry.dtb_offset >= dtb_area || entry.dtb_size > dtb_area - entry.dtb_offset)
+			goto stale;
+
+		memcpy(&dtb_hdr, dtb_start + entry.dtb_offset, sizeof(dtb_hdr));
+		if (fdt_magic(&dtb_hdr) != FDT_MAGIC || fdt_totalsize(&dtb_hdr) != entry.dtb_size)
+			goto stale;
+	}
+
+	for (i = 0; i < hdr.num_entries; i++) {
+		memcpy(&entry, (void *)(entries + i * sizeof(entry)), sizeof(entry));
+
+		memset(&cur_dt_entry, 0, sizeof(cur_dt_entry));
+		cur_dt_entry.platform_id = entry.platform_id;
+		cur_dt_entry.variant_id = entry.variant_id;
+		cur_dt_entry.board_hw_subtype = entry.board_hw_subtype;
+		cur_dt_entry.soc_rev = entry.soc_rev;
+		if (entry.flags & DT_INDEX_PMIC_FROM_BOARD) {
+			cur_dt_entry.pmic_rev[0] = board_pmic_target(0);
+			cur_dt_entry.pmic_rev[1] = board_pmic_target(1);
+			cur_dt_entry.pmic_rev[2] = board_pmic_target(2);
+			cur_dt_entry.pmic_rev[3] = board_pmic_target(3);
+		} else {
+			memcpy(cur_dt_entry.pmic_rev, entry.pmic_rev, sizeof(entry.pmic_rev));
+		}
+		cur_dt_entry.offset = (uint32_t)(dtb_start + entry.dtb_offset);
+		cur_dt_entry.size = entry.dtb_size;
+		/* as dev_tree_compatible() numbers them */
+		cur_dt_entry.idx = (entry.flags & DT_INDEX_DTB_V1) ? 0 : 1;
+
+		platform_dt_absolute_match(&cur_dt_entry, dtb_list);
+	}
+
+	dprintf(INFO, "DTB index: %u entries for %u DTBs\n", hdr.num_entries, num_dtbs);
+	return 0;
+
+stale:
+	dprintf(CRITICAL, "DTB index doesn't match the appended DTBs, ignoring it\n");
+	return -1;
+}
+
 /*
  * Will relocate the DTB to the tags addr if the device tree is found and return
  * its address
@@ -1170,11 +1425,13 @@ out:
  * Return Value: DTB address : If appended device tree is found
  *               'NULL'         : Otherwise
  */
-void *dev_tree_appended(void *kernel, uint32_t kernel_size, uint32_t dtb_offset, void *tags)
+static void *__dev_tree_appended(void *kernel, uint32_t kernel_size, uint32_t dtb_offset, void *tags)
 {
 	uintptr_t kernel_end = (uintptr_t)kernel + kernel_size;
 	uint32_t app_dtb_offset = 0;
 	void *dtb = NULL;
+	void *dtb_start = NULL;
+	uint32_t num_dtbs = 0;
 	void *bestmatch_tag = NULL;
 	struct dt_entry *best_match_dt_entry = NULL;
 	uint32_t bestmatch_tag_size;
@@ -1209,10 +1466,11 @@ void *dev_tree_appended(void *kernel, uint32_t kernel_size, uint32_t dtb_offset,
 		return NULL;
 	}
 	dtb = (void *)((uintptr_t)kernel + app_dtb_offset);
+	dtb_start = dtb;
 
+	/* Find the extent of the appended DTBs from their headers alone */
 	while (((uintptr_t)dtb + sizeof(struct fdt_header)) < (uintptr_t)kernel_end) {
 		struct fdt_header dtb_hdr;
-		uint32_t dtb_size;
 
 		/* the DTB could be unaligned, so extract the header,
 		 * and operate on it separately */
@@ -1222,12 +1480,27 @@ void *dev_tree_appended(void *kernel, uint32_t kernel_size, uint32_t dtb_offset,
 		    ((uintptr_t)dtb + (uintptr_t)fdt_totalsize((const void *)&dtb_hdr) < (uintptr_t)dtb) ||
 			((uintptr_t)dtb + (uintptr_t)fdt_totalsize((const void *)&dtb_hdr) > (uintptr_t)kernel_end))
 			break;
-		dtb_size = fdt_totalsize(&dtb_hdr);
-
-		dev_tree_compatible(dtb, dtb_size, dt_entry_queue);
 
 		/* goto the next device tree if any */
-		dtb += dtb_size;
+		dtb += fdt_totalsize(&dtb_hdr);
+		num_dtbs++;
+	}
+
+	/* Without an index from the image tooling, parse each of them */
+	if (dev_tree_index_match(dtb_start, dtb, kernel_end, num_dtbs, dt_entry_queue)) {
+		void *dtb_end = dtb;
+
+		for (dtb = dtb_start; dtb < dtb_end; ) {
+			struct fdt_header dtb_hdr;
+			uint32_t dtb_size;
+
+			memcpy(&dtb_hdr, dtb, sizeof(struct fdt_header));
+			dtb_size = fdt_totalsize(&dtb_hdr);
+
+			dev_tree_compatible(dtb, dtb_size, dt_entry_queue);
+
+			dtb += dtb_size;
+		}
 	}
 
 	best_match_dt_entry = platform_dt_match_best(dt_entry_queue);
@@ -1276,6 +1549,18 @@ void *dev_tree_appended(void *kernel, uint32_t kernel_size, uint32_t dtb_offset,
 	return NULL;
 }
 
+void *dev_tree_appended(void *kernel, uint32_t kernel_size, uint32_t dtb_offset, void *tags)
+{
+	struct bs_trace trace;
+	void *ret;
+
+	bs_trace_begin(&trace, "dev_tree_appended");
+	ret = __dev_tree_appended(kernel, kernel_size, dtb_offset, tags);
+	bs_trace_end(&trace);
+
+	return ret;
+}
+
 /* Returns 0 if the device tree is valid. */
 int dev_tree_validate(struct dt_table *table, unsigned int page_size, uint32_t *dt_hdr_size)
 {
@@ -46,7 +46,11 @@
 
 #define MAX_TD_XFER_SIZE  (16 * 1024)
 
-BUF_DMA_ALIGN(transfer_desc_item, ROUNDUP(sizeof(struct ept_queue_item), CACHE_LINE));
+/*
+ * dTDs of a request are laid out one per cache line, so that cleaning the one
+ * being filled never writes back over a neighbour the controller has retired.
+ */
+#define TD_STRIDE         ROUNDUP(sizeof(struct ept_queue_item), CACHE_LINE)
 
 /* common code - factor out into a shared file */
 
@@ -134,14 +138,24 @@ __WEAK void hsusb_clock_init(void)
 
 struct usb_request {
 	struct udc_request req;
-	struct ept_queue_item *item;
+	struct ept_queue_item *item;	/* dTD chain, TD_STRIDE apart */
+	unsigned num_items;		/* dTDs allocated at item */
+	unsigned queued_items;		/* dTDs used by the queued transfer */
+	struct usb_request *next;	/* Next request queued on the endpoint */
 };
 
+/*
+ * Requests on an endpoint form a queue. Only the oldest one is primed, the
+ * completion interrupt primes its successor straight away so back to back
+ * transfers leave the endpoint idle for an interrupt latency, not for a
+ * round trip through the thread that queued them.
+ */
 struct udc_endpoint {
 	struct udc_endpoint *next;
 	unsigned bit;
 	struct ept_queue_head *head;
-	struct usb_request *req;
+	struct usb_request *req;	/* Oldest queued request, the primed one */
+	struct usb_request *req_tail;	/* Newest queued request */
 	unsigned char num;
 	unsigned char in;
 	unsigned short maxpkt;
@@ -170,6 +184,7 @@ struct udc_endpoint *_udc_endpoint_alloc(unsigned num, unsigned in,
 	ept->num = num;
 	ept->in = !!in;
 	ept->req = 0;
+	ept->req_tail = 0;
 
 	cfg = CONFIG_MAX_PKT(max_pkt) | CONFIG_ZLT;
 
@@ -263,131 +278,206 @@ struct udc_request *udc_request_alloc(void)
 	ASSERT(req);
 	req->req.buf = 0;
 	req->req.length = 0;
-	req->item = memalign(CACHE_LINE, ROUNDUP(sizeof(struct ept_queue_item),
-								CACHE_LINE));
+	req->next = 0;
+	req->queued_items = 0;
+	req->num_items = 1;
+	req->item = memalign(CACHE_LINE, TD_STRIDE);
+	ASSERT(req->item);
 	return &req->req;
 }
 
-void udc_request_free(struct udc_request *req)
+void udc_request_free(struct udc_request *_req)
 {
+	struct usb_request *req = (struct usb_request *)_req;
+
+	free(req->item);
 	free(req);
 }
 
+static inline struct ept_queue_item *req_td(struct usb_request *req, unsigned n)
+{
+	return (struct ept_queue_item *)((addr_t)req->item + n * TD_STRIDE);
+}
+
+/* Hand the dTD chain of req to the controller. Called with interrupts off. */
+static void ept_prime(struct udc_endpoint *ept, struct usb_request *req)
+{
+	ept->head->next = PA((addr_t)req->item);
+	ept->head->info = 0;
+	arch_clean_invalidate_cache_range((addr_t) ept->head,
+					  sizeof(struct ept_queue_head));
+
+	DBG("ept%d %s prime req=%p\n", ept->num, ept->in ? "in" : "out", req);
+	writel(ept->bit, USB_ENDPTPRIME);
+}
+
+/* Drop whatever the controller has primed on ept. Called with interrupts off. */
+static void ept_flush(struct udc_endpoint *ept)
+{
+	do {
+		writel(ept->bit, USB_ENDPTFLUSH);
+		while (readl(USB_ENDPTFLUSH) & ept->bit);
+	} while (readl(USB_ENDPTSTAT) & ept->bit);
+}
+
 /*
- * Assumes that TDs allocated already are not freed.
- * But it can handle case where TDs are freed as well.
+ * Builds the dTD chain for req and appends it to the endpoint queue. If the
+ * endpoint is idle the chain is primed right away, otherwise it is primed by
+ * the completion interrupt of the request ahead of it.
+ * Control endpoints are never queued: a new request replaces the old one.
  */
 int udc_request_queue(struct udc_endpoint *ept, struct udc_request *_req)
 {
 	unsigned xfer = 0;
-	struct ept_queue_item *item, *curr_item;
+	unsigned n, num_items;
+	struct ept_queue_item *item;
 	struct usb_request *req = (struct usb_request *)_req;
 	unsigned phys = (unsigned)req->req.buf;
 	unsigned len = req->req.length;
 
-	xfer = (len > MAX_TD_XFER_SIZE) ? MAX_TD_XFER_SIZE : len;
-	/*
-	 * First TD allocated during request allocation
-	 */
-	curr_item = req->item;
-	curr_item->info = INFO_BYTES(xfer) | INFO_ACTIVE;
-	curr_item->page0 = phys;
-	curr_item->page1 = (phys & 0xfffff000) + 0x1000;
-	curr_item->page2 = (phys & 0xfffff000) + 0x2000;
-	curr_item->page3 = (phys & 0xfffff000) + 0x3000;
-	curr_item->page4 = (phys & 0xfffff000) + 0x4000;
-	phys += xfer;
-	len -= xfer;
+	num_items = len ? (len + MAX_TD_XFER_SIZE - 1) / MAX_TD_XFER_SIZE : 1;
+	if (num_items > req->num_items) {
+		item = memalign(CACHE_LINE, num_items * TD_STRIDE);
+		if (!item) {
+			dprintf(CRITICAL, "Failed to allocate %u dTDs\n", num_items);
+			return -1;
+		}
+		free(req->item);
+		req->item = item;
+		req->num_items = num_items;
+	}
 
-	/*
-	 * If transfer length is more then
-	 * accomodate by 1 TD
-	 * we add more transfer descriptors
-	 */
-	while (len > 0) {
+	for (n = 0; n < num_items; n++) {
 		xfer = (len > MAX_TD_XFER_SIZE) ? MAX_TD_XFER_SIZE : len;
-		if (curr_item->next == TERMINATE) {
-				curr_item->next = PA((addr_t)transfer_desc_item);
-				item = (struct ept_queue_item *)transfer_desc_item;
-				item->next = TERMINATE;
-		} else
-			/* Since next TD in chain already exists */
-			item = (struct ept_queue_item *)VA(curr_item->next);
-
-		/* Update TD with transfer information */
+		item = req_td(req, n);
+		item->next = (n + 1 < num_items) ?
+			PA((addr_t)req_td(req, n + 1)) : TERMINATE;
 		item->info = INFO_BYTES(xfer) | INFO_ACTIVE;
 		item->page0 = phys;
 		item->page1 = (phys & 0xfffff000) + 0x1000;
 		item->page2 = (phys & 0xfffff000) + 0x2000;
 		item->page3 = (phys & 0xfffff000) + 0x3000;
 		item->page4 = (phys & 0xfffff000) + 0x4000;
-
-		curr_item = item;
-		len -= xfer;
 		phys += xfer;
+		len -= xfer;
 	}
 
-	/* Terminate and set interrupt for last TD */
-	curr_item->next = TERMINATE;
-	curr_item->info |= INFO_IOC;
-	enter_critical_section();
-	ept->head->next = PA((addr_t)req->item);
-	ept->head->info = 0;
-	ept->req = req;
-	arch_clean_invalidate_cache_range((addr_t) ept,
-					  sizeof(struct udc_endpoint));
-	arch_clean_invalidate_cache_range((addr_t) ept->head,
-					  sizeof(struct ept_queue_head));
-	arch_clean_invalidate_cache_range((addr_t) ept->req,
-					  sizeof(struct usb_request));
+	/* Set interrupt for last TD */
+	item->info |= INFO_IOC;
+	req->queued_items = num_items;
+	req->next = 0;
+
+	/* Write all TD's to memory from cache */
+	arch_clean_invalidate_cache_range((addr_t) req->item,
+					  num_items * TD_STRIDE);
 	arch_clean_invalidate_cache_range((addr_t) VA((addr_t)req->req.buf),
 					  req->req.length);
 
-	item = req->item;
-	/* Write all TD's to memory from cache */
-	while (item != NULL) {
-		curr_item = item;
-		if (curr_item->next == TERMINATE)
-			item = NULL;
-		else
-			item =  (struct ept_queue_item *)curr_item->next;
-		arch_clean_invalidate_cache_range((addr_t) curr_item,
-					  sizeof(struct ept_queue_item));
+	enter_critical_section();
+	if (ept->req && ept->num != 0) {
+		DBG("ept%d %s queue req=%p behind %p\n", ept->num,
+		    ept->in ? "in" : "out", req, ept->req_tail);
+		ept->req_tail->next = req;
+		ept->req_tail = req;
+	} else {
+		ept->req = req;
+		ept->req_tail = req;
+		ept_prime(ept, req);
 	}
+	exit_critical_section();
+	return 0;
+}
 
-	DBG("ept%d %s queue req=%p\n", ept->num, ept->in ? "in" : "out", req);
-	writel(ept->bit, USB_ENDPTPRIME);
+/*
+ * Takes req off the endpoint queue without completing it. If it is the primed
+ * request, the endpoint is flushed and the next one in line is primed instead;
+ * any data already received into req is lost.
+ */
+int udc_request_cancel(struct udc_endpoint *ept, struct udc_request *_req)
+{
+	struct usb_request *req = (struct usb_request *)_req;
+	struct usb_request *prev = NULL;
+	struct usb_request *cur;
+
+	enter_critical_section();
+	for (cur = ept->req; cur && cur != req; cur = cur->next)
+		prev = cur;
+
+	if (!cur) {
+		exit_critical_section();
+		return -1;
+	}
+
+	if (prev) {
+		prev->next = req->next;
+	} else {
+		ept_flush(ept);
+		ept->req = req->next;
+		if (ept->req)
+			ept_prime(ept, ept->req);
+	}
+	if (ept->req_tail == req)
+		ept->req_tail = prev;
+	req->next = 0;
 	exit_critical_section();
+
 	return 0;
 }
 
+/* Take the primed request off the queue and prime the one behind it */
+static struct usb_request *ept_dequeue(struct udc_endpoint *ept)
+{
+	struct usb_request *req = ept->req;
+
+	if (req) {
+		ept->req = req->next;
+		req->next = 0;
+		if (ept->req)
+			ept_prime(ept, ept->req);
+		else
+			ept->req_tail = 0;
+	}
+	return req;
+}
+
+/* Complete every queued request with an error, e.g. on bus reset */
+static void ept_fail_requests(struct udc_endpoint *ept)
+{
+	struct usb_request *req;
+
+	while ((req = ept->req)) {
+		ept->req = req->next;
+		req->next = 0;
+		if (ept->req == 0)
+			ept->req_tail = 0;
+		if (req->req.complete)
+			req->req.complete(&req->req, 0, -1);
+	}
+}
+
 static void handle_ept_complete(struct udc_endpoint *ept)
 {
 	struct ept_queue_item *item;
 	unsigned actual, total_len;
+	unsigned n;
 	int status;
-	struct usb_request *req=NULL;
+	struct usb_request *req;
 
 	DBG("ept%d %s complete req=%p\n",
 	    ept->num, ept->in ? "in" : "out", ept->req);
 
-	arch_invalidate_cache_range((addr_t) ept,
-					  sizeof(struct udc_endpoint));
-
-	if(ept->req)
-	{
-		req = (struct usb_request *)VA((addr_t)ept->req);
-		arch_invalidate_cache_range((addr_t) ept->req,
-						sizeof(struct usb_request));
-	}
+	/*
+	 * The controller is done with every dTD of the primed request, so
+	 * get the next one going before looking at the results.
+	 */
+	req = ept_dequeue(ept);
 
 	if (req) {
-		item = (struct ept_queue_item *)VA((addr_t)req->item);
 		/* total transfer length for transacation */
 		total_len = req->req.length;
-		ept->req = 0;
 		actual = 0;
-		while(1) {
+		for (n = 0; ; n++) {
+			item = req_td(req, n);
 
 			do {
 				/*
@@ -412,7 +502,7 @@ static void handle_ept_complete(struct udc_endpoint *ept)
 			}
 
 			/* Check if we are processing last TD */
-			if (item->next == TERMINATE) {
+			if (n + 1 == req->queued_items) {
 				/*
 				 * Record the data transferred for the last TD
 				 */
@@ -429,8 +519,6 @@ static void handle_ept_complete(struct udc_endpoint *ept)
 				 */
 				actual += (MAX_TD_XFER_SIZE - (item->info >> 16)) & 0x7FFF;
 				total_len -= (MAX_TD_XFER_SIZE - (item->info >> 16)) & 0x7FFF;
-				/*Move to next item in chain*/
-				item = (struct ept_queue_item *)VA(item->next);
 			}
 		}
 		status = 0;
@@ -764,15 +852,8 @@ enum handler_return udc_interrupt(void *arg)
 		the_gadget->notify(the_gadget, UDC_EVENT_OFFLINE);
 
 		/* error out any pending reqs */
-		for (ept = ept_list; ept; ept = ept->next) {
-			/* ensure that ept_complete considers
-			 * this to be an error state
-			 */
-			if (ept->req) {
-				ept->req->item->info = INFO_HALTED;
-				handle_ept_complete(ept);
-			}
-		}
+		for (ept = ept_list; ept; ept = ept->next)
+			ept_fail_requests(ept);
 		usb_status(0, usb_highspeed);
 	}
 	if (n & STS_SLI) {
@@ -31,6 +31,7 @@
 #include <string.h>
 #include <platform.h>
 #include <openssl/err.h>
+#include <lib/rsa.h>
 #include "image_verify.h"
 #include "scm.h"
 
@@ -41,6 +42,66 @@ const char hash_identifier[] = {
 	0x04, 0x02, 0x01, 0x05, 0x00, 0x04, 0x20
 };
 
+/*
+ * Strips PKCS#1 v1.5 block type 1 padding, 00 01 FF..FF 00 followed by the
+ * payload with at least eight FF bytes, as RSA_public_decrypt() does.
+ * Returns -1 if the padding is malformed otherwise size of plain_text in bytes
+ */
+static int image_pkcs1_unpad(const unsigned char *em, unsigned int em_len,
+			     unsigned char *plain_text)
+{
+	unsigned int i;
+
+	if (em_len < 11 || em[0] != 0x00 || em[1] != 0x01)
+		return -1;
+
+	for (i = 2; i < em_len && em[i] == 0xff; i++)
+		;
+	if (i == em_len || em[i] != 0x00 || i - 2 < 8)
+		return -1;
+	i++;
+
+	memcpy(plain_text, em + i, em_len - i);
+	return em_len - i;
+}
+
+/*
+ * Returns -1 if decryption failed otherwise size of plain_text in bytes
+ */
+static int image_decrypt_signature_key(unsigned char *signature_ptr,
+		unsigned char *plain_text, const struct rsa_key *key)
+{
+	unsigned char em[SIGNATURE_SIZE];
+
+	if (rsa_key_len(key) != SIGNATURE_SIZE)
+		return -1;
+
+	if (rsa_public(key, signature_ptr, em) != NO_ERROR)
+		return -1;
+
+	return image_pkcs1_unpad(em, SIGNATURE_SIZE, plain_text);
+}
+
+/*
+ * Montgomery context for an OpenSSL public key, from the shared cache.
+ * Returns NULL for keys only OpenSSL handles: another size than
+ * SIGNATURE_SIZE or an exponent wider than 32 bits.
+ */
+static struct rsa_key *image_rsa_key_get(RSA *rsa_key)
+{
+	unsigned char n[SIGNATURE_SIZE];
+
+	if (rsa_key->n == NULL || rsa_key->e == NULL)
+		return NULL;
+
+	if (BN_num_bytes(rsa_key->n) != SIGNATURE_SIZE ||
+	    BN_num_bits(rsa_key->e) > 32)
+		return NULL;
+
+	BN_bn2bin(rsa_key->n, n);
+	return rsa_key_get(n, SIGNATURE_SIZE, BN_get_word(rsa_key->e), NULL, 0);
+}
+
 /*
  * Returns -1 if decryption failed otherwise size of plain_text in bytes
  */
@@ -48,12 +109,21 @@ int image_decrypt_signature_rsa(unsigned char *signature_ptr,
 		unsigned char *plain_text, RSA *rsa_key)
 {
 	int ret = -1;
+	struct rsa_key *key;
 
 	if (rsa_key == NULL) {
 		dprintf(CRITICAL, "ERROR: Boot Invalid, RSA_KEY is NULL!\n");
 		return ret;
 	}
 
+	key = image_rsa_key_get(rsa_key);
+	if (key != NULL) {
+		ret = image_decrypt_signature_key(signature_ptr, plain_text, key);
+		rsa_key_put(key);
+		dprintf(SPEW, "DEBUG: Return of rsa_public = %d\n", ret);
+		return ret;
+	}
+
 	ret = RSA_public_decrypt(SIGNATURE_SIZE, signature_ptr, plain_text,
 				 rsa_key, RSA_PKCS1_PADDING);
 	dprintf(SPEW, "DEBUG openssl: Return of RSA_public_decrypt = %d\n",
@@ -74,7 +144,11 @@ image_decrypt_signature(unsigned char *signature_ptr, unsigned char *plain_text)
 	int ret = -1;
 	X509 *x509_certificate = NULL;
 	const unsigned char *cert_ptr = NULL;
+	const unsigned char *cert_start = NULL;
 	unsigned int cert_size = 0;
+	/* The certificate is parsed once, later images reuse its key */
+	static const unsigned char *oem_cert;
+	static struct rsa_key *oem_key;
 
 	if (is_vb_le_enabled()) {
 		cert_ptr = (const unsigned char *)LE_OEM_CERTIFICATE;
@@ -83,6 +157,11 @@ image_decrypt_signature(unsigned char *signature_ptr, unsigned char *plain_text)
 		cert_ptr = (const unsigned char *)certBuffer;
 		cert_size = sizeof(certBuffer);
 	}
+	cert_start = cert_ptr;
+
+	if (oem_key != NULL && oem_cert == cert_start)
+		return image_decrypt_signature_key(signature_ptr, plain_text,
+						   oem_key);
 
 	EVP_PKEY *pub_key = NULL;
 	RSA *rsa_key = NULL;
@@ -107,8 +186,17 @@ image_decrypt_signature(unsigned char *signature_ptr, unsigned char *plain_text)
 		goto cleanup;
 	}
 
-	ret = image_decrypt_signature_rsa(signature_ptr, plain_text, rsa_key);
-	dprintf(SPEW, "DEBUG openssl: Return of RSA_public_decrypt = %d\n",
+	/* keep the reference for the next image */
+	rsa_key_put(oem_key);
+	oem_key = image_rsa_key_get(rsa_key);
+	oem_cert = cert_start;
+	if (oem_key != NULL)
+		ret = image_decrypt_signature_key(signature_ptr, plain_text,
+						  oem_key);
+	else
+		ret = image_decrypt_signature_rsa(signature_ptr, plain_text,
+						  rsa_key);
+	dprintf(SPEW, "DEBUG: Return of image_decrypt_signature = %d\n",
 		ret);
 
  cleanup:
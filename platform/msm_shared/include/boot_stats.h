@@ -30,6 +30,8 @@
 #ifndef __BOOT_STATS_H
 #define __BOOT_STATS_H
 
+#include <sys/types.h>
+
 /* The order of the entries in this enum does not correspond to bootup order.
  * It is mandated by the expected order of the entries in imem when the values
  * are read in the kernel.
@@ -47,4 +49,48 @@ enum bs_entry {
 };
 void bs_set_timestamp(enum bs_entry bs_id);
 
+/* Boot trace: named begin/end spans stamped with the qtimer counter.
+ * Completed spans go into a ring buffer (the oldest are overwritten) and are
+ * folded into a per-phase aggregate keyed by the span name, so the totals
+ * stay exact however many spans the ring has dropped.
+ */
+#define BS_TRACE_RING_SIZE      128
+#define BS_TRACE_MAX_PHASES     16
+/* Duration histogram, one bucket per decade: <10us, <100us ... >=1s */
+#define BS_TRACE_HIST_BUCKETS   7
+/* Room for the "lk.boot_trace=" summary on the kernel cmdline */
+#define BS_TRACE_CMDLINE_LEN    256
+
+struct bs_trace {
+	const char *name;
+	uint64_t start;
+};
+
+struct bs_trace_span {
+	const char *name;
+	uint64_t start;
+	uint64_t end;
+};
+
+struct bs_trace_phase {
+	const char *name;
+	uint32_t count;
+	uint64_t total;
+	uint64_t max;
+	uint32_t hist[BS_TRACE_HIST_BUCKETS];
+};
+
+/* name must be a string with static storage, only the pointer is kept */
+void bs_trace_begin(struct bs_trace *t, const char *name);
+void bs_trace_end(struct bs_trace *t);
+uint64_t bs_trace_ticks_to_us(uint64_t ticks);
+/* Copies out phase idx, returns false once idx is past the last phase */
+bool bs_trace_get_phase(unsigned idx, struct bs_trace_phase *out);
+/* Full text report (phases, histograms, ring contents), returns its length */
+unsigned bs_trace_dump(char *buf, unsigned len);
+/* " lk.boot_trace=name:us/count,..." for the kernel cmdline, or "".
+ * aboot only appends it when built with ENABLE_BOOT_TRACE_CMDLINE=1.
+ */
+unsigned bs_trace_summary(char *buf, unsigned len);
+
 #endif
@@ -26,5 +26,19 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-/* API to calculate CRC32 */
+#ifndef __CRC32_H
+#define __CRC32_H
+
+/*
+ * API to calculate CRC32
+ * crc is the running CRC register: callers pass ~0 to start and invert
+ * the final value, e.g. crc32(~0L, buf, len) ^ ~0L for the IEEE CRC.
+ * Uses the ARMv8 CRC32 instructions when the core has them.
+ */
 uint32_t crc32(uint32_t crc, const void *buf, size_t size);
+
+/* Portable implementations, exposed for benchmarking */
+uint32_t crc32_bytewise(uint32_t crc, const void *buf, size_t size);
+uint32_t crc32_slice8(uint32_t crc, const void *buf, size_t size);
+
+#endif
@@ -98,6 +98,14 @@ extern void crypto_send_data(void *ctx_ptr,
 			     unsigned int bytes_to_write,
 			     unsigned int *ret_status);
 
+extern void crypto_send_data_async(void *ctx_ptr,
+				   unsigned char *data_ptr,
+				   unsigned int buff_size,
+				   unsigned int bytes_to_write,
+				   unsigned int *ret_status);
+
+extern void crypto_wait_data(unsigned int *ret_status);
+
 extern void crypto_get_digest(unsigned char *digest_ptr,
 			      unsigned int *ret_status,
 			      crypto_auth_alg_type auth_alg, bool last);
@@ -136,4 +144,23 @@ hash_find(unsigned char *addr, unsigned int size, unsigned char *digest,
           unsigned char auth_alg);
 
 crypto_engine_type board_ce_type(void);
+
+/*
+ * Streaming hash of an image while it is being loaded.
+ *
+ * hash_stream_begin() arms a stream over the contiguous buffer at addr and
+ * hash_stream_update() is called each time more of that buffer has been
+ * filled, in order. On HW engines the data is handed to the crypto engine
+ * without waiting, so the hash of one chunk overlaps the read of the next.
+ * The last block of what has been loaded is always held back.
+ *
+ * The stream is consumed by the first hash_find() over a range starting at
+ * addr that covers at least what was streamed: only the held back bytes and
+ * anything appended after them are hashed at that point. Anything else that
+ * hashes in the meantime just waits for the pending chunk first.
+ * hash_stream_abort() drops an unconsumed stream.
+ */
+void hash_stream_begin(unsigned char *addr, unsigned char auth_alg);
+void hash_stream_update(unsigned char *buf, unsigned int len);
+void hash_stream_abort(void);
 #endif
@@ -191,6 +191,39 @@ struct pmic_id
 	uint32_t pmic_version[4];
 };
 
+/*
+ * Optional index of the DTBs appended to the kernel, placed by the image
+ * tooling (scripts/mkdtbidx.py) right after the last one. It holds the
+ * entries dev_tree_compatible() would build, so none of the DTBs need to
+ * be parsed. All fields are little endian.
+ */
+#define DT_INDEX_MAGIC          0x49544451 /* "QDTI" */
+#define DT_INDEX_VERSION        1
+/* No qcom,pmic-id in the DTB, the entry takes the board's pmic revisions */
+#define DT_INDEX_PMIC_FROM_BOARD 0x1
+/* Version 1 DTB (<msm-id variant-id soc-rev> triplets) */
+#define DT_INDEX_DTB_V1         0x2
+
+struct dt_index_hdr
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_dtbs;
+	uint32_t num_entries;
+};
+
+struct dt_index_entry
+{
+	uint32_t dtb_offset;    /* from the first appended DTB */
+	uint32_t dtb_size;
+	uint32_t flags;
+	uint32_t platform_id;
+	uint32_t variant_id;
+	uint32_t board_hw_subtype;
+	uint32_t soc_rev;
+	uint32_t pmic_rev[4];
+};
+
 struct dt_mem_node_info
 {
 	uint32_t offset;
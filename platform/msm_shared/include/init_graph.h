@@ -0,0 +1,66 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INIT_GRAPH_H
+#define __INIT_GRAPH_H
+
+#include <sys/types.h>
+#include <list.h>
+#include <kernel/event.h>
+
+#define INIT_TASK_MAX_DEPS      4
+
+/* One step of boot time bring-up, run on a thread of its own so that it
+ * overlaps with the others. A task starts once every task in deps has
+ * finished, whatever their status. Tasks are static and run once; the
+ * name must have static storage, it is also the boot trace phase name.
+ */
+struct init_task {
+	const char *name;
+	int (*run)(void *arg);
+	void *arg;
+	struct init_task *deps[INIT_TASK_MAX_DEPS];  /* NULL terminated */
+	size_t stack_size;                           /* 0: DEFAULT_STACK_SIZE */
+
+	/* Private */
+	bool started;
+	int status;
+	event_t done;
+	struct list_node node;
+};
+
+/* Start the task, it runs as soon as its dependencies are done */
+void init_task_start(struct init_task *task);
+/* Wait for the task (starting it if needed), returns what run returned */
+int init_task_wait(struct init_task *task);
+/* Wait for every task started so far */
+void init_task_join_all(void);
+/* True while started tasks have not finished; busy waits should yield */
+bool init_tasks_running(void);
+
+#endif
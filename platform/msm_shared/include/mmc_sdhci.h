@@ -346,6 +346,10 @@ struct mmc_device *mmc_init(struct mmc_config_data *);
 uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest, uint64_t blk_addr, uint32_t num_blocks);
 /* API: Write requried number of blocks from source to card */
 uint32_t mmc_sdhci_write(struct mmc_device *dev, void *src, uint64_t blk_addr, uint32_t num_blocks);
+/* API: Read blocks from the card into scattered buffers with one command */
+uint32_t mmc_sdhci_read_sg(struct mmc_device *dev, struct mmc_data_seg *segs, uint32_t num_segs, uint64_t blk_addr, uint32_t num_blocks);
+/* API: Write blocks from scattered buffers to the card with one command */
+uint32_t mmc_sdhci_write_sg(struct mmc_device *dev, struct mmc_data_seg *segs, uint32_t num_segs, uint64_t blk_addr, uint32_t num_blocks);
 /* API: Erase len bytes (after converting to number of erase groups), from specified address */
 uint32_t mmc_sdhci_erase(struct mmc_device *dev, uint32_t blk_addr, uint64_t len);
 /* API: Write protect or release len bytes (after converting to number of write protect groups) from specified start address*/
@@ -30,8 +30,41 @@
 #define __MMC_WRAPPER_H__
 
 #include <mmc_sdhci.h>
+#include <list.h>
+#include <kernel/event.h>
 
 #define BOARD_KERNEL_PAGESIZE                2048
+
+/*
+ * Asynchronous request for mmc_submit_read/mmc_submit_write. The request
+ * and its buffer belong to the io thread until mmc_wait() returns.
+ * Requests are done in the order they were submitted; back to back
+ * requests for contiguous card addresses go out as one transfer.
+ */
+struct mmc_request {
+	struct list_node node;
+	uint64_t data_addr;   /* Byte address on the card */
+	void *buf;            /* Cache line aligned for reads */
+	uint32_t len;         /* Multiple of the block size */
+	bool write;
+	uint32_t status;      /* 0 on success, valid after mmc_wait */
+	event_t done;
+	void *ufs_req;        /* In flight on the ufs doorbells */
+};
+
+/*
+ * Small mmc_read() calls inside a partition are served from read-ahead
+ * windows: the first read of a small partition brings in all of it, in
+ * larger ones a window's worth from the read on. Writes and erases
+ * drop the windows they overlap.
+ */
+struct mmc_read_cache_stats {
+	uint32_t hits;        /* Served from a window */
+	uint32_t misses;      /* Filled a window */
+	uint32_t bypassed;    /* Too large or outside any partition */
+	uint64_t prefetched;  /* Bytes read ahead of what was asked for */
+};
+
 /* Wrapper APIs */
 
 struct mmc_device *get_mmc_device();
@@ -39,6 +72,11 @@ uint32_t mmc_get_psn(void);
 
 uint32_t mmc_read(uint64_t data_addr, uint32_t *out, uint32_t data_len);
 uint32_t mmc_write(uint64_t data_addr, uint32_t data_len, void *in);
+void mmc_submit_read(struct mmc_request *req, uint64_t data_addr, void *out, uint32_t data_len);
+void mmc_submit_write(struct mmc_request *req, uint64_t data_addr, void *in, uint32_t data_len);
+uint32_t mmc_wait(struct mmc_request *req);
+void mmc_flush_requests();
+void mmc_read_cache_get_stats(struct mmc_read_cache_stats *stats);
 uint32_t mmc_erase_card(uint64_t, uint64_t);
 uint64_t mmc_get_device_capacity(void);
 uint32_t mmc_erase_card(uint64_t addr, uint64_t len);
@@ -34,12 +34,16 @@
 #define QTMR_TIMER_CTRL_INT_MASK        (1 << 1)
 
 #define QTMR_PHY_CNT_MAX_VALUE          0xFFFFFFFFFFFFFF
+#define QTMR_TVAL_MAX                   0x7FFFFFFF
 
 void qtimer_set_physical_timer(time_t msecs_interval,
 	platform_timer_callback tmr_callback, void *tmr_arg);
+void qtimer_set_oneshot_timer(uint32_t ticks,
+	platform_timer_callback tmr_callback, void *tmr_arg);
 void qtimer_disable();
 uint64_t qtimer_get_phy_timer_cnt();
 uint32_t qtimer_current_time();
+uint32_t qtimer_counter_time();
 uint32_t qtimer_get_frequency();
 void qtimer_uninit();
 void qtimer_init();
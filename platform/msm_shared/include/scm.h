@@ -485,4 +485,17 @@ uint32_t scm_io_write(uint32_t address, uint32_t val);
 int is_scm_call_available(uint32_t svc_id, uint32_t cmd_id);
 int scm_disable_sdi();
 bool allow_set_fuse(uint32_t version);
+
+/* PSCI 0.2 power state coordination calls, SMC32 function ids */
+#define PSCI_0_2_FN_CPU_OFF             0x84000002
+#define PSCI_0_2_FN_CPU_ON              0x84000003
+#define PSCI_0_2_FN_AFFINITY_INFO       0x84000004
+
+#define PSCI_AFFINITY_ON                0
+#define PSCI_AFFINITY_OFF               1
+#define PSCI_AFFINITY_ON_PENDING        2
+
+int psci_cpu_on(uint32_t mpidr, paddr_t entry, uint32_t context_id);
+void psci_cpu_off(void);
+int psci_affinity_info(uint32_t mpidr);
 #endif
@@ -73,10 +73,19 @@ struct sdhci_host {
 	uint16_t minor;          /* host controller major ver */
 	bool use_cdclp533;       /* Use cdclp533 calibration circuit */
 	event_t* sdhc_event;     /* Event for power control irqs */
+	bool yield_wait;         /* Yield the cpu while a transfer is polled */
 	struct host_caps caps;   /* Host capabilities */
 	struct sdhci_msm_data *msm_host; /* MSM specific host info */
 };
 
+/*
+ * One buffer of a scattered transfer
+ */
+struct mmc_data_seg {
+	void *data_ptr;      /* Start of the buffer */
+	uint32_t len;        /* Length of the buffer in bytes */
+};
+
 /*
  * Data pointer to be read/written
  */
@@ -84,6 +93,8 @@ struct mmc_data {
 	void *data_ptr;      /* Points to stream of data */
 	uint32_t blk_sz;     /* Block size for the data */
 	uint32_t num_blocks; /* num of blocks, each always of size SDHCI_MMC_BLK_SZ */
+	struct mmc_data_seg *segs; /* If set, data is scattered over these instead of data_ptr */
+	uint32_t num_segs;   /* Number of entries in segs */
 };
 
 /*
@@ -255,6 +266,7 @@ enum {
 #define SDHCI_ERR_INT_STAT_MASK                   0x8000
 #define SDHCI_ADMA_DESC_LINE_SZ                   65536
 #define SDHCI_ADMA_MAX_TRANS_SZ                   (65535 * 512)
+#define SDHCI_MAX_BLK_CNT                         65535 /* 16 bit block count register */
 #define SDHCI_ADMA_TRANS_VALID                    BIT(0)
 #define SDHCI_ADMA_TRANS_END                      BIT(1)
 #define SDHCI_ADMA_TRANS_DATA                     BIT(5)
@@ -293,6 +305,7 @@ enum {
 #define SDHCI_CMD_TIMEOUT                         0xF
 #define SDHCI_MAX_CMD_RETRY                       9000000
 #define SDHCI_MAX_TRANS_RETRY                     10000000
+#define SDHCI_YIELD_INTERVAL                      64
 
 #define SDHCI_PREP_CMD(c, f)                      ((((c) & 0xff) << 8) | ((f) & 0xff))
 
@@ -73,6 +73,8 @@ enum utp_scsi_cmd_type
 	SCSI_CMD_REPORT_LUNS        = 0xA0,
 };
 
+struct ucs_async_req;
+
 struct scsi_req_build_type
 {
 	addr_t               cdb;
@@ -164,6 +166,13 @@ int ucs_scsi_send_inquiry(struct ufs_dev *dev);
 int ucs_do_scsi_cmd(struct ufs_dev *dev, struct scsi_req_build_type *req);
 int ucs_do_scsi_read(struct ufs_dev *dev, struct scsi_rdwr_req *req);
 int ucs_do_scsi_write(struct ufs_dev *dev, struct scsi_rdwr_req *req);
+/*
+ * Queue a read/write on several UTRD slots and return without waiting.
+ * Returns NULL on failure, otherwise the request must be passed to
+ * ucs_wait_scsi_rdwr_async() before the buffer is touched.
+ */
+struct ucs_async_req *ucs_do_scsi_rdwr_async(struct ufs_dev *dev, struct scsi_rdwr_req *req, bool write);
+int ucs_wait_scsi_rdwr_async(struct ufs_dev *dev, struct ucs_async_req *areq);
 int ucs_do_scsi_unmap(struct ufs_dev *dev, struct scsi_unmap_req *req);
 /*
  * ucs_do_sci_rpmb_read function takes a RPMB frame, sector address and number of
@@ -50,11 +50,14 @@ struct ufs_req_node
 };
 
 
+struct ucs_async_req;
+
 struct ufs_utp_req_meta_data
 {
 	mutex_t             bitmap_mutex;
 	struct ufs_req_node list_head;
 	uint32_t            bitmap;
+	uint32_t            async_bits;  /* Slots of batches still in flight. */
 	uint32_t            task_id;
 	uint64_t            list_base_addr;
 };
@@ -117,6 +120,14 @@ struct ufs_dev
 int ufs_init(struct ufs_dev *dev);
 int ufs_read(struct ufs_dev* dev, uint64_t start_lba, addr_t buffer, uint32_t num_blocks);
 int ufs_write(struct ufs_dev* dev, uint64_t start_lba, addr_t buffer, uint32_t num_blocks);
+/*
+ * Start a read/write and return without waiting for it. The transfer is
+ * spread over several UTRD slots. Returns NULL if it could not be queued,
+ * otherwise ufs_async_wait() must be called before the buffer is used.
+ */
+struct ucs_async_req *ufs_read_async(struct ufs_dev* dev, uint64_t start_lba, addr_t buffer, uint32_t num_blocks);
+struct ucs_async_req *ufs_write_async(struct ufs_dev* dev, uint64_t start_lba, addr_t buffer, uint32_t num_blocks);
+int ufs_async_wait(struct ufs_dev* dev, struct ucs_async_req *req);
 int ufs_erase(struct ufs_dev* dev, uint64_t start_lba, uint32_t num_blocks);
 uint64_t ufs_get_dev_capacity(struct ufs_dev* dev);
 uint32_t ufs_get_serial_num(struct ufs_dev* dev);
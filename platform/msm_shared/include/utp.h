@@ -48,6 +48,10 @@
 
 #define UTP_GENERIC_CMD_TIMEOUT                            40000
 #define UTP_MAX_COMMAND_RETRY                              5000000
+#define UTP_YIELD_INTERVAL                                 64
+
+/* Max UTRD slots used by one batch, the rest stay free for other requests. */
+#define UTP_MAX_ASYNC_UTRD                                 16
 
 struct utp_prdt_entry
 {
@@ -144,7 +148,23 @@ struct utp_bitmap_access_type
 	mutex_t *mutx;
 };
 
+/* A set of upius submitted together, see utp_enqueue_upiu_async(). */
+struct utp_async_batch
+{
+	uint32_t                   count;
+	struct upiu_req_build_type *upiu[UTP_MAX_ASYNC_UTRD];
+
+	/* Filled in by utp_enqueue_upiu_async(). */
+	struct upiu_gen_hdr        *req_upiu[UTP_MAX_ASYNC_UTRD];
+	struct utp_trans_req_desc  *desc[UTP_MAX_ASYNC_UTRD];
+	uint32_t                   cmd_desc_len[UTP_MAX_ASYNC_UTRD];
+	uint32_t                   door_bell_bit[UTP_MAX_ASYNC_UTRD];
+	uint32_t                   door_bell_bits;
+};
+
 int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data);
+int utp_enqueue_upiu_async(struct ufs_dev *dev, struct utp_async_batch *batch);
+int utp_wait_upiu_async(struct ufs_dev *dev, struct utp_async_batch *batch);
 void utp_process_req_completion(struct ufs_req_irq_type *irq);
 int utp_poll_utrd_complete(struct ufs_dev *dev);
 #endif
@@ -0,0 +1,119 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <list.h>
+#include <init_graph.h>
+#include <boot_stats.h>
+#include <kernel/thread.h>
+#include <kernel/event.h>
+
+static struct list_node init_tasks = LIST_INITIAL_VALUE(init_tasks);
+static uint32_t init_tasks_active;
+
+static void init_task_run(struct init_task *task)
+{
+	struct bs_trace trace;
+	uint32_t i;
+
+	for (i = 0; i < INIT_TASK_MAX_DEPS && task->deps[i]; i++)
+		init_task_wait(task->deps[i]);
+
+	bs_trace_begin(&trace, task->name);
+	task->status = task->run(task->arg);
+	bs_trace_end(&trace);
+
+	if (task->status)
+		dprintf(CRITICAL, "init task %s failed: %d\n", task->name, task->status);
+
+	enter_critical_section();
+	init_tasks_active--;
+	exit_critical_section();
+
+	event_signal(&task->done, true);
+}
+
+static int init_task_thread(void *arg)
+{
+	init_task_run((struct init_task *) arg);
+
+	return 0;
+}
+
+void init_task_start(struct init_task *task)
+{
+	thread_t *thr;
+
+	enter_critical_section();
+	if (task->started)
+	{
+		exit_critical_section();
+		return;
+	}
+
+	task->started = true;
+	task->status = 0;
+	event_init(&task->done, false, 0);
+	list_add_tail(&init_tasks, &task->node);
+	init_tasks_active++;
+	exit_critical_section();
+
+	thr = thread_create(task->name, init_task_thread, task, DEFAULT_PRIORITY,
+				task->stack_size ? task->stack_size : DEFAULT_STACK_SIZE);
+	if (!thr)
+	{
+		/* Run it right here instead */
+		dprintf(CRITICAL, "Failed to create init task %s\n", task->name);
+		init_task_run(task);
+		return;
+	}
+
+	thread_resume(thr);
+}
+
+int init_task_wait(struct init_task *task)
+{
+	init_task_start(task);
+	event_wait(&task->done);
+
+	return task->status;
+}
+
+void init_task_join_all(void)
+{
+	struct init_task *task;
+
+	/* Tasks only ever get added, at the tail */
+	list_for_every_entry(&init_tasks, task, struct init_task, node)
+		event_wait(&task->done);
+}
+
+bool init_tasks_running(void)
+{
+	return init_tasks_active != 0;
+}
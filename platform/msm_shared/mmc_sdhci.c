@@ -1852,13 +1852,17 @@ static uint32_t mmc_stop_command(struct mmc_device *dev)
 }
 
 /*
- * Function: mmc sdhci read
- * Arg     : mmc device structure, block address, number of blocks & destination
- * Return  : 0 on Success, non zero on success
- * Flow    : Fill in the command structure & send the command
+ * Function: mmc sdhci data xfer
+ * Arg     : mmc device structure, direction, buffer or buffer segments,
+ *           block address & number of blocks
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Fill in the CMD17/18 or CMD24/25 command structure & send it.
+ *           When segs is set the blocks are scattered over the segments
+ *           in order, the card still sees one multi block transfer.
  */
-uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
-						uint64_t blk_addr, uint32_t num_blocks)
+static uint32_t mmc_sdhci_data_xfer(struct mmc_device *dev, bool write, void *buf,
+									struct mmc_data_seg *segs, uint32_t num_segs,
+									uint64_t blk_addr, uint32_t num_blocks)
 {
 	uint32_t mmc_ret = 0;
 	struct mmc_command cmd;
@@ -1866,13 +1870,13 @@ uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
 
 	memset((struct mmc_command *)&cmd, 0, sizeof(struct mmc_command));
 
-	/* CMD17/18 Format:
+	/* CMD17/18/24/25 Format:
 	 * [31:0] Data Address
 	 */
-	if (num_blocks == 1)
-		cmd.cmd_index = CMD17_READ_SINGLE_BLOCK;
+	if (write)
+		cmd.cmd_index = (num_blocks == 1) ? CMD24_WRITE_SINGLE_BLOCK : CMD25_WRITE_MULTIPLE_BLOCK;
 	else
-		cmd.cmd_index = CMD18_READ_MULTIPLE_BLOCK;
+		cmd.cmd_index = (num_blocks == 1) ? CMD17_READ_SINGLE_BLOCK : CMD18_READ_MULTIPLE_BLOCK;
 
 	/*
 	 * Standard emmc cards use byte mode addressing
@@ -1886,7 +1890,7 @@ uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
 
 	cmd.cmd_type = SDHCI_CMD_TYPE_NORMAL;
 	cmd.resp_type = SDHCI_CMD_RESP_R1;
-	cmd.trans_mode = SDHCI_MMC_READ;
+	cmd.trans_mode = write ? SDHCI_MMC_WRITE : SDHCI_MMC_READ;
 	cmd.data_present = 0x1;
 
 	/* Use CMD23 If card supports CMD23:
@@ -1901,13 +1905,15 @@ uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
 	else
 		cmd.cmd23_support = 0x1;
 
-	cmd.data.data_ptr = dest;
+	cmd.data.data_ptr = buf;
+	cmd.data.segs = segs;
+	cmd.data.num_segs = num_segs;
 	cmd.data.num_blocks = num_blocks;
 
 	/* send command */
 	mmc_ret = sdhci_send_command(&dev->host, &cmd);
 
-	/* For multi block read failures send stop command */
+	/* For multi block read/write failures send stop command */
 	if (mmc_ret && num_blocks > 1)
 	{
 		return mmc_stop_command(dev);
@@ -1920,6 +1926,18 @@ uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
 	return mmc_parse_response(cmd.resp[0]);
 }
 
+/*
+ * Function: mmc sdhci read
+ * Arg     : mmc device structure, block address, number of blocks & destination
+ * Return  : 0 on Success, non zero on success
+ * Flow    : Fill in the command structure & send the command
+ */
+uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
+						uint64_t blk_addr, uint32_t num_blocks)
+{
+	return mmc_sdhci_data_xfer(dev, false, dest, NULL, 0, blk_addr, num_blocks);
+}
+
 /*
  * Function: mmc sdhci write
  * Arg     : mmc device structure, block address, number of blocks & source
@@ -1929,64 +1947,27 @@ uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
 uint32_t mmc_sdhci_write(struct mmc_device *dev, void *src,
 						 uint64_t blk_addr, uint32_t num_blocks)
 {
-	uint32_t mmc_ret = 0;
-	struct mmc_command cmd;
-	struct mmc_card *card = &dev->card;
-
-	memset((struct mmc_command *)&cmd, 0, sizeof(struct mmc_command));
-
-	/* CMD24/25 Format:
-	 * [31:0] Data Address
-	 */
-
-	if (num_blocks == 1)
-		cmd.cmd_index = CMD24_WRITE_SINGLE_BLOCK;
-	else
-		cmd.cmd_index = CMD25_WRITE_MULTIPLE_BLOCK;
-
-	/*
-	 * Standard emmc cards use byte mode addressing
-	 * convert the block address to byte address before
-	 * sending the command
-	 */
-	if (card->type == MMC_TYPE_STD_MMC)
-		cmd.argument = blk_addr * card->block_size;
-	else
-		cmd.argument = blk_addr;
-	cmd.cmd_type = SDHCI_CMD_TYPE_NORMAL;
-	cmd.resp_type = SDHCI_CMD_RESP_R1;
-	cmd.trans_mode = SDHCI_MMC_WRITE;
-
-	/* Use CMD23 If card supports CMD23:
-	 * For SD card use the value read from SCR register
-	 * For emmc by default use CMD23.
-	 * Also as per SDCC spec always use CMD23 to stop
-	 * multiblock read/write if UHS (Ultra High Speed) is
-	 * enabled
-	 */
-	if (MMC_CARD_SD(card))
-		cmd.cmd23_support = dev->card.scr.cmd23_support;
-	else
-		cmd.cmd23_support = 0x1;
-
-	cmd.data_present = 0x1;
-	cmd.data.data_ptr = src;
-	cmd.data.num_blocks = num_blocks;
-
-	/* send command */
-	mmc_ret = sdhci_send_command(&dev->host, &cmd);
+	return mmc_sdhci_data_xfer(dev, true, src, NULL, 0, blk_addr, num_blocks);
+}
 
-	/* For multi block write failures send stop command */
-	if (mmc_ret && num_blocks > 1)
-	{
-		return mmc_stop_command(dev);
-	}
+/*
+ * Function: mmc sdhci read/write sg
+ * Arg     : mmc device structure, buffer segments, block address & number
+ *           of blocks
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Transfer num_blocks contiguous blocks of the card to/from the
+ *           segments with a single command and one adma table.
+ */
+uint32_t mmc_sdhci_read_sg(struct mmc_device *dev, struct mmc_data_seg *segs,
+						   uint32_t num_segs, uint64_t blk_addr, uint32_t num_blocks)
+{
+	return mmc_sdhci_data_xfer(dev, false, NULL, segs, num_segs, blk_addr, num_blocks);
+}
 
-	/*
-	 * Response contains 32 bit Card status.
-	 * Parse the errors & provide relevant information
-	 */
-	return mmc_parse_response(cmd.resp[0]);
+uint32_t mmc_sdhci_write_sg(struct mmc_device *dev, struct mmc_data_seg *segs,
+							uint32_t num_segs, uint64_t blk_addr, uint32_t num_blocks)
+{
+	return mmc_sdhci_data_xfer(dev, true, NULL, segs, num_segs, blk_addr, num_blocks);
 }
 
 /*
@@ -28,6 +28,8 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <malloc.h>
+#include <arch/defines.h>
 #include <mmc_wrapper.h>
 #include <mmc_sdhci.h>
 #include <sdhci.h>
@@ -37,6 +39,39 @@
 #include <partition_parser.h>
 #include <boot_device.h>
 #include <dme.h>
+#include <boot_stats.h>
+#include <list.h>
+#include <kernel/thread.h>
+#include <kernel/mutex.h>
+#include <kernel/event.h>
+
+/* Max requests merged into one adma table by the io thread */
+#define MMC_IO_MERGE_MAX                     8
+
+/* Read-ahead windows kept for the small synchronous reads done at boot */
+#define MMC_RA_WINDOWS                       4
+#define MMC_RA_WINDOW_SZ                     (64 * 1024)
+/* Reads larger than this go straight to the card */
+#define MMC_RA_MAX_READ                      (32 * 1024)
+
+struct mmc_ra_window {
+	uint64_t start;       /* Byte address on the card */
+	uint32_t len;         /* 0 when the window holds nothing */
+	uint8_t lun;
+	uint32_t used;        /* Lru stamp */
+	uint8_t *buf;
+};
+
+static struct list_node mmc_io_queue = LIST_INITIAL_VALUE(mmc_io_queue);
+static event_t mmc_io_event;     /* Requests were queued */
+static event_t mmc_io_idle;      /* Queue is empty & nothing is in flight */
+static mutex_t mmc_io_lock;      /* Serializes data transfers on the card */
+static bool mmc_io_ready;
+static bool mmc_io_started;
+/* Read-ahead state, protected by mmc_io_lock */
+static struct mmc_ra_window mmc_ra[MMC_RA_WINDOWS];
+static uint32_t mmc_ra_clock;
+static struct mmc_read_cache_stats mmc_ra_stats;
 /*
  * Weak function for UFS.
  * These are needed to avoid link errors for platforms which
@@ -53,6 +88,21 @@ __WEAK int ufs_read(struct ufs_dev *dev, uint64_t data_addr, addr_t in, uint32_t
 	return 0;
 }
 
+__WEAK struct ucs_async_req *ufs_read_async(struct ufs_dev *dev, uint64_t data_addr, addr_t in, uint32_t len)
+{
+	return NULL;
+}
+
+__WEAK struct ucs_async_req *ufs_write_async(struct ufs_dev *dev, uint64_t data_addr, addr_t in, uint32_t len)
+{
+	return NULL;
+}
+
+__WEAK int ufs_async_wait(struct ufs_dev *dev, struct ucs_async_req *req)
+{
+	return 0;
+}
+
 __WEAK uint32_t ufs_get_page_size(struct ufs_dev *dev)
 {
 	return 0;
@@ -100,13 +150,38 @@ static struct mmc_card *get_mmc_card()
 	return card;
 }
 
+static void mmc_io_init()
+{
+	if (mmc_io_ready)
+		return;
+
+	mutex_init(&mmc_io_lock);
+	event_init(&mmc_io_event, false, EVENT_FLAG_AUTOUNSIGNAL);
+	event_init(&mmc_io_idle, true, 0);
+	mmc_io_ready = true;
+}
+
 /*
- * Function: mmc_write
- * Arg     : Data address on card, data length, i/p buffer
- * Return  : 0 on Success, non zero on failure
- * Flow    : Write the data from in to the card
+ * Function: mmc ra invalidate
+ * Arg     : Byte address & length on the card
+ * Return  : None
+ * Flow    : Drop the read-ahead windows that overlap a range about to be
+ *           written or erased, or just written asynchronously. Called
+ *           with mmc_io_lock held.
  */
-uint32_t mmc_write(uint64_t data_addr, uint32_t data_len, void *in)
+static void mmc_ra_invalidate(uint64_t addr, uint64_t len)
+{
+	uint32_t i;
+
+	for (i = 0; i < MMC_RA_WINDOWS; i++)
+	{
+		if (mmc_ra[i].len && addr < mmc_ra[i].start + mmc_ra[i].len &&
+			mmc_ra[i].start < addr + len)
+			mmc_ra[i].len = 0;
+	}
+}
+
+static uint32_t __mmc_write(uint64_t data_addr, uint32_t data_len, void *in)
 {
 	uint32_t val = 0;
 	int ret = 0;
@@ -124,6 +199,8 @@ uint32_t mmc_write(uint64_t data_addr, uint32_t data_len, void *in)
 	if (data_len % block_size)
 		data_len = ROUNDUP(data_len, block_size);
 
+	mmc_ra_invalidate(data_addr, data_len);
+
 	/*
 	 * Flush the cache before handing over the data to
 	 * storage driver
@@ -169,13 +246,7 @@ uint32_t mmc_write(uint64_t data_addr, uint32_t data_len, void *in)
 	return val;
 }
 
-/*
- * Function: mmc_read
- * Arg     : Data address on card, o/p buffer & data length
- * Return  : 0 on Success, non zero on failure
- * Flow    : Read data from the card to out
- */
-uint32_t mmc_read(uint64_t data_addr, uint32_t *out, uint32_t data_len)
+static uint32_t __mmc_read(uint64_t data_addr, uint32_t *out, uint32_t data_len)
 {
 	uint32_t ret = 0;
 	uint32_t block_size;
@@ -236,6 +307,469 @@ uint32_t mmc_read(uint64_t data_addr, uint32_t *out, uint32_t data_len)
 	return ret;
 }
 
+/*
+ * Function: mmc ra span
+ * Arg     : Read request, lun & o/p range to read ahead
+ * Return  : 0 if the read falls in a partition on the current lun
+ * Flow    : A partition no bigger than a window is read in full, the
+ *           first time any of it is read. Otherwise read a window's
+ *           worth from the request on, up to the end of the partition.
+ */
+static int mmc_ra_span(uint64_t data_addr, uint32_t data_len, uint8_t lun,
+			uint64_t *start, uint32_t *len)
+{
+	unsigned count = partition_get_partition_count();
+	unsigned long long offset;
+	unsigned long long size;
+	unsigned i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (!platform_boot_dev_isemmc() && partition_get_lun(i) != lun)
+			continue;
+
+		offset = partition_get_offset(i);
+		size = partition_get_size(i);
+
+		if (!size || data_addr < offset || data_addr + data_len > offset + size)
+			continue;
+
+		if (size <= MMC_RA_WINDOW_SZ)
+		{
+			*start = offset;
+			*len = size;
+		}
+		else
+		{
+			*start = data_addr;
+			*len = MIN(MMC_RA_WINDOW_SZ, offset + size - data_addr);
+		}
+
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Function: mmc ra read
+ * Arg     : Data address on card, o/p buffer & data length
+ * Return  : 0 if the read was served from a read-ahead window
+ * Flow    : Copy the data out of a window holding it, or fill the least
+ *           recently used window around the request first. Reads that
+ *           are too large or outside any partition are left to the
+ *           caller. Called with mmc_io_lock held.
+ */
+static int mmc_ra_read(uint64_t data_addr, void *out, uint32_t data_len)
+{
+	struct mmc_ra_window *win = NULL;
+	uint8_t lun = mmc_get_lun();
+	uint64_t start;
+	uint32_t len;
+	uint32_t i;
+
+	if (!data_len || data_len > MMC_RA_MAX_READ)
+		goto bypass;
+
+	for (i = 0; i < MMC_RA_WINDOWS; i++)
+	{
+		if (mmc_ra[i].len && mmc_ra[i].lun == lun && data_addr >= mmc_ra[i].start &&
+			data_addr + data_len <= mmc_ra[i].start + mmc_ra[i].len)
+		{
+			win = &mmc_ra[i];
+			mmc_ra_stats.hits++;
+			goto copy;
+		}
+	}
+
+	if (mmc_ra_span(data_addr, data_len, lun, &start, &len))
+		goto bypass;
+
+	/* Refill the least recently used window, empty ones first */
+	win = &mmc_ra[0];
+	for (i = 1; i < MMC_RA_WINDOWS && win->len; i++)
+	{
+		if (!mmc_ra[i].len || mmc_ra[i].used < win->used)
+			win = &mmc_ra[i];
+	}
+
+	if (!win->buf)
+	{
+		win->buf = memalign(CACHE_LINE, MMC_RA_WINDOW_SZ);
+		if (!win->buf)
+			goto bypass;
+	}
+
+	win->len = 0;
+	if (__mmc_read(start, (uint32_t *) win->buf, len))
+		goto bypass;
+
+	win->start = start;
+	win->len = len;
+	win->lun = lun;
+	mmc_ra_stats.misses++;
+	mmc_ra_stats.prefetched += len - data_len;
+
+copy:
+	win->used = ++mmc_ra_clock;
+	memcpy(out, win->buf + (data_addr - win->start), data_len);
+	return 0;
+
+bypass:
+	mmc_ra_stats.bypassed++;
+	return 1;
+}
+
+/*
+ * Function: mmc read cache get stats
+ * Arg     : o/p stats
+ * Return  : None
+ * Flow    : Copy out the read-ahead counters
+ */
+void mmc_read_cache_get_stats(struct mmc_read_cache_stats *stats)
+{
+	mmc_io_init();
+
+	mutex_acquire(&mmc_io_lock);
+	*stats = mmc_ra_stats;
+	mutex_release(&mmc_io_lock);
+}
+
+/*
+ * Function: mmc_write
+ * Arg     : Data address on card, data length, i/p buffer
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Write the data from in to the card
+ */
+uint32_t mmc_write(uint64_t data_addr, uint32_t data_len, void *in)
+{
+	uint32_t ret;
+
+	mmc_io_init();
+
+	mutex_acquire(&mmc_io_lock);
+	ret = __mmc_write(data_addr, data_len, in);
+	mutex_release(&mmc_io_lock);
+
+	return ret;
+}
+
+/*
+ * Function: mmc_read
+ * Arg     : Data address on card, o/p buffer & data length
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Read data from the card to out
+ */
+uint32_t mmc_read(uint64_t data_addr, uint32_t *out, uint32_t data_len)
+{
+	struct bs_trace trace;
+	uint32_t ret;
+
+	mmc_io_init();
+
+	bs_trace_begin(&trace, "mmc_read");
+	mutex_acquire(&mmc_io_lock);
+	if (mmc_ra_read(data_addr, out, data_len))
+		ret = __mmc_read(data_addr, out, data_len);
+	else
+		ret = 0;
+	mutex_release(&mmc_io_lock);
+	bs_trace_end(&trace);
+
+	return ret;
+}
+
+/*
+ * Function: mmc io merge max
+ * Arg     : None
+ * Return  : Number of queued requests that can go out as one transfer
+ * Flow    : Only emmc can merge. A merged batch is one CMD18/CMD25, so it
+ *           is bounded by what the host can move in one transfer: the
+ *           block count register, see mmc_io_merge_bytes(). The adma
+ *           table is sized per transfer, one segment per request.
+ */
+static uint32_t mmc_io_merge_max()
+{
+	if (!platform_boot_dev_isemmc())
+		return 1;
+
+	return MMC_IO_MERGE_MAX;
+}
+
+/*
+ * Function: mmc io merge bytes
+ * Arg     : None
+ * Return  : Largest transfer a merged batch may add up to
+ */
+static uint32_t mmc_io_merge_bytes()
+{
+	return SDHCI_MAX_BLK_CNT * mmc_get_device_blocksize();
+}
+
+/*
+ * Function: mmc io run
+ * Arg     : Requests that are contiguous on the card & their count
+ * Return  : None
+ * Flow    : Transfer the requests, a batch of more than one request goes
+ *           out as a single CMD18/CMD25 with an adma table that spans all
+ *           the request buffers. Completes every request in the batch.
+ */
+static void mmc_io_run(struct mmc_request **batch, uint32_t count)
+{
+	struct mmc_data_seg segs[MMC_IO_MERGE_MAX];
+	struct mmc_device *dev = NULL;
+	uint32_t block_size = mmc_get_device_blocksize();
+	uint32_t num_blocks = 0;
+	uint32_t status = 0;
+	uint32_t i;
+
+	mutex_acquire(&mmc_io_lock);
+
+	if (platform_boot_dev_isemmc())
+	{
+		dev = (struct mmc_device *) target_mmc_device();
+		dev->host.yield_wait = true;
+	}
+
+	if (count > 1)
+	{
+		for (i = 0; i < count; i++)
+		{
+			segs[i].data_ptr = batch[i]->buf;
+			segs[i].len = batch[i]->len;
+			num_blocks += batch[i]->len / block_size;
+			arch_clean_invalidate_cache_range((addr_t) batch[i]->buf, batch[i]->len);
+		}
+
+		if (batch[0]->write)
+		{
+			mmc_ra_invalidate(batch[0]->data_addr, (uint64_t) num_blocks * block_size);
+			status = mmc_sdhci_write_sg(dev, segs, count, batch[0]->data_addr / block_size, num_blocks);
+		}
+		else
+			status = mmc_sdhci_read_sg(dev, segs, count, batch[0]->data_addr / block_size, num_blocks);
+
+		if (status)
+			dprintf(CRITICAL, "Failed %s blocks @ %x\n", batch[0]->write ? "writing" : "reading",
+					(unsigned int) (batch[0]->data_addr / block_size));
+
+		for (i = 0; i < count; i++)
+			batch[i]->status = status;
+	}
+	else
+	{
+		if (batch[0]->write)
+			batch[0]->status = __mmc_write(batch[0]->data_addr, batch[0]->len, batch[0]->buf);
+		else
+			batch[0]->status = __mmc_read(batch[0]->data_addr, batch[0]->buf, batch[0]->len);
+	}
+
+	if (dev)
+		dev->host.yield_wait = false;
+
+	mutex_release(&mmc_io_lock);
+
+	for (i = 0; i < count; i++)
+		event_signal(&batch[i]->done, false);
+}
+
+static int mmc_io_thread(void *arg)
+{
+	struct mmc_request *batch[MMC_IO_MERGE_MAX];
+	struct mmc_request *next;
+	uint32_t merge_max = mmc_io_merge_max();
+	uint32_t merge_bytes = mmc_io_merge_bytes();
+	uint32_t total;
+	uint32_t count;
+
+	for (;;)
+	{
+		event_wait(&mmc_io_event);
+
+		for (;;)
+		{
+			enter_critical_section();
+
+			batch[0] = list_remove_head_type(&mmc_io_queue, struct mmc_request, node);
+			if (!batch[0])
+			{
+				event_signal(&mmc_io_idle, false);
+				exit_critical_section();
+				break;
+			}
+
+			/* Pull in the requests that continue this one on the card */
+			count = 1;
+			total = batch[0]->len;
+			while (count < merge_max)
+			{
+				next = list_peek_head_type(&mmc_io_queue, struct mmc_request, node);
+				if (!next || next->write != batch[0]->write ||
+					next->data_addr != batch[count - 1]->data_addr + batch[count - 1]->len ||
+					total + next->len > merge_bytes)
+					break;
+
+				list_delete(&next->node);
+				batch[count++] = next;
+				total += next->len;
+			}
+
+			exit_critical_section();
+
+			mmc_io_run(batch, count);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Function: mmc ufs submit
+ * Arg     : Request, filled in by mmc_submit_read/mmc_submit_write
+ * Return  : None
+ * Flow    : Ufs spreads the request over its own doorbells, so start it
+ *           right away instead of going through the io thread. mmc_wait
+ *           reaps it.
+ */
+static void mmc_ufs_submit(struct mmc_request *req)
+{
+	struct ufs_dev *dev = (struct ufs_dev *) target_mmc_device();
+	uint32_t num_blocks = req->len / mmc_get_device_blocksize();
+
+	mutex_acquire(&mmc_io_lock);
+
+	arch_clean_invalidate_cache_range((addr_t) req->buf, req->len);
+
+	if (req->write)
+	{
+		mmc_ra_invalidate(req->data_addr, req->len);
+		req->ufs_req = ufs_write_async(dev, req->data_addr, (addr_t) req->buf, num_blocks);
+	}
+	else
+		req->ufs_req = ufs_read_async(dev, req->data_addr, (addr_t) req->buf, num_blocks);
+
+	mutex_release(&mmc_io_lock);
+
+	/* Could not be queued, do the transfer right here */
+	if (!req->ufs_req)
+		mmc_io_run(&req, 1);
+}
+
+/*
+ * Function: mmc_submit
+ * Arg     : Request, filled in by mmc_submit_read/mmc_submit_write
+ * Return  : None
+ * Flow    : Queue the request for the io thread & return right away.
+ */
+static void mmc_submit(struct mmc_request *req)
+{
+	thread_t *thr;
+	uint32_t block_size = mmc_get_device_blocksize();
+
+	ASSERT(!(req->data_addr % block_size));
+	ASSERT(!(req->len % block_size));
+
+	mmc_io_init();
+
+	req->status = 0;
+	req->ufs_req = NULL;
+	event_init(&req->done, false, 0);
+
+	if (!platform_boot_dev_isemmc())
+	{
+		mmc_ufs_submit(req);
+		return;
+	}
+
+	if (!mmc_io_started)
+	{
+		thr = thread_create("mmc_io", mmc_io_thread, NULL, DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+		if (!thr)
+		{
+			/* Fall back to doing the transfer right here */
+			dprintf(CRITICAL, "Failed to create mmc io thread\n");
+			mmc_io_run(&req, 1);
+			return;
+		}
+		mmc_io_started = true;
+		thread_resume(thr);
+	}
+
+	enter_critical_section();
+	list_add_tail(&mmc_io_queue, &req->node);
+	event_unsignal(&mmc_io_idle);
+	event_signal(&mmc_io_event, false);
+	exit_critical_section();
+}
+
+void mmc_submit_read(struct mmc_request *req, uint64_t data_addr, void *out, uint32_t data_len)
+{
+	req->data_addr = data_addr;
+	req->buf = out;
+	req->len = data_len;
+	req->write = false;
+
+	mmc_submit(req);
+}
+
+void mmc_submit_write(struct mmc_request *req, uint64_t data_addr, void *in, uint32_t data_len)
+{
+	req->data_addr = data_addr;
+	req->buf = in;
+	req->len = data_len;
+	req->write = true;
+
+	mmc_submit(req);
+}
+
+/*
+ * Function: mmc_wait
+ * Arg     : Request passed to mmc_submit_read/mmc_submit_write
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Block until the io thread has completed the request, ufs
+ *           requests are reaped here.
+ */
+uint32_t mmc_wait(struct mmc_request *req)
+{
+	if (req->ufs_req)
+	{
+		mutex_acquire(&mmc_io_lock);
+		req->status = ufs_async_wait((struct ufs_dev *) target_mmc_device(), req->ufs_req);
+		/* The lock was dropped while the write was in flight, a read
+		 * may have refilled a window from the old data meanwhile.
+		 */
+		if (req->write)
+			mmc_ra_invalidate(req->data_addr, req->len);
+		mutex_release(&mmc_io_lock);
+
+		if (!req->write)
+			arch_invalidate_cache_range((addr_t) req->buf, req->len);
+
+		req->ufs_req = NULL;
+		event_signal(&req->done, false);
+	}
+
+	event_wait(&req->done);
+	event_destroy(&req->done);
+
+	return req->status;
+}
+
+/*
+ * Function: mmc_flush_requests
+ * Arg     : None
+ * Return  : None
+ * Flow    : Block until every queued request has completed. Ufs
+ *           requests are not queued, they complete in mmc_wait.
+ */
+void mmc_flush_requests()
+{
+	if (!mmc_io_ready)
+		return;
+
+	event_wait(&mmc_io_idle);
+}
+
 
 /*
  * Function: mmc get erase unit size
@@ -320,12 +854,13 @@ static uint32_t mmc_zero_out(struct mmc_device* dev, uint32_t blk_addr, uint32_t
 }
 
 /*
- * Function: mmc erase card
+ * Function: __mmc_erase_card
  * Arg     : Block address & length
  * Return  : Returns 0
- * Flow    : Erase the card from specified addr
+ * Flow    : Erase the card from specified addr. Called with
+ *           mmc_io_lock held.
  */
-uint32_t mmc_erase_card(uint64_t addr, uint64_t len)
+static uint32_t __mmc_erase_card(uint64_t addr, uint64_t len)
 {
 	struct mmc_device *dev;
 	uint32_t block_size;
@@ -416,6 +951,28 @@ uint32_t mmc_erase_card(uint64_t addr, uint64_t len)
 	return 0;
 }
 
+/*
+ * Function: mmc erase card
+ * Arg     : Block address & length
+ * Return  : Returns 0
+ * Flow    : Erase the card from specified addr. The lock is held across
+ *           the erase so no read-ahead of the old contents can refill
+ *           the window in between.
+ */
+uint32_t mmc_erase_card(uint64_t addr, uint64_t len)
+{
+	uint32_t ret;
+
+	mmc_io_init();
+
+	mutex_acquire(&mmc_io_lock);
+	mmc_ra_invalidate(addr, len);
+	ret = __mmc_erase_card(addr, len);
+	mutex_release(&mmc_io_lock);
+
+	return ret;
+}
+
 /*
  * Function: mmc get psn
  * Arg     : None
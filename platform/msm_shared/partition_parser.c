@@ -86,6 +86,20 @@ static unsigned partition_count;
 /* this is a pointer to ptn_entries_buffer */
 static unsigned char *new_buffer = NULL;
 
+/*
+ * Name index over partition_entries: buckets hold the first entry with a
+ * given name hash and entries are chained in increasing index order, so a
+ * lookup returns the same (lowest) index as a linear scan.
+ */
+#define PTN_HASH_BUCKETS           256
+static int16_t ptn_hash_head[PTN_HASH_BUCKETS];
+static int16_t ptn_hash_next[NUM_PARTITIONS];
+/* 1-based position of each entry within its LUN */
+static uint8_t ptn_lun_rank[NUM_PARTITIONS];
+static bool ptn_index_valid = false;
+
+static void partition_index_build();
+
 unsigned partition_get_partition_count()
 {
 	return partition_count;
@@ -110,6 +124,9 @@ unsigned int partition_read_table()
 		ASSERT(partition_entries);
 	}
 
+	/* Entries get appended below, the index is rebuilt once they are read */
+	ptn_index_valid = false;
+
 	/* Read MBR of the card */
 	ret = mmc_boot_read_mbr(block_size);
 	if (ret) {
@@ -130,6 +147,8 @@ unsigned int partition_read_table()
 	/* TODO: Move this to mmc_boot_read_gpt() */
 	partition_scan_for_multislot();
 
+	partition_index_build();
+
 	return 0;
 }
 
@@ -516,55 +535,12 @@ static unsigned int write_mbr(uint32_t size, uint8_t *mbrImage, uint32_t block_s
 	return ret;
 }
 
-/*
- * A8h reflected is 15h, i.e. 10101000 <--> 00010101
-*/
-int reflect(int data, int len)
-{
-	int ref = 0;
-
-	for (int i = 0; i < len; i++) {
-		if (data & 0x1) {
-			ref |= (1 << ((len - 1) - i));
-		}
-		data = (data >> 1);
-	}
-
-	return ref;
-}
-
 /*
 * Function to calculate the CRC32
 */
 unsigned int calculate_crc32(unsigned char *buffer, int len)
 {
-	int byte_length = 8;	/*length of unit (i.e. byte) */
-	int msb = 0;
-	int polynomial = 0x04C11DB7;	/* IEEE 32bit polynomial */
-	unsigned int regs = 0xFFFFFFFF;	/* init to all ones */
-	int regs_mask = 0xFFFFFFFF;	/* ensure only 32 bit answer */
-	int regs_msb = 0;
-	unsigned int reflected_regs;
-
-	for (int i = 0; i < len; i++) {
-		int data_byte = buffer[i];
-		data_byte = reflect(data_byte, 8);
-		for (int j = 0; j < byte_length; j++) {
-			msb = data_byte >> (byte_length - 1);	/* get MSB */
-			msb &= 1;	/* ensure just 1 bit */
-			regs_msb = (regs >> 31) & 1;	/* MSB of regs */
-			regs = regs << 1;	/* shift regs for CRC-CCITT */
-			if (regs_msb ^ msb) {	/* MSB is a 1 */
-				regs = regs ^ polynomial;	/* XOR with generator poly */
-			}
-			regs = regs & regs_mask;	/* Mask off excess upper bits */
-			data_byte <<= 1;	/* get to next bit */
-		}
-	}
-	regs = regs & regs_mask;
-	reflected_regs = reflect(regs, 32) ^ 0xFFFFFFFF;
-
-	return reflected_regs;
+	return crc32(~0L, buffer, len) ^ (~0L);
 }
 
 /*
@@ -824,6 +800,9 @@ unsigned int write_partition(unsigned size, unsigned char *partition)
 		goto end;
 	}
 
+	/* Entries are about to change, rebuilt on the next lookup */
+	ptn_index_valid = false;
+
 	block_size = mmc_get_device_blocksize();
 	/* size is from target_get_max_flash_size and it will check at
 	* cmd_download if it is size > download_max it will fail early
@@ -932,109 +911,131 @@ mbr_fill_name(struct partition_entry *partition_ent, unsigned int type)
 	};
 }
 
+static uint32_t ptn_name_hash(uint32_t hash, const char *str, unsigned int len)
+{
+	/* FNV-1a */
+	while (len-- && *str)
+		hash = (hash ^ (uint8_t)*str++) * 16777619;
+
+	return hash;
+}
+
+#define PTN_HASH_SEED              2166136261U
+
+static void partition_index_build()
+{
+	uint8_t lun_count[256] = {0};
+	uint32_t bucket;
+	int n;
+
+	memset(ptn_hash_head, 0xff, sizeof(ptn_hash_head));
+
+	/* Insert backwards so each chain ends up in increasing index order */
+	for (n = (int)MIN(partition_count, NUM_PARTITIONS) - 1; n >= 0; n--)
+	{
+		bucket = ptn_name_hash(PTN_HASH_SEED,
+				(const char *)partition_entries[n].name,
+				MAX_GPT_NAME_SIZE) & (PTN_HASH_BUCKETS - 1);
+		ptn_hash_next[n] = ptn_hash_head[bucket];
+		ptn_hash_head[bucket] = n;
+	}
+
+	for (n = 0; n < (int)MIN(partition_count, NUM_PARTITIONS); n++)
+		ptn_lun_rank[n] = ++lun_count[partition_entries[n].lun];
+
+	ptn_index_valid = true;
+}
+
 /*
- * Find index of parition in array of partition entries
+ * Lowest index of the entry named name followed by suffix (may be NULL),
+ * restricted to lun unless lun is negative.
  */
-int partition_get_index(const char *name)
+static int partition_index_lookup(const char *name, const char *suffix, int lun)
 {
-	unsigned int input_string_length = strlen(name);
-	unsigned n;
-	int curr_slot = INVALID;
-	const char *suffix_curr_actv_slot = NULL;
-	char *curr_suffix = NULL;
+	unsigned int len = strlen(name);
+	unsigned int suffix_len = suffix ? strlen(suffix) : 0;
+	uint32_t hash;
+	int n;
 
-	if( partition_count >= NUM_PARTITIONS)
-	{
+	if (!partition_entries)
 		return INVALID_PTN;
-	}
 
-	/*	We iterate through the parition entries list,
-		to find the partition with active slot suffix.
-	*/
-	for (n = 0; n < partition_count; n++)
+	if (!ptn_index_valid)
+		partition_index_build();
+
+	hash = ptn_name_hash(PTN_HASH_SEED, name, len);
+	if (suffix)
+		hash = ptn_name_hash(hash, suffix, suffix_len);
+
+	for (n = ptn_hash_head[hash & (PTN_HASH_BUCKETS - 1)]; n >= 0; n = ptn_hash_next[n])
 	{
-		if (!strncmp((const char*)name, (const char *)partition_entries[n].name,
-					input_string_length))
-		{
-			curr_suffix = (char *)(partition_entries[n].name+input_string_length);
+		const char *pname = (const char *)partition_entries[n].name;
 
-			/* if partition_entries.name is NULL terminated return the index */
-			if (*curr_suffix == '\0')
-				return n;
+		if (lun >= 0 && partition_entries[n].lun != lun)
+			continue;
 
-			if (partition_multislot_is_supported())
-			{
-				curr_slot = partition_find_active_slot();
-
-				/* If suffix string matches with current active slot suffix return index */
-				if (curr_slot != INVALID)
-				{
-					suffix_curr_actv_slot = SUFFIX_SLOT(curr_slot);
-					if (!strncmp((const char *)curr_suffix, suffix_curr_actv_slot,
-							strlen(suffix_curr_actv_slot)))
-						return n;
-					else
-						continue;
-				}
-				else
-				{
-					/* No valid active slot */
-					return INVALID_PTN;
-				}
-			}
-		}
+		if (strncmp(pname, name, len))
+			continue;
+
+		if (suffix ? !strcmp(pname + len, suffix) : pname[len] == '\0')
+			return n;
 	}
+
 	return INVALID_PTN;
 }
 
 /*
- * Find relative index of partition in lun
+ * Index of name, or of name with the active slot suffix on A/B devices,
+ * whichever comes first in lun (any lun if negative).
  */
-int partition_get_index_in_lun(const char *name, unsigned int lun)
+static int partition_index_find(const char *name, int lun)
 {
-	unsigned int input_string_length = strlen(name);
-	unsigned int n, relative_index = 0;
-	int curr_slot = INVALID;
-	const char *suffix_curr_actv_slot = NULL;
-	char *curr_suffix = NULL;
-	for (n = 0; n < partition_count; n++)
+	int index, slot_index;
+	int curr_slot;
+
+	index = partition_index_lookup(name, NULL, lun);
+
+	if (!partition_multislot_is_supported())
+		return index;
+
+	curr_slot = partition_find_active_slot();
+
+	/* No valid active slot */
+	if (curr_slot == INVALID)
+		return index;
+
+	slot_index = partition_index_lookup(name, SUFFIX_SLOT(curr_slot), lun);
+
+	if (index == INVALID_PTN || (slot_index != INVALID_PTN && slot_index < index))
+		return slot_index;
+
+	return index;
+}
+
+/*
+ * Find index of parition in array of partition entries
+ */
+int partition_get_index(const char *name)
+{
+	if( partition_count >= NUM_PARTITIONS)
 	{
-		if (lun == partition_entries[n].lun)
-		{
-			relative_index++;
-			if (!strncmp((const char*)name, (const char *)partition_entries[n].name,
-					input_string_length))
-			{
-				curr_suffix = (char *)(partition_entries[n].name+input_string_length);
-
-				/* if partition_entries.name is NULL terminated return relative index */
-				if (*curr_suffix == '\0')
-					return relative_index;
-
-				if (partition_multislot_is_supported())
-				{
-					curr_slot = partition_find_active_slot();
-
-					/* If suffix string matches with current active slot suffix return index */
-					if (curr_slot != INVALID)
-					{
-						suffix_curr_actv_slot = SUFFIX_SLOT(curr_slot);
-						if (!strncmp((const char *)curr_suffix, suffix_curr_actv_slot,
-							strlen(suffix_curr_actv_slot)))
-							return relative_index;
-						else
-							continue;
-					}
-					else
-					{
-						/* No valid active slot */
-						return INVALID_PTN;
-					}
-				}
-			}
-		}
+		return INVALID_PTN;
 	}
-	return INVALID_PTN;
+
+	return partition_index_find(name, -1);
+}
+
+/*
+ * Find relative index of partition in lun
+ */
+int partition_get_index_in_lun(const char *name, unsigned int lun)
+{
+	int n = partition_index_find(name, lun);
+
+	if (n == INVALID_PTN)
+		return INVALID_PTN;
+
+	return ptn_lun_rank[n];
 }
 
 /* Get size of the partition */
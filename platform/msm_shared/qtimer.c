@@ -31,6 +31,7 @@
 #include <compiler.h>
 #include <qtimer.h>
 #include <kernel/thread.h>
+#include <init_graph.h>
 
 static uint32_t ticks_per_sec;
 
@@ -46,25 +47,85 @@ status_t platform_set_periodic_timer(platform_timer_callback callback,
 	return 0;
 }
 
+#if PLATFORM_HAS_DYNAMIC_TIMER
+/* Without a periodic tick the time comes straight from the counter */
+time_t current_time(void)
+{
+	return qtimer_counter_time();
+}
+
+/* Arm the comparator for the next timer deadline, interval msecs after the
+ * current millisecond started, the resolution current_time() has.
+ */
+status_t platform_set_oneshot_timer(platform_timer_callback callback,
+	void *arg, time_t interval)
+{
+	uint64_t ticks_per_ms = ticks_per_sec / 1000;
+	uint64_t cnt;
+	uint64_t ticks = 0;
+
+	enter_critical_section();
+
+	cnt = qtimer_get_phy_timer_cnt();
+	if (interval)
+		ticks = (uint64_t) interval * ticks_per_ms - (cnt % ticks_per_ms);
+
+	/* The down counter is 32 bit signed, a far deadline just takes
+	 * more than one expiry to reach.
+	 */
+	if (ticks > QTMR_TVAL_MAX)
+		ticks = QTMR_TVAL_MAX;
+
+	qtimer_set_oneshot_timer((uint32_t) ticks, callback, arg);
+
+	exit_critical_section();
+	return 0;
+}
+
+void platform_stop_timer(void)
+{
+	qtimer_disable();
+}
+#else
 time_t current_time(void)
 {
 	return qtimer_current_time();
 }
+#endif
+
+/* Milliseconds since the counter started */
+uint32_t qtimer_counter_time()
+{
+	if (!ticks_per_sec)
+		return 0;
+
+	return (uint32_t) (qtimer_get_phy_timer_cnt() / (ticks_per_sec / 1000));
+}
 
 void qtimer_uninit()
 {
 	qtimer_disable();
 }
 
+/* Delays at least this long give up the cpu while init tasks run */
+#define QTMR_YIELD_MIN_USEC    100
+
 /* Blocking function to wait until the specified ticks of the timer.
  * Note: ticks to wait for cannot be more than 56 bit.
  *          Should be sufficient for all practical purposes.
+ * While init tasks run in parallel the wait yields to them instead of
+ * spinning, unless it is short or called with interrupts off.
  */
 static void delay(uint64_t ticks)
 {
 	volatile uint64_t cnt;
 	uint64_t init_cnt;
 	uint64_t timeout = 0;
+	bool yield = false;
+
+	if (ticks >= ((uint64_t) ticks_per_sec * QTMR_YIELD_MIN_USEC) / 1000000 &&
+		!in_critical_section() && init_tasks_running())
+		yield = true;
 
 	cnt = qtimer_get_phy_timer_cnt();
 	init_cnt = cnt;
@@ -78,13 +139,21 @@ static void delay(uint64_t ticks)
 	 * in cases where there is a wrapping.
 	 */
 	while(timeout < cnt && init_cnt <= cnt)
+	{
+		if (yield)
+			thread_yield();
 		/* read global counter */
 		cnt = qtimer_get_phy_timer_cnt();
+	}
 
 	/* Wait till the number of ticks is reached*/
 	while(timeout > cnt)
+	{
+		if (yield)
+			thread_yield();
 		/* read global counter */
 		cnt = qtimer_get_phy_timer_cnt();
+	}
 
 }
 
@@ -110,7 +179,10 @@ void udelay(unsigned usecs)
 /* Return current time in micro seconds */
 bigtime_t current_time_hires(void)
 {
-	return qtimer_current_time() * 1000000ULL;
+	if (!ticks_per_sec)
+		return 0;
+
+	return (qtimer_get_phy_timer_cnt() * 1000ULL) / (ticks_per_sec / 1000);
 }
 
 void qtimer_init()
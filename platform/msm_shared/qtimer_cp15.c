@@ -40,12 +40,20 @@ static time_t timer_interval;
 /* time in ms from start of LK. */
 static volatile uint32_t current_time;
 static uint32_t tick_count;
+/* set while the timer fires once per qtimer_set_oneshot_timer() */
+static bool timer_oneshot;
 
 extern void isb();
 static void qtimer_enable();
 
 static enum handler_return qtimer_irq(void *arg)
 {
+	if (timer_oneshot)
+	{
+		qtimer_disable();
+		return timer_callback(timer_arg, qtimer_counter_time());
+	}
+
 	current_time += timer_interval;
 
 	/* Program the down counter again to get
@@ -71,6 +79,7 @@ void qtimer_set_physical_timer(time_t msecs_interval,
 	timer_interval = msecs_interval;
 	timer_arg = tmr_arg;
 	timer_callback = tmr_callback;
+	timer_oneshot = false;
 
 	/* Set Physical Down Counter */
 	__asm__ volatile("mcr p15, 0, %0, c14, c2, 0" : :"r" (tick_count));
@@ -87,6 +96,28 @@ void qtimer_set_physical_timer(time_t msecs_interval,
 
 }
 
+/* Programs the Physical Down counter to expire once.
+ * ticks : Counter ticks till expiry interrupt is fired.
+ */
+void qtimer_set_oneshot_timer(uint32_t ticks,
+	platform_timer_callback tmr_callback,
+	void *tmr_arg)
+{
+	qtimer_disable();
+
+	timer_arg = tmr_arg;
+	timer_callback = tmr_callback;
+	timer_oneshot = true;
+
+	__asm__ volatile("mcr p15, 0, %0, c14, c2, 0" : :"r" (ticks));
+	isb();
+
+	qtimer_enable();
+
+	register_int_handler(INT_QTMR_NON_SECURE_PHY_TIMER_EXP, qtimer_irq, 0);
+	unmask_interrupt(INT_QTMR_NON_SECURE_PHY_TIMER_EXP);
+}
+
 static void qtimer_enable()
 {
 	uint32_t ctrl;
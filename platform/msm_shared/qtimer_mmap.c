@@ -42,11 +42,19 @@ static time_t timer_interval;
 /* time in ms from start of LK. */
 static volatile uint32_t current_time;
 static uint32_t tick_count;
+/* set while the timer fires once per qtimer_set_oneshot_timer() */
+static bool timer_oneshot;
 
 static void qtimer_enable();
 
 static enum handler_return qtimer_irq(void *arg)
 {
+	if (timer_oneshot)
+	{
+		qtimer_disable();
+		return timer_callback(timer_arg, qtimer_counter_time());
+	}
+
 	current_time += timer_interval;
 
 	/* Program the down counter again to get
@@ -73,6 +81,7 @@ void qtimer_set_physical_timer(time_t msecs_interval,
 	timer_interval = msecs_interval;
 	timer_arg = tmr_arg;
 	timer_callback = tmr_callback;
+	timer_oneshot = false;
 
 	/* Set Physical Down Counter */
 	writel(tick_count, QTMR_V1_CNTP_TVAL);
@@ -85,6 +94,29 @@ void qtimer_set_physical_timer(time_t msecs_interval,
 	qtimer_enable();
 }
 
+/* Programs the Physical Down counter to expire once.
+ * ticks : Counter ticks till expiry interrupt is fired.
+ */
+void qtimer_set_oneshot_timer(uint32_t ticks,
+							  platform_timer_callback tmr_callback,
+							  void *tmr_arg)
+{
+	qtimer_disable();
+
+	timer_arg = tmr_arg;
+	timer_callback = tmr_callback;
+	timer_oneshot = true;
+
+	writel(ticks, QTMR_V1_CNTP_TVAL);
+	dsb();
+
+	register_int_handler(INT_QTMR_FRM_0_PHYSICAL_TIMER_EXP, qtimer_irq, 0);
+
+	unmask_interrupt(INT_QTMR_FRM_0_PHYSICAL_TIMER_EXP);
+
+	qtimer_enable();
+}
+
 
 /* Function to return the frequency of the timer */
 uint32_t qtimer_get_frequency()
@@ -35,6 +35,13 @@
 #include <rpm-glink.h>
 #include <rpm-smd.h>
 #include <string.h>
+#include <kernel/mutex.h>
+
+/* Requests and their acks must not interleave when init tasks on other
+ * threads talk to rpm at the same time.
+ */
+static mutex_t rpm_lock;
+static bool rpm_lock_init;
 
 __WEAK glink_err_type rpm_glink_send_data(uint32_t *data, uint32_t len, msg_type type)
 {
@@ -64,12 +71,24 @@ int rpm_send_data(uint32_t *data, uint32_t len, msg_type type)
 {
 	int ret = 0;
 
+	enter_critical_section();
+	if (!rpm_lock_init)
+	{
+		mutex_init(&rpm_lock);
+		rpm_lock_init = true;
+	}
+	exit_critical_section();
+
+	mutex_acquire(&rpm_lock);
+
 	/* Runtime select to call glink or smd */
 	if (platform_is_glink_enabled())
 		ret = rpm_glink_send_data(data, len, type);
 	else
 		ret = rpm_smd_send_data(data, len, type);
 
+	mutex_release(&rpm_lock);
+
 	return ret;
 }
 
@@ -16,6 +16,7 @@ OBJS += \
 	$(LOCAL_DIR)/ab_partition_parser.o \
 	$(LOCAL_DIR)/hsusb.o \
 	$(LOCAL_DIR)/boot_stats.o \
+	$(LOCAL_DIR)/init_graph.o \
 	$(LOCAL_DIR)/qgic_common.o \
 	$(LOCAL_DIR)/crc32.o
 
@@ -32,6 +33,10 @@ ifeq ($(ENABLE_QGIC3), 1)
 OBJS += $(LOCAL_DIR)/qgic_v3.o
 endif
 
+ifeq ($(ENABLE_SMP), 1)
+OBJS += $(LOCAL_DIR)/smp.o
+endif
+
 ifeq ($(ENABLE_SMD_SUPPORT),1)
 OBJS += \
 	$(LOCAL_DIR)/rpm-ipc.o \
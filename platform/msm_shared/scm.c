@@ -40,6 +40,7 @@
 #include <qseecomi_lk.h>
 #include <qseecom_lk_api.h>
 #include <boot_device.h>
+#include <kernel/mutex.h>
 #include "scm.h"
 
 #pragma GCC optimize ("O0")
@@ -71,6 +72,30 @@
 bool scm_arm_support;
 static bool scm_initialized;
 
+/* An interrupted call is resumed by reissuing the smc, so calls from init
+ * tasks on different threads must not interleave.
+ */
+static mutex_t scm_lock;
+static bool scm_lock_init;
+
+static void scm_acquire(void)
+{
+	enter_critical_section();
+	if (!scm_lock_init)
+	{
+		mutex_init(&scm_lock);
+		scm_lock_init = true;
+	}
+	exit_critical_section();
+
+	mutex_acquire(&scm_lock);
+}
+
+static void scm_release(void)
+{
+	mutex_release(&scm_lock);
+}
+
 bool is_scm_armv8_support()
 {
 	if (!scm_initialized)
@@ -298,7 +323,9 @@ scm_call(uint32_t svc_id, uint32_t cmd_id, const void *cmd_buf,
 	/* Flush command to main memory for TZ */
 	arch_clean_invalidate_cache_range((addr_t) cmd, cmd->len);
 
+	scm_acquire();
 	ret = smc((uint32_t) cmd);
+	scm_release();
 	if (ret)
 		goto out;
 
@@ -1246,7 +1273,9 @@ uint32_t scm_call2(scmcall_arg *arg, scmcall_ret *ret)
 		x5 = (addr_t) indir_arg;
 	}
 
+	scm_acquire();
 	rc = scm_call_a32(arg->x0, arg->x1, arg->x2, arg->x3, arg->x4, x5, ret);
+	scm_release();
 
 	if (rc)
 	{
@@ -1462,3 +1491,46 @@ bool allow_set_fuse(uint32_t version)
     return FALSE;
   }
 }
+
+/* PSCI calls take their arguments in r1-r3 and return in r0 only, they
+ * are never interrupted like scm calls.
+ */
+static int psci_call(uint32_t fn, uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+	register uint32_t r0 __asm__("r0") = fn;
+	register uint32_t r1 __asm__("r1") = arg1;
+	register uint32_t r2 __asm__("r2") = arg2;
+	register uint32_t r3 __asm__("r3") = arg3;
+
+	__asm__ volatile(
+		__asmeq("%0", "r0")
+		__asmeq("%1", "r0")
+		__asmeq("%2", "r1")
+		__asmeq("%3", "r2")
+		__asmeq("%4", "r3")
+		"smc    #0  @ switch to secure world\n"
+		: "=r" (r0)
+		: "r" (r0), "r" (r1), "r" (r2), "r" (r3)
+		: "memory");
+
+	return (int) r0;
+}
+
+/* Power up the core, it starts at entry with the mmu off and context_id
+ * in r0.
+ */
+int psci_cpu_on(uint32_t mpidr, paddr_t entry, uint32_t context_id)
+{
+	return psci_call(PSCI_0_2_FN_CPU_ON, mpidr, (uint32_t) entry, context_id);
+}
+
+/* Power down the calling core, does not return on success */
+void psci_cpu_off(void)
+{
+	psci_call(PSCI_0_2_FN_CPU_OFF, 0, 0, 0);
+}
+
+int psci_affinity_info(uint32_t mpidr)
+{
+	return psci_call(PSCI_0_2_FN_AFFINITY_INFO, mpidr, 0, 0);
+}
@@ -31,6 +31,7 @@
 #include <platform/interrupts.h>
 #include <platform/timer.h>
 #include <kernel/event.h>
+#include <kernel/thread.h>
 #include <target.h>
 #include <string.h>
 #include <stdlib.h>
@@ -538,6 +539,13 @@ static uint8_t sdhci_cmd_complete(struct sdhci_host *host, struct mmc_command *c
 
 			retry++;
 			udelay(1);
+
+			/* Long transfers issued from the mmc io thread let the
+			 * other threads run while the controller moves data.
+			 */
+			if (host->yield_wait && !(retry % SDHCI_YIELD_INTERVAL))
+				thread_yield();
+
 			if (retry == max_trans_retry) {
 				dprintf(CRITICAL, "Error: Transfer never completed\n");
 				ret = 1;
@@ -592,83 +600,73 @@ err:
 
 /*
  * Function: sdhci prep desc table
- * Arg     : Pointer data & length
+ * Arg     : Array of data segments & number of segments
  * Return  : Pointer to desc table
- * Flow:   : Prepare the adma table as per the sd spec v 3.0
+ * Flow:   : Prepare the adma table as per the sd spec v 3.0. Every segment
+ *           is split into descriptor lines, only the very last line of the
+ *           table carries the end attribute so the controller walks all the
+ *           segments as one transfer.
  */
-static struct desc_entry *sdhci_prep_desc_table(void *data, uint32_t len)
+static struct desc_entry *sdhci_prep_desc_table(struct mmc_data_seg *segs, uint32_t num_segs)
 {
 	struct desc_entry *sg_list;
 	uint32_t sg_len = 0;
-	uint32_t remain = 0;
 	uint32_t i;
+	uint32_t n = 0;
 	uint32_t table_len = 0;
+	uint32_t len;
+	uint8_t *data;
 
-	if (len <= SDHCI_ADMA_DESC_LINE_SZ) {
-		/* Allocate only one descriptor */
-		sg_list = (struct desc_entry *) memalign(lcm(4, CACHE_LINE), ROUNDUP(sizeof(struct desc_entry), CACHE_LINE));
+	/* Calculate the number of entries in desc table */
+	for (i = 0; i < num_segs; i++)
+		sg_len += (segs[i].len + SDHCI_ADMA_DESC_LINE_SZ - 1) / SDHCI_ADMA_DESC_LINE_SZ;
 
-		if (!sg_list) {
-			dprintf(CRITICAL, "Error allocating memory\n");
-			ASSERT(0);
-		}
+	ASSERT(sg_len);
 
-		sg_list[0].addr = (uint32_t)data;
-		sg_list[0].len = (len < SDHCI_ADMA_DESC_LINE_SZ) ? len : (SDHCI_ADMA_DESC_LINE_SZ & 0xffff);
-		sg_list[0].tran_att = SDHCI_ADMA_TRANS_VALID | SDHCI_ADMA_TRANS_DATA
-							  | SDHCI_ADMA_TRANS_END;
+	table_len = (sg_len * sizeof(struct desc_entry));
 
-		sg_len = 1;
-		table_len = sizeof(struct desc_entry);
-	} else {
-		/* Calculate the number of entries in desc table */
-		sg_len = len / SDHCI_ADMA_DESC_LINE_SZ;
-		remain = len - (sg_len * SDHCI_ADMA_DESC_LINE_SZ);
+	sg_list = (struct desc_entry *) memalign(lcm(4, CACHE_LINE), ROUNDUP(table_len, CACHE_LINE));
 
-		/* Allocate sg_len + 1 entries if there are remaining bytes at the end */
-		if (remain)
-			sg_len++;
-
-		table_len = (sg_len * sizeof(struct desc_entry));
+	if (!sg_list) {
+		dprintf(CRITICAL, "Error allocating memory\n");
+		ASSERT(0);
+	}
 
-		sg_list = (struct desc_entry *) memalign(lcm(4, CACHE_LINE), ROUNDUP(table_len, CACHE_LINE));
+	memset((void *) sg_list, 0, table_len);
 
-		if (!sg_list) {
-			dprintf(CRITICAL, "Error allocating memory\n");
-			ASSERT(0);
-		}
+	/*
+	 * Prepare sglist in the format:
+	 *  ___________________________________________________
+	 * |Transfer Len | Transfer ATTR | Data Address        |
+	 * | (16 bit)    | (16 bit)      | (32 bit)            |
+	 * |_____________|_______________|_____________________|
+	 */
+	for (i = 0; i < num_segs; i++) {
+		data = segs[i].data_ptr;
+		len = segs[i].len;
 
-		memset((void *) sg_list, 0, table_len);
+		while (len) {
+			sg_list[n].addr = (uint32_t)data;
+			/*
+			 * Length attribute is 16 bit value & max transfer size for one
+			 * descriptor line is 65536 bytes, As per SD Spec3.0 'len = 0'
+			 * implies 65536 bytes. Truncate the length to limit to 16 bit
+			 * range.
+			 */
+			sg_list[n].len = (len < SDHCI_ADMA_DESC_LINE_SZ) ? len : (SDHCI_ADMA_DESC_LINE_SZ & 0xffff);
+			sg_list[n].tran_att = SDHCI_ADMA_TRANS_VALID | SDHCI_ADMA_TRANS_DATA;
 
-		/*
-		 * Prepare sglist in the format:
-		 *  ___________________________________________________
-		 * |Transfer Len | Transfer ATTR | Data Address        |
-		 * | (16 bit)    | (16 bit)      | (32 bit)            |
-		 * |_____________|_______________|_____________________|
-		 */
-		for (i = 0; i < (sg_len - 1); i++) {
-				sg_list[i].addr = (uint32_t)data;
-				/*
-				 * Length attribute is 16 bit value & max transfer size for one
-				 * descriptor line is 65536 bytes, As per SD Spec3.0 'len = 0'
-				 * implies 65536 bytes. Truncate the length to limit to 16 bit
-				 * range.
-				 */
-				sg_list[i].len = (SDHCI_ADMA_DESC_LINE_SZ & 0xffff);
-				sg_list[i].tran_att = SDHCI_ADMA_TRANS_VALID | SDHCI_ADMA_TRANS_DATA;
-				data += SDHCI_ADMA_DESC_LINE_SZ;
+			if (len < SDHCI_ADMA_DESC_LINE_SZ)
+				len = 0;
+			else
 				len -= SDHCI_ADMA_DESC_LINE_SZ;
-			}
-
-			/* Fill the last entry of the table with Valid & End
-			 * attributes
-			 */
-			sg_list[sg_len - 1].addr = (uint32_t)data;
-			sg_list[sg_len - 1].len = (len < SDHCI_ADMA_DESC_LINE_SZ) ? len : (SDHCI_ADMA_DESC_LINE_SZ & 0xffff);
-			sg_list[sg_len - 1].tran_att = SDHCI_ADMA_TRANS_VALID | SDHCI_ADMA_TRANS_DATA |
-										   SDHCI_ADMA_TRANS_END;
+			data += SDHCI_ADMA_DESC_LINE_SZ;
+			n++;
 		}
+	}
+
+	/* Mark the last entry of the table with the End attribute */
+	sg_list[sg_len - 1].tran_att |= SDHCI_ADMA_TRANS_END;
 
 	arch_clean_invalidate_cache_range((addr_t)sg_list, table_len);
 
@@ -694,12 +692,11 @@ static struct desc_entry *sdhci_adma_transfer(struct sdhci_host *host,
 {
 	uint32_t num_blks = 0;
 	uint32_t sz;
-	void *data;
+	struct mmc_data_seg seg;
 	struct desc_entry *adma_addr;
 
 
 	num_blks = cmd->data.num_blocks;
-	data = cmd->data.data_ptr;
 
 	/*
 	 * Some commands send data on DAT lines which is less
@@ -715,7 +712,16 @@ static struct desc_entry *sdhci_adma_transfer(struct sdhci_host *host,
 		sz = num_blks * SDHCI_MMC_BLK_SZ;
 
 	/* Prepare adma descriptor table */
-	adma_addr = sdhci_prep_desc_table(data, sz);
+	if (cmd->data.num_segs)
+	{
+		adma_addr = sdhci_prep_desc_table(cmd->data.segs, cmd->data.num_segs);
+	}
+	else
+	{
+		seg.data_ptr = cmd->data.data_ptr;
+		seg.len = sz;
+		adma_addr = sdhci_prep_desc_table(&seg, 1);
+	}
 
 	/* Write adma address to adma register */
 	REG_WRITE32(host, (uint32_t) adma_addr, SDHCI_ADM_ADDR_REG);
@@ -751,13 +757,14 @@ uint32_t sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 	uint16_t trans_mode = 0;
 	uint16_t present_state;
 	uint32_t flags;
+	uint32_t i;
 	struct desc_entry *sg_list = NULL;
 
 	DBG("\n %s: START: cmd:%04d, arg:0x%08x, resp_type:0x%04x, data_present:%d\n",
 				__func__, cmd->cmd_index, cmd->argument, cmd->resp_type, cmd->data_present);
 
 	if (cmd->data_present)
-		ASSERT(cmd->data.data_ptr);
+		ASSERT(cmd->data.data_ptr || cmd->data.num_segs);
 
 	/*
 	 * Assert if the data buffer is not aligned to cache
@@ -769,7 +776,15 @@ uint32_t sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 	 * certain image formats like sparse image.
 	 */
 	if (cmd->trans_mode == SDHCI_READ_MODE)
-		ASSERT(IS_CACHE_LINE_ALIGNED(cmd->data.data_ptr));
+	{
+		if (cmd->data.num_segs)
+		{
+			for (i = 0; i < cmd->data.num_segs; i++)
+				ASSERT(IS_CACHE_LINE_ALIGNED(cmd->data.segs[i].data_ptr));
+		}
+		else
+			ASSERT(IS_CACHE_LINE_ALIGNED(cmd->data.data_ptr));
+	}
 
 	do {
 		present_state = REG_READ32(host, SDHCI_PRESENT_STATE_REG);
@@ -906,9 +921,15 @@ uint32_t sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 		/* Read can be performed on block size < SDHCI_MMC_BLK_SZ, make sure to flush
 		 * the data only for the read size instead
 		 */
-		arch_invalidate_cache_range((addr_t)cmd->data.data_ptr, (cmd->data.blk_sz) ? \
-									(cmd->data.num_blocks * cmd->data.blk_sz) : \
-									(cmd->data.num_blocks * SDHCI_MMC_BLK_SZ));
+		if (cmd->data.num_segs)
+		{
+			for (i = 0; i < cmd->data.num_segs; i++)
+				arch_invalidate_cache_range((addr_t)cmd->data.segs[i].data_ptr, cmd->data.segs[i].len);
+		}
+		else
+			arch_invalidate_cache_range((addr_t)cmd->data.data_ptr, (cmd->data.blk_sz) ? \
+										(cmd->data.num_blocks * cmd->data.blk_sz) : \
+										(cmd->data.num_blocks * SDHCI_MMC_BLK_SZ));
 	}
 
 	DBG("\n %s: END: cmd:%04d, arg:0x%08x, resp:0x%08x 0x%08x 0x%08x 0x%08x\n",
@@ -0,0 +1,73 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <kernel/smp.h>
+#include <scm.h>
+
+/* Secondary cores are powered through PSCI. Cpu numbers are dense, with
+ * SMP_CPUS_PER_CLUSTER cores in each cluster: MPIDR Aff1 is the cluster
+ * and Aff0 the core within it.
+ */
+#define MPIDR_AFF0(mpidr)	((mpidr) & 0xff)
+#define MPIDR_AFF1(mpidr)	(((mpidr) >> 8) & 0xff)
+
+static uint32_t smp_cpu_mpidr(uint cpu)
+{
+	return ((cpu / SMP_CPUS_PER_CLUSTER) << 8) | (cpu % SMP_CPUS_PER_CLUSTER);
+}
+
+uint platform_smp_curr_cpu(void)
+{
+	uint32_t mpidr;
+
+	__asm__ volatile("mrc p15, 0, %0, c0, c0, 5" : "=r" (mpidr));
+
+	return MPIDR_AFF1(mpidr) * SMP_CPUS_PER_CLUSTER + MPIDR_AFF0(mpidr);
+}
+
+int platform_smp_cpu_on(uint cpu, addr_t entry)
+{
+	int ret;
+
+	ret = psci_cpu_on(smp_cpu_mpidr(cpu), (paddr_t) entry, cpu);
+	if (ret)
+		dprintf(INFO, "PSCI cpu on for cpu %u failed: %d\n", cpu, ret);
+
+	return ret;
+}
+
+void platform_smp_cpu_off(void)
+{
+	psci_cpu_off();
+}
+
+bool platform_smp_cpu_is_off(uint cpu)
+{
+	return psci_affinity_info(smp_cpu_mpidr(cpu)) == PSCI_AFFINITY_OFF;
+}
@@ -35,6 +35,7 @@
 #include <platform/interrupts.h>
 #include <malloc.h>
 #include <platform.h>
+#include <kernel/thread.h>
 
 #define PMIC_ARB_V2 0x20010000
 #define CHNL_IDX(sid, pid) ((sid << 8) | pid)
@@ -130,8 +131,8 @@ static void write_wdata_from_array(uint8_t *array,
  *
  * return value : 0 if success, the error bit set on error
  */
-unsigned int pmic_arb_write_cmd(struct pmic_arb_cmd *cmd,
-                                struct pmic_arb_param *param)
+static unsigned int __pmic_arb_write_cmd(struct pmic_arb_cmd *cmd,
+                                         struct pmic_arb_param *param)
 {
 	uint32_t bytes_written = 0;
 	uint32_t error;
@@ -203,6 +204,21 @@ unsigned int pmic_arb_write_cmd(struct pmic_arb_cmd *cmd,
 		return 0;
 }
 
+/* The channel number and command registers are shared, init tasks on
+ * other threads may issue commands at the same time.
+ */
+unsigned int pmic_arb_write_cmd(struct pmic_arb_cmd *cmd,
+                                struct pmic_arb_param *param)
+{
+	unsigned int ret;
+
+	enter_critical_section();
+	ret = __pmic_arb_write_cmd(cmd, param);
+	exit_critical_section();
+
+	return ret;
+}
+
 static void read_rdata_into_array(uint8_t *array,
                                   uint8_t reg_num,
                                   uint8_t array_size,
@@ -242,8 +258,8 @@ static void read_rdata_into_array(uint8_t *array,
  *
  * return value : 0 if success, the error bit set on error
  */
-unsigned int pmic_arb_read_cmd(struct pmic_arb_cmd *cmd,
-                               struct pmic_arb_param *param)
+static unsigned int __pmic_arb_read_cmd(struct pmic_arb_cmd *cmd,
+                                        struct pmic_arb_param *param)
 {
 	uint32_t val = 0;
 	uint32_t error;
@@ -325,6 +341,17 @@ unsigned int pmic_arb_read_cmd(struct pmic_arb_cmd *cmd,
 	return 0;
 }
 
+unsigned int pmic_arb_read_cmd(struct pmic_arb_cmd *cmd,
+                               struct pmic_arb_param *param)
+{
+	unsigned int ret;
+
+	enter_critical_section();
+	ret = __pmic_arb_read_cmd(cmd, param);
+	exit_critical_section();
+
+	return ret;
+}
 
 /* Funtion to determine if the peripheral that caused the interrupt
  * is of interest.
@@ -432,11 +459,15 @@ void pmic_spmi_reg_mask_write(uint32_t addr, uint8_t mask, uint8_t val)
 {
 	uint8_t reg;
 
+	enter_critical_section();
+
 	reg = pmic_spmi_reg_read(addr);
 
 	reg &= ~mask;
 	reg |= val & mask;
 	pmic_spmi_reg_write(addr, reg);
+
+	exit_critical_section();
 }
 
 void spmi_uninit()
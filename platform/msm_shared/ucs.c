@@ -33,56 +33,79 @@
 #include <utp.h>
 #include <rpmb.h>
 
-int ucs_do_scsi_cmd(struct ufs_dev *dev, struct scsi_req_build_type *req)
-{
-	struct upiu_req_build_type req_upiu;
-	struct upiu_basic_resp_hdr      resp_upiu;
-
-	memset(&req_upiu, 0 , sizeof(struct upiu_req_build_type));
-
-	req_upiu.cmd_set_type	   = UPIU_SCSI_CMD_SET;
-	req_upiu.trans_type	       = UPIU_TYPE_COMMAND;
-	req_upiu.data_buffer_addr  = req->data_buffer_addr;
-	req_upiu.expected_data_len = req->data_len;
-	req_upiu.data_seg_len	   = 0;
-	req_upiu.ehs_len		   = 0;
-	req_upiu.flags			   = req->flags;
-	req_upiu.lun			   = req->lun;
-	req_upiu.query_mgmt_func   = 0;
-	req_upiu.cdb			   = req->cdb;
-	req_upiu.cmd_type		   = UTRD_SCSCI_CMD;
-	req_upiu.dd			       = req->dd;
-	req_upiu.resp_ptr		   = &resp_upiu;
-	req_upiu.resp_len		   = sizeof(resp_upiu);
-	req_upiu.timeout_msecs	   = UTP_GENERIC_CMD_TIMEOUT;
+/* Don't split a transfer into commands smaller than 1MB. */
+#define UCS_MIN_BLKS_PER_UPIU          256
+#define UCS_MAX_ASYNC_BLKS             (UTP_MAX_ASYNC_UTRD * SCSI_MAX_DATA_TRANS_BLK_LEN)
 
-	if (utp_enqueue_upiu(dev, &req_upiu))
-	{
-		dprintf(CRITICAL, "ucs_do_scsi_cmd: enqueue failed\n");
-		return -UFS_FAILURE;
-	}
+struct ucs_async_req
+{
+	struct utp_async_batch     batch;
+	struct upiu_req_build_type req_upiu[UTP_MAX_ASYNC_UTRD];
+	struct upiu_basic_resp_hdr resp_upiu[UTP_MAX_ASYNC_UTRD];
+	struct scsi_rdwr_cdb       cdb[UTP_MAX_ASYNC_UTRD];
+};
+
+static void ucs_fill_scsi_upiu(struct scsi_req_build_type *req, struct upiu_req_build_type *req_upiu,
+							   struct upiu_basic_resp_hdr *resp_upiu)
+{
+	memset(req_upiu, 0 , sizeof(struct upiu_req_build_type));
+
+	req_upiu->cmd_set_type	    = UPIU_SCSI_CMD_SET;
+	req_upiu->trans_type	    = UPIU_TYPE_COMMAND;
+	req_upiu->data_buffer_addr  = req->data_buffer_addr;
+	req_upiu->expected_data_len = req->data_len;
+	req_upiu->data_seg_len	    = 0;
+	req_upiu->ehs_len		    = 0;
+	req_upiu->flags			    = req->flags;
+	req_upiu->lun			    = req->lun;
+	req_upiu->query_mgmt_func   = 0;
+	req_upiu->cdb			    = req->cdb;
+	req_upiu->cmd_type		    = UTRD_SCSCI_CMD;
+	req_upiu->dd			    = req->dd;
+	req_upiu->resp_ptr		    = resp_upiu;
+	req_upiu->resp_len		    = sizeof(*resp_upiu);
+	req_upiu->timeout_msecs	    = UTP_GENERIC_CMD_TIMEOUT;
+}
 
-	if (resp_upiu.status != SCSI_STATUS_GOOD)
+static int ucs_check_scsi_resp(uint8_t opcode, struct upiu_basic_resp_hdr *resp_upiu)
+{
+	if (resp_upiu->status != SCSI_STATUS_GOOD)
 	{
-		if (resp_upiu.status == SCSI_STATUS_CHK_COND && (*((uint8_t *)(req->cdb)) != SCSI_CMD_SENSE_REQ))
+		if (resp_upiu->status == SCSI_STATUS_CHK_COND && opcode != SCSI_CMD_SENSE_REQ)
 		{
-			dprintf(CRITICAL, "Data segment length: %x\n", BE16(resp_upiu.data_seg_len));
-			if (BE16(resp_upiu.data_seg_len))
+			dprintf(CRITICAL, "Data segment length: %x\n", BE16(resp_upiu->data_seg_len));
+			if (BE16(resp_upiu->data_seg_len))
 			{
 				dprintf(CRITICAL, "SCSI Request failed and we have sense data\n");
-				dprintf(CRITICAL, "Sense Data Length/Response Code: 0x%x/0x%x\n", BE16(resp_upiu.sense_length), BE16(resp_upiu.sense_response_code));
-				parse_sense_key(resp_upiu.sense_data[0]);
-				dprintf(CRITICAL, "Sense Buffer (HEX): 0x%x 0x%x 0x%x 0x%x\n", BE32(resp_upiu.sense_data[0]), BE32(resp_upiu.sense_data[1]), BE32(resp_upiu.sense_data[2]), BE32(resp_upiu.sense_data[3]));
+				dprintf(CRITICAL, "Sense Data Length/Response Code: 0x%x/0x%x\n", BE16(resp_upiu->sense_length), BE16(resp_upiu->sense_response_code));
+				parse_sense_key(resp_upiu->sense_data[0]);
+				dprintf(CRITICAL, "Sense Buffer (HEX): 0x%x 0x%x 0x%x 0x%x\n", BE32(resp_upiu->sense_data[0]), BE32(resp_upiu->sense_data[1]), BE32(resp_upiu->sense_data[2]), BE32(resp_upiu->sense_data[3]));
 			}
 		}
 
-		dprintf(CRITICAL, "ucs_do_scsi_cmd failed status = %x\n", resp_upiu.status);
+		dprintf(CRITICAL, "ucs_do_scsi_cmd failed status = %x\n", resp_upiu->status);
 		return -UFS_FAILURE;
 	}
 
 	return UFS_SUCCESS;
 }
 
+int ucs_do_scsi_cmd(struct ufs_dev *dev, struct scsi_req_build_type *req)
+{
+	struct upiu_req_build_type req_upiu;
+	struct upiu_basic_resp_hdr      resp_upiu;
+
+	ucs_fill_scsi_upiu(req, &req_upiu, &resp_upiu);
+
+	if (utp_enqueue_upiu(dev, &req_upiu))
+	{
+		dprintf(CRITICAL, "ucs_do_scsi_cmd: enqueue failed\n");
+		return -UFS_FAILURE;
+	}
+
+	return ucs_check_scsi_resp(*((uint8_t *)(req->cdb)), &resp_upiu);
+}
+
 int parse_sense_key(uint32_t sense_data)
 {
 	uint32_t key = BE32(sense_data) >> 24;
@@ -235,127 +258,139 @@ int ucs_do_scsi_rpmb_read(struct ufs_dev *dev, uint32_t *req_buf, uint32_t blk_c
 	return UFS_SUCCESS;
 }
 
-int ucs_do_scsi_read(struct ufs_dev *dev, struct scsi_rdwr_req *req)
+/*
+ * Splits the transfer into READ10/WRITE10 commands of at least
+ * UCS_MIN_BLKS_PER_UPIU blocks each, spread over as many UTRD slots as that
+ * gives (up to UTP_MAX_ASYNC_UTRD), and rings them all at once so that the
+ * device can work on the next command while the current one is on the link.
+ * The caller reaps the request with ucs_wait_scsi_rdwr_async().
+ */
+struct ucs_async_req *ucs_do_scsi_rdwr_async(struct ufs_dev *dev, struct scsi_rdwr_req *req, bool write)
 {
-	STACKBUF_DMA_ALIGN(cdb, sizeof(struct scsi_rdwr_cdb));
-	struct scsi_req_build_type     req_upiu;
-	struct scsi_rdwr_cdb           *cdb_param;
+	struct ucs_async_req           *areq;
+	struct scsi_req_build_type     scsi_req;
 	uint32_t                       blks_remaining;
-	uint16_t                       blks_to_transfer;
-	uint64_t                       bytes_to_transfer;
+	uint32_t                       blks_per_upiu;
+	uint32_t                       blks_to_transfer;
 	uint32_t                       start_blk;
 	uint32_t                       buf;
+	uint32_t                       i;
+
+	if (!req->num_blocks || req->num_blocks > UCS_MAX_ASYNC_BLKS)
+	{
+		dprintf(CRITICAL, "%s: Invalid transfer length: %u blocks\n", __func__, req->num_blocks);
+		return NULL;
+	}
+
+	areq = (struct ucs_async_req *) malloc(sizeof(struct ucs_async_req));
+	if (!areq)
+	{
+		dprintf(CRITICAL, "%s: Failed to allocate the request\n", __func__);
+		return NULL;
+	}
 
+	blks_per_upiu  = MAX(UCS_MIN_BLKS_PER_UPIU, ROUNDUP(req->num_blocks, UTP_MAX_ASYNC_UTRD) / UTP_MAX_ASYNC_UTRD);
+	blks_per_upiu  = MIN(blks_per_upiu, SCSI_MAX_DATA_TRANS_BLK_LEN);
 	blks_remaining = req->num_blocks;
 	buf            = req->data_buffer_base;
 	start_blk      = req->start_lba;
 
-	cdb_param = (struct scsi_rdwr_cdb*) cdb;
-	while (blks_remaining)
+	for (i = 0; blks_remaining; i++)
 	{
-		if (blks_remaining <= SCSI_MAX_DATA_TRANS_BLK_LEN)
-		{
-			blks_to_transfer = blks_remaining;
-			blks_remaining   = 0;
-		}
-		else
-		{
-			blks_to_transfer = SCSI_MAX_DATA_TRANS_BLK_LEN;
-			blks_remaining  -= SCSI_MAX_DATA_TRANS_BLK_LEN;
-		}
+		blks_to_transfer = MIN(blks_remaining, blks_per_upiu);
 
-		bytes_to_transfer = blks_to_transfer * UFS_DEFAULT_SECTORE_SIZE;
+		memset(&areq->cdb[i], 0, sizeof(struct scsi_rdwr_cdb));
+		areq->cdb[i].opcode    = write ? SCSI_CMD_WRITE10 : SCSI_CMD_READ10;
+		areq->cdb[i].cdb1      = SCSI_READ_WRITE_10_CDB1(0, 0, 1, 0);
+		areq->cdb[i].lba       = BE32(start_blk);
+		areq->cdb[i].trans_len = BE16(blks_to_transfer);
 
-		memset(cdb_param, 0, sizeof(struct scsi_rdwr_cdb));
-		cdb_param->opcode    = SCSI_CMD_READ10;
-		cdb_param->cdb1      = SCSI_READ_WRITE_10_CDB1(0, 0, 1, 0);
-		cdb_param->lba       = BE32(start_blk);
-		cdb_param->trans_len = BE16(blks_to_transfer);
+		memset(&scsi_req, 0 , sizeof(struct scsi_req_build_type));
 
+		scsi_req.cdb              = (addr_t) &areq->cdb[i];
+		scsi_req.data_buffer_addr = buf;
+		scsi_req.data_len         = blks_to_transfer * UFS_DEFAULT_SECTORE_SIZE;
+		scsi_req.flags            = write ? UPIU_FLAGS_WRITE : UPIU_FLAGS_READ;
+		scsi_req.lun              = req->lun;
+		scsi_req.dd               = write ? UTRD_SYSTEM_TO_TARGET : UTRD_TARGET_TO_SYSTEM;
 
-		dsb();
-		arch_clean_invalidate_cache_range((addr_t) cdb_param, sizeof(struct scsi_rdwr_cdb));
+		ucs_fill_scsi_upiu(&scsi_req, &areq->req_upiu[i], &areq->resp_upiu[i]);
+		areq->batch.upiu[i] = &areq->req_upiu[i];
 
-		memset(&req_upiu, 0 , sizeof(struct scsi_req_build_type));
-
-		req_upiu.cdb               = (addr_t) cdb_param;
-		req_upiu.data_buffer_addr  = buf;
-		req_upiu.data_len = bytes_to_transfer;
-		req_upiu.flags             = UPIU_FLAGS_READ;
-		req_upiu.lun               = req->lun;
-		req_upiu.dd                = UTRD_TARGET_TO_SYSTEM;
+		buf            += scsi_req.data_len;
+		start_blk      += blks_to_transfer;
+		blks_remaining -= blks_to_transfer;
+	}
 
-		if (ucs_do_scsi_cmd(dev, &req_upiu))
-		{
-			dprintf(CRITICAL, "ucs_do_scsi_read: failed\n");
-			return -UFS_FAILURE;
-		}
+	areq->batch.count = i;
 
-		buf       += bytes_to_transfer;
-		start_blk += SCSI_MAX_DATA_TRANS_BLK_LEN;
+	if (utp_enqueue_upiu_async(dev, &areq->batch))
+	{
+		dprintf(CRITICAL, "%s: enqueue failed\n", __func__);
+		free(areq);
+		return NULL;
 	}
 
-	return UFS_SUCCESS;
+	return areq;
 }
 
-int ucs_do_scsi_write(struct ufs_dev *dev, struct scsi_rdwr_req *req)
+int ucs_wait_scsi_rdwr_async(struct ufs_dev *dev, struct ucs_async_req *areq)
+{
+	int      ret;
+	uint32_t i;
+
+	ret = utp_wait_upiu_async(dev, &areq->batch);
+
+	for (i = 0; !ret && i < areq->batch.count; i++)
+		ret = ucs_check_scsi_resp(areq->cdb[i].opcode, &areq->resp_upiu[i]);
+
+	free(areq);
+
+	return ret;
+}
+
+static int ucs_do_scsi_rdwr(struct ufs_dev *dev, struct scsi_rdwr_req *req, bool write)
 {
-	struct scsi_req_build_type     req_upiu;
-	STACKBUF_DMA_ALIGN(cdb, sizeof(struct scsi_rdwr_cdb));
-	struct scsi_rdwr_cdb           *cdb_param;
+	struct scsi_rdwr_req           batch_req;
+	struct ucs_async_req           *areq;
 	uint32_t                       blks_remaining;
-	uint16_t                       blks_to_transfer;
-	uint64_t                       bytes_to_transfer;
-	uint32_t                       start_blk;
-	uint32_t                       buf;
 
+	batch_req      = *req;
 	blks_remaining = req->num_blocks;
-	buf = req->data_buffer_base;
-	start_blk = req->start_lba;
 
-	cdb_param = (struct scsi_rdwr_cdb*) cdb;
 	while (blks_remaining)
 	{
-		if (blks_remaining <= SCSI_MAX_DATA_TRANS_BLK_LEN)
-		{
-			blks_to_transfer = blks_remaining;
-			blks_remaining   = 0;
-		}
-		else
-		{
-			blks_to_transfer = SCSI_MAX_DATA_TRANS_BLK_LEN;
-			blks_remaining  -= SCSI_MAX_DATA_TRANS_BLK_LEN;
-		}
-
-		bytes_to_transfer = blks_to_transfer * UFS_DEFAULT_SECTORE_SIZE;
+		batch_req.num_blocks = MIN(blks_remaining, UCS_MAX_ASYNC_BLKS);
 
-		memset(cdb_param, 0, sizeof(struct scsi_rdwr_cdb));
-		cdb_param->opcode    = SCSI_CMD_WRITE10;
-		cdb_param->cdb1      = SCSI_READ_WRITE_10_CDB1(0, 0, 1, 0);
-		cdb_param->lba       = BE32(start_blk);
-		cdb_param->trans_len = BE16(blks_to_transfer);
+		areq = ucs_do_scsi_rdwr_async(dev, &batch_req, write);
+		if (!areq || ucs_wait_scsi_rdwr_async(dev, areq))
+			return -UFS_FAILURE;
 
-		/* Flush cdb to memory. */
-		dsb();
-		arch_clean_invalidate_cache_range((addr_t) cdb_param, sizeof(struct scsi_rdwr_cdb));
+		batch_req.data_buffer_base += batch_req.num_blocks * UFS_DEFAULT_SECTORE_SIZE;
+		batch_req.start_lba        += batch_req.num_blocks;
+		blks_remaining             -= batch_req.num_blocks;
+	}
 
-		memset(&req_upiu, 0 , sizeof(struct scsi_req_build_type));
+	return UFS_SUCCESS;
+}
 
-		req_upiu.cdb               = (addr_t) cdb_param;
-		req_upiu.data_buffer_addr  = buf;
-		req_upiu.data_len          = bytes_to_transfer;
-		req_upiu.flags             = UPIU_FLAGS_WRITE;
-		req_upiu.lun               = req->lun;
-		req_upiu.dd                = UTRD_SYSTEM_TO_TARGET;
+int ucs_do_scsi_read(struct ufs_dev *dev, struct scsi_rdwr_req *req)
+{
+	if (ucs_do_scsi_rdwr(dev, req, false))
+	{
+		dprintf(CRITICAL, "ucs_do_scsi_read: failed\n");
+		return -UFS_FAILURE;
+	}
 
-		if (ucs_do_scsi_cmd(dev, &req_upiu))
-		{
-			dprintf(CRITICAL, "ucs_do_scsi_write: failed\n");
-			return -UFS_FAILURE;
-		}
+	return UFS_SUCCESS;
+}
 
-		buf       += bytes_to_transfer;
-		start_blk += SCSI_MAX_DATA_TRANS_BLK_LEN;
+int ucs_do_scsi_write(struct ufs_dev *dev, struct scsi_rdwr_req *req)
+{
+	if (ucs_do_scsi_rdwr(dev, req, true))
+	{
+		dprintf(CRITICAL, "ucs_do_scsi_write: failed\n");
+		return -UFS_FAILURE;
 	}
 
 	return UFS_SUCCESS;
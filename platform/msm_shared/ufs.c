@@ -53,6 +53,7 @@ static int ufs_dev_init(struct ufs_dev *dev)
 
 	/* Initialize the bitmaps. */
 	dev->utrd_data.bitmap  = 0;
+	dev->utrd_data.async_bits = 0;
 	dev->utmrd_data.bitmap = 0;
 
 	/* Initialize task ids. */
@@ -161,6 +162,48 @@ int ufs_write(struct ufs_dev* dev, uint64_t start_lba, addr_t buffer, uint32_t n
 	return ret;
 }
 
+static struct ucs_async_req *ufs_rdwr_async(struct ufs_dev* dev, uint64_t start_lba, addr_t buffer,
+											uint32_t num_blocks, bool write)
+{
+	struct scsi_rdwr_req req;
+	struct ucs_async_req *areq;
+
+	req.data_buffer_base = buffer;
+	req.lun              = dev->current_lun;
+	req.num_blocks       = num_blocks;
+	req.start_lba        = start_lba / dev->block_size;
+
+	areq = ucs_do_scsi_rdwr_async(dev, &req, write);
+	if (!areq)
+		dprintf(CRITICAL, "UFS %s submit failed.\n", write ? "write" : "read");
+
+	return areq;
+}
+
+struct ucs_async_req *ufs_read_async(struct ufs_dev* dev, uint64_t start_lba, addr_t buffer, uint32_t num_blocks)
+{
+	return ufs_rdwr_async(dev, start_lba, buffer, num_blocks, false);
+}
+
+struct ucs_async_req *ufs_write_async(struct ufs_dev* dev, uint64_t start_lba, addr_t buffer, uint32_t num_blocks)
+{
+	return ufs_rdwr_async(dev, start_lba, buffer, num_blocks, true);
+}
+
+int ufs_async_wait(struct ufs_dev* dev, struct ucs_async_req *req)
+{
+	int ret;
+
+	ret = ucs_wait_scsi_rdwr_async(dev, req);
+	if (ret)
+	{
+		dprintf(CRITICAL, "UFS async transfer failed.\n");
+		ufs_dump_hc_registers(dev);
+	}
+
+	return ret;
+}
+
 int ufs_erase(struct ufs_dev* dev, uint64_t start_lba, uint32_t num_blocks)
 {
 	struct scsi_unmap_req req;
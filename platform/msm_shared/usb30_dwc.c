@@ -638,6 +638,76 @@ uint8_t dwc_event_check_trb_status(dwc_dev_t *dev,
 	return status;
 }
 
+/* complete the oldest request queued on a bulk ep:
+ * works out how much data got transferred from the TRBs of the request and
+ * reclaims the TRBs skipped by h/w when a short pkt ended the request early.
+ * Then releases its TRB ring space and informs the client.
+ */
+static void dwc_ep_bulk_request_complete(dwc_dev_t *dev, dwc_ep_t *ep)
+{
+	dwc_request_t req;
+	dwc_trb_t    *trb;
+	uint32_t      bytes_remaining = 0;
+	uint32_t      ring_bytes;
+	uint8_t       status          = 0;
+	uint8_t       trb_updated     = 0;
+
+	if (!ep->req_count)
+	{
+		ERR("\n No request queued on ep_phy_num = %d. ignored.\n", ep->phy_num);
+		dwc_print_current_state(dev);
+		return;
+	}
+
+	req        = ep->req_queue[ep->req_head];
+	trb        = &ep->trb[req.trb_first];
+	ring_bytes = ROUNDUP(req.trb_num, DWC_TRBS_PER_LINE) * sizeof(dwc_trb_t);
+
+	/* invalidate trb data before reading */
+	arch_invalidate_cache_range((addr_t) trb, ring_bytes);
+
+	for (uint32_t i = 0; i < req.trb_num; i++, trb++)
+	{
+		bytes_remaining += REG_READ_FIELD_LOCAL(&trb->f3, TRB_F3, BUFSIZ);
+
+		/* first non-zero status indicates the request status. */
+		if (!status)
+		{
+			status = REG_READ_FIELD_LOCAL(&trb->f3, TRB_F3, TRBSTS);
+		}
+
+		/* snps 8.2.3.2: "fast-forward" on short pkt. */
+		if (REG_READ_FIELD_LOCAL(&trb->f4, TRB_F4, HWO))
+		{
+			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, HWO, 0x0);
+			trb_updated = 1;
+		}
+	}
+
+	/* flush out any updates to trb before continuing */
+	if (trb_updated)
+	{
+		arch_clean_invalidate_cache_range((addr_t) &ep->trb[req.trb_first], ring_bytes);
+	}
+
+	/* release the request and its TRBs */
+	ep->req_head = (ep->req_head + 1) % DWC_MAX_REQ_PER_EP;
+	ep->req_count--;
+
+	ep->trb_dequeue = ep->req_count ? ep->req_queue[ep->req_head].trb_first :
+									  ep->trb_enqueue;
+
+	DBG("\n\n ******DATA TRANSFER COMPLETED (ep_phy_num = %d) ********"
+		"bytes_remaining = %d\n\n", ep->phy_num, bytes_remaining);
+
+	if (req.callback)
+	{
+		req.callback(req.context,
+					 req.bytes_queued - bytes_remaining,
+					 status ? -1 : 0);
+	}
+}
+
 /* handle all events occurring in Control-Setup state */
 static void dwc_event_handler_ep_ctrl_state_setup(dwc_dev_t *dev,
 												  uint32_t *event)
@@ -1272,16 +1342,28 @@ static void dwc_event_handler_ep_bulk_state_start_transfer(dwc_dev_t *dev,
 					/* save the resource id assigned to this ep. */
 					ep->state        = EP_STATE_XFER_IN_PROG;
 					ep->resource_idx = DWC_EVENT_EP_EVENT_XFER_RES_IDX(*event);
+
+					/* end the transfer if it was cancelled meanwhile,
+					 * otherwise hand over the requests queued while
+					 * start xfer was in progress.
+					 */
+					if (ep->cancel_pending)
+					{
+						ep->cancel_pending = 0;
+						ep->update_pending = 0;
+						dwc_ep_cmd_end_transfer(dev, ep_phy_num);
+					}
+					else if (ep->update_pending)
+					{
+						ep->update_pending = 0;
+						dwc_ep_cmd_update_transfer(dev, ep_phy_num);
+					}
 				}
 				else
 				{
-					/* start transfer failed. inform client */
-					if (ep->req.callback)
-					{
-						ep->req.callback(ep->req.context, 0, -1);
-					}
-
-					/* back to inactive state */
+					/* start transfer failed. back to inactive state.
+					 * this fails all the queued requests.
+					 */
 					dwc_ep_bulk_state_inactive_enter(dev, ep_phy_num);
 				}
 			}
@@ -1291,6 +1373,14 @@ static void dwc_event_handler_ep_bulk_state_start_transfer(dwc_dev_t *dev,
 			}
 		}
 		break;
+	case DWC_EVENT_EP_XFER_IN_PROGRESS:
+		{
+			/* first request completed before the start xfer cmd
+			 * complete event was handled.
+			 */
+			dwc_ep_bulk_request_complete(dev, ep);
+		}
+		break;
 	default:
 		ERR("\n Ignore the unexpected EP event: %s\n", event_lookup_ep[event_id]);
 		dwc_print_ep_event_details(dev, event);
@@ -1320,13 +1410,9 @@ static void dwc_event_handler_ep_bulk_state_xfer_in_prog(dwc_dev_t *dev,
 				/* transfer was cancelled for some reason. */
 				DBG("\n transfer was cancelled on ep_phy_num = %d\n", ep_phy_num);
 
-				/* inform client that transfer failed. */
-				if (ep->req.callback)
-				{
-					ep->req.callback(ep->req.context, 0, -1);
-				}
-
-				/* back to inactive state */
+				/* back to inactive state. inform client that all the
+				 * queued requests failed.
+				 */
 				dwc_ep_bulk_state_inactive_enter(dev, ep_phy_num);
 			}
 			else
@@ -1344,30 +1430,21 @@ static void dwc_event_handler_ep_bulk_state_xfer_in_prog(dwc_dev_t *dev,
 				"No action. ignored.", ep_phy_num);
 		}
 		break;
+	case DWC_EVENT_EP_XFER_IN_PROGRESS:
+		{
+			/* oldest queued request is done. transfer stays active and
+			 * h/w moves on to the next request in the TRB ring.
+			 */
+			dwc_ep_bulk_request_complete(dev, ep);
+		}
+		break;
 	case DWC_EVENT_EP_XFER_COMPLETE:
 		{
-			uint32_t bytes_remaining;
-			uint8_t  status;
-
-			/* Check how many TRBs were processed and how much data got
-			 * transferred. If there are bytes_remaining, it does not
-			 * necessarily mean failed xfer. We could have queued a 512 byte
-			 * read and receive say 13 bytes of data which is a valid scenario.
+			/* bulk TRBs never set LST, so h/w is not expected to end the
+			 * transfer on its own. If it does, complete the current
+			 * request and fail the rest since the transfer resource is gone.
 			 */
-			status = dwc_event_check_trb_status(dev,
-												event,
-												DWC_EP_PHY_TO_INDEX(ep_phy_num),
-												&bytes_remaining);
-
-			DBG("\n\n ******DATA TRANSFER COMPLETED (ep_phy_num = %d) ********"
-				"bytes_remaining = %d\n\n", ep_phy_num, bytes_remaining);
-
-			if (ep->req.callback)
-			{
-				ep->req.callback(ep->req.context,
-								 ep->bytes_queued - bytes_remaining,
-								 status ? -1 : 0);
-			}
+			dwc_ep_bulk_request_complete(dev, ep);
 
 			dwc_ep_bulk_state_inactive_enter(dev, ep_phy_num);
 		}
@@ -1442,6 +1519,55 @@ void dwc_event_handler_ep_bulk(dwc_dev_t *dev, uint32_t *event)
 
 /******************** Endpoint related APIs **********************************/
 
+/* write a link TRB at ring index "index" pointing to ring index "target".
+ * caller must flush the trb to main memory.
+ */
+static void dwc_ep_trb_link(dwc_ep_t *ep, uint32_t index, uint32_t target)
+{
+	dwc_trb_t *trb = &ep->trb[index];
+
+	memset(trb, 0, sizeof(dwc_trb_t));
+
+	REG_WRITE_FIELD_LOCAL(&trb->f1, TRB_F1, PTR_LOW,  (uint32_t) &ep->trb[target]);
+	REG_WRITE_FIELD_LOCAL(&trb->f2, TRB_F2, PTR_HIGH, 0x0);
+	REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, TRBCTL,   TRBCTL_LINK_TRB);
+	REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, HWO,      0x1);
+}
+
+/* reserve "size" TRBs (whole cache lines) in the TRB ring of a bulk ep.
+ * Space is handed out in ring order between dequeue and enqueue index.
+ * enqueue never catches up with dequeue while requests are queued, so
+ * the two being equal always means an empty ring.
+ * Returns the ring index of the reserved space or -1 if ring is full.
+ */
+static int dwc_ep_ring_reserve(dwc_ep_t *ep, uint32_t size)
+{
+	uint32_t end = ep->trb_count - DWC_TRBS_PER_LINE;
+	uint32_t enq = ep->trb_enqueue;
+	uint32_t deq = ep->trb_dequeue;
+
+	if (!ep->req_count || (enq > deq))
+	{
+		/* free space up to the end of the ring */
+		if (enq + size <= end)
+		{
+			return enq;
+		}
+
+		/* wrap around to the start of the ring */
+		if (ep->req_count ? (size < deq) : (size <= end))
+		{
+			return 0;
+		}
+	}
+	else if (enq + size < deq)
+	{
+		return enq;
+	}
+
+	return -1;
+}
+
 /* Initialize and enable EP:
  * - set the initial configuration for an endpoint
  * - set transfer resources
@@ -1547,6 +1673,15 @@ static void dwc_ep_bulk_state_inactive_enter(dwc_dev_t *dev, uint8_t ep_phy_num)
 	dwc_ep_t *ep = &dev->ep[DWC_EP_PHY_TO_INDEX(ep_phy_num)];
 	ASSERT(ep != NULL);
 
+	dwc_request_t failed[DWC_MAX_REQ_PER_EP];
+	uint8_t       failed_count = ep->req_count;
+
+	/* requests still queued can no longer complete. */
+	for (uint8_t i = 0; i < failed_count; i++)
+	{
+		failed[i] = ep->req_queue[(ep->req_head + i) % DWC_MAX_REQ_PER_EP];
+	}
+
 	/* queue request to receive the first setup pkt from host */
 	ep->req.data     = NULL;
 	ep->req.len      = 0;
@@ -1561,6 +1696,23 @@ static void dwc_ep_bulk_state_inactive_enter(dwc_dev_t *dev, uint8_t ep_phy_num)
 	ep->resource_idx = 0;
 	ep->trb_queued   = 0;
 	ep->bytes_queued = 0;
+
+	/* next transfer starts at the beginning of the TRB ring */
+	ep->trb_enqueue    = 0;
+	ep->trb_dequeue    = 0;
+	ep->update_pending = 0;
+	ep->cancel_pending = 0;
+	ep->req_head       = 0;
+	ep->req_count      = 0;
+
+	/* inform client. done last since client may queue a new request. */
+	for (uint8_t i = 0; i < failed_count; i++)
+	{
+		if (failed[i].callback)
+		{
+			failed[i].callback(failed[i].context, 0, -1);
+		}
+	}
 }
 
 /*************************** External APIs ************************************/
@@ -1630,7 +1782,7 @@ void dwc_device_add_ep(dwc_dev_t *dev, dwc_ep_t *new_ep)
 	dwc_ep_t *ep = &dev->ep[index];
 	ASSERT(ep != NULL);
 
-	memset(ep, 0, sizeof(ep));
+	memset(ep, 0, sizeof(*ep));
 
 	/* copy client specified params */
 
@@ -1645,10 +1797,23 @@ void dwc_device_add_ep(dwc_dev_t *dev, dwc_ep_t *new_ep)
 
 	ASSERT(ep->trb);
 
+	/* bulk TRB ring is managed in cache lines. last line is for the link
+	 * TRB pointing back to the start of the ring.
+	 */
+	ASSERT(IS_CACHE_LINE_ALIGNED(ep->trb));
+	ASSERT((ep->trb_count % DWC_TRBS_PER_LINE) == 0);
+	ASSERT(ep->trb_count > DWC_TRBS_PER_LINE);
+
 	/* clear out trb memory space. */
-	memset(ep->trb, 0, (ep->trb_count)*sizeof(ep->trb));
+	memset(ep->trb, 0, (ep->trb_count)*sizeof(dwc_trb_t));
+
+	if (ep->type == EP_TYPE_BULK)
+	{
+		dwc_ep_trb_link(ep, ep->trb_count - DWC_TRBS_PER_LINE, 0);
+	}
+
 	arch_clean_invalidate_cache_range((addr_t) ep->trb,
-									  (ep->trb_count)*sizeof(ep->trb));
+									  (ep->trb_count)*sizeof(dwc_trb_t));
 
 	/* initialize dwc specified params */
 
@@ -1723,7 +1888,10 @@ static int dwc_request_queue(dwc_dev_t     *dev,
 	uint32_t transfer_len   = req->len;
 	dwc_trb_trbctl_t trbctl = req->trbctl;
 
-	uint32_t pad_len;
+	if (ep->type == EP_TYPE_BULK)
+	{
+		return dwc_request_queue_bulk(dev, ep, req);
+	}
 
 	if(ep->state != EP_STATE_INACTIVE)
 	{
@@ -1759,138 +1927,6 @@ static int dwc_request_queue(dwc_dev_t     *dev,
 		ep->bytes_queued += transfer_len;
 		data_ptr += transfer_len;
 	}
-	else if (ep->type == EP_TYPE_BULK)
-	{
-		/* reserve 1 trb for pad/zero-length pkt */
-		uint32_t trb_available = ep->trb_count - 1;
-		uint32_t max_bytes_per_trb;
-		uint32_t offset;
-		uint32_t trb_len = 0;
-
-		/* snps 7.2 table 7-1. applies only to older versions of the controller:
-		 * - data_ptr in first TRB can be aligned to byte
-		 * - but the following TRBs should point to data that is aligned
-		 *   to master bus data width.
-		 */
-
-		/* align default MAX_BYTES_PER_TRB to DWC_MASTER_BUS_WIDTH */
-		max_bytes_per_trb = ROUNDDOWN(DWC_MAX_BYTES_PER_TRB, DWC_MASTER_BUS_WIDTH);
-
-		while (trb_available && transfer_len)
-		{
-			/* clear out trb fields */
-			memset(trb, 0, sizeof(dwc_trb_t));
-
-			if (ep->trb_queued == 0)
-			{
-				/* first trb: limit the transfer length in this TRB such that
-				 * the next trb data_ptr will be aligned to master bus width.
-				 */
-				offset = ((uint32_t) data_ptr) & (DWC_MASTER_BUS_WIDTH - 1);
-				trb_len = (transfer_len <= max_bytes_per_trb) ?
-									transfer_len : (max_bytes_per_trb - offset);
-			}
-			else
-			{
-				trb_len = (transfer_len <= max_bytes_per_trb) ?
-									transfer_len : max_bytes_per_trb;
-			}
-
-			REG_WRITE_FIELD_LOCAL(&trb->f1, TRB_F1, PTR_LOW,  (uint32_t) data_ptr);
-			REG_WRITE_FIELD_LOCAL(&trb->f2, TRB_F2, PTR_HIGH, 0x0);
-			REG_WRITE_FIELD_LOCAL(&trb->f3, TRB_F3, BUFSIZ,   trb_len);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, LST,      0x0);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, CHN,      0x1);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, CSP,      0x0);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, TRBCTL,   trbctl);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, IOC,      0x0);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, HWO,      0x1);
-
-			/* increment the queued trb count */
-			ep->trb_queued++;
-			ep->bytes_queued += trb_len;
-			data_ptr += trb_len;
-
-			/* remaining transfer len */
-			transfer_len -= trb_len;
-
-			/* remaining trb */
-			trb_available--;
-
-			/* point to the next trb */
-			trb++;
-		}
-
-		if (transfer_len)
-		{
-			/* TRBs not available to queue the entire request.
-			 * If more data is expected in each request, increase the number
-			 * of TRBs allocated for this EP.
-			 */
-			ERR("\n ERROR: Enough TRBs are not available to setup transfer\n");
-			ERR("\n ERROR: Increase TRB chain for the ep.\n");
-			ERR("\n ERROR: phy_ep_num = %d xfer len = %d\n", ep_phy_num, req->len);
-			ASSERT(0);
-		}
-
-		/* snps 8.2.3.3:
-		 * For an OUT ep:
-		 * (a) The "buffer descriptor" must be exact multiple of max_pkt_size
-		 *     "buffer descriptor" consists of one or more TRBs upto the TRB
-		 *     with CHN (chain) flag is not set.
-		 *     Add a TRB to pad the len if it is not exact multiple.
-		 *
-		 * (b) If the expected amount of data is exact multiple of max_pkt_size:
-		 *     add a max_pkt_size trb to sink in zero-length pkt, only if
-		 *     the EP expects it.
-		 */
-		uint32_t roundup = req->len % ep->max_pkt_size;
-
-		if ( (ep->dir == DWC_EP_DIRECTION_OUT) &&
-			 (roundup || ep->zlp))
-		{
-			if(roundup)
-			{
-				/* add a TRB to make it exact multiple of max_pkt_size */
-				pad_len = ep->max_pkt_size - roundup;
-			}
-			else
-			{
-				/* "buffer descriptor" is exact multiple of max_pkt_size and
-				 * ep expects a zero-length pkt.
-				 * Add a TRB to sink in the zero-length pkt.
-				 */
-				pad_len = ep->max_pkt_size;
-			}
-
-			memset(trb, 0, sizeof(dwc_trb_t));
-			memset(ep->zlp_buf, 0, DWC_ZLP_BUF_SIZE);
-
-			REG_WRITE_FIELD_LOCAL(&trb->f1, TRB_F1, PTR_LOW,  (uint32_t) ep->zlp_buf);
-			REG_WRITE_FIELD_LOCAL(&trb->f2, TRB_F2, PTR_HIGH, 0x0);
-			REG_WRITE_FIELD_LOCAL(&trb->f3, TRB_F3, BUFSIZ,   pad_len);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, LST,      0x1);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, CHN,      0x0);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, CSP,      0x0);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, TRBCTL,   trbctl);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, IOC,      0x1);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, HWO,      0x1);
-
-			/* increment the queued trb count */
-			ep->trb_queued++;
-			ep->bytes_queued += pad_len;
-		}
-		else /* pad trb not needed. */
-		{
-			/* point trb to the last programmed trb */
-			trb--;
-
-			/* setup params for last TRB */
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, CHN, 0x0);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, LST, 0x1);
-			REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, IOC, 0x1);
-		}
-	}
 	else
 	{
 		/* invalid EP type */
@@ -1939,6 +1975,215 @@ static int dwc_request_queue(dwc_dev_t     *dev,
 	return 0;
 }
 
+/* Enqueue new data transfer request on a bulk endpoint:
+ * Bulk requests are added to the ep's TRB ring behind any request that is
+ * still in progress. The transfer is started once and kept running, new
+ * TRBs are handed over to h/w with update transfer. Each request ends with
+ * an IOC TRB (and ISP for OUT) which raises a xfer in progress event.
+ *
+ * Each request starts on a new cache line of the ring, the unused TRBs at
+ * the end of its last line are skipped with a link TRB. This way s/w never
+ * writes back a cache line holding TRBs h/w is still working on.
+ */
+static int dwc_request_queue_bulk(dwc_dev_t     *dev,
+								  dwc_ep_t      *ep,
+								  dwc_request_t *req)
+{
+	uint8_t *data_ptr       = req->data;
+	uint32_t transfer_len   = req->len;
+	uint32_t roundup        = req->len % ep->max_pkt_size;
+	uint32_t end            = ep->trb_count - DWC_TRBS_PER_LINE;
+	uint32_t pad_len        = 0;
+	uint32_t max_bytes_per_trb;
+	uint32_t first_len;
+	uint32_t offset;
+	uint32_t trb_len;
+	uint32_t size;
+	uint32_t index;
+	dwc_trb_t *trb;
+	int first;
+
+	/* snps 7.2 table 7-1. applies only to older versions of the controller:
+	 * - data_ptr in first TRB can be aligned to byte
+	 * - but the following TRBs should point to data that is aligned
+	 *   to master bus data width.
+	 */
+	max_bytes_per_trb = ROUNDDOWN(DWC_MAX_BYTES_PER_TRB, DWC_MASTER_BUS_WIDTH);
+	offset            = ((uint32_t) data_ptr) & (DWC_MASTER_BUS_WIDTH - 1);
+	first_len         = (transfer_len <= max_bytes_per_trb) ?
+								transfer_len : (max_bytes_per_trb - offset);
+
+	/* snps 8.2.3.3:
+	 * For an OUT ep:
+	 * (a) The "buffer descriptor" must be exact multiple of max_pkt_size
+	 *     Add a TRB to pad the len if it is not exact multiple.
+	 * (b) If the expected amount of data is exact multiple of max_pkt_size:
+	 *     add a max_pkt_size trb to sink in zero-length pkt, only if
+	 *     the EP expects it.
+	 */
+	if ((ep->dir == DWC_EP_DIRECTION_OUT) && (roundup || ep->zlp))
+	{
+		pad_len = roundup ? (ep->max_pkt_size - roundup) : ep->max_pkt_size;
+	}
+
+	/* TRBs needed: first trb, the rest of the data and the pad trb. */
+	req->trb_num = 1 + ((transfer_len - first_len) + max_bytes_per_trb - 1) / max_bytes_per_trb;
+	if (pad_len)
+	{
+		req->trb_num++;
+	}
+	req->bytes_queued = 0;
+
+	size = ROUNDUP(req->trb_num, DWC_TRBS_PER_LINE);
+
+	/* request queue is shared with the event handler. */
+	enter_critical_section();
+
+	if (ep->state == EP_STATE_INIT || ep->req_count == DWC_MAX_REQ_PER_EP)
+	{
+		DBG("\n Cannot queue request on ep_phy_num = %d state = %s queued = %d\n",
+			ep->phy_num, ep_state_lookup[ep->state], ep->req_count);
+		exit_critical_section();
+		return -1;
+	}
+
+	first = dwc_ep_ring_reserve(ep, size);
+	if (first < 0)
+	{
+		/* If more data is expected in each request, increase the number
+		 * of TRBs allocated for this EP.
+		 */
+		ERR("\n ERROR: Enough TRBs are not available to setup transfer\n");
+		ERR("\n ERROR: phy_ep_num = %d xfer len = %d\n", ep->phy_num, req->len);
+		exit_critical_section();
+		return -1;
+	}
+
+	req->trb_first = first;
+
+	trb = &ep->trb[first];
+	memset(trb, 0, size * sizeof(dwc_trb_t));
+
+	index = 0;
+	do
+	{
+		trb_len = index ? MIN(transfer_len, max_bytes_per_trb) : first_len;
+
+		REG_WRITE_FIELD_LOCAL(&trb->f1, TRB_F1, PTR_LOW,  (uint32_t) data_ptr);
+		REG_WRITE_FIELD_LOCAL(&trb->f2, TRB_F2, PTR_HIGH, 0x0);
+		REG_WRITE_FIELD_LOCAL(&trb->f3, TRB_F3, BUFSIZ,   trb_len);
+		REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, CHN,      0x1);
+		REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, TRBCTL,   req->trbctl);
+		REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, ISP,      ep->dir == DWC_EP_DIRECTION_OUT);
+		REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, HWO,      0x1);
+
+		req->bytes_queued += trb_len;
+		data_ptr          += trb_len;
+		transfer_len      -= trb_len;
+
+		index++;
+		trb++;
+	} while (transfer_len);
+
+	if (pad_len)
+	{
+		REG_WRITE_FIELD_LOCAL(&trb->f1, TRB_F1, PTR_LOW,  (uint32_t) ep->zlp_buf);
+		REG_WRITE_FIELD_LOCAL(&trb->f2, TRB_F2, PTR_HIGH, 0x0);
+		REG_WRITE_FIELD_LOCAL(&trb->f3, TRB_F3, BUFSIZ,   pad_len);
+		REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, CHN,      0x1);
+		REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, TRBCTL,   req->trbctl);
+		REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, ISP,      0x1);
+		REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, HWO,      0x1);
+
+		req->bytes_queued += pad_len;
+
+		index++;
+		trb++;
+	}
+
+	ASSERT(index == req->trb_num);
+
+	/* last TRB ends the buffer descriptor of this request. LST stays clear
+	 * so the transfer keeps running for the requests queued after this one.
+	 */
+	trb--;
+	REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, CHN, 0x0);
+	REG_WRITE_FIELD_LOCAL(&trb->f4, TRB_F4, IOC, 0x1);
+
+	/* skip the rest of the cache line */
+	if (index < size)
+	{
+		dwc_ep_trb_link(ep, first + index, first + size);
+	}
+
+	/* flush the trb data to main memory */
+	arch_clean_invalidate_cache_range((addr_t) &ep->trb[first], size * sizeof(dwc_trb_t));
+
+	/* request did not fit at the end of the ring: point h/w back to the start.
+	 * Nothing to do if enqueue is at the ring's own link TRB.
+	 */
+	if ((uint32_t) first != ep->trb_enqueue && ep->trb_enqueue != end)
+	{
+		dwc_ep_trb_link(ep, ep->trb_enqueue, 0);
+		arch_clean_invalidate_cache_range((addr_t) &ep->trb[ep->trb_enqueue], CACHE_LINE);
+	}
+
+	/* save the request */
+	if (!ep->req_count)
+	{
+		ep->trb_dequeue = first;
+	}
+	ep->req_queue[(ep->req_head + ep->req_count) % DWC_MAX_REQ_PER_EP] = *req;
+	ep->req_count++;
+	ep->trb_enqueue = first + size;
+
+	DBG("\n Queued bulk xfer on ep_phy_num = %d first trb = %d trb_num = %d\n",
+		ep->phy_num, first, req->trb_num);
+
+	switch (ep->state)
+	{
+	case EP_STATE_INACTIVE:
+		{
+			/* ring is reset when ep goes inactive. */
+			ASSERT(first == 0);
+
+			dwc_ep_cmd_start_transfer(dev, ep->phy_num);
+
+			if(dwc_device_run_status(dev))
+			{
+				ep->state = EP_STATE_START_TRANSFER;
+			}
+			else
+			{
+				/* no interrupt expected on completion of start transfer.
+				 * directly move to xfer in prog state. resource index is
+				 * in the cmd param register once the cmd is done.
+				 */
+				ep->state        = EP_STATE_XFER_IN_PROG;
+				ep->resource_idx = REG_READ_FIELDI(dev, DEPCMD, ep->phy_num, COMMANDPARAM);
+			}
+		}
+		break;
+	case EP_STATE_START_TRANSFER:
+		{
+			/* update transfer needs the resource index. */
+			ep->update_pending = 1;
+		}
+		break;
+	case EP_STATE_XFER_IN_PROG:
+		{
+			dwc_ep_cmd_update_transfer(dev, ep->phy_num);
+		}
+		break;
+	default:
+		ASSERT(0);
+	}
+
+	exit_critical_section();
+
+	return 0;
+}
+
 /* data transfer request:
  * NOTE: Assumes that the data to be transferred is already in main memory.
  *  	 Any cache management must be done by caller																.
@@ -1975,3 +2220,41 @@ int dwc_transfer_request(dwc_dev_t               *dwc,
 
 	return dwc_request_queue(dwc, ep_phy_num, &req);
 }
+
+/* cancel all requests queued on a bulk ep.
+ * The transfer is ended and, once the end transfer cmd completes, the
+ * queued requests are failed like on a reset: their callbacks run with
+ * an error status after h/w has stopped using their buffers.
+ * Returns -1 if no transfer was in progress on the ep.
+ */
+int dwc_transfer_cancel(dwc_dev_t          *dwc,
+						uint8_t             usb_ep,
+						dwc_ep_direction_t  dir)
+{
+	uint8_t ep_phy_num = DWC_EP_PHY_NUM(usb_ep, dir);
+	int ret = 0;
+
+	ASSERT(usb_ep != 0);
+	ASSERT(DWC_EP_PHY_TO_INDEX(ep_phy_num) < DWC_MAX_NUM_OF_EP);
+	dwc_ep_t *ep = &dwc->ep[DWC_EP_PHY_TO_INDEX(ep_phy_num)];
+
+	/* ep state is shared with the event handler. */
+	enter_critical_section();
+
+	switch (ep->state)
+	{
+	case EP_STATE_XFER_IN_PROG:
+		dwc_ep_cmd_end_transfer(dwc, ep_phy_num);
+		break;
+	case EP_STATE_START_TRANSFER:
+		/* no resource index yet to end the transfer with. */
+		ep->cancel_pending = 1;
+		break;
+	default:
+		ret = -1;
+	}
+
+	exit_critical_section();
+
+	return ret;
+}
@@ -305,6 +305,9 @@ typedef struct
 	dwc_trb_trbctl_t trbctl;
 	void            *context;
 	void (*callback)(void *context, uint32_t actual, int status);
+	uint32_t         trb_first;     /* bulk: ring index of the first TRB of this request. */
+	uint32_t         trb_num;       /* bulk: number of data and pad TRBs of this request. */
+	uint32_t         bytes_queued;  /* bulk: number of bytes queued in this request. */
 } dwc_request_t;
 
 /******************** END: local data not needed by external APIs *************/
@@ -339,6 +342,14 @@ typedef void (*dwc_transfer_callback_t)(void *context, uint32_t actual, int stat
  */
 #define DWC_ZLP_BUF_SIZE    512
 
+/* max number of requests that can be queued on a bulk ep at a time. */
+#define DWC_MAX_REQ_PER_EP  4
+
+/* TRBs sharing one cache line. Every bulk request starts on a new cache line
+ * of the TRB ring so that TRBs owned by s/w and h/w never share a line.
+ */
+#define DWC_TRBS_PER_LINE   (CACHE_LINE / sizeof(dwc_trb_t))
+
 /* Structure to keep all information about an endpoint */
 typedef struct
 {
@@ -362,6 +373,15 @@ typedef struct
 	uint32_t            bytes_queued;  /* number of bytes queued in the current request. */
 	dwc_request_t       req;           /* transfer request that is currently queued on this ep. */
 
+	/* bulk ep: the TRBs form a ring terminated by a link TRB. */
+	uint32_t            trb_enqueue;   /* ring index where the next request is queued. */
+	uint32_t            trb_dequeue;   /* ring index of the oldest queued request. */
+	uint8_t             update_pending;/* TRBs were added before start xfer completed. */
+	uint8_t             cancel_pending;/* transfer was cancelled before start xfer completed. */
+	uint8_t             req_head;      /* index of the oldest request in req_queue. */
+	uint8_t             req_count;     /* number of requests in req_queue. */
+	dwc_request_t       req_queue[DWC_MAX_REQ_PER_EP]; /* requests queued on this bulk ep. */
+
 	dwc_ep_state_t      state;         /* data transfer state of the ep. */
 
 } dwc_ep_t;
@@ -461,6 +481,9 @@ int dwc_transfer_request(dwc_dev_t *dwc,
 						 uint32_t len,
 						 dwc_transfer_callback_t callback,
 						 void *callback_context);
+int dwc_transfer_cancel(dwc_dev_t *dwc,
+						uint8_t usb_ep,
+						dwc_ep_direction_t dir);
 
 /******************** END: data needed by external APIs *********************/
 /* static apis */
@@ -480,6 +503,7 @@ static void dwc_event_handler_ep_bulk(dwc_dev_t *dev, uint32_t *event);
 static void dwc_event_handler_ep_bulk_state_inactive(dwc_dev_t *dev, uint32_t *event);
 static void dwc_event_handler_ep_bulk_state_xfer_in_prog(dwc_dev_t *dev, uint32_t *event);
 static void dwc_ep_bulk_state_inactive_enter(dwc_dev_t *dev, uint8_t ep_phy_num);
+static void dwc_ep_bulk_request_complete(dwc_dev_t *dev, dwc_ep_t *ep);
 
 /* control ep event handling functions */
 static void dwc_event_handler_ep_ctrl(dwc_dev_t *dev, uint32_t *event);
@@ -498,4 +522,5 @@ static void dwc_ep_config_init_enable(dwc_dev_t *dev, uint8_t index);
 void dwc_ep_cmd_clear_stall(dwc_dev_t *dev, uint8_t ep_phy_num);
 
 static int dwc_request_queue(dwc_dev_t *dev, uint8_t ep_phy_num, dwc_request_t *req);
+static int dwc_request_queue_bulk(dwc_dev_t *dev, dwc_ep_t *ep, dwc_request_t *req);
 #endif
@@ -189,6 +189,28 @@ void dwc_ep_cmd_end_transfer(dwc_dev_t *dev, uint8_t ep_phy_num)
 	dwc_ep_cmd(dev, ep_phy_num, &ep_cmd);
 }
 
+/* update transfer on a particular endpoint:
+ * tells the h/w that more TRBs were handed over to it after the transfer
+ * was started. assumes the new trbs are already populated.
+ */
+void dwc_ep_cmd_update_transfer(dwc_dev_t *dev, uint8_t ep_phy_num)
+{
+	dwc_ep_cmd_t ep_cmd;
+
+	dwc_ep_t *ep = &dev->ep[DWC_EP_PHY_TO_INDEX(ep_phy_num)];
+
+	/* set cmd and the resource index */
+	ep_cmd.cmd                 = DEPCMD_CMD_UPDATE_TRANSFER;
+	ep_cmd.xfer_resource_index = ep->resource_idx;
+
+	/* params */
+	ep_cmd.param2 = 0;
+	ep_cmd.param1 = 0;
+	ep_cmd.param0 = 0;
+
+	dwc_ep_cmd(dev, ep_phy_num, &ep_cmd);
+}
+
 /* set number of transfer resources to be used for the ep. */
 void dwc_ep_cmd_set_transfer_resource(dwc_dev_t *dev, uint8_t ep_phy_num)
 {
@@ -256,6 +278,12 @@ void dwc_ep_cmd_set_config(dwc_dev_t *dev, uint8_t index, uint8_t action)
 	ep_cmd.param1 |= BIT(DEPCMDPAR2_XFER_N_RDY_BIT);
 	ep_cmd.param1 |= BIT(DEPCMDPAR2_XFER_COMPLETE_BIT);
 
+	/* bulk transfers are never ended by the TRBs (LST is not set). each
+	 * request is reported by a xfer in progress event instead.
+	 */
+	if (ep_type == EP_TYPE_BULK)
+		ep_cmd.param1 |= BIT(DEPCMDPAR2_XFER_IN_PROG_BIT);
+
 	/* interrupt number: which event buffer to be used. */
 	ep_cmd.param1 |= 0;
 
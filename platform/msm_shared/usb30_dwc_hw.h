@@ -30,6 +30,7 @@
 
 void dwc_ep_cmd_start_transfer(dwc_dev_t *dev, uint8_t ep_phy_num);
 void dwc_ep_cmd_end_transfer(dwc_dev_t *dev, uint8_t ep_phy_num);
+void dwc_ep_cmd_update_transfer(dwc_dev_t *dev, uint8_t ep_phy_num);
 void dwc_ep_cmd_set_config(dwc_dev_t *dev, uint8_t index, uint8_t action);
 void dwc_ep_cmd_set_transfer_resource(dwc_dev_t *dev, uint8_t index);
 void dwc_ep_cmd_stall(dwc_dev_t *dev, uint8_t ep_phy_num);
@@ -852,14 +852,11 @@ stall:
  */
 void udc_request_complete(void *context, uint32_t actual, int status)
 {
-	struct udc_request *req = ((udc_t *) context)->queued_req;
+	struct udc_request *req = (struct udc_request *) context;
 
 	DBG("\n UDC: udc_request_callback: xferred %d bytes status = %d\n",
 		actual, status);
 
-	/* clear the queued request. */
-	((udc_t *) context)->queued_req = NULL;
-
 	if (req->complete)
 	{
 		req->complete(req, actual, status);
@@ -883,32 +880,40 @@ int usb30_udc_request_queue(struct udc_endpoint *ept, struct udc_request *req)
 		return -1;
 	}
 
-	/* only one request at a time is supported.
-	 * check if a request is already queued.
-	 */
-	if(udc_dev->queued_req)
-	{
-		return -1;
-	}
-
 	DBG("\n udc_request_queue: entry: ep_usb_num = %d", ept->num);
 
-	/* save the queued request. */
-	udc_dev->queued_req = req;
-
+	/* requests are queued per ep by the dwc layer. It returns error
+	 * when the ep cannot take any more requests.
+	 */
 	ret = dwc_transfer_request(dwc_dev,
 							   ept->num,
 							   ept->in ? DWC_EP_DIRECTION_IN : DWC_EP_DIRECTION_OUT,
 							   req->buf,
 							   req->length,
 							   udc_request_complete,
-							   (void *) udc_dev);
+							   (void *) req);
 
 	DBG("\n udc_request_queue: exit: ep_usb_num = %d", ept->num);
 
 	return ret;
 }
 
+/* The dwc layer can only end the transfer on the whole TRB ring of an ep,
+ * so this cancels req together with every other request queued on ept.
+ * Their complete callbacks run with an error status once the controller
+ * no longer writes to their buffers.
+ */
+int usb30_udc_request_cancel(struct udc_endpoint *ept, struct udc_request *req)
+{
+	dwc_dev_t *dwc_dev = udc_dev->dwc;
+
+	ASSERT(dwc_dev);
+
+	return dwc_transfer_cancel(dwc_dev,
+							   ept->num,
+							   ept->in ? DWC_EP_DIRECTION_IN : DWC_EP_DIRECTION_OUT);
+}
+
 /* For HS device should have the version number as 0x0200.
  * Update the minor version to 0x00 when we receive the connect
  * event with HS or FS mode
@@ -1029,7 +1034,7 @@ static struct udc_endpoint *_udc_endpoint_alloc(uint8_t num,
 	ept->type       = type;
 	ept->in         = !!in;
 	ept->maxburst   = 4;      /* no performance improvement is seen beyond burst size of 4 */
-	ept->trb_count  = 66;     /* each trb can transfer (16MB - 1). 65 for 1GB transfer + 1 for roundup/zero length pkt. */
+	ept->trb_count  = 128;    /* TRB ring. each trb can transfer (16MB - 1). 65 for 1GB transfer + 1 for roundup/zero length pkt. room for more queued requests. */
 	ept->trb        = memalign(lcm(CACHE_LINE, 16), ROUNDUP(ept->trb_count*sizeof(dwc_trb_t), CACHE_LINE)); /* TRB must be aligned to 16 */
 	ASSERT(ept->trb);
 
@@ -84,7 +84,6 @@ typedef struct
 	udc_device_speed_t     speed;           /* keeps track of usb connection speed. */
 	uint8_t                config_selected; /* keeps track of the selected configuration */
 
-	struct udc_request    *queued_req;      /* pointer to the currently queued request. NULL indicates no request is queued. */
 	usb_state_t            usb_state;       /* USB state, default, addressed & configured */
 
 } udc_t;
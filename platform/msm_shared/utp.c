@@ -445,13 +445,15 @@ static void utp_fill_prdt_entries(struct upiu_req_build_type *upiu_data, struct
 
 }
 
-int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data)
+/* Allocates and fills the command descriptor (request upiu, room for the
+ * response and the PRDT) of upiu_data and the UTRD properties pointing to it.
+ */
+static int utp_prep_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data,
+						 struct utp_utrd_req_build_type *utrd, uint32_t *desc_len)
 {
 	struct upiu_gen_hdr            *req_upiu;
-	struct utp_utrd_req_build_type utrd;
 	uint32_t                       num_prdt;
 	struct utp_prdt_entry          *prdt_entry;
-	int                            ret = UFS_SUCCESS;
 	uint32_t                       resp_len;
 	uint32_t                       cmd_desc_len;
 	struct utrd_cmd_desc           cmd_desc;
@@ -476,17 +478,17 @@ int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data)
 	}
 
 	/* Fill req upiu. */
-	ret = utp_fill_req_upiu(dev, upiu_data, req_upiu);
-	if (ret)
+	if (utp_fill_req_upiu(dev, upiu_data, req_upiu))
 	{
-		goto utp_enqueue_upiu_err;
+		free(req_upiu);
+		return -UFS_FAILURE;
 	}
 
 	/* Fill UTRD properties. */
 	cmd_desc.num_prdt      = num_prdt;
 	cmd_desc.req_upiu      = req_upiu;
 	cmd_desc.resp_upiu_len = resp_len;
-	utp_fill_utrd_properties(upiu_data, &utrd, &cmd_desc);
+	utp_fill_utrd_properties(upiu_data, utrd, &cmd_desc);
 
 	prdt_entry         = (struct utp_prdt_entry *) ((uint32_t) req_upiu + UPIU_HDR_LEN + resp_len);
 
@@ -498,6 +500,180 @@ int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data)
 	dsb();
 	arch_clean_invalidate_cache_range((addr_t) req_upiu, cmd_desc_len);
 
+	*desc_len = cmd_desc_len;
+
+	return UFS_SUCCESS;
+}
+
+static void utp_save_upiu_resp(struct upiu_req_build_type *upiu_data, struct upiu_gen_hdr *req_upiu, uint32_t cmd_desc_len)
+{
+	/* UPIU processed. Invalidate cache to update resp. */
+	arch_invalidate_cache_range((addr_t) req_upiu, cmd_desc_len);
+
+	/* Save the response. */
+	memcpy(upiu_data->resp_ptr, (void *) ((uint32_t)req_upiu + UPIU_HDR_LEN), upiu_data->resp_len);
+	memcpy((void *) upiu_data->resp_data_ptr, (void *) ((uint32_t)req_upiu + 2 * UPIU_HDR_LEN), upiu_data->resp_data_len);
+}
+
+/* Waits for the controller to clear all of door_bell_bits. */
+static int utp_poll_door_bell_clear(struct ufs_dev *dev, uint32_t door_bell_bits)
+{
+	uint32_t retry = 0;
+
+	while (readl(UFS_UTRLDBR(dev->base)) & door_bell_bits)
+	{
+		retry++;
+		udelay(1);
+
+		/* Let other threads run while the link moves the data. */
+		if (!(retry % UTP_YIELD_INTERVAL))
+			thread_yield();
+
+		if (retry == UTP_MAX_COMMAND_RETRY)
+		{
+			dprintf(CRITICAL, "%s:%d UTP batch never completed, pending: 0x%x\n", __func__, __LINE__,
+					readl(UFS_UTRLDBR(dev->base)) & door_bell_bits);
+			return ERR_TIMED_OUT;
+		}
+	}
+
+	/* The batch does not use the completion status, clear it so that it is
+	 * not taken for the completion of a synchronous request.
+	 */
+	writel(UFS_IS_UTRCS, UFS_IS(dev->base));
+
+	return UFS_SUCCESS;
+}
+
+static void utp_release_batch_entry(struct ufs_dev *dev, struct utp_async_batch *batch, uint32_t i)
+{
+	struct utp_bitmap_access_type bitmap_req;
+
+	bitmap_req.bitmap        = &dev->utrd_data.bitmap;
+	bitmap_req.door_bell_bit = batch->door_bell_bit[i];
+	bitmap_req.mutx          = &(dev->utrd_data.bitmap_mutex);
+
+	utp_remove_from_bitmap(&bitmap_req);
+
+	free(batch->req_upiu[i]);
+	batch->req_upiu[i] = NULL;
+}
+
+/*
+ * Queues batch->count upius on free UTRD slots and rings all of their
+ * doorbells with a single write. Returns without waiting: the command
+ * descriptors and data buffers belong to the controller until
+ * utp_wait_upiu_async() is called on the batch.
+ */
+int utp_enqueue_upiu_async(struct ufs_dev *dev, struct utp_async_batch *batch)
+{
+	struct utp_utrd_req_build_type utrd;
+	uint32_t                       i;
+
+	if (!batch->count || batch->count > UTP_MAX_ASYNC_UTRD)
+		return -UFS_FAILURE;
+
+	batch->door_bell_bits = 0;
+
+	/* Check register UTRLRSR and make sure it is read 1 before continuing. */
+	if (!readl(UFS_UTRLRSR(dev->base)))
+		return -UFS_FAILURE;
+
+	for (i = 0; i < batch->count; i++)
+	{
+		if (utp_prep_upiu(dev, batch->upiu[i], &utrd, &batch->cmd_desc_len[i]))
+			goto utp_enqueue_upiu_async_err;
+
+		batch->req_upiu[i] = (struct upiu_gen_hdr *) utrd.req_upiu;
+
+		batch->desc[i] = utp_get_desc_slot_addr(dev, &utrd, &batch->door_bell_bit[i]);
+		if (!batch->desc[i])
+		{
+			free(batch->req_upiu[i]);
+			goto utp_enqueue_upiu_async_err;
+		}
+
+		utp_enqueue_utrd_fill_desc(batch->desc[i], &utrd);
+		batch->door_bell_bits |= batch->door_bell_bit[i];
+	}
+
+	dev->utrd_data.async_bits |= batch->door_bell_bits;
+
+	dsb();
+
+	utp_ring_door_bell(UFS_UTRLDBR(dev->base), batch->door_bell_bits);
+
+	dsb();
+
+	return UFS_SUCCESS;
+
+utp_enqueue_upiu_async_err:
+	while (i--)
+		utp_release_batch_entry(dev, batch, i);
+
+	dprintf(CRITICAL, "%s:%d Unable to queue the batch\n", __func__, __LINE__);
+	return -UFS_FAILURE;
+}
+
+/*
+ * Reaps a batch queued with utp_enqueue_upiu_async(): waits for all of
+ * its doorbells, saves the responses and frees the slots.
+ */
+int utp_wait_upiu_async(struct ufs_dev *dev, struct utp_async_batch *batch)
+{
+	int      ret;
+	uint32_t i;
+
+	ret = utp_poll_door_bell_clear(dev, batch->door_bell_bits);
+	if (ret == ERR_TIMED_OUT)
+	{
+		/* Take the slots back from the controller before reusing them. */
+		writel(~batch->door_bell_bits, UFS_UTRLCLR(dev->base));
+		ret = -UFS_FAILURE;
+	}
+
+	dev->utrd_data.async_bits &= ~batch->door_bell_bits;
+
+	for (i = 0; i < batch->count; i++)
+	{
+		/* Force read UTRD from memory. */
+		dsb();
+		cache_clean_invalidate_unaligned_start_addr((addr_t) batch->desc[i], sizeof(struct utp_trans_req_desc));
+
+		if (!ret && batch->desc[i]->overall_cmd_status != UTRD_OCS_SUCCESS)
+		{
+			dprintf(CRITICAL, "%s:%d Command %u of the batch failed, ocs = %x\n", __func__, __LINE__,
+					i, batch->desc[i]->overall_cmd_status);
+			ret = -UFS_FAILURE;
+		}
+
+		if (!ret)
+			utp_save_upiu_resp(batch->upiu[i], batch->req_upiu[i], batch->cmd_desc_len[i]);
+
+		utp_release_batch_entry(dev, batch, i);
+	}
+
+	return ret;
+}
+
+int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data)
+{
+	struct upiu_gen_hdr            *req_upiu;
+	struct utp_utrd_req_build_type utrd;
+	int                            ret = UFS_SUCCESS;
+	uint32_t                       cmd_desc_len;
+
+	/* The synchronous path waits on the UTRCS status, so let the batches in
+	 * flight complete first or their completion would be taken for ours.
+	 */
+	if (dev->utrd_data.async_bits && utp_poll_door_bell_clear(dev, dev->utrd_data.async_bits))
+		return -UFS_FAILURE;
+
+	if (utp_prep_upiu(dev, upiu_data, &utrd, &cmd_desc_len))
+		return -UFS_FAILURE;
+
+	req_upiu = (struct upiu_gen_hdr *) utrd.req_upiu;
+
 	/* Check the response. */
 	ret = utp_enqueue_utrd(dev, &utrd);
 	if (ret)
@@ -506,12 +682,7 @@ int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data)
 		goto utp_enqueue_upiu_err;
 	}
 
-	/* UPIU processed. Invalidate cache to update resp. */
-	arch_invalidate_cache_range((addr_t) req_upiu, cmd_desc_len);
-
-	/* Save the response. */
-	memcpy(upiu_data->resp_ptr, (void *) ((uint32_t)req_upiu + UPIU_HDR_LEN), upiu_data->resp_len);
-	memcpy((void *) upiu_data->resp_data_ptr, (void *) ((uint32_t)req_upiu + 2 * UPIU_HDR_LEN), upiu_data->resp_data_len);
+	utp_save_upiu_resp(upiu_data, req_upiu, cmd_desc_len);
 
 utp_enqueue_upiu_err:
 	free(req_upiu);
@@ -46,6 +46,10 @@ DEFINES += ENABLE_CMNLIB64_LOADING=1
 ENABLE_SMD_SUPPORT := 1
 ENABLE_PWM_SUPPORT := true
 
+#Uncomment to hash AVB hash descriptor images on the secondary cores
+#(work queue only, threads keep running on the boot core)
+#ENABLE_SMP := 1
+
 #Comment this to disable this feature.
 DEFINES += SECURE_CODE_MEM=1
 
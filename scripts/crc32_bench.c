@@ -0,0 +1,141 @@
+/* Copyright (c) 2026, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host micro-benchmark for the LK CRC32 library.
+ *
+ * Build and run from the top of the tree:
+ *   gcc -O2 -Iplatform/msm_shared/include -o crc32_bench scripts/crc32_bench.c
+ *   ./crc32_bench
+ *
+ * Checks that every implementation agrees with the bitwise reference that
+ * partition_parser.c used to carry, then reports MB/s for GPT entry array
+ * and UBI/eraseblock sized buffers.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "../platform/msm_shared/crc32.c"
+
+typedef uint32_t (*crc_fn)(uint32_t crc, const void *buf, size_t size);
+
+/* Equivalent of the former calculate_crc32(), one bit at a time */
+static uint32_t crc32_bitwise(uint32_t crc, const void *buf, size_t size)
+{
+	const uint8_t *p = buf;
+	int i;
+
+	while (size--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	return crc;
+}
+
+static const struct {
+	const char *name;
+	crc_fn fn;
+} impls[] = {
+	{ "bitwise", crc32_bitwise },
+	{ "bytewise", crc32_bytewise },
+	{ "slice8", crc32_slice8 },
+};
+
+static const size_t sizes[] = { 92, 4096, 16384, 128 * 1024, 1024 * 1024 };
+
+/* keeps the timed loops from being optimized away */
+static volatile uint32_t sink;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+	static uint8_t buf[1024 * 1024 + 8];
+	uint32_t ref, crc;
+	size_t i, j, off;
+	unsigned iter, n;
+	double t;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = (uint8_t)(i * 2654435761u >> 24);
+
+	/* "123456789" check value of the IEEE CRC32 */
+	if ((crc32_slice8(~0U, "123456789", 9) ^ ~0U) != 0xcbf43926) {
+		printf("FAIL: check value\n");
+		return 1;
+	}
+
+	for (off = 0; off < 8; off++) {
+		for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			ref = crc32_bitwise(~0U, buf + off, sizes[i]);
+			for (j = 1; j < sizeof(impls) / sizeof(impls[0]); j++) {
+				crc = impls[j].fn(~0U, buf + off, sizes[i]);
+				if (crc != ref) {
+					printf("FAIL: %s size %zu offset %zu\n",
+					       impls[j].name, sizes[i], off);
+					return 1;
+				}
+			}
+		}
+	}
+
+	printf("%-10s", "size");
+	for (j = 0; j < sizeof(impls) / sizeof(impls[0]); j++)
+		printf("%12s", impls[j].name);
+	printf("   (MB/s)\n");
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		printf("%-10zu", sizes[i]);
+		for (j = 0; j < sizeof(impls) / sizeof(impls[0]); j++) {
+			iter = (64 * 1024 * 1024) / sizes[i];
+			if (impls[j].fn == crc32_bitwise)
+				iter /= 8;
+			crc = 0;
+			t = now();
+			for (n = 0; n < iter; n++)
+				crc ^= impls[j].fn(~0U, buf, sizes[i]);
+			t = now() - t;
+			sink = crc;
+			printf("%12.1f", (double)sizes[i] * iter / t / (1024 * 1024));
+		}
+		printf("\n");
+	}
+
+	return 0;
+}
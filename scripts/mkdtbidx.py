@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+# Copyright (c) 2026, The Linux Foundation. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met:
+#   * Redistributions of source code must retain the above copyright
+#     notice, this list of conditions and the following disclaimer.
+#   * Redistributions in binary form must reproduce the above
+#     copyright notice, this list of conditions and the following
+#     disclaimer in the documentation and/or other materials provided
+#     with the distribution.
+#   * Neither the name of The Linux Foundation. nor the names of its
+#     contributors may be used to endorse or promote products derived
+#     from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+# BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+# BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+# OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+"""Build the index of the DTBs appended to a kernel image.
+
+LK's dev_tree_appended() uses the index, when it follows the last appended
+DTB, to pick the best match without parsing each DTB. The entries are the
+ones dev_tree_compatible() would build from qcom,msm-id, qcom,board-id and
+qcom,pmic-id.
+
+Usage: mkdtbidx.py -o dtb.idx a.dtb b.dtb ...
+       cat Image.gz a.dtb b.dtb ... dtb.idx > Image.gz-dtb
+"""
+
+import getopt
+import struct
+import sys
+
+FDT_MAGIC = 0xd00dfeed
+FDT_BEGIN_NODE = 1
+FDT_PROP = 3
+FDT_NOP = 4
+
+DT_INDEX_MAGIC = 0x49544451
+DT_INDEX_VERSION = 1
+DT_INDEX_PMIC_FROM_BOARD = 0x1
+DT_INDEX_DTB_V1 = 0x2
+
+def be32_list(data):
+    return list(struct.unpack('>%dI' % (len(data) // 4), data[:len(data) // 4 * 4]))
+
+def split_dtbs(blob):
+    """Split concatenated DTBs, the way LK walks them."""
+    dtbs = []
+    off = 0
+    while off + 40 <= len(blob):
+        magic, size = struct.unpack_from('>II', blob, off)
+        if magic != FDT_MAGIC or size < 40 or off + size > len(blob):
+            break
+        dtbs.append((off, blob[off:off + size]))
+        off += size
+    return dtbs, off
+
+def root_props(dtb):
+    (magic, size, off_struct, off_strings, off_rsvmap, version,
+     last_comp, boot_cpuid, size_strings, size_struct) = struct.unpack_from('>10I', dtb)
+    props = {}
+    p = off_struct
+    while True:
+        tag, = struct.unpack_from('>I', dtb, p)
+        p += 4
+        if tag != FDT_NOP:
+            break
+    if tag != FDT_BEGIN_NODE:
+        raise ValueError('no root node')
+    p = (dtb.index(b'\0', p) + 4) & ~3
+    while True:
+        tag, = struct.unpack_from('>I', dtb, p)
+        p += 4
+        if tag == FDT_NOP:
+            continue
+        if tag != FDT_PROP:
+            return props
+        length, nameoff = struct.unpack_from('>II', dtb, p)
+        p += 8
+        if version < 16 and length >= 8:
+            p = (p + 7) & ~7
+        name_start = off_strings + nameoff
+        name = dtb[name_start:dtb.index(b'\0', name_start)].decode()
+        props[name] = dtb[p:p + length]
+        p = (p + length + 3) & ~3
+
+def dtb_entries(dtb):
+    """Same entries, in the same order, as dev_tree_compatible()."""
+    props = root_props(dtb)
+    pmic = props.get('qcom,pmic-id', b'')
+    board = props.get('qcom,board-id', b'')
+    msm = props.get('qcom,msm-id', b'')
+
+    if pmic and board:
+        if len(pmic) % 8 or len(board) % 8:
+            return []
+        ver, plat_len = 3, 8
+    elif board:
+        if len(board) % 8:
+            return []
+        ver, plat_len = 2, 8
+    else:
+        ver, plat_len = 1, 12
+
+    if not msm or len(msm) % plat_len:
+        return []
+
+    entries = []
+    if ver == 1:
+        ids = be32_list(msm)
+        for i in range(0, len(ids), 3):
+            entries.append((DT_INDEX_DTB_V1 | DT_INDEX_PMIC_FROM_BOARD,
+                            ids[i], ids[i + 1], ids[i + 1] >> 24, ids[i + 2], [0] * 4))
+        return entries
+
+    ids = be32_list(msm)
+    plats = [(ids[i], ids[i + 1]) for i in range(0, len(ids), 2)]
+    ids = be32_list(board)
+    boards = []
+    for i in range(0, len(ids), 2):
+        subtype = ids[i + 1] if ids[i + 1] else ids[i] >> 24
+        boards.append((ids[i], subtype))
+    ids = be32_list(pmic)
+    pmics = [ids[i:i + 4] for i in range(0, len(ids) // 4 * 4, 4)]
+
+    for platform_id, soc_rev in plats:
+        for variant_id, subtype in boards:
+            if ver == 3:
+                for pmic_rev in pmics:
+                    entries.append((0, platform_id, variant_id, subtype, soc_rev, pmic_rev))
+            else:
+                entries.append((DT_INDEX_PMIC_FROM_BOARD, platform_id, variant_id,
+                                subtype, soc_rev, [0] * 4))
+    return entries
+
+def build_index(blob):
+    dtbs, end = split_dtbs(blob)
+    if end != len(blob):
+        sys.stderr.write('warning: %d trailing bytes after the last DTB\n' % (len(blob) - end))
+    out = b''
+    count = 0
+    for off, dtb in dtbs:
+        for flags, platform_id, variant_id, subtype, soc_rev, pmic_rev in dtb_entries(dtb):
+            out += struct.pack('<11I', off, len(dtb), flags, platform_id, variant_id,
+                               subtype, soc_rev, *pmic_rev)
+            count += 1
+    return struct.pack('<4I', DT_INDEX_MAGIC, DT_INDEX_VERSION, len(dtbs), count) + out
+
+def main():
+    opts, args = getopt.getopt(sys.argv[1:], 'o:')
+    output = None
+    for opt, val in opts:
+        if opt == '-o':
+            output = val
+    if not args or not output:
+        sys.stderr.write(__doc__)
+        return 1
+
+    blob = b''
+    for name in args:
+        with open(name, 'rb') as f:
+            blob += f.read()
+
+    with open(output, 'wb') as f:
+        f.write(build_index(blob))
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -61,6 +61,7 @@
 #include "target/display.h"
 #include "recovery.h"
 #include <ab_partition_parser.h>
+#include <init_graph.h>
 
 #if LONG_PRESS_POWER_ON
 #include <shutdown_detect.h>
@@ -348,21 +349,92 @@ static void target_keystatus()
 		keys_post_event(KEY_VOLUMEUP, 1);
 }
 
+static int target_storage_init(void *arg)
+{
+	target_sdc_init();
+	if (partition_read_table())
+	{
+		dprintf(CRITICAL, "Error reading the partition table info\n");
+		ASSERT(0);
+	}
+
+	return 0;
+}
+
+static int target_qseecom_init(void *arg)
+{
+	clock_ce_enable(CE1_INSTANCE);
+
+	/* Initialize Qseecom */
+	if (qseecom_init() < 0)
+	{
+		dprintf(CRITICAL, "Failed to initialize qseecom\n");
+		ASSERT(0);
+	}
+
+	/* Start Qseecom */
+	if (qseecom_tz_init() < 0)
+	{
+		dprintf(CRITICAL, "Failed to start qseecom\n");
+		ASSERT(0);
+	}
+
+	return 0;
+}
+
+static int target_secapp_init(void *arg)
+{
+	if (rpmb_init() < 0)
+	{
+		dprintf(CRITICAL, "RPMB init failed\n");
+		ASSERT(0);
+	}
+
+	/*
+	 * Load the sec app for first time
+	 */
+	if (load_sec_app() < 0)
+	{
+		dprintf(CRITICAL, "Failed to load App for verified\n");
+		ASSERT(0);
+	}
+
+	return 0;
+}
+
+/* Storage and qseecom come up side by side, rpmb and the sec app need both */
+static struct init_task storage_task = {
+	.name = "storage_init",
+	.run = target_storage_init,
+};
+
+static struct init_task qseecom_task = {
+	.name = "qseecom_init",
+	.run = target_qseecom_init,
+};
+
+static struct init_task secapp_task = {
+	.name = "secapp_init",
+	.run = target_secapp_init,
+	.deps = { &storage_task, &qseecom_task, NULL },
+};
+
 void target_init(void)
 {
 	dprintf(INFO, "target_init()\n");
 
 	spmi_init(PMIC_ARB_CHANNEL_NUM, PMIC_ARB_OWNER_ID);
 
-	target_keystatus();
+	init_task_start(&storage_task);
 
-	target_sdc_init();
-	if (partition_read_table())
+	if (VB_M <= target_get_vb_version())
 	{
-		dprintf(CRITICAL, "Error reading the partition table info\n");
-		ASSERT(0);
+		init_task_start(&qseecom_task);
+		init_task_start(&secapp_task);
 	}
 
+	target_keystatus();
+
 #if LONG_PRESS_POWER_ON
 	if (target_is_pmi_enabled())
 		shutdown_detect();
@@ -377,39 +449,7 @@ void target_init(void)
 	if (target_use_signed_kernel())
 		target_crypto_init_params();
 
-	if (VB_M <= target_get_vb_version())
-	{
-		clock_ce_enable(CE1_INSTANCE);
-
-		/* Initialize Qseecom */
-		if (qseecom_init() < 0)
-		{
-			dprintf(CRITICAL, "Failed to initialize qseecom\n");
-			ASSERT(0);
-		}
-
-		/* Start Qseecom */
-		if (qseecom_tz_init() < 0)
-		{
-			dprintf(CRITICAL, "Failed to start qseecom\n");
-			ASSERT(0);
-		}
-
-		if (rpmb_init() < 0)
-		{
-			dprintf(CRITICAL, "RPMB init failed\n");
-			ASSERT(0);
-		}
-
-		/*
-		 * Load the sec app for first time
-		 */
-		if (load_sec_app() < 0)
-		{
-			dprintf(CRITICAL, "Failed to load App for verified\n");
-			ASSERT(0);
-		}
-	}
+	init_task_join_all();
 
 #if SMD_SUPPORT
 	rpm_smd_init();